@@ -580,9 +580,9 @@ void VProject::FileSystemEventHandler( const std::vector< VFilePath > &inFilePat
 	} 
 	else 
 	{
-		// A file was added, renamed, or deleted.  So we want to resynchronize the containing folder with the file
+		// A file was added, renamed, or deleted.  So we want to resynchronize the containing folders with the file
 		// system.
-		SynchronizeWithFileSystem(GetProjectItem());
+		SynchronizeWithFileSystem( inFilePaths);
 
 		if ((fSolution != NULL) && (fSolution->GetDelegate() != NULL))
 			fSolution->GetDelegate()->SynchronizeFromSolution();
@@ -1153,7 +1153,7 @@ VError VProject::StartWatchingFileSystem()
 
 	fIsWatchingFileSystem = true;
 
-	return VFileSystemNotifier::Instance()->StartWatchingForChanges( folder, VFileSystemNotifier::kAll, this, 100 );
+	return VFileSystemNotifier::Instance()->StartWatchingForChanges( folder, VFileSystemNotifier::kAll, this, kFILE_SYSTEM_EVENTS_LATENCY );
 }
 
 
@@ -1196,6 +1196,24 @@ VError VProject::ReloadCatalogs()
 
 
 VError VProject::SynchronizeWithFileSystem( VProjectItem *inItem)
+{
+	VectorOfProjectItems items( 1, inItem);
+	return _SynchronizeItemsWithFileSystem( items, true);
+}
+
+
+VError VProject::SynchronizeWithFileSystem( const std::vector< VFilePath >& inChangedPaths)
+{
+	VectorOfProjectItems folders;
+	if (_GetFoldersToSynchronize( inChangedPaths, folders))
+		return _SynchronizeItemsWithFileSystem( folders, false);
+
+	// The changes cannot be applied to the tree: the whole project is synchronized
+	return SynchronizeWithFileSystem( fProjectItem);
+}
+
+
+VError VProject::_SynchronizeItemsWithFileSystem( const VectorOfProjectItems& inItems, bool inRecursive)
 {
 	VError err = VE_OK;
 
@@ -1204,7 +1222,8 @@ VError VProject::SynchronizeWithFileSystem( VProjectItem *inItem)
 
 	VProjectFileStampSaver stampSaver(this);
 	
-	err = _SynchronizeWithFileSystem( inItem);
+	for (VectorOfProjectItemsConstIterator iter = inItems.begin() ; iter != inItems.end() && err == VE_OK ; ++iter)
+		err = _SynchronizeWithFileSystem( *iter, inRecursive);
 
 	// Reprocess the files in the project so that the symbol table stays in sync.
 	BackgroundParseFiles();
@@ -1248,14 +1267,13 @@ void VProject::RegisterProjectItemInMapOfFullPathes(VProjectItem* inProjectItem)
 		VString strProjectItemFullPath = filePath.GetPath();
 		if (!strProjectItemFullPath.IsEmpty())
 		{
-		#if VERSION_LINUX
-			// sc & jmo 07/07/2011, WAK0072129
-			PathBuffer tmpBuf;
-			VError verr = tmpBuf.Init( strProjectItemFullPath, PathBuffer::withRealPath);
-			verr = tmpBuf.ToPath( &strProjectItemFullPath);
-		#endif
+			// the path may have been resolved while the item did not exist yet
+			_ForgetCanonicalPath( strProjectItemFullPath);
+
+			VString canonicalPath;
+			_GetCanonicalPath( strProjectItemFullPath, canonicalPath);
 
-			fMapFullPathProjectItem[strProjectItemFullPath] = inProjectItem;
+			fMapFullPathProjectItem[canonicalPath] = inProjectItem;
 		}
 		else
 		{
@@ -1286,14 +1304,20 @@ void VProject::UnregisterProjectItemFromMapOfFullPathes(VProjectItem* inProjectI
 		VString strProjectItemFullPath = filePath.GetPath();
 		if (!strProjectItemFullPath.IsEmpty())
 		{
-			VProjectItem* projectItem = GetProjectItemFromFullPath(strProjectItemFullPath);
-			if (projectItem)
+			VString canonicalPath;
+			_GetCanonicalPath( strProjectItemFullPath, canonicalPath);
+
+			MapFullPathProjectItem::iterator found = fMapFullPathProjectItem.find( canonicalPath);
+			if (found != fMapFullPathProjectItem.end())
 			{
 #if RIA_STUDIO
-				RemoveProjectItemFromSymbolTable( projectItem );
+				RemoveProjectItemFromSymbolTable( found->second );
 #endif
-				fMapFullPathProjectItem.erase(strProjectItemFullPath);
+				fMapFullPathProjectItem.erase( found);
 			}
+
+			// the item has been deleted or renamed
+			_ForgetCanonicalPath( strProjectItemFullPath);
 		}
 		else
 			assert(false);
@@ -1309,18 +1333,50 @@ VProjectItem* VProject::GetProjectItemFromFilePath( const XBOX::VFilePath& inPat
 
 VProjectItem* VProject::GetProjectItemFromFullPath( const VString& inFullPath) const
 {
-	VString fullPath( inFullPath);
+	VString fullPath;
+	_GetCanonicalPath( inFullPath, fullPath);
 
+	MapFullPathProjectItem::const_iterator i = fMapFullPathProjectItem.find(fullPath);
+
+	return (i == fMapFullPathProjectItem.end()) ? NULL : i->second;
+}
+
+
+void VProject::_GetCanonicalPath( const VString& inFullPath, VString& outCanonicalPath) const
+{
 #if VERSION_LINUX
+	{
+		VTaskLock lock( &fCanonicalPathesMutex);
+		unordered_map_VString< VString >::const_iterator found = fCanonicalPathes.find( inFullPath);
+		if (found != fCanonicalPathes.end())
+		{
+			outCanonicalPath = found->second;
+			return;
+		}
+	}
+
 	// sc & jmo 07/07/2011, WAK0072129
+	outCanonicalPath = inFullPath;
 	PathBuffer tmpBuf;
-	VError verr = tmpBuf.Init( fullPath, PathBuffer::withRealPath);
-	verr = tmpBuf.ToPath( &fullPath);
+	VError verr = tmpBuf.Init( outCanonicalPath, PathBuffer::withRealPath);
+	verr = tmpBuf.ToPath( &outCanonicalPath);
+
+	VTaskLock lock( &fCanonicalPathesMutex);
+	if (fCanonicalPathes.size() >= kMAX_CANONICAL_PATHES_CACHE_SIZE)
+		fCanonicalPathes.clear();
+	fCanonicalPathes[inFullPath] = outCanonicalPath;
+#else
+	outCanonicalPath = inFullPath;
 #endif
+}
 
-	MapFullPathProjectItem::const_iterator i = fMapFullPathProjectItem.find(fullPath);
 
-	return (i == fMapFullPathProjectItem.end()) ? NULL : i->second;
+void VProject::_ForgetCanonicalPath( const VString& inFullPath)
+{
+#if VERSION_LINUX
+	VTaskLock lock( &fCanonicalPathesMutex);
+	fCanonicalPathes.erase( inFullPath);
+#endif
 }
 
 
@@ -1843,7 +1899,7 @@ VProjectItem* VProject::ReferenceExternalFolder( XBOX::VError& outError, VProjec
 					if ((fSolution != NULL) && (fSolution->GetDelegate() != NULL))
 						fSolution->GetDelegate()->DoStartPossibleLongTimeOperation();
 
-					if (_SynchronizeWithFileSystem( result) == VE_OK)
+					if (_SynchronizeWithFileSystem( result, true) == VE_OK)
 						BackgroundParseFiles();
 					
 					if ((fSolution != NULL) && (fSolution->GetDelegate() != NULL))
@@ -1984,7 +2040,7 @@ XBOX::VError VProject::RemoveItems( const VectorOfProjectItems& inProjectItems,
 			if ((fSolution != NULL) && (fSolution->GetDelegate() != NULL))
 				fSolution->GetDelegate()->DoStartPossibleLongTimeOperation();
 
-			if (_SynchronizeWithFileSystem( firstCommonParent) == VE_OK)
+			if (_SynchronizeWithFileSystem( firstCommonParent, true) == VE_OK)
 				BackgroundParseFiles();
 						
 			if ((fSolution != NULL) && (fSolution->GetDelegate() != NULL))
@@ -2076,7 +2132,38 @@ void VProject::_SetProjectFileItem( VProjectItem* inProjectItem)
 }
 
 
-VError VProject::_SynchronizeWithFileSystem( VProjectItem *inItem)
+class VProjectFolderLookup : public IProjectItemFolderLookup
+{
+public:
+	VProjectFolderLookup( const VProject& inProject) : fProject( inProject) {}
+
+	VProjectItem* GetProjectItemFromFilePath( const VFilePath& inPath) const
+	{
+		return fProject.GetProjectItemFromFilePath( inPath);
+	}
+
+	bool IsFolderSynchronizedByOwner( VProjectItem *inFolderItem) const
+	{
+		return true;
+	}
+
+private:
+	const VProject&	fProject;
+};
+
+
+bool VProject::_GetFoldersToSynchronize( const std::vector< VFilePath >& inChangedPaths, VectorOfProjectItems& outFolders) const
+{
+	VFilePath projectFolderPath;
+	if (!GetProjectFolderPath( projectFolderPath))
+		return false;
+
+	VProjectFolderLookup lookup( *this);
+	return VProjectItemTools::GetFoldersToSynchronize( projectFolderPath, inChangedPaths, lookup, outFolders);
+}
+
+
+VError VProject::_SynchronizeWithFileSystem( VProjectItem *inItem, bool inRecursive)
 {
 	VError err = VE_OK;
 
@@ -2113,9 +2200,9 @@ VError VProject::_SynchronizeWithFileSystem( VProjectItem *inItem)
 			{
 				deletedItems.push_back( iter);
 			}
-			else
+			else if (inRecursive)
 			{
-				err = _SynchronizeWithFileSystem( iter);
+				err = _SynchronizeWithFileSystem( iter, true);
 			}
 		}
 	}
@@ -2177,7 +2264,7 @@ VError VProject::_SynchronizeWithFileSystem( VProjectItem *inItem)
 
 								_DoItemAdded( folderItem, true);
 
-								err = _SynchronizeWithFileSystem( folderItem);
+								err = _SynchronizeWithFileSystem( folderItem, true);
 							}
 						}
 					}
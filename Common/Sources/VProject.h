@@ -83,6 +83,9 @@ public:
 	// creation du projet depuis le template
 	// ---------------------------------------
 	XBOX::VError				SynchronizeWithFileSystem( VProjectItem *inItem);
+	/**	@brief	Synchronize only the folders which contain the changed paths. The whole project is synchronized
+				if the paths cannot be applied to the tree, typically when the notifier reports the project folder itself. */
+	XBOX::VError				SynchronizeWithFileSystem( const std::vector< XBOX::VFilePath >& inChangedPaths);
 
 	// ---------------------------------------
 	// accesseurs directs sur fichier catalog, project...
@@ -157,7 +160,15 @@ private:
 			/**	@brief	Set the item of the project file. The project item is retained. */
 			void				_SetProjectFileItem( VProjectItem* inProjectItem);
 
-			XBOX::VError		_SynchronizeWithFileSystem( VProjectItem *inItem);
+			/**	@brief	If inRecursive is false, only the children of the item are synchronized. The new folders are always synchronized recursively. */
+			XBOX::VError		_SynchronizeWithFileSystem( VProjectItem *inItem, bool inRecursive);
+			XBOX::VError		_SynchronizeItemsWithFileSystem( const VectorOfProjectItems& inItems, bool inRecursive);
+			/**	@brief	Returns the existing folders which contain the changed paths, the deepest first. Returns false if a full synchronization is required. */
+			bool				_GetFoldersToSynchronize( const std::vector< XBOX::VFilePath >& inChangedPaths, VectorOfProjectItems& outFolders) const;
+
+			/**	@brief	Returns the path used as key of the map of full pathes. On Linux, the real path is resolved once and cached. */
+			void				_GetCanonicalPath( const XBOX::VString& inFullPath, XBOX::VString& outCanonicalPath) const;
+			void				_ForgetCanonicalPath( const XBOX::VString& inFullPath);
 			
 			/**	@brief	Add the item to the VProject internal containers. */
 			void				_DoItemAdded( VProjectItem *inItem, bool inTouchProjectFile);
@@ -199,6 +210,11 @@ private:
 	// ---------------------------------------
 	// toutes les formulations utiles en interne
 	MapFullPathProjectItem		fMapFullPathProjectItem;
+#if VERSION_LINUX
+	// cache of the real pathes resolved by _GetCanonicalPath()
+	mutable XBOX::unordered_map_VString< XBOX::VString >	fCanonicalPathes;
+	mutable XBOX::VCriticalSection							fCanonicalPathesMutex;
+#endif
 
 	VectorOfProjectItems		fReferencedItems;
 
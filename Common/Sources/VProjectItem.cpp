@@ -27,6 +27,10 @@
 USING_TOOLBOX_NAMESPACE
 
 
+// Above this count of changed paths, the tree is synchronized as a whole
+static const size_t kMAX_INCREMENTAL_SYNCHRONIZATION_PATHS = 256;
+
+
 #if VERSIONDEBUG
 sLONG VProjectItem::sNbProjectItem = 0;
 #endif
@@ -93,6 +97,8 @@ VProjectItem::VProjectItem(e_ProjectItemKind inKind)
 ,fProjectItemSolutionOwner(NULL)
 ,fLevel(0)
 ,fExternalReference(false)
+,fChildrenIndexValid(false)
+,fChildrenIndexHasDuplicates(false)
 ,fPhysicalLinkValid(true)
 ,fGhost(false)
 ,fUserData(NULL)
@@ -117,6 +123,8 @@ VProjectItem::VProjectItem(const VURL& inURL, e_ProjectItemKind inKind)
 ,fProjectItemSolutionOwner(NULL)
 ,fLevel(0)
 ,fExternalReference(false)
+,fChildrenIndexValid(false)
+,fChildrenIndexHasDuplicates(false)
 ,fPhysicalLinkValid(true)
 ,fGhost(false)
 ,fUserData(NULL)
@@ -143,6 +151,8 @@ VProjectItem::VProjectItem( VProjectItemBehaviour *inBehaviour)
 ,fProjectItemSolutionOwner(NULL)
 ,fLevel(0)
 ,fExternalReference(false)
+,fChildrenIndexValid(false)
+,fChildrenIndexHasDuplicates(false)
 ,fPhysicalLinkValid(true)
 ,fGhost(false)
 ,fUserData(NULL)
@@ -352,10 +362,33 @@ uLONG VProjectItem::GetStamp() const
 }
 
 
+void VProjectItem::SetExternalReference( bool inExternalReference)
+{
+	if (fParent != NULL)
+		fParent->_UnindexChild( this);
+
+	fExternalReference = inExternalReference;
+
+	if (fParent != NULL)
+		fParent->_IndexChild( this);
+}
+
+
 void VProjectItem::SetURL( const XBOX::VURL& inURL)
 {
 	if (testAssert(fRelativePath.IsEmpty()))
+	{
+		if (fParent != NULL)
+			fParent->_UnindexChild( this);
+
 		fURL = inURL;
+
+		if (fParent != NULL)
+			fParent->_IndexChild( this);
+
+		// the keys of the descendants which are built from their file path depend on this URL
+		_InvalidateChildrenIndexes();
+	}
 }
 
 
@@ -398,7 +431,16 @@ void VProjectItem::SetRelativePath( const XBOX::VString& inRelativePath, XBOX::E
 		if (inStyle != eURL_POSIX_STYLE)
 			VURL::Convert( relativePath, inStyle, eURL_POSIX_STYLE, true);
 
+		if (fParent != NULL)
+			fParent->_UnindexChild( this);
+
 		fRelativePath = relativePath;
+
+		if (fParent != NULL)
+			fParent->_IndexChild( this);
+
+		// the keys of the descendants which are built from their file path depend on this path
+		_InvalidateChildrenIndexes();
 	}
 }
 
@@ -495,31 +537,166 @@ VProjectItem* VProjectItem::FindChildByRelativePath( const XBOX::VString& inRela
 {
 	VProjectItem *found = NULL;
 
+	if (!fChildrenIndexValid)
+		_BuildChildrenIndex();
+
+	VString key( inRelativePath);
+	if (inStyle != eURL_POSIX_STYLE)
+		VURL::Convert( key, inStyle, eURL_POSIX_STYLE, true);
+
+	if (!_MakeChildIndexKey( key))
+		return _FindChildByRelativePath( inRelativePath, inStyle);
+
+	XBOX::unordered_map_VString< VProjectItem* >::const_iterator iter = fChildrenIndex.find( key);
+	if (iter != fChildrenIndex.end())
+	{
+		// the relative paths are compared as before, the index is only a shortcut
+		VString relativePath;
+		if (_GetChildRelativePath( iter->second, inStyle, relativePath) && (relativePath == inRelativePath))
+			found = iter->second;
+	}
+
+	for (VectorOfProjectItems::const_iterator it = fChildrenNotIndexed.begin() ; it != fChildrenNotIndexed.end() ; ++it)
+	{
+		VString relativePath;
+		if (_GetChildRelativePath( *it, inStyle, relativePath) && (relativePath == inRelativePath))
+		{
+			// only the order of the children list tells which child the linear search returns
+			return _FindChildByRelativePath( inRelativePath, inStyle);
+		}
+	}
+
+	return found;
+}
+
+
+VProjectItem* VProjectItem::_FindChildByRelativePath( const XBOX::VString& inRelativePath, XBOX::EURLPathStyle inStyle) const
+{
+	VProjectItem *found = NULL;
+
 	for (ListOfProjectItemConstIterator iter = fChildren.begin() ; (iter != fChildren.end()) && (found == NULL) ; ++iter)
 	{
-		if (!(*iter)->IsExternalReference())
+		VString relativePath;
+		if (_GetChildRelativePath( *iter, inStyle, relativePath) && (relativePath == inRelativePath))
+			found = *iter;
+	}
+
+	return found;
+}
+
+
+void VProjectItem::_BuildChildrenIndex() const
+{
+	fChildrenIndex.clear();
+	fChildrenNotIndexed.clear();
+	fChildrenIndexHasDuplicates = false;
+
+	for (ListOfProjectItemConstIterator iter = fChildren.begin() ; iter != fChildren.end() ; ++iter)
+	{
+		VString key;
+		if (_GetChildRelativePath( *iter, eURL_POSIX_STYLE, key))
 		{
-			VString relativePath;
-			(*iter)->GetRelativePath( relativePath, inStyle);
+			if (!_MakeChildIndexKey( key))
+				fChildrenNotIndexed.push_back( *iter);
+			// the first child wins as with a linear search
+			else if (!fChildrenIndex.insert( std::make_pair( key, *iter)).second)
+				fChildrenIndexHasDuplicates = true;
+		}
+	}
+
+	fChildrenIndexValid = true;
+}
+
 
-			if (relativePath.IsEmpty())
+bool VProjectItem::_GetChildRelativePath( const VProjectItem *inChild, XBOX::EURLPathStyle inStyle, XBOX::VString& outRelativePath) const
+{
+	if (inChild->IsExternalReference())
+		return false;
+
+	inChild->GetRelativePath( outRelativePath, inStyle);
+
+	if (outRelativePath.IsEmpty())
+	{
+		VFilePath parentPath, childPath;
+		if (GetFilePath( parentPath) && inChild->GetFilePath( childPath))
+		{
+			if (childPath.GetRelativePath( parentPath, outRelativePath))
 			{
-				VFilePath parentPath, childPath;
-				if (GetFilePath( parentPath) && (*iter)->GetFilePath( childPath))
-				{
-					if (childPath.GetRelativePath( parentPath, relativePath))
-					{
-						VURL::Convert( relativePath, eURL_NATIVE_STYLE, inStyle, true);
-					}
-				}
+				VURL::Convert( outRelativePath, eURL_NATIVE_STYLE, inStyle, true);
 			}
+		}
+	}
+	return true;
+}
+
 
-			if (relativePath == inRelativePath)
-				found = *iter;
+bool VProjectItem::_MakeChildIndexKey( XBOX::VString& ioKey)
+{
+	// VString comparison ignores the case and the diacritics: only ASCII pathes have a key which matches it
+	const UniChar *p = ioKey.GetCPointer();
+	for (VIndex i = ioKey.GetLength() ; i > 0 ; --i, ++p)
+	{
+		if (*p > 127)
+			return false;
+	}
+
+	ioKey.ToLowerCase();
+	return true;
+}
+
+
+void VProjectItem::_IndexChild( VProjectItem *inChild) const
+{
+	if (fChildrenIndexValid)
+	{
+		VString key;
+		if (_GetChildRelativePath( inChild, eURL_POSIX_STYLE, key))
+		{
+			if (!_MakeChildIndexKey( key))
+				fChildrenNotIndexed.push_back( inChild);
+			// another child owns the key: only a rebuild keeps the order of the children list
+			else if (!fChildrenIndex.insert( std::make_pair( key, inChild)).second)
+				fChildrenIndexValid = false;
 		}
 	}
+}
 
-	return found;
+
+void VProjectItem::_UnindexChild( VProjectItem *inChild) const
+{
+	if (fChildrenIndexValid)
+	{
+		VString key;
+		if (_GetChildRelativePath( inChild, eURL_POSIX_STYLE, key))
+		{
+			// the key of the child may have changed without notice, and another child may be waiting for the key
+			if (!_MakeChildIndexKey( key))
+			{
+				VectorOfProjectItems::iterator found = std::find( fChildrenNotIndexed.begin(), fChildrenNotIndexed.end(), inChild);
+				if (found == fChildrenNotIndexed.end())
+					fChildrenIndexValid = false;
+				else
+					fChildrenNotIndexed.erase( found);
+			}
+			else
+			{
+				XBOX::unordered_map_VString< VProjectItem* >::iterator found = fChildrenIndex.find( key);
+				if (fChildrenIndexHasDuplicates || (found == fChildrenIndex.end()) || (found->second != inChild))
+					fChildrenIndexValid = false;
+				else
+					fChildrenIndex.erase( found);
+			}
+		}
+	}
+}
+
+
+void VProjectItem::_InvalidateChildrenIndexes() const
+{
+	fChildrenIndexValid = false;
+
+	for (ListOfProjectItemConstIterator iter = fChildren.begin() ; iter != fChildren.end() ; ++iter)
+		(*iter)->_InvalidateChildrenIndexes();
 }
 
 
@@ -892,6 +1069,7 @@ VProjectItem* VProjectItem::NewChild(e_ProjectItemKind inKind)
 		projectItem->SetParent(this);
 		projectItem->SetLevel(fLevel + 1); 
 		fChildren.push_back(projectItem);
+		_IndexChild( projectItem);
 
 		Touch();
 	}
@@ -917,6 +1095,7 @@ VProjectItem* VProjectItem::NewChild(const XBOX::VURL& inURL, e_ProjectItemKind
 	}
 
 	fChildren.push_back(projectItem);
+	_IndexChild( projectItem);
 
 	Touch();
 
@@ -955,6 +1134,11 @@ void VProjectItem::AttachChild(VProjectItem* inChildProjectItem)
 	inChildProjectItem->SetLevel(fLevel + 1); 
 
 	fChildren.push_back(inChildProjectItem);
+	_IndexChild( inChildProjectItem);
+
+	// the file pathes of the descendants of a moved item have changed
+	if (inChildProjectItem->HasChildren())
+		inChildProjectItem->_InvalidateChildrenIndexes();
 
 	Touch();
 }
@@ -963,6 +1147,7 @@ void VProjectItem::DetachChild(VProjectItem* inChildProjectItem)
 {
 	if (inChildProjectItem != NULL)
 	{
+		_UnindexChild( inChildProjectItem);
 		fChildren.remove(inChildProjectItem);
 		inChildProjectItem->SetParent(NULL);
 
@@ -1755,6 +1940,73 @@ VProjectItem* VProjectItemTools::GetFirstCommonParent( const VectorOfProjectItem
 }
 
 
+bool VProjectItemTools::GetFoldersToSynchronize( const VFilePath& inRootFolderPath, const std::vector< VFilePath >& inChangedPaths, const IProjectItemFolderLookup& inLookup, VectorOfProjectItems& outFolders)
+{
+	// A large batch of changes is cheaper to handle with a single recursive synchronization.
+	// It is also the only overflow hint we get: the file system notifier does not report the events it has dropped.
+	if (inChangedPaths.size() > kMAX_INCREMENTAL_SYNCHRONIZATION_PATHS)
+		return false;
+
+	std::map< VFilePath, VProjectItem* > resolvedFolders;		// parent folder of a changed path -> folder to synchronize
+	std::set< VProjectItem* > folders;
+	std::multimap< VIndex, VProjectItem*, std::greater<VIndex> > foldersByDepth;
+
+	for (std::vector< VFilePath >::const_iterator iter = inChangedPaths.begin() ; iter != inChangedPaths.end() ; ++iter)
+	{
+		// A change reported on the root folder itself cannot be located in the tree
+		VFilePath changedPath( *iter);
+		if (changedPath.IsFile())
+			changedPath = changedPath.ToFolder();
+		if (changedPath == inRootFolderPath)
+			return false;
+
+		VFilePath parentPath;
+		if (!iter->GetParent( parentPath))
+			return false;
+
+		if (resolvedFolders.find( parentPath) != resolvedFolders.end())
+			continue;
+
+		// Look for the nearest folder which is known by the owner and which still exists: a deleted folder is synchronized by its parent
+		VProjectItem *folderItem = NULL;
+		VFilePath folderPath( parentPath);
+		bool hasFolder = true;
+		while (hasFolder && folderItem == NULL)
+		{
+			VProjectItem *item = inLookup.GetProjectItemFromFilePath( folderPath);
+			if ((item != NULL) && item->IsPhysicalFolder() && !item->IsGhost() && item->ContentExists())
+			{
+				folderItem = item;
+			}
+			else
+			{
+				VFilePath path;
+				hasFolder = folderPath.GetParent( path);
+				folderPath = path;
+			}
+		}
+
+		// The path is outside of the tree
+		if (folderItem == NULL)
+			return false;
+
+		if (!inLookup.IsFolderSynchronizedByOwner( folderItem))
+			folderItem = NULL;
+
+		resolvedFolders[parentPath] = folderItem;
+
+		if ((folderItem != NULL) && folders.insert( folderItem).second)
+			foldersByDepth.insert( std::make_pair( folderPath.GetPath().GetLength(), folderItem));
+	}
+
+	// The deepest folders are synchronized first: the synchronization of a folder may delete its descendants
+	for (std::multimap< VIndex, VProjectItem*, std::greater<VIndex> >::iterator folderIter = foldersByDepth.begin() ; folderIter != foldersByDepth.end() ; ++folderIter)
+		outFolders.push_back( folderIter->second);
+
+	return true;
+}
+
+
 
 // ----------------------------------------------------------------------------
 // VProjectItemTagManager (SC)
@@ -126,7 +126,7 @@ public:
 
 			XBOX::VValueBag*			GetBag() const										{ return fBag; }
 
-			void						SetExternalReference( bool inExternalReference)		{ fExternalReference = inExternalReference; }
+			void						SetExternalReference( bool inExternalReference);
 			bool						IsExternalReference() const							{ return fExternalReference; }
 
 			/**	@brief	The physical link is valid when the physical item exists.
@@ -282,7 +282,20 @@ protected:
 	
 	ListOfProjectItem fChildren;
 
+	// index of the children by relative path, updated with the children list and rebuilt on demand when a change cannot be applied in place
+	mutable XBOX::unordered_map_VString< VProjectItem* >	fChildrenIndex;
+	mutable VectorOfProjectItems							fChildrenNotIndexed;	// children with a non ASCII path, compared one by one
+	mutable bool											fChildrenIndexValid;
+	mutable bool											fChildrenIndexHasDuplicates;
+
 private:
+			void					_BuildChildrenIndex() const;
+			VProjectItem*			_FindChildByRelativePath( const XBOX::VString& inRelativePath, XBOX::EURLPathStyle inStyle) const;
+			bool					_GetChildRelativePath( const VProjectItem *inChild, XBOX::EURLPathStyle inStyle, XBOX::VString& outRelativePath) const;
+	static	bool					_MakeChildIndexKey( XBOX::VString& ioKey);
+			void					_IndexChild( VProjectItem *inChild) const;
+			void					_UnindexChild( VProjectItem *inChild) const;
+			void					_InvalidateChildrenIndexes() const;
 			
 			void					_CreateItemBehaviour( e_ProjectItemKind inKind);
 
@@ -509,6 +522,21 @@ inline sLONG VProjectItem::GetCountChildren() const
 
 
 
+// ----------------------------------------------------------------------------
+// Project items lookup used to map the file system changes onto a project items tree
+
+class IProjectItemFolderLookup
+{
+public:
+			/** @brief	Returns the item which is referenced by the path or NULL. */
+	virtual	VProjectItem*			GetProjectItemFromFilePath( const XBOX::VFilePath& inPath) const = 0;
+
+			/** @brief	Returns false if the synchronization of the folder belongs to another owner. */
+	virtual	bool					IsFolderSynchronizedByOwner( VProjectItem *inFolderItem) const = 0;
+};
+
+
+
 // ----------------------------------------------------------------------------
 // Project items static utilities
 
@@ -525,6 +553,10 @@ public:
 	static	void					GetChildFile( VProjectItem *inProjectItem, VectorOfProjectItems& ioChildren, bool inRecursive);
 
 	static	VProjectItem*			GetFirstCommonParent( const VectorOfProjectItems &inProjectItems);
+
+			/** @brief	Returns the folders to synchronize non recursively for the changed paths, deepest first.
+						Returns false if the changes cannot be applied incrementally and the whole tree must be synchronized. */
+	static	bool					GetFoldersToSynchronize( const XBOX::VFilePath& inRootFolderPath, const std::vector< XBOX::VFilePath >& inChangedPaths, const IProjectItemFolderLookup& inLookup, VectorOfProjectItems& outFolders);
 };
 
 
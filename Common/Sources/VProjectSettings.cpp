@@ -295,6 +295,34 @@ sLONG VProjectSettings::GetLogMaxSize() const
 }
 
 
+bool VProjectSettings::GetLogRequestTimings() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::http);
+	bool result = RIASettingsKeys::HTTP::logRequestTimings.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+void VProjectSettings::GetMetricsPattern( XBOX::VString& outPattern) const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::http);
+	outPattern = RIASettingsKeys::HTTP::metricsPattern.Get( bag);
+	ReleaseRefCountable( &bag);
+}
+
+
+void VProjectSettings::GetMetricsAllowedAddresses( XBOX::VectorOfVString& outAddresses) const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::http);
+	VString addresses = RIASettingsKeys::HTTP::metricsAllowedAddresses.Get( bag);
+	ReleaseRefCountable( &bag);
+
+	outAddresses.clear();
+	addresses.GetSubStrings( CHAR_COMMA, outAddresses, false, true);
+}
+
+
 bool VProjectSettings::GetAllowCompression() const
 {
 	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
@@ -479,6 +507,69 @@ sLONG VProjectSettings::GetContextPoolSize() const
 }
 
 
+sLONG VProjectSettings::GetSpareContextsLowWaterMark() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	sLONG result = RIASettingsKeys::JavaScript::spareContextsLowWaterMark.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+sLONG VProjectSettings::GetSpareContextsHighWaterMark() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	sLONG result = RIASettingsKeys::JavaScript::spareContextsHighWaterMark.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+bool VProjectSettings::GetUseScriptsCache() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	bool result = RIASettingsKeys::JavaScript::scriptsCache.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+sLONG VProjectSettings::GetGarbageCollectMemoryBudget() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	sLONG result = RIASettingsKeys::JavaScript::gcMemoryBudget.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+sLONG VProjectSettings::GetGarbageCollectRequestsBudget() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	sLONG result = RIASettingsKeys::JavaScript::gcRequestsBudget.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+sLONG VProjectSettings::GetGarbageCollectPauseBudget() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	sLONG result = RIASettingsKeys::JavaScript::gcPauseBudget.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
+bool VProjectSettings::GetLazyDataStore() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
+	bool result = RIASettingsKeys::JavaScript::lazyDataStore.Get( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
 bool VProjectSettings::GetEnableJavaScriptDebugger() const
 {
 	const VValueBag *bag = RetainSettings( RIASettingID::javaScript);
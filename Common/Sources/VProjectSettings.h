@@ -82,6 +82,12 @@ public:
 
 			sLONG					GetLogMaxSize() const;
 
+			bool					GetLogRequestTimings() const;
+
+			void					GetMetricsPattern( XBOX::VString& outPattern) const;
+
+			void					GetMetricsAllowedAddresses( XBOX::VectorOfVString& outAddresses) const;
+
 			bool					GetAllowCompression() const;
 
 			sLONG					GetCompressionMinThreshold() const;
@@ -115,6 +121,24 @@ public:
 
 			sLONG					GetContextPoolSize() const;
 
+			sLONG					GetSpareContextsLowWaterMark() const;
+
+			sLONG					GetSpareContextsHighWaterMark() const;
+
+			bool					GetUseScriptsCache() const;
+
+			/** @brief	Process memory growth in megabytes which triggers the garbage collection of the contexts */
+			sLONG					GetGarbageCollectMemoryBudget() const;
+
+			/** @brief	Count of requests handled by a context which triggers its garbage collection */
+			sLONG					GetGarbageCollectRequestsBudget() const;
+
+			/** @brief	Maximum time in milliseconds spent to collect idle contexts at each scheduler pass, at least 1 millisecond */
+			sLONG					GetGarbageCollectPauseBudget() const;
+
+			/** @brief	If true, the datastore and the entity models are bound to a JavaScript context on first access to "ds" */
+			bool					GetLazyDataStore() const;
+
 			bool					GetEnableJavaScriptDebugger() const;
 
 			// Services settings accessors
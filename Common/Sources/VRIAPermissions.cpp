@@ -23,58 +23,148 @@ USING_TOOLBOX_NAMESPACE
 
 
 
-class VRIAPermissionsSearch : public XBOX::VObject
+namespace RIAPermissionsKeys
+{
+	CREATE_BAGKEY( allow);
+	CREATE_BAGKEY( resource);
+	CREATE_BAGKEY( type);
+	CREATE_BAGKEY( action);
+	CREATE_BAGKEY( groupID);
+	CREATE_BAGKEY( groupName);
+}
+
+
+
+// ----------------------------------------------------------------------------
+// VRIAPermissionsSnapshot class : immutable compiled permissions
+// The permissions are indexed on (type, resource, action) and the group IDs are parsed once.
+
+
+
+class VRIAPermissionsSnapshot : public XBOX::VObject, public XBOX::IRefCountable
 {
 public:
-			VRIAPermissionsSearch( const VString& inType, const VString& inResource, const VString& inAction) : fType(inType), fResource(inResource), fAction(inAction) {;}
-	virtual	~VRIAPermissionsSearch() {;}
+	typedef struct
+	{
+		VString		fType;
+		VString		fResource;
+		VString		fAction;
+		bool		fHasGroupID;
+		VUUID		fGroupID;
+	} CompiledPermission;
+
+			VRIAPermissionsSnapshot()
+			{
+			}
 
-			bool operator() ( VRefPtr<VValueBag> inPermission)
+			VRIAPermissionsSnapshot( const std::vector< VRefPtr<VValueBag> >& inPermissions)
+			: fPermissions(inPermissions)
 			{
-				VString resource, type, action;
-				
-				inPermission->GetString( RIAPermissionsKeys::type, type);
-				if (!fType.EqualToString( type, true))
-					return false;
+				fCompiledPermissions.resize( fPermissions.size());
+
+				for (size_t pos = 0 ; pos < fPermissions.size() ; ++pos)
+				{
+					CompiledPermission& permission = fCompiledPermissions[pos];
+					VString groupID;
+
+					fPermissions[pos]->GetString( RIAPermissionsKeys::type, permission.fType);
+					fPermissions[pos]->GetString( RIAPermissionsKeys::resource, permission.fResource);
+					fPermissions[pos]->GetString( RIAPermissionsKeys::action, permission.fAction);
+
+					permission.fHasGroupID = fPermissions[pos]->GetString( RIAPermissionsKeys::groupID, groupID);
+					if (permission.fHasGroupID)
+						permission.fGroupID.FromString( groupID);
 
-				inPermission->GetString( RIAPermissionsKeys::resource, resource);
-				if (!fResource.EqualToString( resource, true))
-					return false;
+					// The first permission wins, as with a linear search
+					fIndex.insert( MapOfPermissionIndex::value_type( PermissionKey( permission.fType, permission.fResource, permission.fAction), pos));
+				}
+			}
 
-				inPermission->GetString( RIAPermissionsKeys::action, action);
-				if (!fAction.EqualToString( action, true))
-					return false;
+	virtual	~VRIAPermissionsSnapshot()
+			{
+			}
 
-				return true;
+			/** @brief	returns the position of the first permission which matches, or -1 */
+			sLONG	Find( const VString& inType, const VString& inResource, const VString& inAction) const
+			{
+				MapOfPermissionIndex::const_iterator found = fIndex.find( PermissionKey( inType, inResource, inAction));
+				return (found != fIndex.end()) ? (sLONG) found->second : -1;
 			}
+
+			const std::vector< VRefPtr<VValueBag> >&	GetPermissions() const
+			{
+				return fPermissions;
+			}
+
+			const CompiledPermission&	GetCompiledPermission( sLONG inPos) const
+			{
+				return fCompiledPermissions[inPos];
+			}
+
 private:
-			VString		fType;
-			VString		fResource;
-			VString		fAction;
+	/** @brief	The key references the strings of a compiled permission or the strings of a lookup */
+	class PermissionKey
+	{
+	public:
+			PermissionKey( const VString& inType, const VString& inResource, const VString& inAction)
+			: fType(&inType), fResource(&inResource), fAction(&inAction)
+			{
+			}
+
+			const VString	*fType;
+			const VString	*fResource;
+			const VString	*fAction;
+	};
+
+	/** @brief	The keys are ordered with the same diacritical collation which was used to compare the permissions, so that
+				the strings which compare equal always find each other. A hash of the raw characters would not be consistent
+				with the collation, which may consider different characters sequences as equal. */
+	class PermissionKeyLess
+	{
+	public:
+			bool operator()( const PermissionKey& inKey1, const PermissionKey& inKey2) const
+			{
+				CompareResult result = inKey1.fType->CompareToString( *inKey2.fType, true);
+				if (result == CR_EQUAL)
+					result = inKey1.fResource->CompareToString( *inKey2.fResource, true);
+				if (result == CR_EQUAL)
+					result = inKey1.fAction->CompareToString( *inKey2.fAction, true);
+				return result == CR_SMALLER;
+			}
+	};
+
+	typedef std::map< PermissionKey, size_t, PermissionKeyLess >	MapOfPermissionIndex;
+
+	// the index references the compiled permissions strings
+			VRIAPermissionsSnapshot( const VRIAPermissionsSnapshot&);
+			VRIAPermissionsSnapshot& operator=( const VRIAPermissionsSnapshot&);
+
+			std::vector< VRefPtr<VValueBag> >	fPermissions;
+			std::vector< CompiledPermission >	fCompiledPermissions;
+			MapOfPermissionIndex				fIndex;
 };
 
 
 
-namespace RIAPermissionsKeys
-{
-	CREATE_BAGKEY( allow);
-	CREATE_BAGKEY( resource);
-	CREATE_BAGKEY( type);
-	CREATE_BAGKEY( action);
-	CREATE_BAGKEY( groupID);
-	CREATE_BAGKEY( groupName);
-}
+// ----------------------------------------------------------------------------
 
 
 
 VRIAPermissions::VRIAPermissions( const XBOX::VFilePath& inPath)
 : fPath(inPath)
+, fSnapshot(NULL)
+, fWatchingFileChanges(false)
+, fStamp(0)
 {
+	fSnapshot = new VRIAPermissionsSnapshot();
 }
 
 
 VRIAPermissions::~VRIAPermissions()
 {
+	xbox_assert(!fWatchingFileChanges);
+
+	ReleaseRefCountable( &fSnapshot);
 }
 
 
@@ -90,81 +180,136 @@ VError VRIAPermissions::LoadPermissionFile( VFolder* inDTDsFolder)
 
 	return err;
 }
-	
 
-const VValueBag* VRIAPermissions::RetainResourcePermission( const VString& inType, const VString& inResource, const VString& inAction)
-{
-	if (inType.IsEmpty() || inResource.IsEmpty() || inAction.IsEmpty())
-		return NULL;
 
-	const VValueBag *permissionBag = NULL;
+VError VRIAPermissions::StartWatchingFileChanges()
+{
+	VError err = VE_OK;
 
 	if (fMutex.Lock())
 	{
-		VError err = _LoadPermissionFile( NULL);	// sc 16/05/2012 check for permissions file changes
-		if (err == VE_OK)
+		if (!fWatchingFileChanges && fPath.IsFile())
 		{
-			VRIAPermissionsSearch search( inType, inResource, inAction);
-			std::vector< VRefPtr<VValueBag> >::iterator found = std::find_if( fPermissions.begin(), fPermissions.end(), search);
-			if (found != fPermissions.end())
-				permissionBag = found->Retain();
-		}
+			VFilePath folderPath;
+			fPath.GetParent( folderPath);
+			VFolder folder( folderPath);
 
+			err = VFileSystemNotifier::Instance()->StartWatchingForChanges( folder, VFileSystemNotifier::kAll, this, 100);
+			if (err == VE_OK)
+			{
+				fWatchingFileChanges = true;
+
+				// Catch the changes which may have occurred before the watching
+				_LoadPermissionFile( NULL);
+			}
+		}
 		fMutex.Unlock();
 	}
 
-	return permissionBag;
+	return err;
 }
 
 
-XBOX::VError VRIAPermissions::RetainResourcesPermission( std::vector< XBOX::VRefPtr<XBOX::VValueBag> >& outPermissions, const XBOX::VString* inType, const XBOX::VString* inResource, const XBOX::VString* inAction)
+VError VRIAPermissions::StopWatchingFileChanges()
 {
 	VError err = VE_OK;
+	bool stop = false;
 
 	if (fMutex.Lock())
 	{
-		err = _LoadPermissionFile( NULL);	// sc 16/05/2012 check for permissions file changes
-		if (err == VE_OK)
+		stop = fWatchingFileChanges;
+		fWatchingFileChanges = false;
+		fMutex.Unlock();
+	}
+
+	if (stop)
+	{
+		// The mutex must not be locked: the notifier may be calling FileSystemEventHandler()
+		VFilePath folderPath;
+		fPath.GetParent( folderPath);
+		VFolder folder( folderPath);
+
+		err = VFileSystemNotifier::Instance()->StopWatchingForChanges( folder, this);
+	}
+
+	return err;
+}
+
+
+void VRIAPermissions::FileSystemEventHandler( const std::vector< VFilePath > &inFilePaths, VFileSystemNotifier::EventKind inKind)
+{
+	for (std::vector< VFilePath >::const_iterator iter = inFilePaths.begin() ; iter != inFilePaths.end() ; ++iter)
+	{
+		if (*iter == fPath)
 		{
-			if (inType == NULL && inResource == NULL && inAction == NULL)
+			if (fMutex.Lock())
 			{
-				outPermissions.insert( outPermissions.end(), fPermissions.begin(), fPermissions.end());
+				if (fWatchingFileChanges)
+				{
+					StErrorContextInstaller errorContext( false, true);
+					_LoadPermissionFile( NULL);
+				}
+				fMutex.Unlock();
 			}
-			else
+			break;
+		}
+	}
+}
+
+
+const VValueBag* VRIAPermissions::RetainResourcePermission( const VString& inType, const VString& inResource, const VString& inAction)
+{
+	if (inType.IsEmpty() || inResource.IsEmpty() || inAction.IsEmpty())
+		return NULL;
+
+	const VValueBag *permissionBag = NULL;
+
+	VRIAPermissionsSnapshot *snapshot = _RetainSnapshot( NULL);
+	if (snapshot != NULL)
+	{
+		sLONG pos = snapshot->Find( inType, inResource, inAction);
+		if (pos >= 0)
+			permissionBag = snapshot->GetPermissions()[pos].Retain();
+	}
+	ReleaseRefCountable( &snapshot);
+
+	return permissionBag;
+}
+
+
+XBOX::VError VRIAPermissions::RetainResourcesPermission( std::vector< XBOX::VRefPtr<XBOX::VValueBag> >& outPermissions, const XBOX::VString* inType, const XBOX::VString* inResource, const XBOX::VString* inAction)
+{
+	VError err = VE_OK;
+
+	VRIAPermissionsSnapshot *snapshot = _RetainSnapshot( &err);
+	if (snapshot != NULL)
+	{
+		const std::vector< XBOX::VRefPtr<XBOX::VValueBag> >& permissions = snapshot->GetPermissions();
+
+		if (inType == NULL && inResource == NULL && inAction == NULL)
+		{
+			outPermissions.insert( outPermissions.end(), permissions.begin(), permissions.end());
+		}
+		else
+		{
+			for (size_t pos = 0 ; pos < permissions.size() ; ++pos)
 			{
-				for (std::vector< XBOX::VRefPtr<XBOX::VValueBag> >::const_iterator permIter = fPermissions.begin() ; permIter != fPermissions.end() ; ++permIter)
-				{
-					if (inType != NULL)
-					{
-						VString type;
-						(*permIter)->GetString( RIAPermissionsKeys::type, type);
-						if (!inType->EqualToString( type, true))
-							continue;
-					}
+				const VRIAPermissionsSnapshot::CompiledPermission& permission = snapshot->GetCompiledPermission( (sLONG) pos);
 
-					if (inResource != NULL)
-					{
-						VString resource;
-						(*permIter)->GetString( RIAPermissionsKeys::resource, resource);
-						if (!inResource->EqualToString( resource, true))
-							continue;
-					}
+				if ((inType != NULL) && !inType->EqualToString( permission.fType, true))
+					continue;
 
-					if (inAction != NULL)
-					{
-						VString action;
-						(*permIter)->GetString( RIAPermissionsKeys::action, action);
-						if (!inAction->EqualToString( action, true))
-							continue;
-					}
+				if ((inResource != NULL) && !inResource->EqualToString( permission.fResource, true))
+					continue;
 
-					outPermissions.push_back( *permIter);
-				}
+				if ((inAction != NULL) && !inAction->EqualToString( permission.fAction, true))
+					continue;
+
+				outPermissions.push_back( permissions[pos]);
 			}
 		}
-
-		fMutex.Unlock();
 	}
+	ReleaseRefCountable( &snapshot);
 
 	return err;
 }
@@ -182,9 +327,7 @@ XBOX::VError VRIAPermissions::AddResourcePermission( const XBOX::VString& inType
 		err = _LoadPermissionFile( NULL);	// sc 16/05/2012 ensure permissions are up to date
 		if (err == VE_OK)
 		{
-			VRIAPermissionsSearch search( inType, inResource, inAction);
-			std::vector< VRefPtr<VValueBag> >::iterator found = std::find_if( fPermissions.begin(), fPermissions.end(), search);
-			if (found != fPermissions.end())
+			if (fSnapshot->Find( inType, inResource, inAction) >= 0)
 			{
 				err = VE_RIA_PERMISSION_ALREADY_EXISTS;
 			}
@@ -204,9 +347,14 @@ XBOX::VError VRIAPermissions::AddResourcePermission( const XBOX::VString& inType
 						permissionBag->SetString( RIAPermissionsKeys::groupID, uuidStr);
 					}
 
-					fPermissions.push_back( VRefPtr<VValueBag>(permissionBag));
+					std::vector< VRefPtr<VValueBag> > permissions( fSnapshot->GetPermissions());
+					permissions.push_back( VRefPtr<VValueBag>(permissionBag));
+
+					VRIAPermissionsSnapshot *snapshot = new VRIAPermissionsSnapshot( permissions);
+					_SetSnapshot( snapshot);
+					ReleaseRefCountable( &snapshot);
 
-					err = _SavePermissionFile();
+					err = _SavePermissionFile( permissions);
 				}
 				else
 				{
@@ -235,12 +383,17 @@ XBOX::VError VRIAPermissions::RemoveResourcePermission( const XBOX::VString& inT
 		err = _LoadPermissionFile( NULL);	// sc 16/05/2012 ensure permissions are up to date
 		if (err == VE_OK)
 		{
-			VRIAPermissionsSearch search( inType, inResource, inAction);
-			std::vector< VRefPtr<VValueBag> >::iterator found = std::find_if( fPermissions.begin(), fPermissions.end(), search);
-			if (found != fPermissions.end())
+			sLONG pos = fSnapshot->Find( inType, inResource, inAction);
+			if (pos >= 0)
 			{
-				fPermissions.erase( found);
-				err = _SavePermissionFile();
+				std::vector< VRefPtr<VValueBag> > permissions( fSnapshot->GetPermissions());
+				permissions.erase( permissions.begin() + pos);
+
+				VRIAPermissionsSnapshot *snapshot = new VRIAPermissionsSnapshot( permissions);
+				_SetSnapshot( snapshot);
+				ReleaseRefCountable( &snapshot);
+
+				err = _SavePermissionFile( permissions);
 			}
 		}
 
@@ -250,17 +403,36 @@ XBOX::VError VRIAPermissions::RemoveResourcePermission( const XBOX::VString& inT
 	return err;
 }
 
+uLONG VRIAPermissions::GetStamp()
+{
+	uLONG stamp = 0;
+
+	if (fMutex.Lock())
+	{
+		if (!fWatchingFileChanges)
+			_LoadPermissionFile( NULL);	// check for permissions file changes
+		stamp = fStamp;
+		fMutex.Unlock();
+	}
+
+	return stamp;
+}
+
+
 void VRIAPermissions::GetRPCModules( std::set<VString>& outRPCFiles )
 {
-	VString resource, type, action;
+	VRIAPermissionsSnapshot *snapshot = _RetainSnapshot( NULL);
+	if (snapshot == NULL)
+		return;
 
-	std::vector< VRefPtr<VValueBag> >::iterator it = fPermissions.begin();
+	VString resource, type, action;
 
-	while ( it != fPermissions.end() )
+	for (size_t pos = 0 ; pos < snapshot->GetPermissions().size() ; ++pos)
 	{
-		(*it)->GetString( RIAPermissionsKeys::type, type);
-		(*it)->GetString( RIAPermissionsKeys::resource, resource);
-		(*it)->GetString( RIAPermissionsKeys::action, action);
+		const VRIAPermissionsSnapshot::CompiledPermission& permission = snapshot->GetCompiledPermission( (sLONG) pos);
+		type = permission.fType;
+		resource = permission.fResource;
+		action = permission.fAction;
 
 		if ( type.EqualToString( "module", true ) && action.EqualToString( "executeFromClient" ) )
 		{
@@ -275,38 +447,40 @@ void VRIAPermissions::GetRPCModules( std::set<VString>& outRPCFiles )
 				outRPCFiles.insert( resource );
 			}
 		}
-
-
-		++it;
 	}
+
+	ReleaseRefCountable( &snapshot);
 }
 
 
 bool VRIAPermissions::IsResourceAccessGrantedForSession( const VString& inType, const VString& inResource, const VString& inAction, CUAGSession *inUAGSession)
 {
-	const VValueBag *permissionBag = RetainResourcePermission( inType, inResource, inAction);
-	if (permissionBag == NULL)
+	if (inType.IsEmpty() || inResource.IsEmpty() || inAction.IsEmpty())
 		return false;
 
 	bool accessGranted = false;
-	VString uuidStr;
 
-	if (permissionBag->GetString( RIAPermissionsKeys::groupID, uuidStr))
+	VRIAPermissionsSnapshot *snapshot = _RetainSnapshot( NULL);
+	if (snapshot != NULL)
 	{
-		VUUID groupID;
-		groupID.FromString( uuidStr);
-
-		if (inUAGSession != NULL)
+		sLONG pos = snapshot->Find( inType, inResource, inAction);
+		if (pos >= 0)
 		{
-			accessGranted = inUAGSession->BelongsTo( groupID, nil);
+			const VRIAPermissionsSnapshot::CompiledPermission& permission = snapshot->GetCompiledPermission( pos);
+			if (permission.fHasGroupID)
+			{
+				if (inUAGSession != NULL)
+				{
+					accessGranted = inUAGSession->BelongsTo( permission.fGroupID, nil);
+				}
+			}
+			else
+			{
+				accessGranted = true;
+			}
 		}
 	}
-	else
-	{
-		accessGranted = true;
-	}
-
-	ReleaseRefCountable( &permissionBag);
+	ReleaseRefCountable( &snapshot);
 
 	return accessGranted;
 }
@@ -319,104 +493,145 @@ VError VRIAPermissions::CheckGroupsValidity( CUAGDirectory *inUAGDirectory)
 
 	VError err = VE_OK;
 
-	if (fMutex.Lock())
+	VRIAPermissionsSnapshot *snapshot = _RetainSnapshot( &err);
+	if (snapshot != NULL)
 	{
-		err = _LoadPermissionFile( NULL);
-		if (err == VE_OK)
+		const std::vector< XBOX::VRefPtr<XBOX::VValueBag> >& permissions = snapshot->GetPermissions();
+		for (std::vector< XBOX::VRefPtr<XBOX::VValueBag> >::const_iterator permIter = permissions.begin() ; permIter != permissions.end() ; ++permIter)
 		{
-			for (std::vector< XBOX::VRefPtr<XBOX::VValueBag> >::const_iterator permIter = fPermissions.begin() ; permIter != fPermissions.end() ; ++permIter)
+			VString groupID, groupName, resource;
+			(*permIter)->GetString( RIAPermissionsKeys::resource, resource);
+			(*permIter)->GetString( RIAPermissionsKeys::groupID, groupID);
+			(*permIter)->GetString( RIAPermissionsKeys::groupName, groupName);
+
+			if (!groupID.IsEmpty() || !groupName.IsEmpty())
 			{
-				VString groupID, groupName, resource;
-				(*permIter)->GetString( RIAPermissionsKeys::resource, resource);
-				(*permIter)->GetString( RIAPermissionsKeys::groupID, groupID);
-				(*permIter)->GetString( RIAPermissionsKeys::groupName, groupName);
+				if (!groupID.IsEmpty() && groupName.IsEmpty())
+				{
+					bool found = false;
+					{
+						VError uagError = VE_OK;
+						StErrorContextInstaller errorContext( false, true);
+						VUUID uuid;
+						uuid.FromString( groupID);
+						CUAGGroup *group = inUAGDirectory->RetainGroup( uuid, &uagError);
+						found = (uagError == VE_OK) && testAssert(group != NULL);
+						ReleaseRefCountable( &group);
+					}
 
-				if (!groupID.IsEmpty() || !groupName.IsEmpty())
+					if (!found)
+					{
+						err = vThrowError( VE_RIA_PERMISSION_GROUP_BY_ID_NOT_FOUND, groupID, resource);
+					}
+				}
+				else if (groupID.IsEmpty() && !groupName.IsEmpty())
 				{
-					if (!groupID.IsEmpty() && groupName.IsEmpty())
+					bool found = false;
 					{
-						bool found = false;
-						{
-							VError uagError = VE_OK;
-							StErrorContextInstaller errorContext( false, true);
-							VUUID uuid;
-							uuid.FromString( groupID);
-							CUAGGroup *group = inUAGDirectory->RetainGroup( uuid, &uagError);
-							found = (uagError == VE_OK) && testAssert(group != NULL);
-							ReleaseRefCountable( &group);
-						}
+						VError uagError = VE_OK;
+						StErrorContextInstaller errorContext( false, true);
+						CUAGGroup *group = inUAGDirectory->RetainGroup( groupName, &uagError);
+						found = (uagError == VE_OK) && testAssert(group != NULL);
+						ReleaseRefCountable( &group);
+					}
 
-						if (!found)
-						{
-							err = vThrowError( VE_RIA_PERMISSION_GROUP_BY_ID_NOT_FOUND, groupID, resource);
-						}
+					if (!found)
+					{
+						err = vThrowError( VE_RIA_PERMISSION_GROUP_BY_NAME_NOT_FOUND, groupName, resource);
 					}
-					else if (groupID.IsEmpty() && !groupName.IsEmpty())
+				}
+				else
+				{
+					bool foundByName = false, foundByID = false;
 					{
-						bool found = false;
+						VError uagError = VE_OK;
+						StErrorContextInstaller errorContext( false, true);
+						VUUID uuid;
+						uuid.FromString( groupID);
+						CUAGGroup *group = inUAGDirectory->RetainGroup( uuid, &uagError);
+						foundByID = (uagError == VE_OK) && testAssert(group != NULL);
+						if (foundByID)
 						{
-							VError uagError = VE_OK;
-							StErrorContextInstaller errorContext( false, true);
-							CUAGGroup *group = inUAGDirectory->RetainGroup( groupName, &uagError);
-							found = (uagError == VE_OK) && testAssert(group != NULL);
-							ReleaseRefCountable( &group);
+							VString name;
+							group->GetName( name);
+							foundByName = (name == groupName);
 						}
+						ReleaseRefCountable( &group);
 
-						if (!found)
+						if (!foundByID)
 						{
-							err = vThrowError( VE_RIA_PERMISSION_GROUP_BY_NAME_NOT_FOUND, groupName, resource);
-						}
-					}
-					else
-					{
-						bool foundByName = false, foundByID = false;
-						{
-							VError uagError = VE_OK;
-							StErrorContextInstaller errorContext( false, true);
-							VUUID uuid;
-							uuid.FromString( groupID);
-							CUAGGroup *group = inUAGDirectory->RetainGroup( uuid, &uagError);
-							foundByID = (uagError == VE_OK) && testAssert(group != NULL);
-							if (foundByID)
-							{
-								VString name;
-								group->GetName( name);
-								foundByName = (name == groupName);
-							}
+							group = inUAGDirectory->RetainGroup( groupName, &uagError);
+							foundByName = (uagError == VE_OK) && testAssert(group != NULL);
 							ReleaseRefCountable( &group);
 
-							if (!foundByID)
-							{
-								group = inUAGDirectory->RetainGroup( groupName, &uagError);
-								foundByName = (uagError == VE_OK) && testAssert(group != NULL);
-								ReleaseRefCountable( &group);
-
-							}
-						}
-						
-						if (!foundByID && !foundByName)
-						{
-							err = vThrowError( VE_RIA_PERMISSION_GROUP_BY_ID_NOT_FOUND, groupID, resource);
-						}
-						else if (foundByID && !foundByName)
-						{
-							err = vThrowError( VE_RIA_PERMISSION_GROUP_NAME_MISMATCH, groupID, resource);
-						}
-						else if (!foundByID && foundByName)
-						{
-							err = vThrowError( VE_RIA_PERMISSION_GROUP_ID_MISMATCH, groupName, resource);
 						}
 					}
+					
+					if (!foundByID && !foundByName)
+					{
+						err = vThrowError( VE_RIA_PERMISSION_GROUP_BY_ID_NOT_FOUND, groupID, resource);
+					}
+					else if (foundByID && !foundByName)
+					{
+						err = vThrowError( VE_RIA_PERMISSION_GROUP_NAME_MISMATCH, groupID, resource);
+					}
+					else if (!foundByID && foundByName)
+					{
+						err = vThrowError( VE_RIA_PERMISSION_GROUP_ID_MISMATCH, groupName, resource);
+					}
 				}
 			}
 		}
-		fMutex.Unlock();
 	}
+	ReleaseRefCountable( &snapshot);
 
 	return err;
 }
 
 
+VRIAPermissionsSnapshot* VRIAPermissions::_RetainSnapshot( XBOX::VError *outError)
+{
+	VRIAPermissionsSnapshot *snapshot = NULL;
+	VError err = VE_OK;
+
+	// When the file is watched, the readers do not wait for a loading: they take the current snapshot
+	if (!fWatchingFileChanges)
+	{
+		if (fMutex.Lock())
+		{
+			err = _LoadPermissionFile( NULL);	// sc 16/05/2012 check for permissions file changes
+			fMutex.Unlock();
+		}
+	}
+
+	if (err == VE_OK)
+	{
+		if (fSnapshotMutex.Lock())
+		{
+			snapshot = RetainRefCountable( fSnapshot);
+			fSnapshotMutex.Unlock();
+		}
+	}
+
+	if (outError != NULL)
+		*outError = err;
+
+	return snapshot;
+}
+
+
+void VRIAPermissions::_SetSnapshot( VRIAPermissionsSnapshot *inSnapshot)
+{
+	// Readers which have retained the previous snapshot keep using it
+	if (fSnapshotMutex.Lock())
+	{
+		CopyRefCountable( &fSnapshot, inSnapshot);
+		fSnapshotMutex.Unlock();
+	}
+	++fStamp;
+}
+
+
 XBOX::VError VRIAPermissions::_LoadPermissionFile( XBOX::VFolder* inDTDsFolder)
 {
 	VError err = VE_OK;
@@ -431,7 +646,7 @@ XBOX::VError VRIAPermissions::_LoadPermissionFile( XBOX::VFolder* inDTDsFolder)
 		{
 			if (fModificationTime != modificationTime)
 			{
-				fPermissions.clear();
+				std::vector< VRefPtr<VValueBag> > permissions;
 
 				VValueBag bag;
 				err = LoadBagFromXML( file, L"permissions", bag, XML_ValidateNever, NULL, inDTDsFolder);
@@ -456,12 +671,24 @@ XBOX::VError VRIAPermissions::_LoadPermissionFile( XBOX::VFolder* inDTDsFolder)
 								if (type.IsEmpty() || resource.IsEmpty() || action.IsEmpty())
 									continue;
 
-								fPermissions.push_back( VRefPtr<VValueBag>(permissionBag));
+								permissions.push_back( VRefPtr<VValueBag>(permissionBag));
 							}
 						}
 					}
 
 					fModificationTime = modificationTime;
+
+					VRIAPermissionsSnapshot *snapshot = new VRIAPermissionsSnapshot( permissions);
+					_SetSnapshot( snapshot);
+					ReleaseRefCountable( &snapshot);
+				}
+				else
+				{
+					// The file may be half written: the previous permissions are kept until the next change
+					VString msg, path;
+					fPath.GetPath( path);
+					msg.Printf( "Cannot load the permissions file \"%S\", the previous permissions are kept", &path);
+					VProcess::Get()->GetLogger()->LogMessage( EML_Error, msg, VProcess::Get()->GetLogSourceIdentifier());
 				}
 			}
 		}
@@ -471,14 +698,14 @@ XBOX::VError VRIAPermissions::_LoadPermissionFile( XBOX::VFolder* inDTDsFolder)
 }
 
 
-XBOX::VError VRIAPermissions::_SavePermissionFile()
+XBOX::VError VRIAPermissions::_SavePermissionFile( const std::vector< XBOX::VRefPtr<XBOX::VValueBag> >& inPermissions)
 {
 	if (!fPath.IsFile())
 		return VE_UNKNOWN_ERROR;
 
 	VValueBag bag;
 
-	for (std::vector< XBOX::VRefPtr<XBOX::VValueBag> >::const_iterator permIter = fPermissions.begin() ; permIter != fPermissions.end() ; ++permIter)
+	for (std::vector< XBOX::VRefPtr<XBOX::VValueBag> >::const_iterator permIter = inPermissions.begin() ; permIter != inPermissions.end() ; ++permIter)
 	{
 		bag.AddElement( RIAPermissionsKeys::allow, *permIter);
 	}
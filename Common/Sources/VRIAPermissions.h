@@ -20,6 +20,7 @@
 
 class CUAGSession;
 class CUAGDirectory;
+class VRIAPermissionsSnapshot;
 
 
 namespace RIAPermissionsKeys
@@ -34,7 +35,9 @@ namespace RIAPermissionsKeys
 
 
 
-class VRIAPermissions : public XBOX::VObject, public XBOX::IRefCountable
+// The permissions are compiled into an immutable snapshot which is replaced each time the permissions change.
+// When the permissions file is watched, the snapshot is replaced on file system notifications and the permissions file is not checked on each call.
+class VRIAPermissions : public XBOX::VObject, public XBOX::IRefCountable, public XBOX::VFileSystemNotifier::IEventHandler
 {
 public:
 			VRIAPermissions( const XBOX::VFilePath& inPath);
@@ -44,6 +47,11 @@ public:
 			*/
 			XBOX::VError			LoadPermissionFile( XBOX::VFolder* inDTDsFolder = NULL);
 
+			/** @brief	start or stop watching the permissions file for changes. StopWatchingFileChanges() must be called before the permissions are released.
+			*/
+			XBOX::VError			StartWatchingFileChanges();
+			XBOX::VError			StopWatchingFileChanges();
+
 			const XBOX::VValueBag*	RetainResourcePermission( const XBOX::VString& inType, const XBOX::VString& inResource, const XBOX::VString& inAction);
 
 			/** @brief	returns the permissions according to the passed filter. Any NULL criteria will be ignored.
@@ -62,18 +70,33 @@ public:
 
 			void					GetRPCModules( std::set<XBOX::VString>& outModules );
 
+			/** @brief	Returns a stamp which is incremented each time the permissions change. The permissions file is checked for changes.
+			*/
+			uLONG					GetStamp();
+
 			/**@brief	check whether the UAG groups used in the permissions are valid
 			*/
 			XBOX::VError			CheckGroupsValidity( CUAGDirectory *inUAGDirectory);
 
+	// VFileSystemNotifier::IEventHandler
+	virtual	void					FileSystemEventHandler( const std::vector< XBOX::VFilePath > &inFilePaths, XBOX::VFileSystemNotifier::EventKind inKind);
+
 private:
+			/** @brief	returns the current permissions snapshot. The permissions file is checked for changes if it is not watched.
+			*/
+			VRIAPermissionsSnapshot*	_RetainSnapshot( XBOX::VError *outError);
+
 			XBOX::VError			_LoadPermissionFile( XBOX::VFolder* inDTDsFolder = NULL);
-			XBOX::VError			_SavePermissionFile();
+			XBOX::VError			_SavePermissionFile( const std::vector< XBOX::VRefPtr<XBOX::VValueBag> >& inPermissions);
+			void					_SetSnapshot( VRIAPermissionsSnapshot *inSnapshot);
 
 			XBOX::VFilePath										fPath;
 			XBOX::VTime											fModificationTime;	// The file modification time when last loading occurs
-			std::vector< XBOX::VRefPtr<XBOX::VValueBag> >		fPermissions;
-	mutable	XBOX::VCriticalSection								fMutex;
+			VRIAPermissionsSnapshot								*fSnapshot;
+			bool												fWatchingFileChanges;
+			uLONG												fStamp;
+	mutable	XBOX::VCriticalSection								fMutex;				// serializes the loadings and the changes
+	mutable	XBOX::VCriticalSection								fSnapshotMutex;		// only guards the swap of fSnapshot against the readers
 };
 
 
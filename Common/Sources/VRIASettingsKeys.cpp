@@ -47,6 +47,7 @@ namespace RIASettingsKeys
 	{
 		CREATE_BAGKEY( serverStartup);
 		CREATE_PATHBAGKEY_WITH_DEFAULT_SCALAR( "serverStartup", stopIfProjectFails, XBOX::VBoolean, bool, true);
+		CREATE_PATHBAGKEY_WITH_DEFAULT_SCALAR( "serverStartup", startupWorkers, XBOX::VLong, sLONG, 1);	// number of tasks which open and start the projects
 		
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( garbageCollect, XBOX::VBoolean, bool, false);
 
@@ -130,6 +131,9 @@ namespace RIASettingsKeys
 		CREATE_BAGKEY_WITH_DEFAULT( logPath, XBOX::VString,  L"$(projectDir)Logs/");
 		CREATE_BAGKEY_WITH_DEFAULT( logFileName, XBOX::VString, L"HTTPServer.waLog");
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( logMaxSize, XBOX::VLong, sLONG, 10 * 1024);	// Max size of log file in Ko
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( logRequestTimings, XBOX::VBoolean, bool, false);	// Log the stages timings of the JavaScript request handlers
+		CREATE_BAGKEY_WITH_DEFAULT( metricsPattern, XBOX::VString, L"");	// URL pattern of the metrics endpoint, the endpoint is disabled if empty
+		CREATE_BAGKEY_WITH_DEFAULT( metricsAllowedAddresses, XBOX::VString, L"");	// comma separated client IP addresses allowed to read the metrics, the endpoint is disabled if empty
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( allowCompression, XBOX::VBoolean, bool, true);
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR (compressionMinThreshold, XBOX::VLong, sLONG, 1024);				// 1 KBytes (in bytes)
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR (compressionMaxThreshold, XBOX::VLong, sLONG, 10 * 1024 * 1024);	// 10 MBytes (in bytes)
@@ -183,6 +187,13 @@ namespace RIASettingsKeys
 		CREATE_BAGKEY( debugger);
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( reuseContexts, XBOX::VBoolean, bool, true);
 		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( contextPoolSize, XBOX::VLong, sLONG, 50);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( spareContextsLowWaterMark, XBOX::VLong, sLONG, 0);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( spareContextsHighWaterMark, XBOX::VLong, sLONG, 0);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( scriptsCache, XBOX::VBoolean, bool, true);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( gcMemoryBudget, XBOX::VLong, sLONG, 50);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( gcRequestsBudget, XBOX::VLong, sLONG, 10);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( gcPauseBudget, XBOX::VLong, sLONG, 50);
+		CREATE_BAGKEY_WITH_DEFAULT_SCALAR( lazyDataStore, XBOX::VBoolean, bool, false);	// bind the datastore and the entity models on first access to "ds"
 	}
 
 	// JavaScript debugger settings
@@ -48,6 +48,7 @@ namespace RIASettingsKeys
 	{
 		EXTERN_BAGKEY( serverStartup);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( stopIfProjectFails, XBOX::VBoolean, bool);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( startupWorkers, XBOX::VLong, sLONG);
 
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( garbageCollect, XBOX::VBoolean, bool);
 
@@ -130,6 +131,9 @@ namespace RIASettingsKeys
 		EXTERN_BAGKEY_WITH_DEFAULT( logPath, XBOX::VString);
 		EXTERN_BAGKEY_WITH_DEFAULT( logFileName, XBOX::VString);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( logMaxSize, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( logRequestTimings, XBOX::VBoolean, bool);
+		EXTERN_BAGKEY_WITH_DEFAULT( metricsPattern, XBOX::VString);
+		EXTERN_BAGKEY_WITH_DEFAULT( metricsAllowedAddresses, XBOX::VString);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( allowCompression, XBOX::VBoolean, bool);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR (compressionMinThreshold, XBOX::VLong, sLONG);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR (compressionMaxThreshold, XBOX::VLong, sLONG);
@@ -184,6 +188,13 @@ namespace RIASettingsKeys
 		EXTERN_BAGKEY( debugger);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( reuseContexts, XBOX::VBoolean, bool);
 		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( contextPoolSize, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( spareContextsLowWaterMark, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( spareContextsHighWaterMark, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( scriptsCache, XBOX::VBoolean, bool);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( gcMemoryBudget, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( gcRequestsBudget, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( gcPauseBudget, XBOX::VLong, sLONG);
+		EXTERN_BAGKEY_WITH_DEFAULT_SCALAR( lazyDataStore, XBOX::VBoolean, bool);
 	}
 
 	// JavaScript debugger settings
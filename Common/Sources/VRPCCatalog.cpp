@@ -392,12 +392,26 @@ void VRPCCatalogFile::Touch()
 
 
 VRPCModule::VRPCModule()
+: fFileResolved(false)
 {
 }
 
 
 VRPCModule::VRPCModule( const XBOX::VString& inPath)
 : fPath(inPath)
+, fFileResolved(false)
+{
+}
+
+
+VRPCModule::VRPCModule( const VRPCModule& inSource)
+: fPath(inSource.fPath)
+, fSchemas(inSource.fSchemas)
+, fFilePath(inSource.fFilePath)
+, fFileModificationTime(inSource.fFileModificationTime)
+, fFileResolved(inSource.fFileResolved)
+, fCandidateFiles(inSource.fCandidateFiles)
+, fDependencies(inSource.fDependencies)
 {
 }
 
@@ -412,6 +426,9 @@ XBOX::VError VRPCModule::Load( XBOX::VJSContext& inContext)
 	VError err = VE_OK;
 
 	fSchemas.clear();
+	fFileResolved = false;
+	fCandidateFiles.clear();
+	fDependencies.clear();
 	
 	VJSException	exception;
 	VJSObject object( inContext.GetGlobalObject());
@@ -472,6 +489,10 @@ XBOX::VError VRPCModule::Load( XBOX::VJSContext& inContext)
 		err = vThrowError( VE_RIA_JS_CALL_TO_REQUIRE_FAILED);
 	}
 
+	// The files are also tracked when the module could not be loaded, so that it is loaded again only once it has been modified
+	_ResolveFile( inContext, err != VE_OK);
+	_CollectDependencies( inContext);
+
 	return err;
 }
 
@@ -502,12 +523,150 @@ XBOX::VError VRPCModule::AppendMethod( const XBOX::VString& inName)
 }
 
 
+const XBOX::VString& VRPCModule::GetPath() const
+{
+	return fPath;
+}
+
+
 const MapOfRPCSchema& VRPCModule::GetSchemas() const
 {
 	return fSchemas;
 }
 
 
+bool VRPCModule::IsModified() const
+{
+	if (fFileResolved)
+	{
+		VFile file( fFilePath);
+		if (!file.Exists())
+			return true;
+
+		VTime modificationTime;
+		if (file.GetTimeAttributes( &modificationTime) != VE_OK)
+			return true;
+
+		if (modificationTime != fFileModificationTime)
+			return true;
+	}
+	else
+	{
+		for (std::vector<VFilePath>::const_iterator iter = fCandidateFiles.begin() ; iter != fCandidateFiles.end() ; ++iter)
+		{
+			if (VFile( *iter).Exists())
+				return true;
+		}
+	}
+
+	for (MapOfFileModificationTime::const_iterator iter = fDependencies.begin() ; iter != fDependencies.end() ; ++iter)
+	{
+		VFile file( iter->first, FPS_POSIX);
+		VTime modificationTime;
+		if (!file.Exists() || (file.GetTimeAttributes( &modificationTime) != VE_OK) || (modificationTime != iter->second))
+			return true;
+	}
+
+	return false;
+}
+
+
+void VRPCModule::_ResolveFile( XBOX::VJSContext& inContext, bool inKeepCandidates)
+{
+	fFileResolved = false;
+	fCandidateFiles.clear();
+
+	// Only the top-level identifiers are resolved using require.paths, the last path has the priority
+	if (fPath.IsEmpty() || fPath.BeginsWith( CVSTR( "/")) || fPath.BeginsWith( CVSTR( ".")))
+		return;
+
+	VJSException exception;
+	VJSObject globalObject( inContext.GetGlobalObject());
+	VJSObject requireObject = globalObject.GetProperty( L"require", exception).GetObject( &exception);
+	if (!exception.IsEmpty())
+		return;
+
+	VJSObject pathsObject = requireObject.GetProperty( L"paths", exception).GetObject( &exception);
+	if (!exception.IsEmpty())
+		return;
+
+	bool exists = false;
+	sLONG count = pathsObject.GetPropertyAsLong( CVSTR( "length"), &exception, &exists);
+
+	for (sLONG pos = count - 1 ; (pos >= 0) && exists && exception.IsEmpty() && !fFileResolved ; --pos)
+	{
+		VString index, basePath;
+		index.FromLong( pos);
+		if (!pathsObject.GetPropertyAsString( index, &exception, basePath) || basePath.IsEmpty())
+			continue;
+
+		if (basePath[basePath.GetLength()-1] != CHAR_SOLIDUS)
+			basePath.AppendUniChar( CHAR_SOLIDUS);
+		basePath.AppendString( fPath);
+
+		// Same resolution order as require(): folder index, file, file with ".js" suffix, file with ".json" suffix
+		const char *suffixes[] = { "/index.js", "", ".js", ".json" };
+		for (sLONG suffixPos = 0 ; (suffixPos < 4) && !fFileResolved ; ++suffixPos)
+		{
+			VString candidate( basePath);
+			candidate.AppendCString( suffixes[suffixPos]);
+
+			VFile file( candidate, FPS_POSIX);
+			if (file.Exists() && (file.GetTimeAttributes( &fFileModificationTime) == VE_OK))
+			{
+				fFilePath = file.GetPath();
+				fFileResolved = true;
+			}
+			else if (inKeepCandidates)
+			{
+				fCandidateFiles.push_back( file.GetPath());
+			}
+		}
+	}
+
+	if (fFileResolved)
+		fCandidateFiles.clear();
+}
+
+
+void VRPCModule::_CollectDependencies( XBOX::VJSContext& inContext)
+{
+	fDependencies.clear();
+
+	// The files loaded by require() before the module are also kept: a dependency may have been loaded by an other module
+	VJSException exception;
+	VJSObject globalObject( inContext.GetGlobalObject());
+	VJSObject requireObject = globalObject.GetProperty( L"require", exception).GetObject( &exception);
+	if (!exception.IsEmpty() || !requireObject.HasProperty( CVSTR( "getLoadedFiles")))
+		return;
+
+	std::vector<VJSValue> params;
+	VJSValue result( inContext);
+	if (requireObject.CallMemberFunction( L"getLoadedFiles", &params, &result, exception) && exception.IsEmpty())
+	{
+		VJSObject filesObject = result.GetObject( &exception);
+		if (!exception.IsEmpty())
+			return;
+
+		bool exists = false;
+		sLONG count = filesObject.GetPropertyAsLong( CVSTR( "length"), &exception, &exists);
+
+		for (sLONG pos = 0 ; (pos < count) && exists && exception.IsEmpty() ; ++pos)
+		{
+			VString index, path;
+			index.FromLong( pos);
+			if (!filesObject.GetPropertyAsString( index, &exception, path) || path.IsEmpty())
+				continue;
+
+			VFile file( path, FPS_POSIX);
+			VTime modificationTime;
+			if (file.Exists() && (file.GetTimeAttributes( &modificationTime) == VE_OK))
+				fDependencies[path] = modificationTime;
+		}
+	}
+}
+
+
 
 // ----------------------------------------------------------------------------
 
@@ -552,6 +711,8 @@ private:
 
 
 VRPCCatalog::VRPCCatalog()
+: fReadOnly(false)
+, fPermissionsStamp(0)
 {
 }
 
@@ -648,6 +809,9 @@ XBOX::VError VRPCCatalog::LoadModule( const XBOX::VString& inPath, XBOX::VJSCont
 {
 	VError err = VE_OK;
 
+	if (!testAssert(!fReadOnly))
+		return VE_UNKNOWN_ERROR;
+
 	if (fMutex.Lock())
 	{
 		VRPCModule *module = new VRPCModule( inPath);
@@ -674,6 +838,9 @@ XBOX::VError VRPCCatalog::AppendModuleMethod( const XBOX::VString& inPath)
 {
 	VError err = VE_OK;
 
+	if (!testAssert(!fReadOnly))
+		return VE_UNKNOWN_ERROR;
+
 	if (fMutex.Lock())
 	{
 		VRPCSchemaIdentifier identifier( inPath);
@@ -717,16 +884,38 @@ XBOX::VError VRPCCatalog::RetainSchemasByModule( const XBOX::VString& inModulePa
 {
 	VError err = VE_OK;
 
+	if (fReadOnly)
+	{
+		err = _RetainSchemasByModule( inModulePath, outSchemas);
+	}
+	else if (fMutex.Lock())
+	{
+		err = _RetainSchemasByModule( inModulePath, outSchemas);
+		fMutex.Unlock();
+	}
+
+	return err;
+}
+
+
+XBOX::VError VRPCCatalog::AppendModule( const VRPCModule& inModule)
+{
+	VError err = VE_OK;
+
+	if (!testAssert(!fReadOnly))
+		return VE_UNKNOWN_ERROR;
+
 	if (fMutex.Lock())
 	{
-		MapOfRPCModule_citer found = fModules.find( inModulePath);
-		if (found != fModules.end())
+		VRPCModule *module = new VRPCModule( inModule);
+		if (module != NULL)
 		{
-			outSchemas.insert( found->second->GetSchemas().begin(), found->second->GetSchemas().end());
+			fModules[module->GetPath()] = module;
+			ReleaseRefCountable( &module);
 		}
 		else
 		{
-			err = vThrowError( VE_RIA_RPC_MODULE_NOT_FOUND);
+			err = vThrowError( VE_MEMORY_FULL);
 		}
 
 		fMutex.Unlock();
@@ -736,6 +925,73 @@ XBOX::VError VRPCCatalog::RetainSchemasByModule( const XBOX::VString& inModulePa
 }
 
 
+VRPCModule* VRPCCatalog::RetainModule( const XBOX::VString& inPath) const
+{
+	VRPCModule *module = NULL;
+
+	if (fReadOnly)
+	{
+		MapOfRPCModule_citer found = fModules.find( inPath);
+		if (found != fModules.end())
+			module = found->second.Retain();
+	}
+	else if (fMutex.Lock())
+	{
+		MapOfRPCModule_citer found = fModules.find( inPath);
+		if (found != fModules.end())
+			module = found->second.Retain();
+
+		fMutex.Unlock();
+	}
+
+	return module;
+}
+
+
+void VRPCCatalog::GetModifiedModules( std::vector<XBOX::VString>& outPaths) const
+{
+	outPaths.clear();
+
+	if (fMutex.Lock())
+	{
+		for (MapOfRPCModule_citer iter = fModules.begin() ; iter != fModules.end() ; ++iter)
+		{
+			if (iter->second->IsModified())
+				outPaths.push_back( iter->first);
+		}
+		fMutex.Unlock();
+	}
+}
+
+
+void VRPCCatalog::SetReadOnly()
+{
+	if (fMutex.Lock())
+	{
+		fReadOnly = true;
+		fMutex.Unlock();
+	}
+}
+
+
+bool VRPCCatalog::IsReadOnly() const
+{
+	return fReadOnly;
+}
+
+
+void VRPCCatalog::SetPermissionsStamp( uLONG inStamp)
+{
+	fPermissionsStamp = inStamp;
+}
+
+
+uLONG VRPCCatalog::GetPermissionsStamp() const
+{
+	return fPermissionsStamp;
+}
+
+
 void VRPCCatalog::Clear()
 {
 	if (fMutex.Lock())
@@ -788,6 +1044,24 @@ void VRPCCatalog::BuildCatalog( const MapOfRPCSchema& inSchemas, VString& outCat
 }
 
 
+XBOX::VError VRPCCatalog::_RetainSchemasByModule( const XBOX::VString& inModulePath, MapOfRPCSchema& outSchemas) const
+{
+	VError err = VE_OK;
+
+	MapOfRPCModule_citer found = fModules.find( inModulePath);
+	if (found != fModules.end())
+	{
+		outSchemas.insert( found->second->GetSchemas().begin(), found->second->GetSchemas().end());
+	}
+	else
+	{
+		err = vThrowError( VE_RIA_RPC_MODULE_NOT_FOUND);
+	}
+
+	return err;
+}
+
+
 VRPCSchema* VRPCCatalog::_GetSchemaFromCatalogFile( const VRPCSchemaIdentifier& inIdentifier) const
 {
 	VRPCSchema *schema = NULL;
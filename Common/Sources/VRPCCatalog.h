@@ -160,17 +160,41 @@ class VRPCModule : public XBOX::VObject, public XBOX::IRefCountable
 public:
 			VRPCModule();
 			VRPCModule( const XBOX::VString& inPath);
+			VRPCModule( const VRPCModule& inSource);
 	virtual	~VRPCModule();
 
+			/** @brief	Require the module and create a schema for each function. The module file is resolved using require.paths */
 			XBOX::VError				Load( XBOX::VJSContext& inContext);
 
 			XBOX::VError				AppendMethod( const XBOX::VString& inName);
 
+			const XBOX::VString&		GetPath() const;
 			const MapOfRPCSchema&		GetSchemas() const;
 
+			/** @brief	Returns true if the module file or one of the files which have been required while loading the module has been modified
+						since the module has been loaded. If the module could not be loaded and its file could not be resolved, returns true
+						once a file which could be the module file has been created.
+						The module file is not checked if it could not be resolved (native module, package.json main file...) */
+			bool						IsModified() const;
+
 private:
+	typedef std::map< XBOX::VString, XBOX::VTime >	MapOfFileModificationTime;	// key is the POSIX full path of the file
+
+			VRPCModule&					operator=( const VRPCModule& inSource);
+
+			/** @brief	Resolve the module file the same way require() does for a top-level module identifier.
+						If inKeepCandidates is true and the file could not be resolved, the candidate files are kept. */
+			void						_ResolveFile( XBOX::VJSContext& inContext, bool inKeepCandidates);
+			/** @brief	Keep the modification time of the files which have been loaded by require() */
+			void						_CollectDependencies( XBOX::VJSContext& inContext);
+
 			XBOX::VString				fPath;
 			MapOfRPCSchema				fSchemas;
+			XBOX::VFilePath				fFilePath;
+			XBOX::VTime					fFileModificationTime;
+			bool						fFileResolved;
+			std::vector<XBOX::VFilePath>	fCandidateFiles;
+			MapOfFileModificationTime	fDependencies;
 };
 
 
@@ -183,9 +207,9 @@ typedef std::vector< XBOX::VRefPtr<VRPCCatalogFile> >					VectorOfRPCCatalogFile
 typedef std::vector< XBOX::VRefPtr<VRPCCatalogFile> >::iterator			VectorOfRPCCatalogFile_iter;
 typedef std::vector< XBOX::VRefPtr<VRPCCatalogFile> >::const_iterator	VectorOfRPCCatalogFile_citer;
 
-typedef std::map< XBOX::VString, XBOX::VRefPtr<VRPCModule> >					MapOfRPCModule;
-typedef std::map< XBOX::VString, XBOX::VRefPtr<VRPCModule> >::iterator			MapOfRPCModule_iter;
-typedef std::map< XBOX::VString, XBOX::VRefPtr<VRPCModule> >::const_iterator	MapOfRPCModule_citer;
+typedef XBOX::unordered_map_VString< XBOX::VRefPtr<VRPCModule> >					MapOfRPCModule;
+typedef XBOX::unordered_map_VString< XBOX::VRefPtr<VRPCModule> >::iterator			MapOfRPCModule_iter;
+typedef XBOX::unordered_map_VString< XBOX::VRefPtr<VRPCModule> >::const_iterator	MapOfRPCModule_citer;
 
 
 
@@ -209,6 +233,23 @@ public:
 
 			XBOX::VError				RetainSchemasByModule( const XBOX::VString& inModulePath, MapOfRPCSchema& outSchemas) const;
 
+			/** @brief	Append a copy of the module */
+			XBOX::VError				AppendModule( const VRPCModule& inModule);
+			VRPCModule*					RetainModule( const XBOX::VString& inPath) const;
+
+			/** @brief	Returns the path of the modules whose file has been modified since they have been loaded */
+			void						GetModifiedModules( std::vector<XBOX::VString>& outPaths) const;
+
+			// Snapshot support
+
+			/** @brief	Once the catalog is read-only, it cannot be modified anymore and its accessors do not lock the catalog */
+			void						SetReadOnly();
+			bool						IsReadOnly() const;
+
+			/** @brief	The stamp of the permissions from which the catalog has been built */
+			void						SetPermissionsStamp( uLONG inStamp);
+			uLONG						GetPermissionsStamp() const;
+
 			// RPC Schemas high level accessors
 
 			/** @brief	Clear the list of catalog files and the list of methods files */
@@ -232,8 +273,12 @@ private:
 			/** @brief	Overrride the schemas list with the content of catalog files */
 			void						_OverrideSchemasFromCatalogFiles( MapOfRPCSchema& inSchemas) const;
 
+			XBOX::VError				_RetainSchemasByModule( const XBOX::VString& inModulePath, MapOfRPCSchema& outSchemas) const;
+
 			VectorOfRPCCatalogFile		fCatalogFiles;
 			MapOfRPCModule				fModules;
+			bool						fReadOnly;
+			uLONG						fPermissionsStamp;
 	mutable	XBOX::VCriticalSection		fMutex;
 };
 
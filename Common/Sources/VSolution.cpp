@@ -1419,7 +1419,7 @@ bool VSolution::Open()
 
 	if (fSuccessfulLoading)
 	{
-		_SynchronizeWithFileSystem( GetSolutionItem());
+		_SynchronizeWithFileSystem( GetSolutionItem(), true);
 
 		CLanguageSyntaxComponent *languageEngine = VComponentManager::RetainComponentOfType< CLanguageSyntaxComponent >();
 		if (languageEngine != NULL)
@@ -1733,7 +1733,7 @@ VError VSolution::StartWatchingFileSystem()
 
 		VFolder folder(path);
 
-		err = VFileSystemNotifier::Instance()->StartWatchingForChanges( folder, VFileSystemNotifier::kAll, this, 100 );
+		err = VFileSystemNotifier::Instance()->StartWatchingForChanges( folder, VFileSystemNotifier::kAll, this, kFILE_SYSTEM_EVENTS_LATENCY );
 	}
 
 	return err;
@@ -1791,7 +1791,18 @@ void VSolution::FileSystemEventHandler( const std::vector< VFilePath > &inFilePa
 	}
 	else
 	{
-		_SynchronizeWithFileSystem( GetSolutionItem());
+		// Only the folders which contain the changed paths are synchronized
+		VectorOfProjectItems folders;
+		if (_GetFoldersToSynchronize( inFilePaths, folders))
+		{
+			VError err = VE_OK;
+			for (VectorOfProjectItemsIterator iter = folders.begin() ; iter != folders.end() && err == VE_OK ; ++iter)
+				err = _SynchronizeWithFileSystem( *iter, false);
+		}
+		else
+		{
+			_SynchronizeWithFileSystem( GetSolutionItem(), true);
+		}
 
 		if (fDelegate != NULL)
 			fDelegate->SynchronizeFromSolution();
@@ -1852,7 +1863,7 @@ void VSolution::SynchronizeWithFileSystem()
 {
 	VSolutionFileStampSaver stampSaver(this);
 	
-	VError err = _SynchronizeWithFileSystem( fSolutionItem);	// sc 05/07/2012, synchronize the solution folder
+	VError err = _SynchronizeWithFileSystem( fSolutionItem, true);	// sc 05/07/2012, synchronize the solution folder
 
 	if ((err == VE_OK) && stampSaver.StampHasBeenChanged())
 	{
@@ -2380,7 +2391,39 @@ VProjectItem* VSolution::_GetProjectItemFromURL( const XBOX::VURL& inURL) const
 }
 
 
-VError VSolution::_SynchronizeWithFileSystem( VProjectItem *inItem)
+class VSolutionFolderLookup : public IProjectItemFolderLookup
+{
+public:
+	VSolutionFolderLookup( const VSolution& inSolution) : fSolution( inSolution) {}
+
+	VProjectItem* GetProjectItemFromFilePath( const VFilePath& inPath) const
+	{
+		return fSolution.GetProjectItemFromFilePath( inPath);
+	}
+
+	bool IsFolderSynchronizedByOwner( VProjectItem *inFolderItem) const
+	{
+		// projects folder synchronisation is done by the projects themselves
+		return (inFolderItem->GetProjectOwner() == NULL);
+	}
+
+private:
+	const VSolution&	fSolution;
+};
+
+
+bool VSolution::_GetFoldersToSynchronize( const std::vector< VFilePath >& inChangedPaths, VectorOfProjectItems& outFolders) const
+{
+	VFilePath solutionFolderPath;
+	if (!GetSolutionFolderPath( solutionFolderPath))
+		return false;
+
+	VSolutionFolderLookup lookup( *this);
+	return VProjectItemTools::GetFoldersToSynchronize( solutionFolderPath, inChangedPaths, lookup, outFolders);
+}
+
+
+VError VSolution::_SynchronizeWithFileSystem( VProjectItem *inItem, bool inRecursive)
 {
 	VError err = VE_OK;
 
@@ -2421,9 +2464,9 @@ VError VSolution::_SynchronizeWithFileSystem( VProjectItem *inItem)
 			{
 				deletedItems.push_back( iter);
 			}
-			else
+			else if (inRecursive)
 			{
-				err = _SynchronizeWithFileSystem( iter);
+				err = _SynchronizeWithFileSystem( iter, true);
 			}
 		}
 	}
@@ -2497,7 +2540,7 @@ VError VSolution::_SynchronizeWithFileSystem( VProjectItem *inItem)
 								if (folderItem != NULL)
 								{
 									_DoItemAdded( folderItem, true);
-									err = _SynchronizeWithFileSystem( folderItem);
+									err = _SynchronizeWithFileSystem( folderItem, true);
 								}
 							}
 						}
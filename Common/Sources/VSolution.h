@@ -362,7 +362,11 @@ private:
 			bool			_UnregisterProjectItem( VProjectItem *inItem);
 			VProjectItem*	_GetProjectItemFromURL( const XBOX::VURL& inURL) const;
 
-			XBOX::VError	_SynchronizeWithFileSystem( VProjectItem *inItem);
+			/**	@brief	If inRecursive is false, only the children of the item are synchronized. The new folders are always synchronized recursively. */
+			XBOX::VError	_SynchronizeWithFileSystem( VProjectItem *inItem, bool inRecursive);
+			/**	@brief	Returns the existing solution folders which contain the changed paths, the deepest first. The paths which belong to a project are ignored.
+						Returns false if a full synchronization is required. */
+			bool			_GetFoldersToSynchronize( const std::vector< XBOX::VFilePath >& inChangedPaths, VectorOfProjectItems& outFolders) const;
 
 			void			_TouchSolutionFile();
 			sLONG			_GetSolutionFileDirtyStamp() const					{ return fSolutionFileDirtyStamp; }
@@ -87,6 +87,12 @@ namespace ProjectItemBagKeys
 // ----------------------------------------------------------------------------
 const XBOX::VString kTREE_ITEM_STATE	=	CVSTR("tree_item_state");
 
+// ----------------------------------------------------------------------------
+// synchronisation avec le systeme de fichiers
+// ----------------------------------------------------------------------------
+const sLONG kFILE_SYSTEM_EVENTS_LATENCY	=	500;	// in milliseconds, the file system notifier coalesces the events which occur within this window
+const sLONG kMAX_CANONICAL_PATHES_CACHE_SIZE	=	4096;	// count of real pathes cached by a project before the cache is reset
+
 // ----------------------------------------------------------------------------
 // Definitions de constantes NEW INTERFACE
 // ----------------------------------------------------------------------------
@@ -48,6 +48,15 @@ bool VSolutionSettings::GetStopIfProjectFails() const
 }
 
 
+sLONG VSolutionSettings::GetStartupWorkers() const
+{
+	const VValueBag *bag = RetainSettings( RIASettingID::solution);
+	sLONG result = RIASettingsKeys::Solution::startupWorkers.GetUsingPath( bag);
+	ReleaseRefCountable( &bag);
+	return result;
+}
+
+
 bool VSolutionSettings::GetGarbageCollect() const
 {
 	const VValueBag *bag = RetainSettings( RIASettingID::solution);
@@ -29,6 +29,9 @@ public:
 
 			bool			GetStopIfProjectFails() const;
 
+			// Returns the number of tasks which open and start the projects concurrently
+			sLONG			GetStartupWorkers() const;
+
 			bool			GetGarbageCollect() const;
 
 			void			GetAuthenticationType( XBOX::VString& outType) const;
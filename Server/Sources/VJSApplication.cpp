@@ -915,6 +915,48 @@ void VJSApplicationGlobalObject::_getWildChar( XBOX::VJSParms_getProperty& ioPar
 	}
 }
 
+void VJSApplicationGlobalObject::_getDataStore( XBOX::VJSParms_getProperty& ioParms, XBOX::VJSGlobalObject* inGlobalObject)
+{
+	bool done = false;
+	VRIAJSRuntimeContext *rtContext = VRIAJSRuntimeContext::GetFromJSGlobalObject( inGlobalObject);
+	if (rtContext != NULL)
+	{
+		VRIAServerProject *application = rtContext->GetRootApplication();
+		if (application != NULL)
+		{
+			VJSContext jsContext( ioParms.GetContext());
+			ioParms.ReturnValue( application->GetJSDataStore( jsContext));
+			done = true;
+		}
+	}
+
+	if (!done)
+	{
+		ioParms.ReturnUndefinedValue();
+	}
+}
+
+void VJSApplicationGlobalObject::_getSyntaxTester( XBOX::VJSParms_getProperty& ioParms, XBOX::VJSGlobalObject* inGlobalObject)
+{
+	bool done = false;
+	VRIAJSRuntimeContext *rtContext = VRIAJSRuntimeContext::GetFromJSGlobalObject( inGlobalObject);
+	if (rtContext != NULL)
+	{
+		VRIAServerProject *application = rtContext->GetRootApplication();
+		if (application != NULL)
+		{
+			VJSContext jsContext( ioParms.GetContext());
+			ioParms.ReturnValue( application->GetJSSyntaxTester( jsContext));
+			done = true;
+		}
+	}
+
+	if (!done)
+	{
+		ioParms.ReturnUndefinedValue();
+	}
+}
+
 void VJSApplicationGlobalObject::_getIsAdministrator( XBOX::VJSParms_getProperty& ioParms, XBOX::VJSGlobalObject* inGlobalObject)
 {
 	bool done = false;
@@ -41,25 +41,78 @@ void VJSConsole::Initialize( const VJSParms_initialize& inParms, VRIAServerProje
 }
 
 VJSConsole::VJSConsoleLogListener::VJSConsoleLogListener()
+: fWriteSequence(0), fReadSequence(0)
 {
+	for (sLONG i = 0 ; i < kHISTORY_SIZE ; ++i)
+		fRing[i] = NULL;
+}
+
+VJSConsole::VJSConsoleLogListener::~VJSConsoleLogListener()
+{
+	for (sLONG i = 0 ; i < kHISTORY_SIZE ; ++i)
+		ReleaseRefCountable( &fRing[i]);
 }
 
 void VJSConsole::VJSConsoleLogListener::Put( std::vector< const XBOX::VValueBag* >& inValuesVector )
 {
+	// the overwritten messages are released outside of the lock
+	std::vector<const XBOX::VValueBag*> overwrittenValues;
+	overwrittenValues.reserve( inValuesVector.size());
+
 	fLock.Lock();
-	
-	for( std::vector<const XBOX::VValueBag*>::size_type idx = 0; idx < fValues.size(); idx++ )
+
+	for (std::vector<const XBOX::VValueBag*>::iterator iter = inValuesVector.begin() ; iter != inValuesVector.end() ; ++iter)
+	{
+		const VValueBag*& slot = fRing[fWriteSequence % kHISTORY_SIZE];
+		if (slot != NULL)
+			overwrittenValues.push_back( slot);
+
+		slot = RetainRefCountable( *iter);
+		++fWriteSequence;
+	}
+
+	fLock.Unlock();
+
+	for (std::vector<const XBOX::VValueBag*>::iterator iter = overwrittenValues.begin() ; iter != overwrittenValues.end() ; ++iter)
+		(*iter)->Release();
+}
+
+sLONG8 VJSConsole::VJSConsoleLogListener::RetainHistory( sLONG8 inFromSequence, std::vector<const XBOX::VValueBag*>& outValues, sLONG8& outNextSequence) const
+{
+	sLONG8 lostCount = 0;
+
+	fLock.Lock();
+
+	sLONG8 oldestSequence = (fWriteSequence > kHISTORY_SIZE) ? fWriteSequence - kHISTORY_SIZE : 0;
+	if (inFromSequence < oldestSequence)
 	{
-		fValues[idx]->Release();
+		lostCount = oldestSequence - inFromSequence;
+		inFromSequence = oldestSequence;
 	}
-	fValues.clear();
 
-	fValues = inValuesVector;
-	for( std::vector<const XBOX::VValueBag*>::size_type idx = 0; idx < fValues.size(); idx++ )
+	if (inFromSequence < fWriteSequence)
 	{
-		fValues[idx]->Retain();
+		outValues.reserve( outValues.size() + (size_t) (fWriteSequence - inFromSequence));
+		for (sLONG8 sequence = inFromSequence ; sequence < fWriteSequence ; ++sequence)
+			outValues.push_back( RetainRefCountable( fRing[sequence % kHISTORY_SIZE]));
 	}
+	outNextSequence = (inFromSequence > fWriteSequence) ? inFromSequence : fWriteSequence;
+
+	fLock.Unlock();
+
+	return lostCount;
+}
+
+void VJSConsole::VJSConsoleLogListener::RetainUnreadMessages( std::vector<const XBOX::VValueBag*>& outValues)
+{
+	// fReadSequence is shared by all the contexts, as the former buffer was
+	fLock.Lock();
+	sLONG8 fromSequence = fReadSequence;
+	fReadSequence = fWriteSequence;
 	fLock.Unlock();
+
+	sLONG8 nextSequence = 0;
+	RetainHistory( fromSequence, outValues, nextSequence);
 }
 
 void VJSConsole::Finalize( const VJSParms_finalize& inParms, VRIAServerProject* inApplication)
@@ -78,6 +131,7 @@ void VJSConsole::GetDefinition( ClassDefinition& outDefinition)
 		{ "info", js_callStaticFunction<_info>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
 		{ "warn", js_callStaticFunction<_warn>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
 		{ "error", js_callStaticFunction<_error>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
+		{ "getHistory", js_callStaticFunction<_getHistory>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
 		{ 0, 0, 0}
 	};
 	
@@ -99,26 +153,25 @@ void VJSConsole::GetProperty( VJSParms_getProperty& ioParms, VRIAServerProject*
 	{
 		VJSArray result( ioParms.GetContext());
 
-		if (inApplication != NULL)
+		if (inApplication != NULL && sJSConsoleLogListener != NULL)
 		{
-			sJSConsoleLogListener->fLock.Lock();
+			std::vector<const XBOX::VValueBag*> values;
+			sJSConsoleLogListener->RetainUnreadMessages( values);
 
-			for( std::vector<const XBOX::VValueBag*>::size_type idx = 0; idx < sJSConsoleLogListener->fValues.size(); idx++ )
+			// the messages are converted here, by the reader, and not when they are logged
+			for (std::vector<const XBOX::VValueBag*>::iterator iter = values.begin() ; iter != values.end() ; ++iter)
 			{
 				VString			loggerID;
 				EMessageLevel	level;
 				VString			message;
-				VLog4jMsgFileLogger::GetLogInfosFromBag( sJSConsoleLogListener->fValues[idx], loggerID, level, message );
+				VLog4jMsgFileLogger::GetLogInfosFromBag( *iter, loggerID, level, message );
 				
 				VJSValue jsValue(ioParms.GetContext());
 				jsValue.SetString(message);
 				result.PushValue(jsValue);
 
-				sJSConsoleLogListener->fValues[idx]->Release();
+				(*iter)->Release();
 			}
-			sJSConsoleLogListener->fValues.clear();
-			sJSConsoleLogListener->fLock.Unlock();
-
 		}
 
 		ioParms.ReturnValue( result);
@@ -164,11 +217,64 @@ void VJSConsole::_error( VJSParms_callStaticFunction& ioParms, VRIAServerProject
 }
 
 
+void VJSConsole::_getHistory( VJSParms_callStaticFunction& ioParms, VRIAServerProject* inApplication)
+{
+	// console.getHistory( [sequence]) returns { messages: [{ sequence, source, level, message }], next: sequence, lost: count }
+	// A client which attaches replays the history by calling getHistory() then polls with the returned "next" sequence number.
+	sLONG8 fromSequence = 0;
+	if (ioParms.IsNumberParam( 1))
+	{
+		Real value = 0.0;
+		ioParms.GetRealParam( 1, &value);
+		if (value > 0)
+			fromSequence = (sLONG8) value;
+	}
+
+	std::vector<const XBOX::VValueBag*> values;
+	sLONG8 nextSequence = fromSequence, lostCount = 0;
+
+	if (sJSConsoleLogListener != NULL)
+		lostCount = sJSConsoleLogListener->RetainHistory( fromSequence, values, nextSequence);
+
+	VJSArray messages( ioParms.GetContext());
+	sLONG8 sequence = nextSequence - (sLONG8) values.size();
+
+	for (std::vector<const XBOX::VValueBag*>::iterator iter = values.begin() ; iter != values.end() ; ++iter, ++sequence)
+	{
+		VString			loggerID;
+		EMessageLevel	level;
+		VString			message;
+		VLog4jMsgFileLogger::GetLogInfosFromBag( *iter, loggerID, level, message );
+
+		VJSObject entry( ioParms.GetContext());
+		entry.MakeEmpty();
+		entry.SetProperty( L"sequence", sequence);
+		entry.SetProperty( L"source", loggerID);
+		entry.SetProperty( L"level", (sLONG8) level);
+		entry.SetProperty( L"message", message);
+		messages.PushValue( entry);
+
+		(*iter)->Release();
+	}
+
+	VJSObject result( ioParms.GetContext());
+	result.MakeEmpty();
+	result.SetProperty( L"messages", messages);
+	result.SetProperty( L"next", nextSequence);
+	result.SetProperty( L"lost", lostCount);
+	ioParms.ReturnValue( result);
+}
+
+
 void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProject* inApplication, const ELog4jMessageLevel& inLevel)
 {
 	VJSContext	vjsContext(ioParms.GetContext());
 	VString message;
 	VJSONArrayWriter jsonParamsArray;
+
+	// the json formatted parameters are only sent to the regular debugger (WAK0080700), so they are only built when it is attached
+	IRemoteDebuggerServer *debuggerServer = (inApplication != NULL) ? VJSGlobalContext::GetDebuggerServer() : NULL;
+	bool withDebuggerData = (debuggerServer != NULL) && (debuggerServer->GetType() == REGULAR_DBG_TYPE);
 	
 	if (ioParms.CountParams() > 0)
 	{
@@ -195,7 +301,7 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 						while ((strPos > 0) && (strPos < strFormat.GetLength()) && (parmsConsumed < parmsCount))
 						{
 							strFormat.GetSubString( staticStringPos, strPos - staticStringPos, staticString);
-							if (!staticString.IsEmpty())
+							if (withDebuggerData && !staticString.IsEmpty())
 								jsonParamsArray.AddString( staticString, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
 
 							UniChar fchar = strFormat.GetUniChar( strPos + 1);
@@ -209,7 +315,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 								strFormat.Replace( strVal, strPos, 2);
 								strPos += strVal.GetLength();
 
-								jsonParamsArray.AddLong( value);
+								if (withDebuggerData)
+									jsonParamsArray.AddLong( value);
 							}
 							else if (fchar == 'i')
 							{
@@ -221,7 +328,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 								strFormat.Replace( strVal, strPos, 2);
 								strPos += strVal.GetLength();
 
-								jsonParamsArray.AddLong( value);
+								if (withDebuggerData)
+									jsonParamsArray.AddLong( value);
 							}
 							else if (fchar == 'f')
 							{
@@ -233,7 +341,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 								strFormat.Replace( strVal, strPos, 2);
 								strPos += strVal.GetLength();
 
-								jsonParamsArray.AddReal( value);
+								if (withDebuggerData)
+									jsonParamsArray.AddReal( value);
 							}
 							else if (fchar == 'o')
 							{
@@ -252,7 +361,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 								strFormat.Replace( strVal, strPos, 2);
 								strPos += strVal.GetLength();
 
-								jsonParamsArray.AddString( strVal, JSON_AlreadyEscapedChars);
+								if (withDebuggerData)
+									jsonParamsArray.AddString( strVal, JSON_AlreadyEscapedChars);
 							}
 							else
 							{
@@ -263,7 +373,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 								strFormat.Replace( strVal, strPos, 2);
 								strPos += strVal.GetLength();
 
-								jsonParamsArray.AddString( strVal, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
+								if (withDebuggerData)
+									jsonParamsArray.AddString( strVal, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
 							}
 
 							staticStringPos = strPos;
@@ -275,19 +386,22 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 						if (staticStringPos <= strFormat.GetLength())
 						{
 							strFormat.GetSubString( staticStringPos, strFormat.GetLength() - staticStringPos + 1, staticString);
-							jsonParamsArray.AddString( staticString, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
+							if (withDebuggerData)
+								jsonParamsArray.AddString( staticString, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
 						}
 											
 						strVal.FromString( strFormat);
 					}
 					else
 					{
-						jsonParamsArray.AddString( strVal, JSON_WithQuotesIfNecessary /* | JSON_AlreadyEscapedChars */);
+						if (withDebuggerData)
+							jsonParamsArray.AddString( strVal, JSON_WithQuotesIfNecessary /* | JSON_AlreadyEscapedChars */);
 					}
 				}
 				else
 				{
-					jsonParamsArray.AddString( strVal, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
+					if (withDebuggerData)
+						jsonParamsArray.AddString( strVal, JSON_WithQuotesIfNecessary | JSON_AlreadyEscapedChars);
 				}
 			}
 			else if (ioParms.IsNumberParam( parmsConsumed + 1))
@@ -296,7 +410,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 
 				Real value = 0.0;
 				ioParms.GetRealParam( parmsConsumed + 1, &value);
-				jsonParamsArray.AddReal( value);
+				if (withDebuggerData)
+					jsonParamsArray.AddReal( value);
 
 				++parmsConsumed;
 			}
@@ -306,7 +421,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 
 				bool value = false;
 				ioParms.GetBoolParam( parmsConsumed + 1, &value);
-				jsonParamsArray.AddBool( value);
+				if (withDebuggerData)
+					jsonParamsArray.AddBool( value);
 
 				++parmsConsumed;
 			}
@@ -324,7 +440,8 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 					strVal.AppendString( "\")");
 				}
 
-				jsonParamsArray.AddString( strVal, JSON_AlreadyEscapedChars);
+				if (withDebuggerData)
+					jsonParamsArray.AddString( strVal, JSON_AlreadyEscapedChars);
 
 				++parmsConsumed;
 			}
@@ -348,23 +465,18 @@ void VJSConsole::_LogParms( VJSParms_callStaticFunction& ioParms, VRIAServerProj
 		VProcess::Get()->GetLogger()->LogBag(bag);
 		ReleaseRefCountable(&bag);
 
-		IRemoteDebuggerServer *debuggerServer = VJSGlobalContext::GetDebuggerServer();
-		if (debuggerServer != NULL)
+		if (withDebuggerData)
 		{
-			if (debuggerServer->GetType() == REGULAR_DBG_TYPE)
-			{
-				// append json formatted message for debugger
-				// sc 07/06/2013 WAK0080700, only for regular debugger
-				VString	strArray, jsonObjectString, loggerID;
-				VJSONSingleObjectWriter object;
-
-				jsonParamsArray.GetArray( strArray, false);
-				object.AddMember( L"data", strArray, JSON_AlreadyEscapedChars);
-				object.GetObject( jsonObjectString);
-				loggerID = inApplication->GetMessagesLoggerID();
-				loggerID.AppendString( L".console");
-				LogMessage( loggerID, inLevel, jsonObjectString);
-			}
+			// append json formatted message for debugger
+			VString	strArray, jsonObjectString, loggerID;
+			VJSONSingleObjectWriter object;
+
+			jsonParamsArray.GetArray( strArray, false);
+			object.AddMember( L"data", strArray, JSON_AlreadyEscapedChars);
+			object.GetObject( jsonObjectString);
+			loggerID = inApplication->GetMessagesLoggerID();
+			loggerID.AppendString( L".console");
+			LogMessage( loggerID, inLevel, jsonObjectString);
 		}
 	}
 	else
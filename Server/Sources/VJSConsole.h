@@ -38,18 +38,34 @@ public:
 	static	void			_info( XBOX::VJSParms_callStaticFunction& ioParms, VRIAServerProject* inApplication);
 	static	void			_warn( XBOX::VJSParms_callStaticFunction& ioParms, VRIAServerProject* inApplication);
 	static	void			_error( XBOX::VJSParms_callStaticFunction& ioParms, VRIAServerProject* inApplication);
+	static	void			_getHistory( XBOX::VJSParms_callStaticFunction& ioParms, VRIAServerProject* inApplication);
 
 private:
 
+	/** @brief	Keeps the latest log messages in a fixed size ring, so that the memory is bounded whatever the rate of messages.
+				Each message gets a sequence number, a reader asks for the messages which follow the last sequence number it has seen. */
 	class VJSConsoleLogListener : public XBOX::VObject, public XBOX::ILogListener
 	{
 	public:
+		enum { kHISTORY_SIZE = 1024 };
+
 						VJSConsoleLogListener();
+		virtual			~VJSConsoleLogListener();
+
 		virtual	void	Put( std::vector< const XBOX::VValueBag* >& inValuesVector );
 
-		std::vector<const XBOX::VValueBag*>		fValues;
+				/** @brief	Retains the messages whose sequence number is greater or equal to inFromSequence and which are still in the ring.
+							outNextSequence is the sequence number to pass on the next call. Returns the count of messages which have been overwritten */
+				sLONG8	RetainHistory( sLONG8 inFromSequence, std::vector<const XBOX::VValueBag*>& outValues, sLONG8& outNextSequence) const;
+
+				/** @brief	Same as RetainHistory() starting from the last message read by "console.content" */
+				void	RetainUnreadMessages( std::vector<const XBOX::VValueBag*>& outValues);
 
-		XBOX::VCriticalSection					fLock;
+	private:
+		const XBOX::VValueBag*			fRing[kHISTORY_SIZE];
+		sLONG8							fWriteSequence;		// sequence number of the next message
+		sLONG8							fReadSequence;		// sequence number of the next message to return for "console.content"
+	mutable	XBOX::VCriticalSection		fLock;				// only held to swap pointers, the messages are formatted by the readers
 	};
 
 	static	VJSConsoleLogListener*			sJSConsoleLogListener;
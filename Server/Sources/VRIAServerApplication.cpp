@@ -33,6 +33,7 @@
 #include "VRIAServerJSAPI.h"
 #include "VRIAServerJSCore.h"
 #include "VRIAServerSupervisor.h"
+#include "VRIAServerMetrics.h"
 #include "VRIAServerProgressIndicator.h"
 #include "VProject.h"
 #include "VRIAServerProjectContext.h"
@@ -1439,6 +1440,9 @@ bool VRIAServerApplication::_Init()
 	if (ok)
 		ok = VRIAServerSupervisor::Init();
 
+	if (ok)
+		ok = VRIAServerMetrics::Init();
+
 	QuickReleaseRefCountable( resFolder);
 
 #if VERSIONMAC && USE_HELPER_TOOLS
@@ -1471,6 +1475,7 @@ void VRIAServerApplication::_DeInit()
 	xbox_assert(fSolution == NULL);
 
 	VRIAServerSupervisor::DeInit();
+	VRIAServerMetrics::DeInit();
 
 	VJSWorker::SetDelegate( NULL);
 
@@ -24,6 +24,8 @@
 #include "VRIAServerHTTPSession.h"
 #include "VRIAServerApplication.h"
 #include "VRIAServerHTTPRequestHandler.h"
+#include "VRIAServerLogger.h"
+#include "VRIAServerMetrics.h"
 
 
 USING_TOOLBOX_NAMESPACE
@@ -31,15 +33,34 @@ USING_TOOLBOX_NAMESPACE
 
 
 VHTTPRequestHandler::VHTTPRequestHandler( VRIAServerProject *inApplication, const VString& inPattern)
-: fApplication(inApplication)
+: fApplication(inApplication), fDurationHistogram(NULL)
 {
 	fPatterns.push_back( inPattern);
+
+	VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+	if (metrics != NULL)
+	{
+		VString labels;
+		_GetApplicationLabel( labels);
+		VRIAServerMetrics::AppendLabel( labels, L"pattern", inPattern);
+
+		fDurationHistogram = metrics->RetainHistogram( L"wakanda_http_handler_duration_milliseconds", L"Duration of the requests served by the application request handlers.", labels);
+	}
 }
 
 
 VHTTPRequestHandler::~VHTTPRequestHandler()
 {
 	fPatterns.clear();
+
+	if (fDurationHistogram != NULL)
+	{
+		VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+		if (metrics != NULL)
+			metrics->ReleaseHistogram( &fDurationHistogram);
+		else
+			ReleaseRefCountable( &fDurationHistogram);
+	}
 }
 
 
@@ -54,6 +75,374 @@ VError VHTTPRequestHandler::GetPatterns( VectorOfVString* outPatterns) const
 }
 
 
+VError VHTTPRequestHandler::HandleRequest( IHTTPResponse* inResponse)
+{
+	uLONG startTime = VSystem::GetCurrentTime();
+
+	VError err = _HandleRequest( inResponse);
+
+	if (fDurationHistogram != NULL)
+		fDurationHistogram->Record( VSystem::GetCurrentTime() - startTime);
+
+	return err;
+}
+
+
+void VHTTPRequestHandler::_GetApplicationLabel( VString& outLabel) const
+{
+	outLabel.Clear();
+	if (fApplication != NULL)
+	{
+		VString appName;
+		fApplication->GetName( appName);
+		VRIAServerMetrics::AppendLabel( outLabel, L"application", appName);
+	}
+}
+
+
+
+// ----------------------------------------------------------------------------
+
+
+
+// Estimation of the memory used by the headers and the bookkeeping of a cached response
+const VSize kJS_RESPONSE_CACHE_ENTRY_OVERHEAD = 1024;
+
+// A stale response is served to the other requests during this delay while a request revalidates it
+const uLONG kJS_RESPONSE_CACHE_REVALIDATION_TIMEOUT = 10000;
+
+// The fresh and stale durations are clamped to 24 days (in seconds) so that they are never wrapped by the uLONG milliseconds
+const sLONG kJS_RESPONSE_CACHE_MAX_DURATION = 24 * 24 * 3600;
+
+
+/*
+	Reads the directives of "Cache-Control" which apply to a shared cache.
+	Returns false if the response must not be stored.
+*/
+static bool _GetSharedCacheDirectives( const VHTTPHeader& inHeader, uLONG& outFreshDuration, uLONG& outStaleDuration)
+{
+	outFreshDuration = 0;
+	outStaleDuration = 0;
+
+	VString cacheControl;
+	if (!inHeader.GetHeaderValue( CVSTR( "Cache-Control"), cacheControl))
+		return false;
+
+	VectorOfVString directives;
+	cacheControl.GetSubStrings( CHAR_COMMA, directives, false, true);
+
+	for (VectorOfVString::iterator iter = directives.begin() ; iter != directives.end() ; ++iter)
+	{
+		VectorOfVString nameAndValue;
+		iter->GetSubStrings( (UniChar) '=', nameAndValue, false, true);
+
+		if (nameAndValue.empty())
+			continue;
+
+		const VString& name = nameAndValue[0];
+
+		if (name.EqualToUSASCIICString( "private") || name.EqualToUSASCIICString( "no-store") || name.EqualToUSASCIICString( "no-cache"))
+			return false;
+
+		if (nameAndValue.size() > 1)
+		{
+			sLONG seconds = nameAndValue[1].GetLong();
+			if (seconds > 0)
+			{
+				if (seconds > kJS_RESPONSE_CACHE_MAX_DURATION)
+					seconds = kJS_RESPONSE_CACHE_MAX_DURATION;
+
+				if (name.EqualToUSASCIICString( "s-maxage"))
+					outFreshDuration = seconds * 1000;
+				else if (name.EqualToUSASCIICString( "stale-while-revalidate"))
+					outStaleDuration = seconds * 1000;
+			}
+		}
+	}
+
+	return (outFreshDuration > 0);
+}
+
+
+static bool _IsCacheableRequestMethod( const IHTTPRequest& inRequest)
+{
+	VString method;
+	inRequest.GetRequestMethodString( method);
+	return method.EqualToUSASCIICString( "GET") || method.EqualToUSASCIICString( "HEAD");
+}
+
+
+
+VJSResponseCache::VJSResponseCache( VSize inMaxMemorySize)
+: fMemorySize(0)
+, fMaxMemorySize(inMaxMemorySize)
+{
+}
+
+
+VJSResponseCache::~VJSResponseCache()
+{
+}
+
+
+bool VJSResponseCache::ReplyFromCache( IHTTPResponse* ioResponse)
+{
+	if (ioResponse == NULL || !_IsCacheableRequestMethod( ioResponse->GetRequest()))
+		return false;
+
+	bool replied = false;
+	VString baseKey, key;
+
+	_BuildBaseKey( ioResponse->GetRequest(), baseKey);
+
+	VTaskLock lock( &fMutex);
+
+	MapOfVaryHeaders::iterator varyIter = fVaryHeaders.find( baseKey);
+	if (varyIter != fVaryHeaders.end())
+	{
+		_BuildKey( ioResponse->GetRequest(), baseKey, varyIter->second.fHeaders, key);
+
+		MapOfCachedResponses::iterator iter = fResponses.find( key);
+		if (iter != fResponses.end())
+		{
+			sCachedResponse& cached = iter->second;
+			uLONG now = VSystem::GetCurrentTime();
+			uLONG age = now - cached.fCreationTime;
+
+			if (age >= cached.fFreshDuration + cached.fStaleDuration)
+			{
+				_RemoveResponse( iter);
+			}
+			else
+			{
+				bool fresh = (age < cached.fFreshDuration);
+
+				if (!fresh && ((cached.fRevalidationTime == 0) || (now - cached.fRevalidationTime >= kJS_RESPONSE_CACHE_REVALIDATION_TIMEOUT)))
+				{
+					// this request revalidates the response, the concurrent requests are served with the stale one
+					cached.fRevalidationTime = now;
+				}
+				else
+				{
+					// the headers are set one by one: the headers which were set by the server before the handler is called are kept
+					for (VectorOfVString::const_iterator nameIter = cached.fHeaderNames.begin(), valueIter = cached.fHeaderValues.begin() ; nameIter != cached.fHeaderNames.end() ; ++nameIter, ++valueIter)
+					{
+						bool overrideHeader = (std::find( cached.fHeaderNames.begin(), nameIter, *nameIter) == nameIter);	// the repeated headers are appended
+						ioResponse->AddResponseHeader( *nameIter, *valueIter, overrideHeader);
+					}
+					ioResponse->SetResponseStatusCode( cached.fStatusCode);
+
+					VString ageString;
+					ageString.FromLong( age / 1000);
+					ioResponse->AddResponseHeader( CVSTR( "Age"), ageString, true);
+
+					VPtrStream& body = ioResponse->GetResponseBody();
+					if (body.OpenWriting() == VE_OK)
+					{
+						body.SetSize( 0);
+						if (!cached.fBody.empty())
+							body.PutData( &cached.fBody[0], cached.fBody.size());
+						body.CloseWriting();
+					}
+					ioResponse->SetContentLengthHeader( cached.fBody.size());
+
+					fLRU.splice( fLRU.begin(), fLRU, cached.fLRUPos);
+					replied = true;
+				}
+			}
+		}
+	}
+
+	return replied;
+}
+
+
+void VJSResponseCache::StoreResponse( IHTTPResponse* inResponse)
+{
+	if (inResponse == NULL || !_IsCacheableRequestMethod( inResponse->GetRequest()) || inResponse->GetResponseStatusCode() != HTTP_OK)
+		return;
+
+	const VHTTPHeader& header = inResponse->GetResponseHeader();
+
+	uLONG freshDuration = 0, staleDuration = 0;
+	if (!_GetSharedCacheDirectives( header, freshDuration, staleDuration))
+		return;
+
+	// the responses which open or update a session are never shared
+	VString cookie;
+	if (header.GetHeaderValue( CVSTR( "Set-Cookie"), cookie) && !cookie.IsEmpty())
+		return;
+
+	// the responses streamed with sendChunkedData() or sent from a file have already been sent and have no body to store
+	VString transferEncoding;
+	if (header.GetHeaderValue( CVSTR( "Transfer-Encoding"), transferEncoding) && !transferEncoding.IsEmpty())
+		return;
+
+	const VPtrStream& body = inResponse->GetResponseBody();
+	VSize bodySize = body.GetDataSize();
+	if (bodySize == 0)
+		return;
+
+	VSize memorySize = bodySize + kJS_RESPONSE_CACHE_ENTRY_OVERHEAD;
+
+	VString baseKey, key, varyString;
+	VectorOfVString varyHeaders;
+
+	if (header.GetHeaderValue( CVSTR( "Vary"), varyString))
+	{
+		if (varyString.EqualToUSASCIICString( "*"))
+			return;
+
+		varyString.GetSubStrings( CHAR_COMMA, varyHeaders, false, true);
+	}
+
+	_BuildBaseKey( inResponse->GetRequest(), baseKey);
+	_BuildKey( inResponse->GetRequest(), baseKey, varyHeaders, key);
+	memorySize += key.GetLength() * sizeof(UniChar);
+
+	VTaskLock lock( &fMutex);
+
+	MapOfCachedResponses::iterator iter = fResponses.find( key);
+	if (iter != fResponses.end())
+		_RemoveResponse( iter);
+
+	if (memorySize > fMaxMemorySize)
+		return;
+
+	_Purge( fMaxMemorySize - memorySize);
+
+	MapOfVaryHeaders::iterator varyIter = fVaryHeaders.find( baseKey);
+	if (varyIter != fVaryHeaders.end() && varyIter->second.fHeaders != varyHeaders)
+	{
+		// the variants stored with other "Vary" headers could no longer be found
+		for (MapOfCachedResponses::iterator respIter = fResponses.begin() ; respIter != fResponses.end() ; )
+		{
+			MapOfCachedResponses::iterator next = respIter;
+			++next;
+			if (respIter->second.fBaseKey == baseKey)
+				_RemoveResponse( respIter);
+			respIter = next;
+		}
+	}
+
+	sVaryHeaders& vary = fVaryHeaders[baseKey];
+	if (vary.fVariantCount == 0)
+		vary.fHeaders = varyHeaders;
+	++vary.fVariantCount;
+
+	sCachedResponse& cached = fResponses[key];
+	cached.fBaseKey = baseKey;
+	cached.fStatusCode = inResponse->GetResponseStatusCode();
+	cached.fHeaderNames.clear();
+	cached.fHeaderValues.clear();
+	const VNameValueCollection& headerList = header.GetHeaderList();
+	for (VNameValueCollection::const_iterator headerIter = headerList.begin() ; headerIter != headerList.end() ; ++headerIter)
+	{
+		// the length is set from the cached body and the date is the one of the new response
+		if (headerIter->first.EqualToUSASCIICString( "Content-Length") || headerIter->first.EqualToUSASCIICString( "Date"))
+			continue;
+
+		cached.fHeaderNames.push_back( headerIter->first);
+		cached.fHeaderValues.push_back( headerIter->second);
+	}
+	cached.fBody.assign( (const char*) body.GetDataPtr(), (const char*) body.GetDataPtr() + bodySize);
+	cached.fCreationTime = VSystem::GetCurrentTime();
+	cached.fFreshDuration = freshDuration;
+	cached.fStaleDuration = staleDuration;
+	cached.fRevalidationTime = 0;
+	cached.fMemorySize = memorySize;
+	cached.fLRUPos = fLRU.insert( fLRU.begin(), key);
+
+	fMemorySize += memorySize;
+}
+
+
+void VJSResponseCache::Clear()
+{
+	VTaskLock lock( &fMutex);
+
+	fResponses.clear();
+	fVaryHeaders.clear();
+	fLRU.clear();
+	fMemorySize = 0;
+}
+
+
+VSize VJSResponseCache::GetMaxMemorySize() const
+{
+	VTaskLock lock( &fMutex);
+	return fMaxMemorySize;
+}
+
+
+void VJSResponseCache::SetMaxMemorySize( VSize inMaxMemorySize)
+{
+	VTaskLock lock( &fMutex);
+
+	fMaxMemorySize = inMaxMemorySize;
+	_Purge( fMaxMemorySize);
+}
+
+
+VSize VJSResponseCache::GetMemorySize() const
+{
+	VTaskLock lock( &fMutex);
+	return fMemorySize;
+}
+
+
+void VJSResponseCache::_BuildBaseKey( const IHTTPRequest& inRequest, VString& outKey) const
+{
+	inRequest.GetRequestMethodString( outKey);
+	outKey.AppendUniChar( CHAR_LINE_FEED);
+	outKey.AppendString( inRequest.GetHost());
+	outKey.AppendUniChar( CHAR_LINE_FEED);
+	outKey.AppendString( inRequest.GetURL());
+}
+
+
+void VJSResponseCache::_BuildKey( const IHTTPRequest& inRequest, const VString& inBaseKey, const VectorOfVString& inVaryHeaders, VString& outKey) const
+{
+	outKey = inBaseKey;
+
+	for (VectorOfVString::const_iterator iter = inVaryHeaders.begin() ; iter != inVaryHeaders.end() ; ++iter)
+	{
+		VString value;
+		inRequest.GetHTTPHeaders().GetHeaderValue( *iter, value);
+
+		outKey.AppendUniChar( CHAR_LINE_FEED);
+		outKey.AppendString( value);
+	}
+}
+
+
+void VJSResponseCache::_RemoveResponse( MapOfCachedResponses::iterator inIter)
+{
+	fMemorySize -= inIter->second.fMemorySize;
+	fLRU.erase( inIter->second.fLRUPos);
+
+	// forget the "Vary" headers once the last variant is gone
+	MapOfVaryHeaders::iterator varyIter = fVaryHeaders.find( inIter->second.fBaseKey);
+	if (testAssert(varyIter != fVaryHeaders.end()) && (--varyIter->second.fVariantCount <= 0))
+		fVaryHeaders.erase( varyIter);
+
+	fResponses.erase( inIter);
+}
+
+
+void VJSResponseCache::_Purge( VSize inMaxMemorySize)
+{
+	while (fMemorySize > inMaxMemorySize && !fLRU.empty())
+	{
+		MapOfCachedResponses::iterator iter = fResponses.find( fLRU.back());
+		if (testAssert(iter != fResponses.end()))
+			_RemoveResponse( iter);
+		else
+			fLRU.pop_back();
+	}
+}
+
+
 
 // ----------------------------------------------------------------------------
 
@@ -63,12 +452,31 @@ VJSRequestHandler::VJSRequestHandler( VRIAServerProject *inApplication, const VS
 : VHTTPRequestHandler( inApplication, inPattern)
 {
 	fCallback = RetainRefCountable( inCallback);
+	fRetainDurationHistogram = NULL;
+
+	VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+	if (metrics != NULL)
+	{
+		VString appLabel;
+		_GetApplicationLabel( appLabel);
+
+		fRetainDurationHistogram = metrics->RetainHistogram( L"wakanda_jscontext_retain_duration_milliseconds", L"Time spent by the request handlers waiting for a JavaScript context.", appLabel);
+	}
 }
 
 
 VJSRequestHandler::~VJSRequestHandler()
 {
 	QuickReleaseRefCountable( fCallback);
+
+	if (fRetainDurationHistogram != NULL)
+	{
+		VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+		if (metrics != NULL)
+			metrics->ReleaseHistogram( &fRetainDurationHistogram);
+		else
+			ReleaseRefCountable( &fRetainDurationHistogram);
+	}
 }
 
 
@@ -78,7 +486,7 @@ IRIAJSCallback* VJSRequestHandler::RetainCallback() const
 }
 
 
-VError VJSRequestHandler::HandleRequest( IHTTPResponse* inResponse)
+VError VJSRequestHandler::_HandleRequest( IHTTPResponse* inResponse)
 {
 	if (inResponse == NULL || fApplication == NULL || fCallback == NULL)
 		return vThrowError( VE_RIA_JS_CANNOT_CALL_REQUEST_HANDLER);
@@ -86,7 +494,31 @@ VError VJSRequestHandler::HandleRequest( IHTTPResponse* inResponse)
 	StTaskPropertiesSetter stTaskProps( &fApplication->GetMessagesLoggerID());
 	VError err = VE_OK;
 
+	VRIARequestLogger *requestLogger = fApplication->RetainRequestLogger();
+	uLONG startTime = VSystem::GetCurrentTime();
+	uLONG retainedTime = startTime, executedTime = startTime;
+
+	VJSResponseCache *responseCache = fApplication->RetainJSResponseCache();
+	if (responseCache != NULL && responseCache->ReplyFromCache( inResponse))
+	{
+		ReleaseRefCountable( &responseCache);
+
+		if (requestLogger != NULL)
+		{
+			_LogRequest( requestLogger, inResponse, startTime, startTime, startTime, true);
+			ReleaseRefCountable( &requestLogger);
+		}
+
+		return VE_OK;
+	}
+
 	VJSGlobalContext *globalContext = fApplication->RetainJSContext( err, true, &inResponse->GetRequest());
+
+	retainedTime = executedTime = VSystem::GetCurrentTime();
+
+	if (fRetainDurationHistogram != NULL)
+		fRetainDurationHistogram->Record( retainedTime - startTime);
+
 	if (globalContext != NULL && err == VE_OK)
 	{
 		VJSContext jsContext( globalContext);
@@ -94,12 +526,15 @@ VError VJSRequestHandler::HandleRequest( IHTTPResponse* inResponse)
 
 		if (testAssert(jsGlobalObject != NULL))
 		{
+			VJSScriptsCache& scriptsCache = VRIAServerApplication::Get()->GetJSContextMgr()->GetScriptsCache();
+			bool useScriptsCache = fApplication->IsScriptsCacheEnabled();
+
 			// Evaluate required file
 			for (MapOfIncludedFiles::iterator iter = fIncludedFiles.begin() ; iter != fIncludedFiles.end() ; ++iter)
 			{
 				if (jsGlobalObject->RegisterIncludedFile( iter->second))	// RegisterIncludedFile() returns false if the file is aready included
 				{
-					globalContext->EvaluateScript( iter->second, NULL);
+					scriptsCache.EvaluateScript( globalContext, iter->second, useScriptsCache);
 				}
 			}
 		}
@@ -114,6 +549,12 @@ VError VJSRequestHandler::HandleRequest( IHTTPResponse* inResponse)
 
 		VJSValue result( jsContext);
 		err = fCallback->Call( jsContext, &params, &result);
+
+		// the body readers may outlive the request
+		VHTTPRequestBodyReader::DetachReaders( jsContext);
+
+		executedTime = VSystem::GetCurrentTime();
+
 		if (err == VE_OK)
 		{
 			// If body has NOT already been set by SSJS API (using "response.body = myVar;" for example)...
@@ -130,10 +571,57 @@ VError VJSRequestHandler::HandleRequest( IHTTPResponse* inResponse)
 
 	fApplication->ReleaseJSContext( globalContext, inResponse);
 
+	if (responseCache != NULL)
+	{
+		if (err == VE_OK)
+			responseCache->StoreResponse( inResponse);
+
+		ReleaseRefCountable( &responseCache);
+	}
+
+	if (requestLogger != NULL)
+	{
+		_LogRequest( requestLogger, inResponse, startTime, retainedTime, executedTime, false);
+		ReleaseRefCountable( &requestLogger);
+	}
+
 	return err;
 }
 
 
+void VJSRequestHandler::_LogRequest( VRIARequestLogger* inLogger, IHTTPResponse* inResponse, uLONG inStartTime, uLONG inRetainedTime, uLONG inExecutedTime, bool inFromCache)
+{
+	VRIARequestLogger::sRequestRecord record;
+	const IHTTPRequest& request = inResponse->GetRequest();
+	uLONG endTime = VSystem::GetCurrentTime();
+
+	record.fTime = ::time( NULL);
+	record.fRetainDuration = inRetainedTime - inStartTime;
+	record.fExecutionDuration = inExecutedTime - inRetainedTime;
+	record.fWriteDuration = endTime - inExecutedTime;
+	record.fTotalDuration = endTime - inStartTime;
+	record.fStatusCode = inResponse->GetResponseStatusCode();
+	record.fBodySize = inResponse->GetResponseBody().GetDataSize();
+	record.fFromCache = inFromCache;
+
+	VString method;
+	request.GetRequestMethodString( method);
+	VRIARequestLogger::SetRecordString( record.fMethod, kREQUEST_LOGGER_METHOD_MAX_LENGTH, record.fMethodLength, method);
+	VRIARequestLogger::SetRecordString( record.fURL, kREQUEST_LOGGER_URL_MAX_LENGTH, record.fURLLength, request.GetURL());
+	VRIARequestLogger::SetRecordString( record.fAddress, kREQUEST_LOGGER_ADDRESS_MAX_LENGTH, record.fAddressLength, request.GetPeerIP());
+
+	VString protocol, referer, userAgent;
+	request.GetRequestHTTPVersionString( protocol);
+	request.GetHTTPHeaders().GetHeaderValue( CVSTR( "Referer"), referer);
+	request.GetHTTPHeaders().GetHeaderValue( CVSTR( "User-Agent"), userAgent);
+	VRIARequestLogger::SetRecordString( record.fProtocol, kREQUEST_LOGGER_PROTOCOL_MAX_LENGTH, record.fProtocolLength, protocol);
+	VRIARequestLogger::SetRecordString( record.fReferer, kREQUEST_LOGGER_REFERER_MAX_LENGTH, record.fRefererLength, referer);
+	VRIARequestLogger::SetRecordString( record.fUserAgent, kREQUEST_LOGGER_USER_AGENT_MAX_LENGTH, record.fUserAgentLength, userAgent);
+
+	inLogger->Log( record);
+}
+
+
 void VJSRequestHandler::RegisterIncludedFile( VFile* inFile)
 {
 	if (inFile != NULL)
@@ -186,7 +674,7 @@ VDebugHTTPRequestHandler::~VDebugHTTPRequestHandler()
 }
 
 
-VError VDebugHTTPRequestHandler::HandleRequest( IHTTPResponse* inResponse)
+VError VDebugHTTPRequestHandler::_HandleRequest( IHTTPResponse* inResponse)
 {
 	if (inResponse == NULL)
 		return VE_INVALID_PARAMETER;
@@ -560,3 +1048,70 @@ void VDebugHTTPRequestHandler::_BeginContextPoolsCleanupHandler()
 	}
 }
 
+
+
+// ----------------------------------------------------------------------------
+
+
+
+VMetricsHTTPRequestHandler::VMetricsHTTPRequestHandler( VRIAServerProject* inApplication, const VString& inPattern, const VectorOfVString& inAllowedAddresses)
+: VHTTPRequestHandler( inApplication, inPattern)
+, fAllowedAddresses( inAllowedAddresses)
+{
+}
+
+
+VMetricsHTTPRequestHandler::~VMetricsHTTPRequestHandler()
+{
+}
+
+
+VError VMetricsHTTPRequestHandler::_HandleRequest( IHTTPResponse* inResponse)
+{
+	if (inResponse == NULL)
+		return VE_INVALID_PARAMETER;
+
+	if (!_IsAllowedAddress( inResponse->GetRequest().GetPeerIP()))
+		return inResponse->ReplyWithStatusCode( HTTP_FORBIDDEN);
+
+	VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+	if (metrics == NULL)
+		return inResponse->ReplyWithStatusCode( HTTP_INTERNAL_SERVER_ERROR);
+
+	// The gauges are refreshed on scrape, the histograms are recorded by the request handlers
+	VRIAServerSolution *solution = (fApplication != NULL) ? fApplication->GetSolution() : NULL;
+	if (solution != NULL)
+	{
+		VectorOfApplication applications;
+		solution->GetApplications( applications);
+
+		for (VectorOfApplication::iterator iter = applications.begin() ; iter != applications.end() ; ++iter)
+			(*iter)->PublishMetrics();
+	}
+	else if (fApplication != NULL)
+	{
+		fApplication->PublishMetrics();
+	}
+
+	VString text;
+	metrics->Print( text);
+
+	VString contentType( L"text/plain; version=0.0.4");
+	return SetHTTPResponseString( inResponse, text, &contentType);
+}
+
+
+bool VMetricsHTTPRequestHandler::_IsAllowedAddress( const VString& inAddress) const
+{
+	// An IPv4 client may be reported with its IPv4-mapped IPv6 address
+	VString address( inAddress);
+	if (address.BeginsWith( L"::ffff:") && (address.FindUniChar( CHAR_FULL_STOP) > 0))
+		address.Remove( 1, 7);
+
+	for (VectorOfVString::const_iterator iter = fAllowedAddresses.begin() ; iter != fAllowedAddresses.end() ; ++iter)
+	{
+		if (iter->EqualToString( address) || iter->EqualToString( inAddress))
+			return true;
+	}
+	return false;
+}
@@ -23,10 +23,13 @@
 
 class VRIAServerProject;
 class IRIAJSCallback;
+class VRIARequestLogger;
+class VRIAMetricsHistogram;
 
 
 
 // VHTTPRequestHandler class : base class for the application's HTTP request handlers
+// The base class records the duration of each request, the derived classes handle the request in _HandleRequest().
 
 class VHTTPRequestHandler : public XBOX::VObject, public IHTTPRequestHandler
 {
@@ -36,10 +39,90 @@ public:
 
 	virtual XBOX::VError				GetPatterns( XBOX::VectorOfVString* outPatterns) const;
 
+	virtual	XBOX::VError				HandleRequest( IHTTPResponse* inResponse);
+
 protected:
 
+	virtual	XBOX::VError				_HandleRequest( IHTTPResponse* inResponse) = 0;
+
+			/** @brief	Returns the "application" label of the handler metrics */
+			void						_GetApplicationLabel( XBOX::VString& outLabel) const;
+
 			VRIAServerProject			*fApplication;
 			XBOX::VectorOfVString		fPatterns;
+
+private:
+			VRIAMetricsHistogram		*fDurationHistogram;
+};
+
+
+
+// ----------------------------------------------------------------------------
+
+
+
+// VJSResponseCache class : shared cache of the responses built by the JavaScript request handlers
+// A handler opts in with response.cacheFor(), which sets the "s-maxage", "stale-while-revalidate" and "Vary" headers.
+// The responses are keyed by method, host, URL and the values of the request headers listed in "Vary".
+
+class VJSResponseCache : public XBOX::VObject, public XBOX::IRefCountable
+{
+public:
+			VJSResponseCache( XBOX::VSize inMaxMemorySize);
+	virtual ~VJSResponseCache();
+
+			/** @brief	Copies the cached response into ioResponse and returns true. Returns false when the handler must be called:
+						no response is cached or the response is stale and this request has been elected to revalidate it */
+			bool					ReplyFromCache( IHTTPResponse* ioResponse);
+
+			/** @brief	Stores the response if the handler made it cacheable */
+			void					StoreResponse( IHTTPResponse* inResponse);
+
+			void					Clear();
+
+			XBOX::VSize				GetMaxMemorySize() const;
+			void					SetMaxMemorySize( XBOX::VSize inMaxMemorySize);
+			XBOX::VSize				GetMemorySize() const;
+
+private:
+
+	typedef std::list<XBOX::VString>	ListOfKeys;
+
+	typedef struct
+	{
+		XBOX::VString				fBaseKey;
+		HTTPStatusCode				fStatusCode;
+		XBOX::VectorOfVString		fHeaderNames;
+		XBOX::VectorOfVString		fHeaderValues;
+		std::vector<char>			fBody;
+		uLONG						fCreationTime;
+		uLONG						fFreshDuration;		// milliseconds
+		uLONG						fStaleDuration;		// milliseconds
+		uLONG						fRevalidationTime;	// 0 when no request is revalidating the response
+		XBOX::VSize					fMemorySize;
+		ListOfKeys::iterator		fLRUPos;
+	} sCachedResponse;
+
+	typedef struct
+	{
+		XBOX::VectorOfVString		fHeaders;
+		sLONG						fVariantCount;
+	} sVaryHeaders;
+
+	typedef XBOX::unordered_map_VString<sCachedResponse>	MapOfCachedResponses;
+	typedef XBOX::unordered_map_VString<sVaryHeaders>		MapOfVaryHeaders;
+
+			void					_BuildBaseKey( const IHTTPRequest& inRequest, XBOX::VString& outKey) const;
+			void					_BuildKey( const IHTTPRequest& inRequest, const XBOX::VString& inBaseKey, const XBOX::VectorOfVString& inVaryHeaders, XBOX::VString& outKey) const;
+			void					_RemoveResponse( MapOfCachedResponses::iterator inIter);
+			void					_Purge( XBOX::VSize inMaxMemorySize);
+
+			MapOfCachedResponses	fResponses;
+			MapOfVaryHeaders		fVaryHeaders;		// the "Vary" headers of the last response stored for each base key
+			ListOfKeys				fLRU;				// the most recently used first
+			XBOX::VSize				fMemorySize;
+			XBOX::VSize				fMaxMemorySize;
+	mutable	XBOX::VCriticalSection	fMutex;
 };
 
 
@@ -61,18 +144,23 @@ public:
 
 			IRIAJSCallback*			RetainCallback() const;
 
-	virtual	XBOX::VError			HandleRequest( IHTTPResponse* inResponse);
-
 			/** @brief	Registered file will be always included in the JavaScript context in which the request handler is called
 						The file is retained */
 			void					RegisterIncludedFile( XBOX::VFile* inFile);
 
+protected:
+
+	virtual	XBOX::VError			_HandleRequest( IHTTPResponse* inResponse);
+
 private:
 
+	static	void					_LogRequest( VRIARequestLogger* inLogger, IHTTPResponse* inResponse, uLONG inStartTime, uLONG inRetainedTime, uLONG inExecutedTime, bool inFromCache);
+
 	typedef	XBOX::unordered_map_VString<XBOX::VRefPtr<XBOX::VFile> >	MapOfIncludedFiles;
 
 			MapOfIncludedFiles		fIncludedFiles;
 			IRIAJSCallback			*fCallback;
+			VRIAMetricsHistogram	*fRetainDurationHistogram;	// time spent waiting for a JavaScript context
 };
 
 
@@ -90,7 +178,9 @@ public:
 	VDebugHTTPRequestHandler( VRIAServerProject *inApplication, const XBOX::VString& inPattern);
 	virtual ~VDebugHTTPRequestHandler();
 
-	virtual	XBOX::VError			HandleRequest( IHTTPResponse* inResponse);
+protected:
+
+	virtual	XBOX::VError			_HandleRequest( IHTTPResponse* inResponse);
 
 private:
 
@@ -111,4 +201,33 @@ private:
 };
 
 
+
+
+// ----------------------------------------------------------------------------
+
+
+
+// VMetricsHTTPRequestHandler class : serves the server metrics using the Prometheus text format
+// The handler is installed when the "metricsPattern" and "metricsAllowedAddresses" HTTP settings are defined and only answers the allowed clients.
+// The loopback clients are not trusted implicitly: behind a reverse proxy, every request comes from the loopback.
+
+class VMetricsHTTPRequestHandler : public VHTTPRequestHandler
+{
+public:
+
+	VMetricsHTTPRequestHandler( VRIAServerProject *inApplication, const XBOX::VString& inPattern, const XBOX::VectorOfVString& inAllowedAddresses);
+	virtual ~VMetricsHTTPRequestHandler();
+
+protected:
+
+	virtual	XBOX::VError			_HandleRequest( IHTTPResponse* inResponse);
+
+private:
+
+			bool					_IsAllowedAddress( const XBOX::VString& inAddress) const;
+
+			XBOX::VectorOfVString	fAllowedAddresses;
+};
+
+
 #endif
\ No newline at end of file
@@ -25,6 +25,8 @@ USING_TOOLBOX_NAMESPACE
 
 const VString kHTTP_SESSION_COOKIE_NAME( "WASID");
 
+const uLONG kEXPIRY_WHEEL_TICK_DURATION = 1000; // in milliseconds
+
 
 
 // ----------------------------------------------------------------------------
@@ -35,13 +37,18 @@ const VString kHTTP_SESSION_COOKIE_NAME( "WASID");
 
 
 VRIAHTTPSessionManager::VRIAHTTPSessionManager()
+: fClockLastTime(VSystem::GetCurrentTime())
+, fClockTime(0)
 {
 }
 
 
 VRIAHTTPSessionManager::~VRIAHTTPSessionManager()
 {
-	xbox_assert( fSessions.empty());
+#if VERSIONDEBUG
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
+		xbox_assert( fShards[shardIndex].fSessions.empty());
+#endif
 }
 
 /*
@@ -71,62 +78,134 @@ void VRIAHTTPSessionManager::AddSession( CUAGSession* inSession)
 {
 	if (inSession != NULL)
 	{
-		if (fMutex.Lock())
+		VUUID id;
+		inSession->GetID( id);
+
+		VUUID userID;
+		_GetSessionUserID( inSession, userID);
+
+		uLONG8 currentTick = _GetCurrentTick();
+
+		VSessionShard& shard = _GetShard( id);
+		if (shard.fMutex.Lock())
 		{
-			VUUID id;
-			inSession->GetID( id);
-			MapOfSession_iter found = fSessions.find( id);
-			if (found == fSessions.end())
+			MapOfSessionEntry_iter found = shard.fSessions.find( id);
+			if (found == shard.fSessions.end())
 			{
-				fSessions[id] = VRefPtr<CUAGSession>( inSession);
+				SessionEntry& entry = shard.fSessions[id];
+				entry.fSession = inSession;
+				entry.fUserID.SetNull( true);
+
+				// The session will be checked for expiration after a full revolution of the wheel
+				entry.fCheckTick = currentTick + kEXPIRY_WHEEL_SLOT_COUNT;
+				shard.fExpiryWheel[entry.fCheckTick % kEXPIRY_WHEEL_SLOT_COUNT].insert( id);
+
+				found = shard.fSessions.find( id);
 			}
-			fMutex.Unlock();
+			_SetSessionUserID( shard, found, userID);
+
+			shard.fMutex.Unlock();
 		}
 	}
 }
 
 
-void VRIAHTTPSessionManager::RemoveSession( CUAGSession* inSession)
+void VRIAHTTPSessionManager::UpdateSessionUser( CUAGSession* inSession)
 {
 	if (inSession != NULL)
 	{
-		if (fMutex.Lock())
+		VUUID id;
+		inSession->GetID( id);
+
+		VUUID userID;
+		_GetSessionUserID( inSession, userID);
+
+		VSessionShard& shard = _GetShard( id);
+		if (shard.fMutex.Lock())
 		{
-			VUUID id;
-			inSession->GetID( id);
-			fSessions.erase( id);
-			fMutex.Unlock();
+			MapOfSessionEntry_iter found = shard.fSessions.find( id);
+			if (found != shard.fSessions.end())
+				_SetSessionUserID( shard, found, userID);
+
+			shard.fMutex.Unlock();
 		}
 	}
 }
 
 
+void VRIAHTTPSessionManager::RemoveSession( CUAGSession* inSession)
+{
+	if (inSession != NULL)
+	{
+		VUUID id;
+		inSession->GetID( id);
+		RemoveSession( id);
+	}
+}
+
+
 void VRIAHTTPSessionManager::RemoveSession( const VUUID& inID)
 {
-	if (fMutex.Lock())
+	VSessionShard& shard = _GetShard( inID);
+	if (shard.fMutex.Lock())
 	{
-		fSessions.erase( inID);
-		fMutex.Unlock();
+		MapOfSessionEntry_iter found = shard.fSessions.find( inID);
+		if (found != shard.fSessions.end())
+			_RemoveSession( shard, found);
+
+		shard.fMutex.Unlock();
 	}
 }
 
 
 void VRIAHTTPSessionManager::RemoveExpiredSessions()
 {
-	if (fMutex.Lock())
-	{
-		std::vector<VUUID> expiredSessionIDs;
+	uLONG8 currentTick = _GetCurrentTick();
 
-		for (MapOfSession_iter sIter = fSessions.begin() ; sIter != fSessions.end() ; ++sIter)
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
+	{
+		VSessionShard& shard = fShards[shardIndex];
+		if (shard.fMutex.Lock())
 		{
-			if ((*sIter).second->hasExpired())
-				expiredSessionIDs.push_back( (*sIter).first);
-		}
+			// If more than one revolution has elapsed, each slot is processed only once
+			if (currentTick - shard.fExpiryWheelTick > kEXPIRY_WHEEL_SLOT_COUNT)
+				shard.fExpiryWheelTick = currentTick - kEXPIRY_WHEEL_SLOT_COUNT;
 
-		for (std::vector<VUUID>::iterator idIter = expiredSessionIDs.begin() ; idIter != expiredSessionIDs.end() ; ++idIter)
-			fSessions.erase( *idIter);
+			while (shard.fExpiryWheelTick < currentTick)
+			{
+				uLONG8 tick = ++shard.fExpiryWheelTick;
+				SetOfSessionID& slot = shard.fExpiryWheel[tick % kEXPIRY_WHEEL_SLOT_COUNT];
+
+				SetOfSessionID sessionIDs;
+				sessionIDs.swap( slot);
 
-		fMutex.Unlock();
+				for (SetOfSessionID::iterator idIter = sessionIDs.begin() ; idIter != sessionIDs.end() ; ++idIter)
+				{
+					MapOfSessionEntry_iter found = shard.fSessions.find( *idIter);
+					if (testAssert(found != shard.fSessions.end()))
+					{
+						SessionEntry& entry = found->second;
+
+						if (entry.fCheckTick > tick)
+						{
+							// Not yet due: the session stays in the same slot
+							slot.insert( *idIter);
+						}
+						else if (entry.fSession->hasExpired())
+						{
+							entry.fCheckTick = tick;	// the session is no longer in the wheel
+							_RemoveSession( shard, found);
+						}
+						else
+						{
+							entry.fCheckTick = tick + kEXPIRY_WHEEL_SLOT_COUNT;
+							slot.insert( *idIter);
+						}
+					}
+				}
+			}
+			shard.fMutex.Unlock();
+		}
 	}
 }
 
@@ -135,14 +214,15 @@ CUAGSession* VRIAHTTPSessionManager::RetainSession( const VUUID& inID) const
 {
 	CUAGSession *session = NULL;
 
-	if (fMutex.Lock())
+	VSessionShard& shard = _GetShard( inID);
+	if (shard.fMutex.Lock())
 	{
-		MapOfSession_citer found = fSessions.find( inID);
-		if (found != fSessions.end())
+		MapOfSessionEntry_citer found = shard.fSessions.find( inID);
+		if (found != shard.fSessions.end())
 		{
-			session = RetainRefCountable( found->second.Get());
+			session = RetainRefCountable( found->second.fSession.Get());
 		}
-		fMutex.Unlock();
+		shard.fMutex.Unlock();
 	}
 	return session;
 }
@@ -150,14 +230,34 @@ CUAGSession* VRIAHTTPSessionManager::RetainSession( const VUUID& inID) const
 
 void VRIAHTTPSessionManager::RetainSessions(const XBOX::VUUID& inUserID, SessionVector& outSessions) // if inUserID is null then returns all sessions
 {
-	VTaskLock lock(&fMutex);
-	outSessions.reserve(fSessions.size());
-	for (MapOfSession_citer cur = fSessions.begin(), end = fSessions.end(); cur != end; ++cur)
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
 	{
-		CUAGSession* session = cur->second.Get();
-		if (session != nil && (inUserID.IsNull() || session->Matches(inUserID)))
+		VSessionShard& shard = fShards[shardIndex];
+		VTaskLock lock(&shard.fMutex);
+
+		if (inUserID.IsNull())
+		{
+			outSessions.reserve( outSessions.size() + shard.fSessions.size());
+			for (MapOfSessionEntry_citer cur = shard.fSessions.begin(), end = shard.fSessions.end(); cur != end; ++cur)
+			{
+				CUAGSession* session = cur->second.fSession.Get();
+				if (session != nil)
+					outSessions.push_back(session);
+			}
+		}
+		else
 		{
-			outSessions.push_back(session);
+			std::pair<MapOfSessionIDByUserID::const_iterator,MapOfSessionIDByUserID::const_iterator> range = shard.fSessionIDsByUserID.equal_range( inUserID);
+			for (MapOfSessionIDByUserID::const_iterator cur = range.first ; cur != range.second ; ++cur)
+			{
+				MapOfSessionEntry_citer found = shard.fSessions.find( cur->second);
+				if (testAssert(found != shard.fSessions.end()))
+				{
+					CUAGSession* session = found->second.fSession.Get();
+					if (session != nil && session->Matches(inUserID))
+						outSessions.push_back(session);
+				}
+			}
 		}
 	}
 }
@@ -166,11 +266,36 @@ void VRIAHTTPSessionManager::RetainSessions(const XBOX::VUUID& inUserID, Session
 
 void VRIAHTTPSessionManager::Clear()
 {
-	if (fMutex.Lock())
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
+	{
+		VSessionShard& shard = fShards[shardIndex];
+		if (shard.fMutex.Lock())
+		{
+			shard.fSessions.clear();
+			shard.fSessionIDsByUserID.clear();
+			for (sLONG slotIndex = 0 ; slotIndex < kEXPIRY_WHEEL_SLOT_COUNT ; ++slotIndex)
+				shard.fExpiryWheel[slotIndex].clear();
+
+			shard.fMutex.Unlock();
+		}
+	}
+}
+
+
+sLONG VRIAHTTPSessionManager::GetSessionCount() const
+{
+	sLONG count = 0;
+
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
 	{
-		fSessions.clear();
-		fMutex.Unlock();
+		VSessionShard& shard = fShards[shardIndex];
+		if (shard.fMutex.Lock())
+		{
+			count += (sLONG) shard.fSessions.size();
+			shard.fMutex.Unlock();
+		}
 	}
+	return count;
 }
 
 
@@ -205,3 +330,88 @@ CUAGSession* VRIAHTTPSessionManager::RetainSessionFromCookie( const IHTTPRequest
 
 	return session;
 }
+
+
+uLONG8 VRIAHTTPSessionManager::_GetCurrentTick()
+{
+	VTaskLock lock( &fClockMutex);
+
+	// The elapsed time is computed modulo 2^32 so that the wrap of VSystem::GetCurrentTime() is transparent,
+	// as long as the clock is read at least once every 24 days (the sessions are checked far more often)
+	uLONG currentTime = VSystem::GetCurrentTime();
+	sLONG elapsedTime = (sLONG) (currentTime - fClockLastTime);
+	if (elapsedTime > 0)
+	{
+		fClockTime += (uLONG8) elapsedTime;
+		fClockLastTime = currentTime;
+	}
+
+	// The clock starts one revolution ahead so that the wheel never goes back before 0
+	return fClockTime / kEXPIRY_WHEEL_TICK_DURATION + kEXPIRY_WHEEL_SLOT_COUNT;
+}
+
+
+VRIAHTTPSessionManager::VSessionShard& VRIAHTTPSessionManager::_GetShard( const VUUID& inID) const
+{
+	// The session IDs are random: the first bytes are enough to spread the sessions
+	const VUUIDBuffer& buffer = inID.GetBuffer();
+	return fShards[buffer.fBytes[0] % kSHARD_COUNT];
+}
+
+
+void VRIAHTTPSessionManager::_GetSessionUserID( CUAGSession* inSession, VUUID& outUserID)
+{
+	outUserID.SetNull( true);
+	CUAGUser *user = inSession->RetainUser();
+	if (user != NULL)
+	{
+		user->GetID( outUserID);
+		user->Release();
+	}
+}
+
+
+void VRIAHTTPSessionManager::_SetSessionUserID( VSessionShard& ioShard, MapOfSessionEntry_iter inIter, const VUUID& inUserID)
+{
+	const VUUID& id = inIter->first;
+	SessionEntry& entry = inIter->second;
+
+	if (entry.fUserID.IsNull() && inUserID.IsNull())
+		return;
+
+	if (!entry.fUserID.IsNull())
+	{
+		if (entry.fUserID == inUserID)
+			return;
+
+		std::pair<MapOfSessionIDByUserID::iterator,MapOfSessionIDByUserID::iterator> range = ioShard.fSessionIDsByUserID.equal_range( entry.fUserID);
+		for (MapOfSessionIDByUserID::iterator iter = range.first ; iter != range.second ; ++iter)
+		{
+			if (iter->second == id)
+			{
+				ioShard.fSessionIDsByUserID.erase( iter);
+				break;
+			}
+		}
+	}
+
+	entry.fUserID = inUserID;
+
+	if (!inUserID.IsNull())
+		ioShard.fSessionIDsByUserID.insert( MapOfSessionIDByUserID::value_type( inUserID, id));
+}
+
+
+void VRIAHTTPSessionManager::_RemoveSession( VSessionShard& ioShard, MapOfSessionEntry_iter inIter)
+{
+	const VUUID& id = inIter->first;
+	SessionEntry& entry = inIter->second;
+
+	ioShard.fExpiryWheel[entry.fCheckTick % kEXPIRY_WHEEL_SLOT_COUNT].erase( id);
+
+	VUUID nullID;
+	nullID.SetNull( true);
+	_SetSessionUserID( ioShard, inIter, nullID);
+
+	ioShard.fSessions.erase( inIter);
+}
@@ -34,13 +34,12 @@ class CUAGSession;
 
 
 
+// The sessions are spread over shards, each shard having its own mutex.
+// Each shard owns an expiry wheel: a session is checked for expiration once per wheel revolution, so that RemoveExpiredSessions() only checks the sessions of the elapsed slots.
 class VRIAHTTPSessionManager : public XBOX::VObject, public XBOX::IRefCountable
 {
 public:
 
-	typedef std::map< XBOX::VUUID, XBOX::VRefPtr<CUAGSession> >					MapOfSession;
-	typedef std::map< XBOX::VUUID, XBOX::VRefPtr<CUAGSession> >::iterator		MapOfSession_iter;
-	typedef std::map< XBOX::VUUID, XBOX::VRefPtr<CUAGSession> >::const_iterator	MapOfSession_citer;
 	typedef std::vector<XBOX::VRefPtr<CUAGSession> >							SessionVector;
 
 			VRIAHTTPSessionManager();
@@ -49,21 +48,70 @@ public:
 			/** @brief	The UAG session and the session storage are retained.
 						If the session storage is NULL, a new session storage is created automatically */
 			//CUAGSession*				CreateAndRetainSession( CUAGSession *inUAGSession, XBOX::VJSSessionStorageObject *inSessionStorageObject, sLONG inLifeTime = kDEFAULT_LIFE_TIME);
+			/** @brief	If the session is already registered, its user is indexed again (the user of a session changes on login) */
 			void						AddSession( CUAGSession* inSession);
+			/** @brief	Index again the user of the session if it is registered. Call it when the user of the session has changed */
+			void						UpdateSessionUser( CUAGSession* inSession);
 			void						RemoveSession( CUAGSession* inSession);
 			void						RemoveSession( const XBOX::VUUID& inID);
-			/** @brief	Remove all the sessions which have expired */
+			/** @brief	Remove the sessions which have expired */
 			void						RemoveExpiredSessions();
 			CUAGSession*				RetainSession( const XBOX::VUUID& inID) const;
 			void						Clear();
 
+			sLONG						GetSessionCount() const;
+
 			CUAGSession*				RetainSessionFromCookie( const IHTTPRequest& inRequest) const;
+			/** @brief	If inUserID is null then returns all sessions */
 			void						RetainSessions(const XBOX::VUUID& inUserID, SessionVector& outSessions);
 
 private:
-
-			MapOfSession				fSessions;
+	enum { kSHARD_COUNT = 16 };
+	enum { kEXPIRY_WHEEL_SLOT_COUNT = 64 };
+
+	typedef struct
+	{
+		XBOX::VRefPtr<CUAGSession>	fSession;
+		XBOX::VUUID					fUserID;
+		uLONG8						fCheckTick;		// the wheel tick at which the session will be checked for expiration
+	} SessionEntry;
+
+	typedef std::map< XBOX::VUUID, SessionEntry >							MapOfSessionEntry;
+	typedef std::map< XBOX::VUUID, SessionEntry >::iterator					MapOfSessionEntry_iter;
+	typedef std::map< XBOX::VUUID, SessionEntry >::const_iterator			MapOfSessionEntry_citer;
+	typedef std::multimap< XBOX::VUUID, XBOX::VUUID >						MapOfSessionIDByUserID;
+	typedef std::set< XBOX::VUUID >											SetOfSessionID;
+
+	class VSessionShard
+	{
+	public:
+			VSessionShard() : fExpiryWheelTick(0) {;}
+
+			MapOfSessionEntry			fSessions;
+			MapOfSessionIDByUserID		fSessionIDsByUserID;
+			SetOfSessionID				fExpiryWheel[kEXPIRY_WHEEL_SLOT_COUNT];
+			uLONG8						fExpiryWheelTick;	// the last processed wheel tick
 	mutable	XBOX::VCriticalSection		fMutex;
+	};
+
+			/** @brief	Returns the current tick of a 64 bits monotonic clock: VSystem::GetCurrentTime() wraps after 49.7 days */
+			uLONG8						_GetCurrentTick();
+
+			VSessionShard&				_GetShard( const XBOX::VUUID& inID) const;
+
+			/** @brief	Returns the ID of the user of the session or a null ID */
+	static	void						_GetSessionUserID( CUAGSession* inSession, XBOX::VUUID& outUserID);
+			/** @brief	The shard mutex must be locked */
+			void						_SetSessionUserID( VSessionShard& ioShard, MapOfSessionEntry_iter inIter, const XBOX::VUUID& inUserID);
+
+			/** @brief	The shard mutex must be locked */
+			void						_RemoveSession( VSessionShard& ioShard, MapOfSessionEntry_iter inIter);
+
+	mutable	VSessionShard				fShards[kSHARD_COUNT];
+
+			XBOX::VCriticalSection		fClockMutex;
+			uLONG						fClockLastTime;		// the last value of VSystem::GetCurrentTime()
+			uLONG8						fClockTime;			// the monotonic time in milliseconds
 };
 
 
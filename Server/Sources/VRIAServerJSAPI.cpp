@@ -74,6 +74,7 @@ const char kSSJS_PROPERTY_NAME_OS[] = "os";
 const char kSSJS_PROPERTY_NAME_Permissions[] = "permissions";
 const char kSSJS_PROPERTY_NAME_backupSettings[] = "backupSettings";
 const char kSSJS_PROPERTY_NAME_wildchar[] = "wildchar";
+const char kSSJS_PROPERTY_NAME_SyntaxTester[] = "_syntaxTester";
 
 const char kSSJS_PROPERTY_NAME_verifyDataStore[] = "verifyDataStore";
 const char kSSJS_PROPERTY_NAME_repairDataStore[] = "repairDataStore";
@@ -117,12 +118,14 @@ bool SetHTTPResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPResponse *i
 			if (XBOX::VTC_UNKNOWN == charSet)
 				charSet = XBOX::VTC_UTF_8;
 
-			XBOX::StStringConverter<char> buffer (valueString, charSet);
-			ioResponse->SetResponseBody (buffer.GetCPointer(), buffer.GetLength());
-			ioResponse->SetContentTypeHeader (contentType, charSet);
-			ioResponse->SetContentLengthHeader (buffer.GetLength());
+			XBOX::VSize bodySize = 0;
+			if (XBOX::VE_OK == SetHTTPResponseBodyText (ioResponse, valueString, charSet, bodySize))
+			{
+				ioResponse->SetContentTypeHeader (contentType, charSet);
+				ioResponse->SetContentLengthHeader (bodySize);
 
-			result = true;
+				result = true;
+			}
 		}
 	}
 	else
@@ -168,10 +171,14 @@ bool SetHTTPResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPResponse *i
 					ioResponse->SetContentTypeHeader (contentType);
 				}
 
-				if (XBOX::VE_OK == ioResponse->GetResponseBody().OpenWriting())
-				{
-					XBOX::VBlobWithPtr *blob = dynamic_cast<XBOX::VBlobWithPtr *>(value);
+				XBOX::VBlobWithPtr *blob = dynamic_cast<XBOX::VBlobWithPtr *>(value);
 
+				if (NULL == blob)
+				{
+					error = XBOX::VE_INVALID_PARAMETER;
+				}
+				else if (XBOX::VE_OK == ioResponse->GetResponseBody().OpenWriting())
+				{
 					error = ioResponse->GetResponseBody().PutData (blob->GetDataPtr(), blob->GetSize());
 
 					ioResponse->GetResponseBody().CloseWriting();
@@ -184,17 +191,19 @@ bool SetHTTPResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPResponse *i
 			}
 
 			result = (XBOX::VE_OK == error);
+
+			// The value is a copy of the JavaScript value
+			delete value;
 		}
 		else // Object is null... Try to get a string value (probably something like "undefined")
 		{
 			XBOX::VString valueString;
+			XBOX::VSize bodySize = 0;
 
-			if (inValue.GetString (valueString))
+			if (inValue.GetString (valueString) && (XBOX::VE_OK == SetHTTPResponseBodyText (ioResponse, valueString, XBOX::VTC_UTF_8, bodySize)))
 			{
-				XBOX::StStringConverter<char> buffer (valueString, XBOX::VTC_UTF_8);
-				ioResponse->SetResponseBody (buffer.GetCPointer(), buffer.GetLength());
 				ioResponse->SetContentTypeHeader (CVSTR ("text/plain"), XBOX::VTC_UTF_8);
-				ioResponse->SetContentLengthHeader (buffer.GetLength());
+				ioResponse->SetContentLengthHeader (bodySize);
 
 				result = true;
 			}
@@ -272,6 +281,7 @@ bool SendChunkedResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPRespons
 		{
 			XBOX::VPtrStream		stream;
 			XBOX::VValueSingle *	value = inValue.CreateVValue();
+			XBOX::VBlobWithPtr *	blob = NULL;
 
 			if (NULL != value)
 			{
@@ -307,14 +317,10 @@ bool SendChunkedResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPRespons
 						ioResponse->SetContentTypeHeader (contentType);
 					}
 
-					if (XBOX::VE_OK == stream.OpenWriting())
-					{
-						XBOX::VBlobWithPtr *blob = dynamic_cast<XBOX::VBlobWithPtr *>(value);
-
-						error = stream.PutData (blob->GetDataPtr(), blob->GetSize());
-
-						stream.CloseWriting();
-					}
+					// The blob data is sent as is, without copying it into the stream
+					blob = dynamic_cast<XBOX::VBlobWithPtr *>(value);
+					if (NULL == blob)
+						error = XBOX::VE_INVALID_PARAMETER;
 				}
 				else
 				{
@@ -326,7 +332,11 @@ bool SendChunkedResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPRespons
 				error = XBOX::VE_INVALID_PARAMETER;
 			}
 
-			if (XBOX::VE_OK == error)
+			if ((XBOX::VE_OK == error) && (NULL != blob))
+			{
+				error = ioResponse->SendData (blob->GetDataPtr(), blob->GetSize(), true);
+			}
+			else if (XBOX::VE_OK == error)
 			{
 				if (XBOX::VE_OK == (error = stream.OpenReading()))
 					error = ioResponse->SendData (stream.GetDataPtr(), stream.GetDataSize(), true);
@@ -336,6 +346,9 @@ bool SendChunkedResponseFromJSValue (const XBOX::VJSValue& inValue, IHTTPRespons
 			{
 				ioResponse->ReplyWithStatusCode (HTTP_INTERNAL_SERVER_ERROR);
 			}
+
+			// The value is a copy of the JavaScript value
+			delete value;
 		}
 
 		result = (XBOX::VE_OK == error);
@@ -662,6 +675,451 @@ void VJSHTTPResponseHeader::GetDefinition (ClassDefinition& outDefinition)
 //--------------------------------------------------------------------------------------------------
 
 
+const XBOX::VSize kBODY_READER_DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+
+// The readers created while a request is handled, stored as a specific of the global object
+class VHTTPRequestBodyReadersList : public XBOX::VObject
+{
+public:
+			VHTTPRequestBodyReadersList()
+			{
+			}
+
+	virtual	~VHTTPRequestBodyReadersList()
+			{
+				for (std::vector<VHTTPRequestBodyReader*>::iterator iter = fReaders.begin() ; iter != fReaders.end() ; ++iter)
+				{
+					(*iter)->Detach();
+					(*iter)->Release();
+				}
+			}
+
+			void	Add (VHTTPRequestBodyReader *inReader)
+			{
+				fReaders.push_back (XBOX::RetainRefCountable (inReader));
+			}
+
+private:
+			std::vector<VHTTPRequestBodyReader*>	fReaders;
+};
+
+
+VHTTPRequestBodyReader::VHTTPRequestBodyReader (IHTTPRequest *inRequest)
+: fRequest (inRequest)
+, fPosition (0)
+, fCharSet (XBOX::VTC_UNKNOWN)
+{
+	xbox_assert (NULL != fRequest);
+
+	XBOX::VString contentType;
+	fRequest->GetContentTypeHeader (contentType, &fCharSet);
+
+	if (XBOX::VTC_UNKNOWN == fCharSet)
+		fCharSet = XBOX::VTC_UTF_8;
+}
+
+
+VHTTPRequestBodyReader::~VHTTPRequestBodyReader()
+{
+}
+
+
+const XBOX::VPtrStream& VHTTPRequestBodyReader::_GetBody() const
+{
+	xbox_assert (NULL != fRequest);
+	return fRequest->GetRequestBody();
+}
+
+
+XBOX::VSize VHTTPRequestBodyReader::GetSize() const
+{
+	return (NULL != fRequest) ? _GetBody().GetDataSize() : 0;
+}
+
+
+XBOX::VSize VHTTPRequestBodyReader::_GetCharactersBoundary (const uBYTE *inData, XBOX::VSize inSize, XBOX::VSize inStart, XBOX::VSize inEnd) const
+{
+	if (inEnd >= inSize)
+		return inSize;
+
+	XBOX::VSize boundary = inEnd;
+
+	switch (fCharSet)
+	{
+		case XBOX::VTC_UTF_8:
+			{
+				// back off to the lead byte of the character cut by the chunk boundary
+				while ((boundary > inStart) && ((inData[boundary] & 0xC0) == 0x80))
+					--boundary;
+
+				if (boundary == inStart)
+				{
+					// the chunk is smaller than a single character
+					boundary = inEnd;
+					while ((boundary < inSize) && ((inData[boundary] & 0xC0) == 0x80))
+						++boundary;
+				}
+				break;
+			}
+
+		case XBOX::VTC_UTF_16:
+		case XBOX::VTC_UTF_16_BIGENDIAN:
+		case XBOX::VTC_UTF_16_SMALLENDIAN:
+			{
+				// keep whole code units and never separate the two halves of a surrogate pair
+				boundary = inStart + ((boundary - inStart) & ~((XBOX::VSize) 1));
+				if (boundary - inStart < 4)
+					boundary = inStart + 4;
+
+				if (boundary < inSize)
+				{
+					bool bigEndian = (XBOX::VTC_UTF_16_BIGENDIAN == fCharSet);
+				#if BIGENDIAN
+					if (XBOX::VTC_UTF_16 == fCharSet)
+						bigEndian = true;
+				#endif
+					UniChar lastUnit = bigEndian ? (UniChar) ((inData[boundary - 2] << 8) | inData[boundary - 1]) : (UniChar) ((inData[boundary - 1] << 8) | inData[boundary - 2]);
+					if ((lastUnit >= 0xD800) && (lastUnit <= 0xDBFF))
+						boundary -= 2;
+				}
+				break;
+			}
+
+		case XBOX::VTC_UTF_32:
+		case XBOX::VTC_UTF_32_BIGENDIAN:
+		case XBOX::VTC_UTF_32_SMALLENDIAN:
+			{
+				boundary = inStart + ((boundary - inStart) & ~((XBOX::VSize) 3));
+				if (boundary == inStart)
+					boundary = inStart + 4;
+				break;
+			}
+
+		case XBOX::VTC_US_ASCII:
+		case XBOX::VTC_ISO_8859_1:
+			break;
+
+		default:
+			{
+				// The multi-byte charsets (Shift-JIS, EUC, GB18030, Big5...) cannot be segmented without decoding them,
+				// but their sequences never contain a byte below 0x30: the chunk is cut after such a byte.
+				while ((boundary > inStart) && (inData[boundary - 1] >= 0x30))
+					--boundary;
+
+				if (boundary == inStart)
+				{
+					boundary = inEnd;
+					while ((boundary < inSize) && (inData[boundary - 1] >= 0x30))
+						++boundary;
+				}
+				break;
+			}
+	}
+
+	return (boundary < inSize) ? boundary : inSize;
+}
+
+
+XBOX::VError VHTTPRequestBodyReader::ReadText (XBOX::VSize inMaxBytes, XBOX::VString& outText)
+{
+	outText.Clear();
+
+	if ((inMaxBytes == 0) || (NULL == fRequest))
+		return XBOX::VE_INVALID_PARAMETER;
+
+	XBOX::VSize size = GetSize();
+	if (fPosition >= size)
+		return XBOX::VE_OK;
+
+	const uBYTE *data = (const uBYTE *) _GetBody().GetDataPtr();
+	XBOX::VSize end = (size - fPosition > inMaxBytes) ? fPosition + inMaxBytes : size;
+
+	// never split a character between two chunks
+	end = _GetCharactersBoundary (data, size, fPosition, end);
+
+	outText.FromBlock (data + fPosition, end - fPosition, fCharSet);
+	fPosition = end;
+
+	return XBOX::VE_OK;
+}
+
+
+XBOX::VError VHTTPRequestBodyReader::WriteToFile (XBOX::VFile& inFile, XBOX::VSize inChunkSize, XBOX::VSize& outWrittenBytes)
+{
+	outWrittenBytes = 0;
+
+	if ((inChunkSize == 0) || (NULL == fRequest))
+		return XBOX::VE_INVALID_PARAMETER;
+
+	XBOX::VFileStream	stream (&inFile);
+	XBOX::VError		error = stream.OpenWriting();
+
+	if (XBOX::VE_OK == error)
+	{
+		const uBYTE *	data = (const uBYTE *) _GetBody().GetDataPtr();
+		XBOX::VSize		size = GetSize();
+
+		error = stream.SetSize (0);
+
+		while ((XBOX::VE_OK == error) && (fPosition < size))
+		{
+			XBOX::VSize chunkSize = (size - fPosition > inChunkSize) ? inChunkSize : size - fPosition;
+
+			error = stream.PutData (data + fPosition, chunkSize);
+			if (XBOX::VE_OK == error)
+			{
+				fPosition += chunkSize;
+				outWrittenBytes += chunkSize;
+			}
+		}
+
+		XBOX::VError closeError = stream.CloseWriting();
+		if (XBOX::VE_OK == error)
+			error = closeError;
+	}
+
+	return error;
+}
+
+
+void VHTTPRequestBodyReader::RegisterReader (const XBOX::VJSContext& inContext, VHTTPRequestBodyReader *inReader)
+{
+	XBOX::VJSGlobalObject *globalObject = inContext.GetGlobalObjectPrivateInstance();
+	if ((NULL != globalObject) && (NULL != inReader))
+	{
+		VHTTPRequestBodyReadersList *readers = static_cast<VHTTPRequestBodyReadersList*>( globalObject->GetSpecific ('rdrX'));
+		if (NULL == readers)
+		{
+			readers = new VHTTPRequestBodyReadersList();
+			if ((NULL != readers) && !globalObject->SetSpecific ('rdrX', readers, XBOX::VJSSpecifics::DestructorVObject))
+			{
+				delete readers;
+				readers = NULL;
+			}
+		}
+
+		if (NULL != readers)
+			readers->Add (inReader);
+		else
+			inReader->Detach();	// cannot be detached later
+	}
+}
+
+
+void VHTTPRequestBodyReader::DetachReaders (const XBOX::VJSContext& inContext)
+{
+	XBOX::VJSGlobalObject *globalObject = inContext.GetGlobalObjectPrivateInstance();
+	if (NULL != globalObject)
+	{
+		// the readers list destructor detaches the readers
+		if (NULL != globalObject->GetSpecific ('rdrX'))
+			globalObject->SetSpecific ('rdrX', NULL, XBOX::VJSSpecifics::DestructorVObject);
+	}
+}
+
+
+//--------------------------------------------------------------------------------------------------
+
+
+void VJSHTTPRequestBodyReader::Initialize (const XBOX::VJSParms_initialize& inParms, VHTTPRequestBodyReader *inReader)
+{
+	XBOX::RetainRefCountable (inReader);
+}
+
+
+void VJSHTTPRequestBodyReader::Finalize (const XBOX::VJSParms_finalize& inParms, VHTTPRequestBodyReader *inReader)
+{
+	XBOX::ReleaseRefCountable (&inReader);
+}
+
+
+void VJSHTTPRequestBodyReader::_GetSize (XBOX::VJSParms_getProperty& ioParms, VHTTPRequestBodyReader *inReader)
+{
+	if ((NULL == inReader) || inReader->IsDetached())
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	ioParms.ReturnNumber (inReader->GetSize());
+}
+
+
+void VJSHTTPRequestBodyReader::_GetPosition (XBOX::VJSParms_getProperty& ioParms, VHTTPRequestBodyReader *inReader)
+{
+	if ((NULL == inReader) || inReader->IsDetached())
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	ioParms.ReturnNumber (inReader->GetPosition());
+}
+
+
+void VJSHTTPRequestBodyReader::_GetEOF (XBOX::VJSParms_getProperty& ioParms, VHTTPRequestBodyReader *inReader)
+{
+	if ((NULL == inReader) || inReader->IsDetached())
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	ioParms.ReturnBool (inReader->IsEOF());
+}
+
+
+bool VJSHTTPRequestBodyReader::_GetChunkSizeParam (XBOX::VJSParms_callStaticFunction& ioParms, size_t inIndex, XBOX::VSize& outChunkSize)
+{
+	outChunkSize = kBODY_READER_DEFAULT_CHUNK_SIZE;
+
+	if (ioParms.CountParams() >= inIndex)
+	{
+		sLONG chunkSize = 0;
+		if (!ioParms.GetLongParam (inIndex, &chunkSize) || (chunkSize <= 0))
+			return false;
+
+		outChunkSize = chunkSize;
+	}
+
+	return true;
+}
+
+
+void VJSHTTPRequestBodyReader::_Read (XBOX::VJSParms_callStaticFunction& ioParms, VHTTPRequestBodyReader *inReader)
+{
+	/*
+	 *	JS Sample code usage:
+	 *	var reader = request.createBodyReader();
+	 *	var chunk;
+	 *	while ((chunk = reader.read (16384)) != null)
+	 *		...
+	 */
+	XBOX::VSize chunkSize = 0;
+
+	if ((NULL == inReader) || inReader->IsDetached() || !_GetChunkSizeParam (ioParms, 1, chunkSize))
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	if (inReader->IsEOF())
+	{
+		ioParms.ReturnNullValue();
+		return;
+	}
+
+	XBOX::VString	chunk;
+	XBOX::VError	error = inReader->ReadText (chunkSize, chunk);
+
+	if (XBOX::VE_OK == error)
+		ioParms.ReturnString (chunk);
+	else
+		XBOX::vThrowError (error);
+}
+
+
+void VJSHTTPRequestBodyReader::_Next (XBOX::VJSParms_callStaticFunction& ioParms, VHTTPRequestBodyReader *inReader)
+{
+	/*
+	 *	JS Sample code usage:
+	 *	var reader = request.createBodyReader();
+	 *	for (var item = reader.next(); !item.done; item = reader.next())
+	 *		... item.value ...
+	 */
+	XBOX::VSize chunkSize = 0;
+
+	if ((NULL == inReader) || inReader->IsDetached() || !_GetChunkSizeParam (ioParms, 1, chunkSize))
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	XBOX::VJSObject	resultObject (ioParms.GetContext());
+	resultObject.MakeEmpty();
+
+	if (inReader->IsEOF())
+	{
+		resultObject.SetProperty (CVSTR ("done"), true);
+	}
+	else
+	{
+		XBOX::VString	chunk;
+		XBOX::VError	error = inReader->ReadText (chunkSize, chunk);
+
+		if (XBOX::VE_OK != error)
+		{
+			XBOX::vThrowError (error);
+			return;
+		}
+
+		resultObject.SetProperty (CVSTR ("value"), chunk);
+		resultObject.SetProperty (CVSTR ("done"), false);
+	}
+
+	ioParms.ReturnValue (resultObject);
+}
+
+
+void VJSHTTPRequestBodyReader::_PipeTo (XBOX::VJSParms_callStaticFunction& ioParms, VHTTPRequestBodyReader *inReader)
+{
+	/*
+	 *	JS Sample code usage:
+	 *	var written = request.createBodyReader().pipeTo (File ('/PROJECT/upload.bin'));
+	 *	var written = request.createBodyReader().pipeTo (File ('/PROJECT/upload.bin'), 1024 * 1024);
+	 */
+	XBOX::VSize		chunkSize = 0;
+	XBOX::VFile *	file = ((NULL != inReader) && !inReader->IsDetached()) ? ioParms.RetainFileParam (1, false) : NULL;
+
+	if ((NULL != file) && _GetChunkSizeParam (ioParms, 2, chunkSize))
+	{
+		XBOX::VSize		writtenBytes = 0;
+		XBOX::VError	error = inReader->WriteToFile (*file, chunkSize, writtenBytes);
+
+		if (XBOX::VE_OK == error)
+			ioParms.ReturnNumber (writtenBytes);
+		else
+			XBOX::vThrowError (error);
+	}
+	else
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+	}
+
+	XBOX::ReleaseRefCountable (&file);
+}
+
+
+void VJSHTTPRequestBodyReader::GetDefinition (ClassDefinition& outDefinition)
+{
+	static inherited::StaticFunction functions[] =
+	{
+		{ "read", js_callStaticFunction<_Read>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
+		{ "next", js_callStaticFunction<_Next>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
+		{ "pipeTo", js_callStaticFunction<_PipeTo>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
+		{ 0, 0, 0}
+	};
+
+	static inherited::StaticValue values[] = 
+	{
+		{ "size", js_getProperty<_GetSize>, nil, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
+		{ "position", js_getProperty<_GetPosition>, nil, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
+		{ "eof", js_getProperty<_GetEOF>, nil, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
+		{ 0, 0, 0, 0}
+	};
+
+	outDefinition.className = "HttpRequestBodyReader";
+	outDefinition.initialize = js_initialize<Initialize>;
+	outDefinition.finalize = js_finalize<Finalize>;
+	outDefinition.staticValues = values;
+	outDefinition.staticFunctions = functions;
+}
+
+
+//--------------------------------------------------------------------------------------------------
+
+
 void VJSHTTPRequest::Initialize (const XBOX::VJSParms_initialize& inParms, IHTTPRequest *inRequest)
 {
 }
@@ -922,6 +1380,32 @@ void VJSHTTPRequest::_GetRemotePort (XBOX::VJSParms_getProperty& ioParms, IHTTPR
 }
 
 
+void VJSHTTPRequest::_CreateBodyReader (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPRequest *inRequest)
+{
+	/*
+	 *	Unlike the body property, the reader never converts the whole body into a single JavaScript value.
+	 */
+	if (NULL == inRequest)
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	VHTTPRequestBodyReader *reader = new VHTTPRequestBodyReader (inRequest);
+	if (NULL != reader)
+	{
+		// the reader is detached when the request handler returns
+		VHTTPRequestBodyReader::RegisterReader (ioParms.GetContext(), reader);
+		ioParms.ReturnValue (VJSHTTPRequestBodyReader::CreateInstance (ioParms.GetContext(), reader));
+		XBOX::ReleaseRefCountable (&reader);
+	}
+	else
+	{
+		XBOX::vThrowError (XBOX::VE_MEMORY_FULL);
+	}
+}
+
+
 /*
  *	Internal Use Only - Do NOT document the following function
  */
@@ -966,6 +1450,7 @@ void VJSHTTPRequest::GetDefinition (ClassDefinition& outDefinition)
 {
 	static inherited::StaticFunction functions[] =
 	{
+		{ "createBodyReader", js_callStaticFunction<_CreateBodyReader>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
 		{ "resolveURL", js_callStaticFunction<_ResolveURL>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
 		{ 0, 0, 0}
 	};
@@ -1162,6 +1647,56 @@ void VJSHTTPResponse::_SetCacheBodyMessage (XBOX::VJSParms_callStaticFunction& i
 }
 
 
+void VJSHTTPResponse::_CacheFor (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPResponse *inResponse)
+{
+	/*
+	 *	JS Sample code usage:
+	 *	response.cacheFor (60);									// shared by every request for 60 seconds
+	 *	response.cacheFor (60, 'Accept-Language');				// one response per language
+	 *	response.cacheFor (60, ['Accept-Language'], 300);		// may be served stale for 300 more seconds while it is rebuilt
+	 *
+	 *	The handler responses cache and the downstream shared caches rely on the "s-maxage", "stale-while-revalidate" and "Vary" headers.
+	 */
+	sLONG seconds = 0;
+
+	if ((NULL == inResponse) || !ioParms.IsNumberParam (1) || !ioParms.GetLongParam (1, &seconds) || (seconds <= 0))
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	XBOX::VString cacheControl;
+	inResponse->GetResponseHeader (CVSTR ("Cache-Control"), cacheControl);
+	if (!cacheControl.IsEmpty())
+		cacheControl.AppendString (CVSTR (", "));
+
+	cacheControl.AppendString (CVSTR ("s-maxage="));
+	cacheControl.AppendLong (seconds);
+
+	sLONG staleSeconds = 0;
+	if (ioParms.IsNumberParam (3) && ioParms.GetLongParam (3, &staleSeconds) && (staleSeconds > 0))
+	{
+		cacheControl.AppendString (CVSTR (", stale-while-revalidate="));
+		cacheControl.AppendLong (staleSeconds);
+	}
+
+	inResponse->AddResponseHeader (CVSTR ("Cache-Control"), cacheControl, true);
+
+	// an array of header names is converted to a comma separated list
+	XBOX::VString varyHeaders;
+	if ((ioParms.IsStringParam (2) || ioParms.IsArrayParam (2)) && ioParms.GetStringParam (2, varyHeaders) && !varyHeaders.IsEmpty())
+	{
+		XBOX::VString vary;
+		inResponse->GetResponseHeader (CVSTR ("Vary"), vary);
+		if (!vary.IsEmpty())
+			vary.AppendString (CVSTR (", "));
+
+		vary.AppendString (varyHeaders);
+		inResponse->AddResponseHeader (CVSTR ("Vary"), vary, true);
+	}
+}
+
+
 void VJSHTTPResponse::GetDefinition (ClassDefinition& outDefinition)
 {
 	static inherited::StaticFunction functions[] =
@@ -1169,6 +1704,7 @@ void VJSHTTPResponse::GetDefinition (ClassDefinition& outDefinition)
 		{ "sendChunkedData", js_callStaticFunction<_SendChunkedData>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
 		{ "allowCompression", js_callStaticFunction<_SetCompression>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
 		{ "allowCache", js_callStaticFunction<_SetCacheBodyMessage>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
+		{ "cacheFor", js_callStaticFunction<_CacheFor>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete },
 		{ 0, 0, 0}
 	};
 	
@@ -1399,10 +1935,17 @@ void VJSHTTPServerCache::Finalize (const XBOX::VJSParms_finalize& inParms, VRIAS
 
 void VJSHTTPServerCache::GetDefinition (ClassDefinition& outDefinition)
 {
+	static inherited::StaticFunction functions[] =
+	{
+		{ "clearHandlers", js_callStaticFunction<_clearHandlers>, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
+		{ 0, 0, 0}
+	};
+
 	static inherited::StaticValue values[] =
 	{
 		{ "enabled", js_getProperty<_getEnabled>, NULL, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
 		{ "memorySize", js_getProperty<_getMemorySize>, NULL, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
+		{ "handlersMemorySize", js_getProperty<_getHandlersMemorySize>, NULL, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete },
 		{ 0, 0, 0,0}
 	};
 
@@ -1410,6 +1953,7 @@ void VJSHTTPServerCache::GetDefinition (ClassDefinition& outDefinition)
 	outDefinition.initialize = js_initialize<Initialize>;
 	outDefinition.finalize = js_finalize<Finalize>;
 	outDefinition.staticValues = values;
+	outDefinition.staticFunctions = functions;
 }
 
 
@@ -1463,6 +2007,46 @@ void VJSHTTPServerCache::_getMemorySize (XBOX::VJSParms_getProperty& ioParms, VR
 }
 
 
+void VJSHTTPServerCache::_getHandlersMemorySize (XBOX::VJSParms_getProperty& ioParms, VRIAServerProject* inRIAServerProject)
+{
+	if (NULL == inRIAServerProject)
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	VJSResponseCache *responseCache = inRIAServerProject->RetainJSResponseCache();
+
+	if (responseCache != NULL)
+	{
+		ioParms.ReturnNumber (responseCache->GetMemorySize());
+	}
+	else
+	{
+		ioParms.ReturnNullValue();
+	}
+
+	XBOX::ReleaseRefCountable (&responseCache);
+}
+
+
+void VJSHTTPServerCache::_clearHandlers (XBOX::VJSParms_callStaticFunction& ioParms, VRIAServerProject* inRIAServerProject)
+{
+	if (NULL == inRIAServerProject)
+	{
+		XBOX::vThrowError (XBOX::VE_INVALID_PARAMETER);
+		return;
+	}
+
+	VJSResponseCache *responseCache = inRIAServerProject->RetainJSResponseCache();
+
+	if (responseCache != NULL)
+		responseCache->Clear();
+
+	XBOX::ReleaseRefCountable (&responseCache);
+}
+
+
 // ----------------------------------------------------------------------------
 
 
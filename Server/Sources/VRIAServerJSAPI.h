@@ -62,6 +62,7 @@ extern const char kSSJS_PROPERTY_NAME_OS[];
 extern const char kSSJS_PROPERTY_NAME_Permissions[];
 extern const char kSSJS_PROPERTY_NAME_Process[];
 extern const char kSSJS_PROPERTY_NAME_wildchar[];
+extern const char kSSJS_PROPERTY_NAME_SyntaxTester[];
 extern const char kSSJS_PROPERTY_NAME_backupSettings[];
 
 extern const char kSSJS_PROPERTY_NAME_verifyDataStore[];
@@ -136,6 +137,83 @@ private:
 // ----------------------------------------------------------------------------
 
 
+/*
+	@brief	Sequential reader over the body of an HTTP request. The body is consumed by chunks of bounded size
+			so that a handler never has to convert the whole body into a single JavaScript value.
+			The reader does not retain the request: it is registered in the JavaScript context and detached when the
+			request handler returns. A detached reader is empty and its methods fail with VE_INVALID_PARAMETER.
+*/
+class VHTTPRequestBodyReader : public XBOX::VObject, public XBOX::IRefCountable
+{
+public:
+											VHTTPRequestBodyReader (IHTTPRequest *inRequest);
+	virtual									~VHTTPRequestBodyReader();
+
+			XBOX::VSize						GetSize() const;
+			XBOX::VSize						GetPosition() const { return fPosition; }
+			bool							IsEOF() const { return fPosition >= GetSize(); }
+
+			/** @brief	Forgets the request. Called when the request handler returns */
+			void							Detach() { fRequest = NULL; }
+			bool							IsDetached() const { return NULL == fRequest; }
+
+	/*
+		@brief	Reads at most inMaxBytes bytes of the remaining body and decodes them using the body charset.
+				The chunk is shortened so that a character is never split between two chunks.
+	*/
+			XBOX::VError					ReadText (XBOX::VSize inMaxBytes, XBOX::VString& outText);
+
+	/*
+		@brief	Writes the remaining body into inFile by chunks of inChunkSize bytes. Each chunk is written before
+				the next one is consumed.
+	*/
+			XBOX::VError					WriteToFile (XBOX::VFile& inFile, XBOX::VSize inChunkSize, XBOX::VSize& outWrittenBytes);
+
+			/** @brief	Registers the reader in the JavaScript context of the request handler */
+	static	void							RegisterReader (const XBOX::VJSContext& inContext, VHTTPRequestBodyReader *inReader);
+			/** @brief	Detaches the readers registered in the JavaScript context. Must be called before the request is released */
+	static	void							DetachReaders (const XBOX::VJSContext& inContext);
+
+private:
+			const XBOX::VPtrStream&			_GetBody() const;
+
+			/** @brief	Returns the end of the chunk [inStart, inEnd[ shortened so that it does not split a character */
+			XBOX::VSize						_GetCharactersBoundary (const uBYTE *inData, XBOX::VSize inSize, XBOX::VSize inStart, XBOX::VSize inEnd) const;
+
+			IHTTPRequest *					fRequest;
+			XBOX::VSize						fPosition;
+			XBOX::CharSet					fCharSet;
+};
+
+
+// ----------------------------------------------------------------------------
+
+
+class VJSHTTPRequestBodyReader : public XBOX::VJSClass<VJSHTTPRequestBodyReader, VHTTPRequestBodyReader>
+{
+public:
+	typedef XBOX::VJSClass<VJSHTTPRequestBodyReader, VHTTPRequestBodyReader>	inherited;
+
+	static	void			Initialize (const XBOX::VJSParms_initialize& inParms, VHTTPRequestBodyReader *inReader);
+	static	void			Finalize (const XBOX::VJSParms_finalize& inParms, VHTTPRequestBodyReader *inReader);
+	static	void			GetDefinition (ClassDefinition& outDefinition);
+
+	static	void			_GetSize (XBOX::VJSParms_getProperty& ioParms, VHTTPRequestBodyReader *inReader);
+	static	void			_GetPosition (XBOX::VJSParms_getProperty& ioParms, VHTTPRequestBodyReader *inReader);
+	static	void			_GetEOF (XBOX::VJSParms_getProperty& ioParms, VHTTPRequestBodyReader *inReader);
+
+	static	void			_Read (XBOX::VJSParms_callStaticFunction& ioParms, VHTTPRequestBodyReader *inReader);
+	static	void			_Next (XBOX::VJSParms_callStaticFunction& ioParms, VHTTPRequestBodyReader *inReader);
+	static	void			_PipeTo (XBOX::VJSParms_callStaticFunction& ioParms, VHTTPRequestBodyReader *inReader);
+
+private:
+	static	bool			_GetChunkSizeParam (XBOX::VJSParms_callStaticFunction& ioParms, size_t inIndex, XBOX::VSize& outChunkSize);
+};
+
+
+// ----------------------------------------------------------------------------
+
+
 class VJSHTTPRequest : public XBOX::VJSClass<VJSHTTPRequest, IHTTPRequest>
 {
 public:
@@ -165,6 +243,8 @@ public:
 	static	void			_GetRemoteAddress (XBOX::VJSParms_getProperty& ioParms, IHTTPRequest *inRequest);
 	static	void			_GetRemotePort (XBOX::VJSParms_getProperty& ioParms, IHTTPRequest *inRequest);
 
+	static	void			_CreateBodyReader (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPRequest *inRequest);
+
 	/*
 	 *	Internal Use Only - Do NOT document the following function
 	 */
@@ -190,6 +270,7 @@ public:
 	static	void			_SendChunkedData (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPResponse *inResponse);
 	static	void			_SetCompression (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPResponse *inResponse);
 	static	void			_SetCacheBodyMessage (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPResponse *inResponse);
+	static	void			_CacheFor (XBOX::VJSParms_callStaticFunction& ioParms, IHTTPResponse *inResponse);
 };
 
 // ----------------------------------------------------------------------------
@@ -237,6 +318,10 @@ public:
 	// Properties getters
 	static	void			_getEnabled (XBOX::VJSParms_getProperty& ioParms, VRIAServerProject* inRIAServerProject);
 	static	void			_getMemorySize (XBOX::VJSParms_getProperty& ioParms, VRIAServerProject* inRIAServerProject);
+	static	void			_getHandlersMemorySize (XBOX::VJSParms_getProperty& ioParms, VRIAServerProject* inRIAServerProject);
+
+	// Functions
+	static	void			_clearHandlers (XBOX::VJSParms_callStaticFunction& ioParms, VRIAServerProject* inRIAServerProject);
 };
 
 
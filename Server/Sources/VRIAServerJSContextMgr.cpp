@@ -25,6 +25,7 @@
 #include "VRIAServerJSAPI.h"
 #include "VJSSolution.h"
 #include "VRIAServerJSContextMgr.h"
+#include "VRIAServerMetrics.h"
 #include "VRIAServerHTTPSession.h"
 #include "JavaScript/Sources/VJSJSON.h"
 #include "Language Syntax/CLanguageSyntax.h"
@@ -35,6 +36,191 @@ USING_TOOLBOX_NAMESPACE
 
 
 const uLONG kINCLUDED_FILES_CHANGES_CHECK_DELAY = 1000; // in milliseconds
+const sLONG kSPARE_CONTEXTS_CHECK_DELAY = 5000; // in milliseconds, the warm-up task is woken up when a context is retained, the delay only catches up on the missed wake-ups
+const sLONG kGARBAGE_COLLECT_SAMPLING_DELAY = 1000; // in milliseconds
+const sLONG kGARBAGE_COLLECT_ON_RELEASE_DELAY = 250; // in milliseconds, minimum delay between two collections on release under memory pressure
+const sLONG kGARBAGE_COLLECT_MIN_PAUSE_BUDGET = 1; // in milliseconds
+const sLONG kGC_PAUSES_HISTOGRAM_MIN_DURATIONS[] = { 0, 1, 5, 10, 50, 100, 500 }; // in milliseconds
+
+
+// ----------------------------------------------------------------------------
+
+
+
+namespace ScriptsCacheBagKeys
+{
+	CREATE_BAGKEY( scriptsCacheInfo);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( scriptCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( sourceCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( hitCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( missCount, VLong, sLONG);
+}
+
+
+VJSScriptsCache::VJSScriptsCache()
+: fHitCount(0)
+, fMissCount(0)
+{
+}
+
+
+VJSScriptsCache::~VJSScriptsCache()
+{
+}
+
+
+bool VJSScriptsCache::EvaluateScript( VJSGlobalContext* inContext, VFile* inFile, bool inUseCache)
+{
+	if (inContext == NULL || inFile == NULL)
+		return false;
+
+	if (inUseCache)
+	{
+		VString source;
+		if (_GetScriptSource( inFile, source))
+		{
+			// The source URL is the file URL, as if the file was evaluated directly
+			VFilePath path;
+			inFile->GetPath( path);
+			VURL url( path);
+			return inContext->EvaluateScript( source, &url, NULL);
+		}
+	}
+
+	return inContext->EvaluateScript( inFile, NULL);
+}
+
+
+void VJSScriptsCache::Touch()
+{
+	if (fMutex.Lock())
+	{
+		fVersions.clear();
+		fSources.clear();
+		fMutex.Unlock();
+	}
+}
+
+
+void VJSScriptsCache::GetCacheInformations( VValueBag& outBag) const
+{
+	BagElement infosBag( outBag, ScriptsCacheBagKeys::scriptsCacheInfo);
+
+	if (fMutex.Lock())
+	{
+		ScriptsCacheBagKeys::scriptCount.Set( infosBag, (sLONG) fVersions.size());
+		ScriptsCacheBagKeys::sourceCount.Set( infosBag, (sLONG) fSources.size());
+		ScriptsCacheBagKeys::hitCount.Set( infosBag, fHitCount);
+		ScriptsCacheBagKeys::missCount.Set( infosBag, fMissCount);
+		fMutex.Unlock();
+	}
+}
+
+
+bool VJSScriptsCache::_GetScriptSource( VFile* inFile, VString& outSource)
+{
+	VFilePath path;
+	inFile->GetPath( path);
+
+	ScriptVersion version;
+	version.fSize = 0;
+	version.fContentHash = 0;
+	version.fOwnSource = false;
+
+	if ((inFile->GetTimeAttributes( &version.fModificationTime) != VE_OK) || (inFile->GetSize( &version.fSize) != VE_OK))
+		return false;
+
+	bool found = false;
+
+	if (fMutex.Lock())
+	{
+		MapOfScriptVersion_iter iter = fVersions.find( path.GetPath());
+		if ((iter != fVersions.end()) && (iter->second.fModificationTime == version.fModificationTime) && (iter->second.fSize == version.fSize))
+		{
+			if (iter->second.fOwnSource)
+			{
+				outSource = iter->second.fSource;
+				++fHitCount;
+				found = true;
+			}
+			else
+			{
+				MapOfScriptSource_iter source = fSources.find( iter->second.fContentHash);
+				if (testAssert(source != fSources.end()))
+				{
+					outSource = source->second;
+					++fHitCount;
+					found = true;
+				}
+			}
+		}
+		fMutex.Unlock();
+	}
+
+	if (!found)
+	{
+		// The file is read and decoded outside of the mutex
+		VFileStream stream( inFile);
+		VError err = stream.OpenReading();
+		if (err == VE_OK)
+		{
+			stream.GuessCharSetFromLeadingBytes( VTC_UTF_8);
+			err = stream.GetText( outSource);
+			stream.CloseReading();
+		}
+
+		if (err == VE_OK)
+		{
+			found = true;
+			version.fContentHash = ComputeStringHash( outSource);
+
+			if (fMutex.Lock())
+			{
+				++fMissCount;
+
+				// The texts are shared by content hash: the text is compared to make sure that the hash does not collide
+				MapOfScriptSource_iter source = fSources.find( version.fContentHash);
+				if (source == fSources.end())
+				{
+					fSources[version.fContentHash] = outSource;
+				}
+				else if (!source->second.EqualToStringRaw( outSource))
+				{
+					version.fOwnSource = true;
+					version.fSource = outSource;
+				}
+
+				MapOfScriptVersion_iter iter = fVersions.find( path.GetPath());
+				if (iter != fVersions.end())
+				{
+					uLONG8 previousHash = iter->second.fContentHash;
+					iter->second = version;
+					_PurgeSource( previousHash);
+				}
+				else
+				{
+					fVersions[path.GetPath()] = version;
+				}
+
+				fMutex.Unlock();
+			}
+		}
+	}
+
+	return found;
+}
+
+
+void VJSScriptsCache::_PurgeSource( uLONG8 inContentHash)
+{
+	for (MapOfScriptVersion_iter iter = fVersions.begin() ; iter != fVersions.end() ; ++iter)
+	{
+		if (iter->second.fContentHash == inContentHash)
+			return;
+	}
+	fSources.erase( inContentHash);
+}
+
 
 
 // ----------------------------------------------------------------------------
@@ -43,12 +229,27 @@ const uLONG kINCLUDED_FILES_CHANGES_CHECK_DELAY = 1000; // in milliseconds
 
 VRIAServerJSContextMgr::VRIAServerJSContextMgr()
 : fPoolsAreBeingCleaned(0)
+, fGarbageCollectTask(NULL)
+, fGCMemoryAtLastCollect(0)
 {
 }
 
 
 VRIAServerJSContextMgr::~VRIAServerJSContextMgr()
 {
+	if (fGarbageCollectTask != NULL)
+	{
+		if (fGarbageCollectTask->GetState() >= TS_RUNNING)
+		{
+			fGarbageCollectTask->Kill();
+
+			while (fGarbageCollectTask->GetState() < TS_DEAD)
+				VTask::Sleep( 20);
+		}
+		fGarbageCollectTask->Release();
+		fGarbageCollectTask = NULL;
+	}
+
 	xbox_assert(fSetOfPool.empty());
 }
 
@@ -205,6 +406,7 @@ void VRIAServerJSContextMgr::BeginPoolsCleanup()
 
 			fSetOfPoolMutex.Unlock();
 		}
+		fScriptsCache.Touch();
 		fBeginContextPoolsCleanupSignal();
 	}
 }
@@ -313,6 +515,80 @@ void VRIAServerJSContextMgr::_UnRegisterPool( VJSContextPool *inPool)
 		}
 		fSetOfPoolMutex.Unlock();
 	}
+
+	// The garbage collection scheduler may be working on a snapshot of the pools which includes the unregistered pool
+	VTaskLock passLock( &fGarbageCollectPassMutex);
+}
+
+
+void VRIAServerJSContextMgr::_StartGarbageCollectScheduler()
+{
+	if (fGarbageCollectTaskMutex.Lock())
+	{
+		if (fGarbageCollectTask == NULL)
+		{
+			fGarbageCollectTask = new VTask( this, 0, eTaskStylePreemptive, &VRIAServerJSContextMgr::_GarbageCollectTaskProc);
+			if (fGarbageCollectTask != NULL)
+			{
+				fGarbageCollectTask->SetName( CVSTR( "JavaScript Garbage Collector"));
+				fGarbageCollectTask->SetKindData( (sLONG_PTR) this);
+				fGarbageCollectTask->Run();
+			}
+		}
+		fGarbageCollectTaskMutex.Unlock();
+	}
+}
+
+
+sLONG VRIAServerJSContextMgr::_GarbageCollectTaskProc( VTask* inTask)
+{
+	VRIAServerJSContextMgr *manager = (VRIAServerJSContextMgr*) inTask->GetKindData();
+
+	while (!inTask->IsDying())
+	{
+		if (!manager->IsPoolsAreBeingCleaned())
+			manager->_GarbageCollectPass( inTask);
+
+		inTask->ExecuteMessagesWithTimeout( kGARBAGE_COLLECT_SAMPLING_DELAY);
+	}
+	return 0;
+}
+
+
+void VRIAServerJSContextMgr::_GarbageCollectPass( VTask* inTask)
+{
+	// A pool waits for the end of the pass before being destroyed, so the set of pools is only locked to take a snapshot
+	VTaskLock passLock( &fGarbageCollectPassMutex);
+
+	std::vector< VJSContextPool* > pools;
+	if (fSetOfPoolMutex.Lock())
+	{
+		pools.assign( fSetOfPool.begin(), fSetOfPool.end());
+		fSetOfPoolMutex.Unlock();
+	}
+
+	// The memory growth of the process is measured from the lowest process memory size since the last collection under pressure
+	sLONG8 memorySize = 0;
+	if (VSystem::AllowedToGetSystemInfo())
+		memorySize = VSystem::GetApplicationPhysicalMemSize();
+
+	sLONG8 memoryGrowth = 0;
+	if (memorySize > 0)
+	{
+		if ((fGCMemoryAtLastCollect == 0) || (memorySize < fGCMemoryAtLastCollect))
+			fGCMemoryAtLastCollect = memorySize;
+		memoryGrowth = memorySize - fGCMemoryAtLastCollect;
+	}
+
+	bool collected = false;
+	for (std::vector< VJSContextPool* >::iterator iter = pools.begin() ; iter != pools.end() && !inTask->IsDying() ; ++iter)
+	{
+		if ((*iter)->ScheduleGarbageCollect( memorySize, memoryGrowth))
+			collected = true;
+	}
+
+	if (collected)
+		fGCMemoryAtLastCollect = memorySize;
 }
 
 
@@ -496,7 +772,7 @@ XBOX::VError VRIAJSRuntimeContext::AttachSolution( const XBOX::VJSContext& inCon
 	VectorOfApplication appCollection;
 	inSolution->GetApplications( appCollection);
 
-	for (VectorOfApplication_iter iter = appCollection.begin() ; iter != appCollection.end() ; ++iter)
+	for (VectorOfApplication_iter iter = appCollection.begin() ; (iter != appCollection.end()) && (err == VE_OK) ; ++iter)
 	{
 		if (!iter->IsNull())
 		{
@@ -694,12 +970,16 @@ XBOX::VError VRIAJSRuntimeContext::SetUAGSession(CUAGSession* inSession, bool ad
 	}
 
 	CopyRefCountable(&fCurrentUAGSession, inSession);
-	if (addSession)
+	if (fCurrentUAGSession != NULL)
 	{
 		VRIAHTTPSessionManager* sessionMgr = fRootApplication->RetainSessionMgr();
 		if (sessionMgr != NULL)
 		{
-			sessionMgr->AddSession(fCurrentUAGSession);
+			// the user of a registered session may have changed on login or logout
+			if (addSession)
+				sessionMgr->AddSession(fCurrentUAGSession);
+			else
+				sessionMgr->UpdateSessionUser(fCurrentUAGSession);
 			sessionMgr->Release();
 		}
 	}
@@ -764,6 +1044,13 @@ VRIAContext* VRIAJSRuntimeContext::GetApplicationContext( VRIAServerProject* inA
 }
 
 
+void VRIAJSRuntimeContext::SetHolderTaskID( VTaskID inTaskID)
+{
+	for (MapOfRIAContext_iter iter = fContextMap.begin() ; iter != fContextMap.end() ; ++iter)
+		iter->second.Get()->SetHolderTaskID( inTaskID);
+}
+
+
 VRIAJSRuntimeContext* VRIAJSRuntimeContext::GetFromJSContext( const XBOX::VJSContext& inContext)
 {
 	return static_cast<VRIAJSRuntimeContext*>( inContext.GetGlobalObjectPrivateInstance()->GetSpecific( 'riax'));
@@ -818,18 +1105,27 @@ public:
 
 
 
+class VJSContextPoolWakeUpMessage : public XBOX::VMessage
+{
+private:
+	virtual	void DoExecute() {;}
+};
+
+
+
 class VJSContextInfo : public XBOX::VObject
 {
 public:
 
-	VJSContextInfo() : fGlobalObject(NULL), fDebuggerActive(false), fReusable(false), fStampOfPool(0), fIncludedFilesChangesCheckTime(0) {;}
+	VJSContextInfo() : fGlobalObject(NULL), fDebuggerActive(false), fReusable(false), fStampOfPool(0), fIncludedFilesChangesCheckTime(0), fRequestCount(0) {;}
 
 	VJSContextInfo( const VJSContextInfo& inSource)
 	: fGlobalObject(inSource.fGlobalObject)
 	, fDebuggerActive(inSource.fDebuggerActive)
 	, fReusable( inSource.fReusable)
 	, fStampOfPool( inSource.fStampOfPool)
-	, fIncludedFilesChangesCheckTime( inSource.fIncludedFilesChangesCheckTime) {;}
+	, fIncludedFilesChangesCheckTime( inSource.fIncludedFilesChangesCheckTime)
+	, fRequestCount( inSource.fRequestCount) {;}
 
 	virtual ~VJSContextInfo() {;}
 
@@ -840,6 +1136,7 @@ public:
 		fReusable = inSource.fReusable;
 		fStampOfPool = inSource.fStampOfPool;
 		fIncludedFilesChangesCheckTime = inSource.fIncludedFilesChangesCheckTime;
+		fRequestCount = inSource.fRequestCount;
 		return *this;
 	}
 
@@ -858,6 +1155,11 @@ public:
 	void				SetIncludedFilesChangesCheckTime( uLONG inTime) { fIncludedFilesChangesCheckTime = inTime; }
 	uLONG				GetIncludedFilesChangesCheckTime() const { return fIncludedFilesChangesCheckTime; }
 
+	// Count of requests handled since the last garbage collection of the context
+	sLONG				IncrementRequestCount() { return ++fRequestCount; }
+	void				ResetRequestCount() { fRequestCount = 0; }
+	sLONG				GetRequestCount() const { return fRequestCount; }
+
 private:
 
 	XBOX::VJSGlobalObject*	fGlobalObject;
@@ -865,6 +1167,7 @@ private:
 	bool					fReusable;
 	uLONG					fStampOfPool;		// the stamp of the pool when context was created
 	uLONG					fIncludedFilesChangesCheckTime;
+	sLONG					fRequestCount;
 };
 
 
@@ -886,10 +1189,36 @@ VJSContextPool::VJSContextPool()
 , fNoUsedContextEvent(NULL)
 , fReusableContextCount(0)
 , fStamp(0)
+, fUsedContextCount(0)
+, fUnusedContextCount(0)
 , fUsedContextMaxCount(0)
 , fCreatedContextCount(0)
 , fDestroyedContextCount(0)
-{
+, fWarmRetainCount(0)
+, fColdRetainCount(0)
+, fSpareContextsLowWaterMark(0)
+, fSpareContextsHighWaterMark(0)
+, fSpareContextsRefilling(false)
+, fWarmedUpContextCount(0)
+, fWarmUpTask(NULL)
+, fWarmUpShard(0)
+, fWarmUpWakeUpPosted(0)
+, fContextCreationTime(0)
+, fGCEnabled(false)
+, fGCPressure(false)
+, fGCMemoryBudget(0)
+, fGCRequestsBudget(0)
+, fGCPauseBudget(0)
+, fGCLastMemorySize(0)
+, fGCLastReleaseCollectTime(0)
+, fGCCount(0)
+, fGCTotalPause(0)
+, fGCMaxPause(0)
+, fScriptsCacheEnabled(true)
+{
+	for (sLONG i = 0 ; i < kGC_PAUSES_HISTOGRAM_SIZE ; ++i)
+		fGCPausesHistogram[i] = 0;
+
 	xbox_assert(false);
 }
 
@@ -907,20 +1236,48 @@ VJSContextPool::VJSContextPool( VRIAServerJSContextMgr *inMgr, IJSContextPoolDel
 , fNoUsedContextEvent(NULL)
 , fReusableContextCount(0)
 , fStamp(0)
+, fUsedContextCount(0)
+, fUnusedContextCount(0)
 , fUsedContextMaxCount(0)
 , fCreatedContextCount(0)
 , fDestroyedContextCount(0)
-{
+, fWarmRetainCount(0)
+, fColdRetainCount(0)
+, fSpareContextsLowWaterMark(0)
+, fSpareContextsHighWaterMark(0)
+, fSpareContextsRefilling(false)
+, fWarmedUpContextCount(0)
+, fWarmUpTask(NULL)
+, fWarmUpShard(0)
+, fWarmUpWakeUpPosted(0)
+, fContextCreationTime(0)
+, fGCEnabled(false)
+, fGCPressure(false)
+, fGCMemoryBudget(0)
+, fGCRequestsBudget(0)
+, fGCPauseBudget(0)
+, fGCLastMemorySize(0)
+, fGCLastReleaseCollectTime(0)
+, fGCCount(0)
+, fGCTotalPause(0)
+, fGCMaxPause(0)
+, fScriptsCacheEnabled(true)
+{
+	for (sLONG i = 0 ; i < kGC_PAUSES_HISTOGRAM_SIZE ; ++i)
+		fGCPausesHistogram[i] = 0;
+
 	xbox_assert(fManager != NULL);
 }
 
 
 VJSContextPool::~VJSContextPool()
 {
+	StopWarmUp();
+
 	if (fManager != NULL)
 		fManager->_UnRegisterPool( this);
 
-	xbox_assert( (fUsedContexts.size() == 0) && (fUnusedContexts.size() == 0) );
+	xbox_assert( (fUsedContextCount == 0) && (fUnusedContextCount == 0) );
 	
 	if (fNoUsedContextEvent != NULL)
 	{
@@ -954,135 +1311,78 @@ VJSGlobalContext* VJSContextPool::RetainContext( VError& outError, bool inReusab
 		if (inReusable && fContextReusingEnabled)
 		{ 
 			// Try to reuse an existing pooled context
-			if (fPoolMutex.Lock())
-			{
-				MapOfJSContext_iter iter = fUnusedContexts.end();
-				
-				// Try to reuse the prefered context
-				if (inPreferedContext != NULL)
-					iter = fUnusedContexts.find( inPreferedContext);
-				
-				if (iter == fUnusedContexts.end())
-					iter = fUnusedContexts.begin();
-
-				while ((globalContext == NULL) && (iter != fUnusedContexts.end()))
-				{
-					xbox_assert(iter->second->IsReusable());
-
-					VJSGlobalObject *globalObject = iter->second->GetGlobalObject();
-
-					// If some included files have been changed or is the pool has been touched, the context is invalid and must not be reused
-					bool isInvalid = (iter->second->GetStampOfPool() < fStamp);
-					
-					// sc 19/06/2014, optimization: check for included files changes at most one time per second
-					if (!isInvalid && ((iter->second->GetIncludedFilesChangesCheckTime() + kINCLUDED_FILES_CHANGES_CHECK_DELAY) < VSystem::GetCurrentTime()))
-					{
-						isInvalid = globalObject->IsIncludedFilesHaveBeenChanged();
-						iter->second->SetIncludedFilesChangesCheckTime( VSystem::GetCurrentTime());
-					}
-
-					if (globalObject != NULL && isInvalid)
-					{
-						VJSGlobalContext *gContext = iter->first;
-						
-						// Remove this context from unused contexts pool
-						--fReusableContextCount;
-						delete iter->second;
-						fUnusedContexts.erase( iter);
-
-						// Release this context
-						globalObject->GarbageCollect();
-						_ReleaseContext( gContext);
-						
-						++fDestroyedContextCount;
-
-						iter = fUnusedContexts.begin();
-					}
-					else
-					{
-						bool	willBeReused = false;
-						VJSContextInfo *info = iter->second;
-						if (info)
-						{
-							if (VJSGlobalContext::IsDebuggerActive())
-							{
-								willBeReused = info->IsDebuggerActive();
-							}
-							else
-							{
-								willBeReused = !info->IsDebuggerActive();
-							}
-						}
-						if (willBeReused)
-						{
-			 				// The context becomes used
-							globalContext = iter->first;
-							fUsedContexts[globalContext] = iter->second;
-							fUnusedContexts.erase( iter);
+			JSContextEntry entry( NULL, NULL);
 
-							if (fUsedContexts.size() > fUsedContextMaxCount)
-								fUsedContextMaxCount = fUsedContexts.size();
+			while ((globalContext == NULL) && _PopUnusedContext( entry, inPreferedContext))
+			{
+				xbox_assert(entry.second->IsReusable());
 
-							XBOX::VJSContext	context(globalContext);
+				// The context is now owned by the current task, so the validity checks are done outside of any lock
+				if (_IsContextValid( entry.second))
+				{
+	 				// The context becomes used
+					globalContext = entry.first;
+					_AddUsedContext( globalContext, entry.second);
+					VInterlocked::Increment( &fWarmRetainCount);
 
-							VJSWorker::RecycleWorker(context);
+					XBOX::VJSContext	context(globalContext);
 
-						}
-						else
-						{
-							xbox_assert(false);
-							globalContext = NULL;
-							iter++;
-						}
-					}
+					VJSWorker::RecycleWorker(context);
 				}
-				fPoolMutex.Unlock();
+				else
+				{
+					_DestroyContext( entry);
+				}
+
+				inPreferedContext = NULL;
 			}
 		}
 
 		if (globalContext == NULL)
 		{
 			// Create a new context
+			uLONG stamp = fStamp;
 			globalContext = _RetainNewContext( outError);
+			if ((globalContext != NULL) && (outError != VE_OK))
+			{
+				// A context which has not been fully initialized, typically without its application contexts, is never pooled
+				_ReleaseContext( globalContext);
+				globalContext = NULL;
+			}
+
 			if (globalContext != NULL)
 			{
 				// Reference the context in the pool as used context
-				if (fPoolMutex.Lock())
+				VJSContextInfo *info = new VJSContextInfo();
+				if  (info != NULL)
 				{
-					VJSContextInfo *info = new VJSContextInfo();
-					if  (info != NULL)
-					{
-						VJSContext jsContext( globalContext);
-						info->SetGlobalObject( jsContext.GetGlobalObjectPrivateInstance());
-						info->SetDebuggerActive( VJSGlobalContext::IsDebuggerActive());
-						info->SetStampOfPool( fStamp);
-
-						if (inReusable && fContextReusingEnabled && (fReusableContextCount < fSize))
-						{
-							info->SetReusable( true);
-							++fReusableContextCount;
-						}
-						else
-						{
-							info->SetReusable( false);
-						}
-
-						fUsedContexts[globalContext] = info;
-
-						if (fUsedContexts.size() > fUsedContextMaxCount)
-							fUsedContextMaxCount = fUsedContexts.size();
-					}
-					else
-					{
-						outError = vThrowError( VE_MEMORY_FULL);
-					}
+					VJSContext jsContext( globalContext);
+					info->SetGlobalObject( jsContext.GetGlobalObjectPrivateInstance());
+					info->SetDebuggerActive( VJSGlobalContext::IsDebuggerActive());
+					info->SetStampOfPool( stamp);
+					info->SetReusable( inReusable && fContextReusingEnabled && _ReserveReusableContext());
 
-					++fCreatedContextCount;
-
-					fPoolMutex.Unlock();
+					_AddUsedContext( globalContext, info);
+				}
+				else
+				{
+					outError = vThrowError( VE_MEMORY_FULL);
 				}
+
+				VInterlocked::Increment( &fCreatedContextCount);
+				VInterlocked::Increment( &fColdRetainCount);
 			}
 		}
+
+		if (globalContext != NULL)
+		{
+			VRIAJSRuntimeContext *runtimeContext = VRIAJSRuntimeContext::GetFromJSContext( VJSContext( globalContext));
+			if (runtimeContext != NULL)
+				runtimeContext->SetHolderTaskID( VTask::GetCurrentID());
+		}
+
+		if ((fWarmUpTask != NULL) && (fUnusedContextCount < fSpareContextsLowWaterMark))
+			_WakeUpWarmUp();
 	}
 
 	return globalContext;
@@ -1095,74 +1395,50 @@ VError VJSContextPool::ReleaseContext( VJSGlobalContext* inContext)
 
 	if (inContext != NULL)
 	{
-		bool isReusable = false;
-	
-		if (fPoolMutex.Lock())
+		JSContextEntry entry( inContext, NULL);
+		VJSContextPoolShard& shard = fShards[_GetUsedContextShardIndex( inContext)];
+
+		if (shard.fMutex.Lock())
 		{
-			MapOfJSContext_iter found = fUsedContexts.find( inContext);
-			if (found != fUsedContexts.end())
+			MapOfJSContext_iter found = shard.fUsedContexts.find( inContext);
+			if (found != shard.fUsedContexts.end())
 			{
-				if (fContextReusingEnabled && found->second->IsReusable())
-				{
-					VJSGlobalObject *globalObject = found->second->GetGlobalObject();
-
-					// If some included files have been changed or is the pool has been touched, the context is invalid and must not be reused
-					bool isInvalid = (found->second->GetStampOfPool() < fStamp);
-
-					// sc 19/06/2014, optimization: check for included files changes at most one time per second
-					if (!isInvalid && ((found->second->GetIncludedFilesChangesCheckTime() + kINCLUDED_FILES_CHANGES_CHECK_DELAY) < VSystem::GetCurrentTime()))
-					{
-						isInvalid = globalObject->IsIncludedFilesHaveBeenChanged();
-						found->second->SetIncludedFilesChangesCheckTime( VSystem::GetCurrentTime());
-					}
-
-					if (globalObject != NULL && isInvalid)
-					{
-						isReusable = false;
-					}
-					else
-					{
-						fUnusedContexts[inContext] = found->second;
-						isReusable = true;
-					}
-				}
-
-				// The context becomes unused
-				if (!isReusable)
-				{
-					VJSGlobalObject *globalObject = found->second->GetGlobalObject();
-					if (globalObject != NULL)
-						globalObject->GarbageCollect();
-
-					if (found->second->IsReusable())
-						--fReusableContextCount;
-
-					++fDestroyedContextCount;
-					
-					delete found->second;
-					found->second = NULL;
-				}
-
-				fUsedContexts.erase( found);
-
-				if (fUsedContexts.size() == 0)
-				{
-					if (fNoUsedContextEvenMutex.Lock())
-					{
-						if (fNoUsedContextEvent != NULL)
-						{
-							if (fNoUsedContextEvent->Unlock())
-								ReleaseRefCountable( &fNoUsedContextEvent);
-						}
-						fNoUsedContextEvenMutex.Unlock();
-					}
-				}
+				entry.second = found->second;
+				shard.fUsedContexts.erase( found);
 			}
-			fPoolMutex.Unlock();
+			shard.fMutex.Unlock();
 		}
 
-		if (!isReusable)
+		if (entry.second != NULL)
+		{
+			// The context is now owned by the current task, so the validity checks are done outside of any lock
+			if (fContextReusingEnabled && entry.second->IsReusable() && _IsContextValid( entry.second))
+			{
+				// Idle contexts are collected by the scheduler. A context is collected on release only under memory pressure
+				// or if the scheduler did not have the opportunity to collect it, typically under a sustained load.
+				sLONG requestCount = entry.second->IncrementRequestCount();
+				if (fGCEnabled && ((fGCPressure && _ClaimCollectOnRelease()) || (requestCount >= 2 * fGCRequestsBudget)))
+					_CollectContext( entry.second);
+
+				VRIAJSRuntimeContext *runtimeContext = VRIAJSRuntimeContext::GetFromJSContext( VJSContext( inContext));
+				if (runtimeContext != NULL)
+					runtimeContext->SetHolderTaskID( NULL_TASK_ID);
+
+				// The context becomes unused and is pooled in the shard of the current task
+				_PushUnusedContext( entry, _GetTaskShardIndex());
+			}
+			else
+			{
+				err = _DestroyContext( entry);
+			}
+
+			// The context is counted as used until it has been pooled or destroyed
+			_RemoveUsedContextCount();
+		}
+		else
+		{
 			err = _ReleaseContext( inContext);
+		}
 	}
 	return err;
 }
@@ -1174,13 +1450,15 @@ bool VJSContextPool::ContextShouldBeReleased( XBOX::VJSGlobalContext* inContext)
 
 	if (inContext != NULL)
 	{
-		if (fPoolMutex.Lock())
+		const VJSContextPoolShard& shard = fShards[_GetUsedContextShardIndex( inContext)];
+
+		if (shard.fMutex.Lock())
 		{
-			MapOfJSContext_citer found = fUsedContexts.find( inContext);
-			if (found != fUsedContexts.end())
+			MapOfJSContext_citer found = shard.fUsedContexts.find( inContext);
+			if (found != shard.fUsedContexts.end())
 				result = found->second->GetStampOfPool() < fStamp;
 
-			fPoolMutex.Unlock();
+			shard.fMutex.Unlock();
 		}
 	}
 	return result;
@@ -1225,22 +1503,133 @@ void VJSContextPool::SetSize( sLONG inSize)
 {
 	if (fPoolMutex.Lock())
 	{
-		if (testAssert( fUsedContexts.empty() && fUnusedContexts.empty()))
+		if (testAssert( (fUsedContextCount == 0) && (fUnusedContextCount == 0)))
 			fSize = inSize;
 		fPoolMutex.Unlock();
 	}
 }
 
 
-uLONG VJSContextPool::GetUsedContextsCount() const
+void VJSContextPool::SetSpareContextsMarks( sLONG inLowWaterMark, sLONG inHighWaterMark)
 {
-	uLONG count = 0;
 	if (fPoolMutex.Lock())
 	{
-		count = (uLONG) fUsedContexts.size();
+		fSpareContextsLowWaterMark = (inLowWaterMark > 0) ? inLowWaterMark : 0;
+		fSpareContextsHighWaterMark = (inHighWaterMark > fSpareContextsLowWaterMark) ? inHighWaterMark : fSpareContextsLowWaterMark;
 		fPoolMutex.Unlock();
 	}
-	return count;
+
+	if ((fSpareContextsLowWaterMark > 0) && (fWarmUpTask == NULL))
+	{
+		fWarmUpTask = new VTask( this, 0, eTaskStylePreemptive, &VJSContextPool::_WarmUpTaskProc);
+		if (fWarmUpTask != NULL)
+		{
+			fWarmUpTask->SetName( CVSTR( "JavaScript Contexts Warm-up"));
+			fWarmUpTask->SetKindData( (sLONG_PTR) this);
+			fWarmUpTask->Run();
+
+			// Initial fill of the pool
+			_WakeUpWarmUp();
+		}
+	}
+}
+
+
+void VJSContextPool::StopWarmUp()
+{
+	if (fWarmUpTask != NULL)
+	{
+		if (fWarmUpTask->GetState() >= TS_RUNNING)
+		{
+			fWarmUpTask->Kill();
+			_WakeUpWarmUp();
+
+			// Wait for the task end: the task may be creating a context which uses the pool delegate
+			while (fWarmUpTask->GetState() < TS_DEAD)
+				VTask::Sleep( 20);
+		}
+		fWarmUpTask->Release();
+		fWarmUpTask = NULL;
+	}
+}
+
+
+void VJSContextPool::SetGarbageCollectBudgets( bool inEnabled, sLONG inMemoryBudget, sLONG inRequestsBudget, sLONG inPauseBudget)
+{
+	if (fPoolMutex.Lock())
+	{
+		fGCMemoryBudget = ((inMemoryBudget > 0) ? inMemoryBudget : 1) * 1024LL * 1024LL;
+		fGCRequestsBudget = (inRequestsBudget > 0) ? inRequestsBudget : 1;
+		fGCPauseBudget = (inPauseBudget > kGARBAGE_COLLECT_MIN_PAUSE_BUDGET) ? inPauseBudget : kGARBAGE_COLLECT_MIN_PAUSE_BUDGET;
+		fGCEnabled = inEnabled;
+		fPoolMutex.Unlock();
+	}
+
+	if (inEnabled)
+		fManager->_StartGarbageCollectScheduler();
+}
+
+
+bool VJSContextPool::ScheduleGarbageCollect( sLONG8 inMemorySize, sLONG8 inMemoryGrowth)
+{
+	if (!fGCEnabled || !fEnabled || fManager->IsPoolsAreBeingCleaned())
+		return false;
+
+	bool pressure = false;
+
+	if (fPoolMutex.Lock())
+	{
+		fGCLastMemorySize = inMemorySize;
+		pressure = inMemoryGrowth > fGCMemoryBudget;
+		fGCPressure = pressure;
+		fPoolMutex.Unlock();
+	}
+
+	bool collected = false;
+
+	if (pressure)
+	{
+		// Collect all the idle contexts which have been used since their last collection
+		collected = _CollectIdleContexts( 1, fGCPauseBudget);
+	}
+	else if ((fUsedContextCount * 2) <= fSize)
+	{
+		// Low load: collect the idle contexts which have exhausted their requests budget
+		_CollectIdleContexts( fGCRequestsBudget, fGCPauseBudget);
+	}
+
+	return collected;
+}
+
+
+bool VJSContextPool::_ClaimCollectOnRelease()
+{
+	// Under memory pressure, one context is collected on release at most every kGARBAGE_COLLECT_ON_RELEASE_DELAY
+	uLONG lastTime = (uLONG) fGCLastReleaseCollectTime;
+	uLONG currentTime = VSystem::GetCurrentTime();
+
+	if ((lastTime != 0) && ((sLONG) (currentTime - lastTime) < kGARBAGE_COLLECT_ON_RELEASE_DELAY))
+		return false;
+
+	return VInterlocked::CompareExchange( &fGCLastReleaseCollectTime, (sLONG) lastTime, (sLONG) currentTime) == (sLONG) lastTime;
+}
+
+
+void VJSContextPool::SetScriptsCacheEnabled( bool inEnabled)
+{
+	fScriptsCacheEnabled = inEnabled;
+}
+
+
+bool VJSContextPool::IsScriptsCacheEnabled() const
+{
+	return fScriptsCacheEnabled;
+}
+
+
+uLONG VJSContextPool::GetUsedContextsCount() const
+{
+	return (uLONG) fUsedContextCount;
 }
 
 
@@ -1248,21 +1637,26 @@ void VJSContextPool::GetWorkersInformations( std::vector<JSWorkerInfo>& outWorke
 {
 	outWorkersInfos.clear();
 
-	if (fPoolMutex.Lock())
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
 	{
-		for (MapOfJSContext_citer iter = fUsedContexts.begin() ; iter != fUsedContexts.end() ; ++iter)
+		const VJSContextPoolShard& shard = fShards[shardIndex];
+
+		if (shard.fMutex.Lock())
 		{
-			VJSContext jsContext( iter->first);
-			VJSWorker *worker = VJSWorker::RetainWorker( jsContext);
-			if (worker != NULL)
+			for (MapOfJSContext_citer iter = shard.fUsedContexts.begin() ; iter != shard.fUsedContexts.end() ; ++iter)
 			{
-				JSWorkerInfo info = { worker->GetWorkerType(), worker->GetURL(), worker->GetName() };
-				outWorkersInfos.push_back( info);
-				worker->Release();
+				VJSContext jsContext( iter->first);
+				VJSWorker *worker = VJSWorker::RetainWorker( jsContext);
+				if (worker != NULL)
+				{
+					JSWorkerInfo info = { worker->GetWorkerType(), worker->GetURL(), worker->GetName() };
+					outWorkersInfos.push_back( info);
+					worker->Release();
+				}
 			}
-		}
 
-		fPoolMutex.Unlock();
+			shard.fMutex.Unlock();
+		}
 	}
 }
 
@@ -1279,6 +1673,25 @@ namespace PoolInfosBagKeys
 	CREATE_BAGKEY_NO_DEFAULT_SCALAR( unusedContextCount, VLong, sLONG);
 	CREATE_BAGKEY_NO_DEFAULT_SCALAR( createdContextCount, VLong, sLONG);
 	CREATE_BAGKEY_NO_DEFAULT_SCALAR( destroyedContextCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( warmRetainCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( coldRetainCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( warmedUpContextCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( spareContextsLowWaterMark, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( spareContextsHighWaterMark, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( scriptsCacheEnabled, VBoolean, bool);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( contextCreationTime, VLong8, sLONG8);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( averageContextCreationTime, VLong8, sLONG8);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcEnabled, VBoolean, bool);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcMemoryBudget, VLong8, sLONG8);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcRequestsBudget, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcPauseBudget, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcMemorySize, VLong8, sLONG8);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcCount, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcTotalPause, VLong8, sLONG8);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( gcMaxPause, VLong, sLONG);
+	CREATE_BAGKEY( gcPause);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( minDuration, VLong, sLONG);
+	CREATE_BAGKEY_NO_DEFAULT_SCALAR( count, VLong, sLONG);
 }
 
 
@@ -1290,40 +1703,97 @@ void VJSContextPool::GetPoolInformations( XBOX::VValueBag& outBag) const
 	{
 		PoolInfosBagKeys::contextPoolSize.Set( infosBag, fSize);
 		PoolInfosBagKeys::activeDebugger.Set( infosBag, VJSGlobalContext::IsDebuggerActive());
-		PoolInfosBagKeys::usedContextCount.Set( infosBag, fUsedContexts.size());
+		PoolInfosBagKeys::usedContextCount.Set( infosBag, fUsedContextCount);
 		PoolInfosBagKeys::usedContextMaxCount.Set( infosBag, fUsedContextMaxCount);
 		PoolInfosBagKeys::reusableContextCount.Set( infosBag, fReusableContextCount);
-		PoolInfosBagKeys::unusedContextCount.Set( infosBag, fUnusedContexts.size());
+		PoolInfosBagKeys::unusedContextCount.Set( infosBag, fUnusedContextCount);
 		PoolInfosBagKeys::createdContextCount.Set( infosBag, fCreatedContextCount);
 		PoolInfosBagKeys::destroyedContextCount.Set( infosBag, fDestroyedContextCount);
+		PoolInfosBagKeys::warmRetainCount.Set( infosBag, fWarmRetainCount);
+		PoolInfosBagKeys::coldRetainCount.Set( infosBag, fColdRetainCount);
+		PoolInfosBagKeys::warmedUpContextCount.Set( infosBag, fWarmedUpContextCount);
+		PoolInfosBagKeys::spareContextsLowWaterMark.Set( infosBag, fSpareContextsLowWaterMark);
+		PoolInfosBagKeys::spareContextsHighWaterMark.Set( infosBag, fSpareContextsHighWaterMark);
+		PoolInfosBagKeys::scriptsCacheEnabled.Set( infosBag, fScriptsCacheEnabled);
+		PoolInfosBagKeys::contextCreationTime.Set( infosBag, fContextCreationTime);
+		PoolInfosBagKeys::averageContextCreationTime.Set( infosBag, (fCreatedContextCount > 0) ? fContextCreationTime / fCreatedContextCount : 0);
+		PoolInfosBagKeys::gcEnabled.Set( infosBag, fGCEnabled);
+		PoolInfosBagKeys::gcMemoryBudget.Set( infosBag, fGCMemoryBudget);
+		PoolInfosBagKeys::gcRequestsBudget.Set( infosBag, fGCRequestsBudget);
+		PoolInfosBagKeys::gcPauseBudget.Set( infosBag, fGCPauseBudget);
+		PoolInfosBagKeys::gcMemorySize.Set( infosBag, fGCLastMemorySize);
+		PoolInfosBagKeys::gcCount.Set( infosBag, fGCCount);
+		PoolInfosBagKeys::gcTotalPause.Set( infosBag, fGCTotalPause);
+		PoolInfosBagKeys::gcMaxPause.Set( infosBag, fGCMaxPause);
+
+		// Histogram of the garbage collection pauses
+		for (sLONG i = 0 ; i < kGC_PAUSES_HISTOGRAM_SIZE ; ++i)
+		{
+			BagElement pauseBag( infosBag, PoolInfosBagKeys::gcPause);
+			PoolInfosBagKeys::minDuration.Set( pauseBag, kGC_PAUSES_HISTOGRAM_MIN_DURATIONS[i]);
+			PoolInfosBagKeys::count.Set( pauseBag, fGCPausesHistogram[i]);
+		}
 		fPoolMutex.Unlock();
 	}
+
+	fManager->GetScriptsCache().GetCacheInformations( infosBag);
 }
 
 
-void VJSContextPool::Clean()
+void VJSContextPool::PublishMetrics( const VString& inLabels) const
 {
-	if (fPoolMutex.Lock())
+	VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+	if (metrics == NULL)
+		return;
+
+	// the counters are only read, the snapshot may be slightly inconsistent but no lock is needed
+	metrics->SetGauge( L"wakanda_jscontext_used", L"Count of JavaScript contexts in use.", inLabels, fUsedContextCount);
+	metrics->SetGauge( L"wakanda_jscontext_unused", L"Count of idle reusable JavaScript contexts.", inLabels, fUnusedContextCount);
+	metrics->SetGauge( L"wakanda_jscontext_pool_size", L"Maximum count of JavaScript contexts.", inLabels, fSize);
+	metrics->SetCounter( L"wakanda_jscontext_created_total", L"Count of JavaScript contexts created since the pool started.", inLabels, fCreatedContextCount);
+	metrics->SetCounter( L"wakanda_jscontext_destroyed_total", L"Count of JavaScript contexts destroyed since the pool started.", inLabels, fDestroyedContextCount);
+	metrics->SetCounter( L"wakanda_jscontext_warm_retain_total", L"Count of requests served by a reused JavaScript context.", inLabels, fWarmRetainCount);
+	metrics->SetCounter( L"wakanda_jscontext_cold_retain_total", L"Count of requests which had to wait for a JavaScript context creation.", inLabels, fColdRetainCount);
+	metrics->SetCounter( L"wakanda_jscontext_creation_milliseconds_total", L"Time spent creating JavaScript contexts.", inLabels, fContextCreationTime);
+	metrics->SetCounter( L"wakanda_gc_total", L"Count of garbage collections scheduled by the pool.", inLabels, fGCCount);
+	metrics->SetCounter( L"wakanda_gc_pause_milliseconds_total", L"Time spent in garbage collections scheduled by the pool.", inLabels, fGCTotalPause);
+	metrics->SetGauge( L"wakanda_gc_pause_max_milliseconds", L"Longest garbage collection pause.", inLabels, fGCMaxPause);
+	metrics->SetGauge( L"wakanda_gc_memory_bytes", L"Physical memory used by the process, measured by the last garbage collection scheduling pass.", inLabels, fGCLastMemorySize);
+
+	// the pauses histogram buckets are not cumulative: each gauge counts the pauses longer than its minimum and shorter than the next one
+	for (sLONG i = 0 ; i < kGC_PAUSES_HISTOGRAM_SIZE ; ++i)
 	{
-		for (MapOfJSContext_iter iter = fUnusedContexts.begin() ; iter != fUnusedContexts.end() ; ++iter)
-		{
-			xbox_assert(iter->second->IsReusable());
+		VString labels( inLabels), minDuration;
+		minDuration.FromLong( kGC_PAUSES_HISTOGRAM_MIN_DURATIONS[i]);
+		VRIAServerMetrics::AppendLabel( labels, L"min_milliseconds", minDuration);
+		metrics->SetGauge( L"wakanda_gc_pauses", L"Count of garbage collection pauses per duration range.", labels, fGCPausesHistogram[i]);
+	}
+}
 
-			VJSGlobalObject *globalObject = iter->second->GetGlobalObject();
-			if (globalObject != NULL)
-				globalObject->GarbageCollect();
 
-			_ReleaseContext( iter->first);
+void VJSContextPool::Clean()
+{
+	// Wait for the idle contexts which are being collected to be back in their shard
+	VTaskLock gcLock( &fGCMutex);
 
-			delete iter->second;
-			--fReusableContextCount;
-			++fDestroyedContextCount;
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
+	{
+		VJSContextPoolShard& shard = fShards[shardIndex];
+		VectorOfJSContext unusedContexts;
+
+		if (shard.fMutex.Lock())
+		{
+			unusedContexts.swap( shard.fUnusedContexts);
+			shard.fMutex.Unlock();
 		}
 
-		xbox_assert(fReusableContextCount == 0);
-		fUnusedContexts.clear();
+		for (VectorOfJSContext_iter iter = unusedContexts.begin() ; iter != unusedContexts.end() ; ++iter)
+		{
+			xbox_assert(iter->second->IsReusable());
 
-		fPoolMutex.Unlock();
+			VInterlocked::Decrement( &fUnusedContextCount);
+			_DestroyContext( *iter);
+		}
 	}
 }
 
@@ -1339,19 +1809,24 @@ VError VJSContextPool::Clean( sLONG inTimeoutMs, uLONG* outRemainingContexts, st
 	fEnabled = false;
 
 	// Ask for terminating all workers
-	if (fPoolMutex.Lock())
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
 	{
-		for (MapOfJSContext_citer iter = fUsedContexts.begin() ; iter != fUsedContexts.end() ; ++iter)
+		VJSContextPoolShard& shard = fShards[shardIndex];
+
+		if (shard.fMutex.Lock())
 		{
-			VJSContext jsContext( iter->first);
-			VJSWorker *worker = VJSWorker::RetainWorker( jsContext);
-			if (worker != NULL)
+			for (MapOfJSContext_citer iter = shard.fUsedContexts.begin() ; iter != shard.fUsedContexts.end() ; ++iter)
 			{
-				worker->Terminate();
-				worker->Release();
+				VJSContext jsContext( iter->first);
+				VJSWorker *worker = VJSWorker::RetainWorker( jsContext);
+				if (worker != NULL)
+				{
+					worker->Terminate();
+					worker->Release();
+				}
 			}
+			shard.fMutex.Unlock();
 		}
-		fPoolMutex.Unlock();
 	}
 	
 
@@ -1406,21 +1881,18 @@ VSyncEvent* VJSContextPool::WaitForNumberOfUsedContextEqualZero()
 {
 	VSyncEvent *syncEvent = NULL;
 
-	if (fPoolMutex.Lock())
+	// The count of used contexts can reach 0 only under the event mutex (see _RemoveUsedContextCount()),
+	// so a release can't slip between the check of the count and the creation of the event
+	if (fNoUsedContextEvenMutex.Lock())
 	{
-		if (fUsedContexts.size() > 0)
+		if (fUsedContextCount > 0)
 		{
-			if (fNoUsedContextEvenMutex.Lock())
-			{
-				if (fNoUsedContextEvent == NULL)
-					fNoUsedContextEvent = new VSyncEvent();
-
-				syncEvent = RetainRefCountable( fNoUsedContextEvent);
+			if (fNoUsedContextEvent == NULL)
+				fNoUsedContextEvent = new VSyncEvent();
 
-				fNoUsedContextEvenMutex.Unlock();
-			}
+			syncEvent = RetainRefCountable( fNoUsedContextEvent);
 		}
-		fPoolMutex.Unlock();
+		fNoUsedContextEvenMutex.Unlock();
 	}
 	return syncEvent;
 }
@@ -1499,33 +1971,29 @@ void VJSContextPool::RemoveRequiredScript( const VFilePath& inPath)
 
 void VJSContextPool::GarbageCollect()
 {
-	if (fPoolMutex.Lock())
+	// The idle contexts are collected out of their shard
+	_CollectIdleContexts( 1, -1);
+
+	for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
 	{
-		for (MapOfJSContext_iter iter = fUnusedContexts.begin() ; iter != fUnusedContexts.end() ; ++iter)
-		{
-			if  (iter->second != NULL)
-			{
-				VJSGlobalObject *globalObject = iter->second->GetGlobalObject();
-				if (globalObject != NULL)
-				{
-					globalObject->GarbageCollect();
-				}
-			}
-		}
+		VJSContextPoolShard& shard = fShards[shardIndex];
 
-		for (MapOfJSContext_iter iter = fUsedContexts.begin() ; iter != fUsedContexts.end() ; ++iter)
+		if (shard.fMutex.Lock())
 		{
-			if  (iter->second != NULL)
+			for (MapOfJSContext_iter iter = shard.fUsedContexts.begin() ; iter != shard.fUsedContexts.end() ; ++iter)
 			{
-				VJSGlobalObject *globalObject = iter->second->GetGlobalObject();
-				if (globalObject != NULL)
+				if  (iter->second != NULL)
 				{
-					globalObject->GarbageCollect();
+					VJSGlobalObject *globalObject = iter->second->GetGlobalObject();
+					if (globalObject != NULL)
+					{
+						globalObject->GarbageCollect();
+					}
 				}
 			}
-		}
 
-		fPoolMutex.Unlock();
+			shard.fMutex.Unlock();
+		}
 	}
 }
 
@@ -1566,6 +2034,9 @@ VJSGlobalContext* VJSContextPool::_RetainNewContext( VError& outError)
 	if (runtimeDelegate == NULL)
 		runtimeDelegate = this;
 
+	uLONG startTime = VSystem::GetCurrentTime();
+	VJSScriptsCache& scriptsCache = fManager->GetScriptsCache();
+
 	VJSGlobalContext *globalContext = RetainNewContext( runtimeDelegate);
 	if (globalContext != NULL)
 	{
@@ -1586,7 +2057,7 @@ VJSGlobalContext* VJSContextPool::_RetainNewContext( VError& outError)
 						if (testAssert(globalObject != NULL))
 							globalObject->RegisterIncludedFile( script);
 
-						globalContext->EvaluateScript( script, NULL);
+						scriptsCache.EvaluateScript( globalContext, script, fScriptsCacheEnabled);
 					}
 				}
 				ReleaseRefCountable( &script);
@@ -1608,7 +2079,7 @@ VJSGlobalContext* VJSContextPool::_RetainNewContext( VError& outError)
 						if (testAssert(globalObject != NULL))
 							globalObject->RegisterIncludedFile( script);	// sc 17/01/2011 to invalid the context when the entity Entity Model script is modified
 
-						globalContext->EvaluateScript( script, NULL);
+						scriptsCache.EvaluateScript( globalContext, script, fScriptsCacheEnabled);
 					}
 				}
 				ReleaseRefCountable( &script);
@@ -1620,6 +2091,12 @@ VJSGlobalContext* VJSContextPool::_RetainNewContext( VError& outError)
 		{
 			outError = fDelegate->InitializeJSContext( globalContext);
 		}
+
+		if (fPoolMutex.Lock())
+		{
+			fContextCreationTime += VSystem::GetCurrentTime() - startTime;
+			fPoolMutex.Unlock();
+		}
 	}
 	else
 	{
@@ -1652,23 +2129,453 @@ VError VJSContextPool::_ReleaseContext( VJSGlobalContext* inContext)
 
 bool VJSContextPool::_IsPooled(  XBOX::VJSGlobalContext* inContext) const
 {
-	if (fUsedContexts.find( inContext) != fUsedContexts.end())
-		return true;
+	bool pooled = false;
+
+	for (sLONG shardIndex = 0 ; (shardIndex < kSHARD_COUNT) && !pooled ; ++shardIndex)
+	{
+		const VJSContextPoolShard& shard = fShards[shardIndex];
+
+		if (shard.fMutex.Lock())
+		{
+			pooled = (shard.fUsedContexts.find( inContext) != shard.fUsedContexts.end());
+
+			for (VectorOfJSContext_citer iter = shard.fUnusedContexts.begin() ; (iter != shard.fUnusedContexts.end()) && !pooled ; ++iter)
+				pooled = (iter->first == inContext);
+
+			shard.fMutex.Unlock();
+		}
+	}
+
+	return pooled;
+}
+
+
+sLONG VJSContextPool::_GetTaskShardIndex() const
+{
+	return (sLONG) (((uLONG) VTask::GetCurrentID()) % kSHARD_COUNT);
+}
+
+
+sLONG VJSContextPool::_GetUsedContextShardIndex( XBOX::VJSGlobalContext* inContext) const
+{
+	// Contexts are allocated objects, so the low bits of the address are not significant
+	return (sLONG) ((((uintptr_t) inContext) >> 4) % kSHARD_COUNT);
+}
+
+
+bool VJSContextPool::_IsContextValid( VJSContextInfo* inInfo) const
+{
+	// If the pool has been touched or if the debugger state has changed, the context is invalid and must not be reused
+	if ((inInfo->GetStampOfPool() < fStamp) || (inInfo->IsDebuggerActive() != VJSGlobalContext::IsDebuggerActive()))
+		return false;
+
+	// sc 19/06/2014, optimization: check for included files changes at most one time per second
+	uLONG currentTime = VSystem::GetCurrentTime();
+	if ((inInfo->GetIncludedFilesChangesCheckTime() + kINCLUDED_FILES_CHANGES_CHECK_DELAY) < currentTime)
+	{
+		inInfo->SetIncludedFilesChangesCheckTime( currentTime);
 
-	if (fUnusedContexts.find( inContext) != fUnusedContexts.end())
+		VJSGlobalObject *globalObject = inInfo->GetGlobalObject();
+		if ((globalObject != NULL) && globalObject->IsIncludedFilesHaveBeenChanged())
+			return false;
+	}
+
+	return true;
+}
+
+
+bool VJSContextPool::_ReserveReusableContext()
+{
+	if (VInterlocked::Increment( &fReusableContextCount) <= fSize)
 		return true;
 
+	VInterlocked::Decrement( &fReusableContextCount);
 	return false;
 }
 
 
+void VJSContextPool::_AddUsedContext( XBOX::VJSGlobalContext* inContext, VJSContextInfo* inInfo)
+{
+	VJSContextPoolShard& shard = fShards[_GetUsedContextShardIndex( inContext)];
+
+	if (shard.fMutex.Lock())
+	{
+		shard.fUsedContexts[inContext] = inInfo;
+		shard.fMutex.Unlock();
+	}
+
+	sLONG usedContextCount = VInterlocked::Increment( &fUsedContextCount);
+	if (usedContextCount > fUsedContextMaxCount)
+	{
+		if (fPoolMutex.Lock())
+		{
+			if (usedContextCount > fUsedContextMaxCount)
+				fUsedContextMaxCount = usedContextCount;
+			fPoolMutex.Unlock();
+		}
+	}
+}
+
+
+void VJSContextPool::_RemoveUsedContextCount()
+{
+	sLONG usedContextCount = VInterlocked::CompareExchange( &fUsedContextCount, 0, 0);
+	while (usedContextCount > 1)
+	{
+		// Decrements which don't reach 0 don't need the event mutex
+		sLONG oldCount = VInterlocked::CompareExchange( &fUsedContextCount, usedContextCount, usedContextCount - 1);
+		if (oldCount == usedContextCount)
+			return;
+
+		usedContextCount = oldCount;
+	}
+
+	if (fNoUsedContextEvenMutex.Lock())
+	{
+		if (VInterlocked::Decrement( &fUsedContextCount) == 0)
+		{
+			if (fNoUsedContextEvent != NULL)
+			{
+				if (fNoUsedContextEvent->Unlock())
+					ReleaseRefCountable( &fNoUsedContextEvent);
+			}
+		}
+		fNoUsedContextEvenMutex.Unlock();
+	}
+}
+
+
+bool VJSContextPool::_PopUnusedContext( JSContextEntry& outEntry, XBOX::VJSGlobalContext* inPreferedContext)
+{
+	if (fUnusedContextCount <= 0)
+		return false;
+
+	bool found = false;
+	sLONG taskShardIndex = _GetTaskShardIndex();
+
+	// Try to reuse the prefered context whatever its shard
+	if (inPreferedContext != NULL)
+	{
+		for (sLONG i = 0 ; (i < kSHARD_COUNT) && !found ; ++i)
+		{
+			VJSContextPoolShard& shard = fShards[(taskShardIndex + i) % kSHARD_COUNT];
+
+			if (shard.fMutex.Lock())
+			{
+				for (VectorOfJSContext_iter iter = shard.fUnusedContexts.begin() ; (iter != shard.fUnusedContexts.end()) && !found ; ++iter)
+				{
+					if (iter->first == inPreferedContext)
+					{
+						outEntry = *iter;
+						shard.fUnusedContexts.erase( iter);
+						found = true;
+						break;
+					}
+				}
+				shard.fMutex.Unlock();
+			}
+		}
+	}
+
+	// Take the most recently released context of the task shard (LIFO), else steal the least recently released context of an other shard
+	for (sLONG i = 0 ; (i < kSHARD_COUNT) && !found ; ++i)
+	{
+		VJSContextPoolShard& shard = fShards[(taskShardIndex + i) % kSHARD_COUNT];
+
+		if (shard.fMutex.Lock())
+		{
+			if (!shard.fUnusedContexts.empty())
+			{
+				if (i == 0)
+				{
+					outEntry = shard.fUnusedContexts.back();
+					shard.fUnusedContexts.pop_back();
+				}
+				else
+				{
+					outEntry = shard.fUnusedContexts.front();
+					shard.fUnusedContexts.erase( shard.fUnusedContexts.begin());
+				}
+				found = true;
+			}
+			shard.fMutex.Unlock();
+		}
+	}
+
+	if (found)
+		VInterlocked::Decrement( &fUnusedContextCount);
+
+	return found;
+}
+
+
+void VJSContextPool::_PushUnusedContext( const JSContextEntry& inEntry, sLONG inShardIndex)
+{
+	VJSContextPoolShard& shard = fShards[inShardIndex];
+
+	if (shard.fMutex.Lock())
+	{
+		shard.fUnusedContexts.push_back( inEntry);
+		shard.fMutex.Unlock();
+	}
+
+	VInterlocked::Increment( &fUnusedContextCount);
+}
+
+
+VError VJSContextPool::_DestroyContext( const JSContextEntry& inEntry)
+{
+	VJSGlobalObject *globalObject = inEntry.second->GetGlobalObject();
+	if (globalObject != NULL)
+		globalObject->GarbageCollect();
+
+	if (inEntry.second->IsReusable())
+		VInterlocked::Decrement( &fReusableContextCount);
+
+	VInterlocked::Increment( &fDestroyedContextCount);
+
+	delete inEntry.second;
+
+	return _ReleaseContext( inEntry.first);
+}
+
+
+bool VJSContextPool::_CollectIdleContexts( sLONG inMinRequestCount, sLONG inPauseBudget)
+{
+	bool done = false;
+
+	if (inMinRequestCount < 1)
+		inMinRequestCount = 1;
+
+	if (fGCMutex.Lock())
+	{
+		uLONG startTime = VSystem::GetCurrentTime();
+
+		while (!done && ((inPauseBudget < 0) || ((sLONG) (VSystem::GetCurrentTime() - startTime) < inPauseBudget)))
+		{
+			// Look for the most used idle context
+			VJSGlobalContext *candidate = NULL;
+			sLONG candidateShardIndex = -1;
+			sLONG candidateRequestCount = inMinRequestCount - 1;
+
+			for (sLONG shardIndex = 0 ; shardIndex < kSHARD_COUNT ; ++shardIndex)
+			{
+				VJSContextPoolShard& shard = fShards[shardIndex];
+
+				if (shard.fMutex.Lock())
+				{
+					for (VectorOfJSContext_citer iter = shard.fUnusedContexts.begin() ; iter != shard.fUnusedContexts.end() ; ++iter)
+					{
+						if (iter->second->GetRequestCount() > candidateRequestCount)
+						{
+							candidate = iter->first;
+							candidateShardIndex = shardIndex;
+							candidateRequestCount = iter->second->GetRequestCount();
+						}
+					}
+					shard.fMutex.Unlock();
+				}
+			}
+
+			if (candidate == NULL)
+			{
+				done = true;
+			}
+			else
+			{
+				// Take the context out of its shard: it may have been retained meanwhile
+				JSContextEntry entry( NULL, NULL);
+				VJSContextPoolShard& shard = fShards[candidateShardIndex];
+
+				if (shard.fMutex.Lock())
+				{
+					for (VectorOfJSContext_iter iter = shard.fUnusedContexts.begin() ; iter != shard.fUnusedContexts.end() ; ++iter)
+					{
+						if (iter->first == candidate)
+						{
+							entry = *iter;
+							shard.fUnusedContexts.erase( iter);
+							break;
+						}
+					}
+					shard.fMutex.Unlock();
+				}
+
+				if (entry.second != NULL)
+				{
+					VInterlocked::Decrement( &fUnusedContextCount);
+
+					_CollectContext( entry.second);
+
+					if ((entry.second->GetStampOfPool() < fStamp) || fManager->IsPoolsAreBeingCleaned())
+						_DestroyContext( entry);
+					else
+						_PushUnusedContext( entry, candidateShardIndex);
+				}
+			}
+		}
+		fGCMutex.Unlock();
+	}
+
+	return done;
+}
+
+
+void VJSContextPool::_CollectContext( VJSContextInfo* inInfo)
+{
+	VJSGlobalObject *globalObject = inInfo->GetGlobalObject();
+	if (globalObject != NULL)
+	{
+		uLONG startTime = VSystem::GetCurrentTime();
+
+		globalObject->GarbageCollect();
+
+		sLONG pause = (sLONG) (VSystem::GetCurrentTime() - startTime);
+
+		if (fPoolMutex.Lock())
+		{
+			++fGCCount;
+			fGCTotalPause += pause;
+			if (pause > fGCMaxPause)
+				fGCMaxPause = pause;
+
+			sLONG bucket = kGC_PAUSES_HISTOGRAM_SIZE - 1;
+			while ((bucket > 0) && (pause < kGC_PAUSES_HISTOGRAM_MIN_DURATIONS[bucket]))
+				--bucket;
+			++fGCPausesHistogram[bucket];
+
+			fPoolMutex.Unlock();
+		}
+	}
+	inInfo->ResetRequestCount();
+}
+
+
+bool VJSContextPool::_CanAddSpareContext() const
+{
+	return	fEnabled
+		&&	!fManager->IsPoolsAreBeingCleaned()
+		&&	IsContextReusingEnabled()
+		&&	(fReusableContextCount < fSize)
+		&&	(fUnusedContextCount < fSpareContextsHighWaterMark);
+}
+
+
+bool VJSContextPool::_WarmUpContext()
+{
+	bool needed = false;
+	uLONG stamp = 0;
+	bool debuggerActive = false;
+
+	if (fPoolMutex.Lock())
+	{
+		// The refill begins when the low-water mark is crossed and ends when the high-water mark is reached
+		if (fUnusedContextCount < fSpareContextsLowWaterMark)
+			fSpareContextsRefilling = true;
+
+		if (fSpareContextsRefilling && !_CanAddSpareContext())
+			fSpareContextsRefilling = false;
+
+		needed = fSpareContextsRefilling;
+		stamp = fStamp;
+		debuggerActive = VJSGlobalContext::IsDebuggerActive();
+		fPoolMutex.Unlock();
+	}
+
+	if (!needed)
+		return false;
+
+	bool added = false;
+
+	// The context is fully initialized outside of any pool lock
+	StErrorContextInstaller errorContext( false, true);
+	VError err = VE_OK;
+	VJSGlobalContext *globalContext = _RetainNewContext( err);
+	if (globalContext != NULL)
+	{
+		VJSContextInfo *info = (err == VE_OK) ? new VJSContextInfo() : NULL;
+		if (info != NULL)
+		{
+			VJSContext jsContext( globalContext);
+
+			// The spare context is not held by the warm-up task
+			VRIAJSRuntimeContext *runtimeContext = VRIAJSRuntimeContext::GetFromJSContext( jsContext);
+			if (runtimeContext != NULL)
+				runtimeContext->SetHolderTaskID( NULL_TASK_ID);
+			info->SetGlobalObject( jsContext.GetGlobalObjectPrivateInstance());
+			info->SetDebuggerActive( debuggerActive);
+			info->SetStampOfPool( stamp);
+			info->SetIncludedFilesChangesCheckTime( VSystem::GetCurrentTime());
+			info->SetReusable( true);
+
+			// The context is lost if the pool has been touched or if the debugger state has changed since the context creation.
+			// The checks and the push are done under the same lock so that a pool cleanup cannot miss the context.
+			if (fPoolMutex.Lock())
+			{
+				if ((stamp == fStamp) && (debuggerActive == VJSGlobalContext::IsDebuggerActive()) && _CanAddSpareContext() && _ReserveReusableContext())
+				{
+					VInterlocked::Increment( &fCreatedContextCount);
+					VInterlocked::Increment( &fWarmedUpContextCount);
+
+					// Spare contexts are spread over the shards
+					_PushUnusedContext( JSContextEntry( globalContext, info), fWarmUpShard);
+					fWarmUpShard = (fWarmUpShard + 1) % kSHARD_COUNT;
+					added = true;
+				}
+				fPoolMutex.Unlock();
+			}
+
+			if (!added)
+				delete info;
+		}
+
+		if (!added)
+			_ReleaseContext( globalContext);
+	}
+
+	return added;
+}
+
+
+sLONG VJSContextPool::_WarmUpTaskProc( VTask* inTask)
+{
+	VJSContextPool *pool = (VJSContextPool*) inTask->GetKindData();
+
+	while (!inTask->IsDying())
+	{
+		// Cleared before the check so that a wake-up posted meanwhile is not lost
+		VInterlocked::Exchange( &pool->fWarmUpWakeUpPosted, 0);
+
+		if (!pool->_WarmUpContext())
+			inTask->ExecuteMessagesWithTimeout( kSPARE_CONTEXTS_CHECK_DELAY);
+	}
+	return 0;
+}
+
+
+void VJSContextPool::_WakeUpWarmUp()
+{
+	// One message is enough whatever the count of contexts retained until the task runs
+	if ((fWarmUpTask != NULL) && (VInterlocked::Exchange( &fWarmUpWakeUpPosted, 1) == 0))
+	{
+		VJSContextPoolWakeUpMessage *msg = new VJSContextPoolWakeUpMessage();
+		msg->PostTo( fWarmUpTask);
+		ReleaseRefCountable( &msg);
+	}
+}
+
+
+// The pools of the projects may be created by concurrent startup workers
+static VCriticalSection sInitGlobalClassesMutex;
+
 void VJSContextPool::_InitGlobalClasses()
 {
 	static bool sDone = false;
 
+	VTaskLock lock( &sInitGlobalClassesMutex);
+
 	if (!sDone)
 	{
-		sDone = true;
 
 		// Append some custom properties to the global class
 
@@ -1742,6 +2649,10 @@ void VJSContextPool::_InitGlobalClasses()
 
 		VJSGlobalClass::AddStaticValue( kSSJS_PROPERTY_NAME_wildchar, VJSGlobalClass::js_getProperty<VJSApplicationGlobalObject::_getWildChar>, NULL, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete);
 
+		VJSGlobalClass::AddStaticValue( kSSJS_PROPERTY_NAME_DataStore, VJSGlobalClass::js_getProperty<VJSApplicationGlobalObject::_getDataStore>, NULL, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete);
+
+		VJSGlobalClass::AddStaticValue( kSSJS_PROPERTY_NAME_SyntaxTester, VJSGlobalClass::js_getProperty<VJSApplicationGlobalObject::_getSyntaxTester>, NULL, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete);
+
 
 		VJSGlobalClass::CreateGlobalClasses();
 		VJSHTTPRequestHeader::Class();
@@ -1763,6 +2674,9 @@ void VJSContextPool::_InitGlobalClasses()
 	#if WITH_SANDBOXED_PROJECT
 		VJSServer::Class();
 	#endif // WITH_SANDBOXED_PROJECT
+
+		// set once the classes are registered: the other pools wait for the lock
+		sDone = true;
 	}
 }
 
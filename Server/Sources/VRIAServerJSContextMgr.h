@@ -41,6 +41,58 @@ typedef struct
 } JSWorkerInfo;
 
 
+/** @brief	VJSScriptsCache class
+
+		Cache of the required and included scripts which is shared by all the context pools.
+		A script file is read and decoded once per version: the file version is identified by its modification time and its size,
+		and the decoded sources are stored by content hash so that identical files share the same text.
+		The cache is purged each time the pools are touched by the context manager.
+
+		Note: JavaScriptCore does not expose any way to serialize compiled bytecode, so the script is still parsed by each context.
+*/
+
+class VJSScriptsCache : public XBOX::VObject
+{
+public:
+			VJSScriptsCache();
+	virtual	~VJSScriptsCache();
+
+			/** @brief	Evaluate the script file into the context. If inUseCache is false, the file is read from disk. */
+			bool						EvaluateScript( XBOX::VJSGlobalContext* inContext, XBOX::VFile* inFile, bool inUseCache = true);
+
+			/** @brief	Purge all the cached scripts. */
+			void						Touch();
+
+			void						GetCacheInformations( XBOX::VValueBag& outBag) const;
+
+private:
+	typedef struct
+	{
+		XBOX::VTime		fModificationTime;
+		sLONG8			fSize;
+		uLONG8			fContentHash;
+		bool			fOwnSource;		// true if the content hash collides with an other text: the source is not shared
+		XBOX::VString	fSource;		// set only if fOwnSource is true
+	} ScriptVersion;
+
+	typedef std::map< XBOX::VString, ScriptVersion >				MapOfScriptVersion;		// key is the file path
+	typedef std::map< XBOX::VString, ScriptVersion >::iterator		MapOfScriptVersion_iter;
+	typedef std::map< uLONG8, XBOX::VString >						MapOfScriptSource;		// key is the content hash
+	typedef std::map< uLONG8, XBOX::VString >::iterator				MapOfScriptSource_iter;
+
+			bool						_GetScriptSource( XBOX::VFile* inFile, XBOX::VString& outSource);
+			/** @brief	Remove the source if none script version references it anymore. The mutex must be locked. */
+			void						_PurgeSource( uLONG8 inContentHash);
+
+			MapOfScriptVersion			fVersions;
+			MapOfScriptSource			fSources;
+			sLONG						fHitCount;
+			sLONG						fMissCount;
+	mutable	XBOX::VCriticalSection		fMutex;
+};
+
+
+
 class VRIAServerJSContextMgr : public XBOX::VObject, public XBOX::IJSWorkerDelegate
 {
 public:
@@ -70,6 +122,9 @@ public:
 #endif
 
 			void						GetAllPools( std::vector<VJSContextPool*>& outPools) const;
+
+			/** @brief	Returns the scripts cache which is shared by all pools */
+			VJSScriptsCache&			GetScriptsCache()		{ return fScriptsCache; }
 			
 			/*	Context pool cleaning utilities:
 				call CleanAllPools() to release all JavaScript contexts:	contextMgr->BeginPoolsCleanup();
@@ -95,14 +150,27 @@ public:
 			// Private utilities
 			void						_RegisterPool( VJSContextPool *inPool);
 			void						_UnRegisterPool( VJSContextPool *inPool);
+			/** @brief	Starts the garbage collection scheduler task if not already running */
+			void						_StartGarbageCollectScheduler();
 
 private:
+			/** @brief	The scheduler samples the process memory on a timer and lets each pool collect its contexts according to its budgets */
+	static	sLONG						_GarbageCollectTaskProc( XBOX::VTask* inTask);
+			void						_GarbageCollectPass( XBOX::VTask* inTask);
+
 			SetOfPool					fSetOfPool;
 	mutable	XBOX::VCriticalSection		fSetOfPoolMutex;
 			sLONG						fPoolsAreBeingCleaned;
 
 			XBOX::VSignalT_0			fBeginContextPoolsCleanupSignal;
 			XBOX::VSignalT_0			fEndContextPoolsCleanupSignal;
+
+			VJSScriptsCache				fScriptsCache;
+
+			XBOX::VTask					*fGarbageCollectTask;
+	mutable	XBOX::VCriticalSection		fGarbageCollectTaskMutex;
+			XBOX::VCriticalSection		fGarbageCollectPassMutex;	// held by the scheduler while it works on a snapshot of the pools
+			sLONG8						fGCMemoryAtLastCollect;		// lowest process memory size since the last collection under memory pressure
 };
 
 
@@ -175,6 +243,9 @@ public:
 
 			CDB4DContext*			RetainDB4DContext(VRIAServerProject* inApplication);
 
+			/** @brief	Called when the JavaScript context is retained from or released to the pool: the application contexts follow their JavaScript context. */
+			void					SetHolderTaskID( XBOX::VTaskID inTaskID);
+
 			/** @brief	Retrieve the runtime context which is attached to the JavaScript context. */
 	static	VRIAJSRuntimeContext*	GetFromJSContext( const XBOX::VJSContext& inContext);
 
@@ -267,6 +338,29 @@ public:
 			/**	@brief	Set the maximum count of reusable JavaScript contexts which are stored in the pool. */
 			void							SetSize( sLONG inSize);
 
+			/**	@brief	Set the low-water and high-water marks of the spare contexts.
+						When a context is retained and the count of unused contexts falls below inLowWaterMark, a background task creates
+						fully initialized reusable contexts until inHighWaterMark is reached. The warm-up is disabled if inLowWaterMark is 0. */
+			void							SetSpareContextsMarks( sLONG inLowWaterMark, sLONG inHighWaterMark);
+
+			/**	@brief	Stop the warm-up task. Must be called before the pool delegate is uninitialized. */
+			void							StopWarmUp();
+
+			/**	@brief	Enable or disable the use of the shared scripts cache to evaluate the required scripts. */
+			void							SetScriptsCacheEnabled( bool inEnabled);
+			bool							IsScriptsCacheEnabled() const;
+
+			/**	@brief	Set the budgets of the garbage collection scheduler. inMemoryBudget is the process memory growth in megabytes
+						which triggers a collection, inRequestsBudget is the count of requests handled by a context before it is collected
+						and inPauseBudget is the maximum time in milliseconds spent to collect idle contexts at each scheduler pass.
+						The pause budget is at least 1 millisecond: a budget of 0 would disable the collection of the idle contexts. */
+			void							SetGarbageCollectBudgets( bool inEnabled, sLONG inMemoryBudget, sLONG inRequestsBudget, sLONG inPauseBudget);
+
+			/**	@brief	Called periodically by the garbage collection scheduler with the current process memory size and its growth
+						since the last collection under memory pressure. Idle contexts are collected without holding any lock which is
+						required by RetainContext(). Returns true if the pool has collected all its used idle contexts under memory pressure. */
+			bool							ScheduleGarbageCollect( sLONG8 inMemorySize, sLONG8 inMemoryGrowth);
+
 			/** @brief	Release all unused contexts and clear reusable contexts set */
 			void							Clean();
 		#if WITH_SANDBOXED_PROJECT
@@ -285,6 +379,9 @@ public:
 
 			void							GetPoolInformations( XBOX::VValueBag& outBag) const;
 
+			/**	@brief	Updates the pool gauges of the server metrics, inLabels identifies the pool */
+			void							PublishMetrics( const XBOX::VString& inLabels) const;
+
 		#if 0
 			/**	@brief	Clear() wait for number of used contexts equal 0 and clear the reusable contexts set. */
 			XBOX::VError					Clear();
@@ -307,9 +404,27 @@ private:
 	typedef std::map< XBOX::VJSGlobalContext*, VJSContextInfo* >::iterator			MapOfJSContext_iter;
 	typedef std::map< XBOX::VJSGlobalContext*, VJSContextInfo* >::const_iterator	MapOfJSContext_citer;
 
+	typedef std::pair< XBOX::VJSGlobalContext*, VJSContextInfo* >					JSContextEntry;
+	typedef std::vector< JSContextEntry >											VectorOfJSContext;
+	typedef std::vector< JSContextEntry >::iterator									VectorOfJSContext_iter;
+	typedef std::vector< JSContextEntry >::const_iterator							VectorOfJSContext_citer;
+
 	typedef std::set< XBOX::VJSGlobalContext*>						SetOfJSContext;
 	typedef std::set< XBOX::VJSGlobalContext*>::iterator			SetOfJSContext_iter;
 	typedef std::set< XBOX::VJSGlobalContext*>::const_iterator		SetOfJSContext_citer;
+
+	enum { kSHARD_COUNT = 8 };
+	enum { kGC_PAUSES_HISTOGRAM_SIZE = 7 };
+
+	/** @brief	The contexts are spread over several shards, each one having its own lock, to reduce the contention between the requests handlers.
+				The unused contexts of a shard are kept in LIFO order so that the most recently used context, whose memory is still hot, is reused first. */
+	class VJSContextPoolShard
+	{
+	public:
+			MapOfJSContext					fUsedContexts;			// used contexts (reusable and non-reusable) whose address hashes to this shard
+			VectorOfJSContext				fUnusedContexts;		// unused contexts which are reusable, the most recently released one is at back
+	mutable	XBOX::VCriticalSection			fMutex;
+	};
 	
 			VJSContextPool();
 
@@ -325,6 +440,40 @@ private:
 
 			bool							_IsPooled(  XBOX::VJSGlobalContext* inContext) const;
 
+			/** @brief	Returns the shard which is preferred by the current task for its unused contexts */
+			sLONG							_GetTaskShardIndex() const;
+			/** @brief	Returns the shard which references the used context */
+			sLONG							_GetUsedContextShardIndex( XBOX::VJSGlobalContext* inContext) const;
+
+			/** @brief	Returns false if the context must not be reused. Must be called without any pool lock because included files may be checked. */
+			bool							_IsContextValid( VJSContextInfo* inInfo) const;
+			/** @brief	Returns true if the pool size allows a new reusable context */
+			bool							_ReserveReusableContext();
+
+			void							_AddUsedContext( XBOX::VJSGlobalContext* inContext, VJSContextInfo* inInfo);
+			/** @brief	Decrements the count of used contexts. The last decrement is done under the event mutex and signals the waiter of WaitForNumberOfUsedContextEqualZero() */
+			void							_RemoveUsedContextCount();
+			/** @brief	Pops the prefered context if it's unused, else the most recent unused context of the task shard, else steals one from an other shard */
+			bool							_PopUnusedContext( JSContextEntry& outEntry, XBOX::VJSGlobalContext* inPreferedContext);
+			void							_PushUnusedContext( const JSContextEntry& inEntry, sLONG inShardIndex);
+			XBOX::VError					_DestroyContext( const JSContextEntry& inEntry);
+
+			/** @brief	Collects the idle contexts which have handled at least inMinRequestCount requests, the most used first, until inPauseBudget is exhausted.
+						Each context is taken out of its shard during the collection. Returns true if all the candidates have been collected. */
+			bool							_CollectIdleContexts( sLONG inMinRequestCount, sLONG inPauseBudget);
+			/** @brief	Collects the context and records the pause. The context must be owned by the current task. */
+			void							_CollectContext( VJSContextInfo* inInfo);
+			/** @brief	Returns true if the released context may be collected under memory pressure. */
+			bool							_ClaimCollectOnRelease();
+
+			/** @brief	Returns true if a spare context may be added to the pool. The pool mutex must be locked. */
+			bool							_CanAddSpareContext() const;
+			/** @brief	Creates a spare context if the pool needs one. Returns true if a context has been added to the pool. */
+			bool							_WarmUpContext();
+	static	sLONG							_WarmUpTaskProc( XBOX::VTask* inTask);
+			/** @brief	Wakes up the warm-up task. */
+			void							_WakeUpWarmUp();
+
 	static	void							_InitGlobalClasses();
 
 	static	bool							_SetSpecific( const XBOX::VJSContext& inContext, VJSContextPoolSpecific* inSpecific);
@@ -338,17 +487,45 @@ private:
 
 			// Contexts pooling
 			uLONG							fStamp;			
-			MapOfJSContext					fUsedContexts;			// pool of used contexts (reusable and non-reusable)
-			MapOfJSContext					fUnusedContexts;		// pool of unused contexts which are reusable
-			sLONG							fReusableContextCount;
+			VJSContextPoolShard				fShards[kSHARD_COUNT];
+			sLONG							fUsedContextCount;		// updated with interlocked operations, reaches 0 only under fNoUsedContextEvenMutex
+			sLONG							fUnusedContextCount;	// updated with interlocked operations
+			sLONG							fReusableContextCount;	// updated with interlocked operations
 			sLONG							fUsedContextMaxCount;
 			sLONG							fCreatedContextCount;
 			sLONG							fDestroyedContextCount;
+			sLONG							fWarmRetainCount;		// count of contexts which have been reused
+			sLONG							fColdRetainCount;		// count of contexts which have been created on demand
+			sLONG8							fContextCreationTime;	// total time spent to create and initialize contexts in milliseconds
 	mutable	XBOX::VCriticalSection			fPoolMutex;
 			XBOX::VSyncEvent				*fNoUsedContextEvent;
 	mutable	XBOX::VCriticalSection			fNoUsedContextEvenMutex;
 
+			// Spare contexts warm-up
+			sLONG							fSpareContextsLowWaterMark;
+			sLONG							fSpareContextsHighWaterMark;
+			bool							fSpareContextsRefilling;
+			sLONG							fWarmedUpContextCount;
+			sLONG							fWarmUpShard;
+			XBOX::VTask						*fWarmUpTask;
+			sLONG							fWarmUpWakeUpPosted;	// updated with interlocked operations
+
+			// Garbage collection scheduling
+			bool							fGCEnabled;
+			bool							fGCPressure;			// set when the memory budget is exceeded, used contexts are collected on release
+			sLONG8							fGCMemoryBudget;		// in bytes
+			sLONG							fGCRequestsBudget;
+			sLONG							fGCPauseBudget;			// in milliseconds
+			sLONG8							fGCLastMemorySize;
+			sLONG							fGCLastReleaseCollectTime;	// updated with interlocked operations
+			sLONG							fGCCount;
+			sLONG8							fGCTotalPause;			// in milliseconds
+			sLONG							fGCMaxPause;			// in milliseconds
+			sLONG							fGCPausesHistogram[kGC_PAUSES_HISTOGRAM_SIZE];
+			XBOX::VCriticalSection			fGCMutex;				// held while idle contexts are out of their shard for a collection
+
 			// Required JavaScript  files
+			bool							fScriptsCacheEnabled;
 			std::vector<XBOX::VFilePath>	fRequiredScripts;
 	mutable	XBOX::VCriticalSection			fRequiredScriptsMutex;
 };
@@ -17,95 +17,229 @@
 #include "VRIAServerApplication.h"
 #include "VRIAServerLogger.h"
 
-#if 0
 USING_TOOLBOX_NAMESPACE
 
 
-VRIARequestLogger::VRIARequestLogger()
-: fEnable(true)
+const sLONG kREQUEST_LOGGER_FLUSH_DELAY = 500; // in milliseconds
+
+
+
+VRIARequestLogger::VRIARequestLogger( const VFolder& inFolder, const VString& inLogFileName)
+: fFlushTask(NULL)
 {
-	fLogger = VProcess::Get()->GetLogger();
-}
+	for (sLONG i = 0 ; i < kREQUEST_LOGGER_RING_COUNT ; ++i)
+	{
+		fRings[i].fWriteCount = 0;
+		fRings[i].fReadCount = 0;
+		fRings[i].fDroppedCount = 0;
+	}
 
+	fLogFile = new VSplitableLogFile( inFolder, inLogFileName);
+	if (fLogFile != NULL && !fLogFile->Open( false))
+	{
+		delete fLogFile;
+		fLogFile = NULL;
+	}
+}
 
 
 VRIARequestLogger::~VRIARequestLogger()
 {
+	Stop();
+
+	if (fLogFile != NULL)
+	{
+		fLogFile->Close();
+		delete fLogFile;
+		fLogFile = NULL;
+	}
+}
+
+
+VError VRIARequestLogger::Start()
+{
+	VError err = VE_OK;
+
+	if (fLogFile == NULL)
+		return VE_INVALID_PARAMETER;
+
+	if (fFlushTask == NULL)
+	{
+		fFlushTask = new VTask( this, 0, eTaskStylePreemptive, &VRIARequestLogger::_FlushTaskProc);
+		if (fFlushTask != NULL)
+		{
+			fFlushTask->SetName( CVSTR( "Request Logger"));
+			fFlushTask->SetKindData( (sLONG_PTR) this);
+			fFlushTask->Run();
+		}
+		else
+		{
+			err = VE_MEMORY_FULL;
+		}
+	}
+	return err;
 }
 
 
-void VRIARequestLogger::Log( OsType inComponentID, void* inCDB4DBaseContext, sLONG inRequestNo, sLONG inRequestNbBytes, sLONG inReplyNbBytes, sLONG inElapsedTime)
+void VRIARequestLogger::Stop()
 {
-	xbox_assert(false);	// RIA Server is not supposed to support 4th Dimension requests
+	if (fFlushTask != NULL)
+	{
+		if (fFlushTask->GetState() >= TS_RUNNING)
+		{
+			fFlushTask->Kill();
+
+			while (fFlushTask->GetState() < TS_DEAD)
+				VTask::Sleep( 20);
+		}
+		fFlushTask->Release();
+		fFlushTask = NULL;
+	}
+
+	_Flush();
 }
 
 
-void VRIARequestLogger::Log( OsType inComponentID, void* inCDB4DBaseContext, const VString& inMessage, sLONG inElapsedTime, bool inCleanString)
+void VRIARequestLogger::Log( const sRequestRecord& inRecord)
 {
-	if (fLogger != NULL)
+	sRing& ring = fRings[((uLONG) VTask::GetCurrentID()) % kREQUEST_LOGGER_RING_COUNT];
+
+	if (ring.fMutex.Lock())
 	{
-		StStringConverter<char> converter( VTC_StdLib_char);
-		if (inCleanString)
+		if (ring.fWriteCount - ring.fReadCount >= kREQUEST_LOGGER_RING_SIZE)
 		{
-			VString tmp( inMessage);
-			sLONG len = tmp.GetLength();
-			UniChar* c = tmp.GetCPointerForWrite();
-			if(c)
+			// the ring is full: the oldest record is dropped
+			++ring.fReadCount;
+			++ring.fDroppedCount;
+		}
+
+		ring.fRecords[ring.fWriteCount % kREQUEST_LOGGER_RING_SIZE] = inRecord;
+		++ring.fWriteCount;
+
+		ring.fMutex.Unlock();
+	}
+}
+
+
+void VRIARequestLogger::SetRecordString( UniChar *outBuffer, sLONG inMaxLength, sLONG& outLength, const VString& inString)
+{
+	outLength = (inString.GetLength() < inMaxLength) ? inString.GetLength() : inMaxLength;
+	if (outLength > 0)
+		::memcpy( outBuffer, inString.GetCPointer(), outLength * sizeof(UniChar));
+}
+
+
+sLONG VRIARequestLogger::_FlushTaskProc( VTask* inTask)
+{
+	VRIARequestLogger *logger = (VRIARequestLogger*) inTask->GetKindData();
+
+	while (!inTask->IsDying())
+	{
+		logger->_Flush();
+
+		inTask->ExecuteMessagesWithTimeout( kREQUEST_LOGGER_FLUSH_DELAY);
+	}
+	return 0;
+}
+
+
+void VRIARequestLogger::_Flush()
+{
+	if (fLogFile == NULL)
+		return;
+
+	// the flush task and Stop() may flush concurrently
+	if (fFlushMutex.Lock())
+	{
+		std::vector<sRequestRecord> records;
+		uLONG droppedCount = 0;
+
+		for (sLONG i = 0 ; i < kREQUEST_LOGGER_RING_COUNT ; ++i)
+		{
+			sRing& ring = fRings[i];
+
+			if (ring.fMutex.Lock())
 			{
-				for(sLONG i=0;i<len;i++)
-				{
-					if(c[i]==0x0009)
-					{
-						c[i]=0x0020;
-					}
-					else
-					{
-					#if VERSIONWIN
-						if(c[i]==0x000d)
-						{
-							if(i<len-1 && c[i+1]==0x000a)
-							{
-								c[i]=0x0020;
-								c[i+1]=0x0020;
-							}
-						}
-					#else
-						if(c[i]==0x000d)
-							c[i]=0x0020;
-					#endif
-					}
-				}
+				for ( ; ring.fReadCount != ring.fWriteCount ; ++ring.fReadCount)
+					records.push_back( ring.fRecords[ring.fReadCount % kREQUEST_LOGGER_RING_SIZE]);
+
+				droppedCount += ring.fDroppedCount;
+				ring.fDroppedCount = 0;
+
+				ring.fMutex.Unlock();
 			}
-			Log( inComponentID, inCDB4DBaseContext, converter.ConvertString( tmp), inElapsedTime);
 		}
-		else
+
+		if (!records.empty() || droppedCount > 0)
 		{
-			Log( inComponentID, inCDB4DBaseContext, converter.ConvertString( inMessage), inElapsedTime);
+			for (std::vector<sRequestRecord>::const_iterator iter = records.begin() ; iter != records.end() ; ++iter)
+				_WriteRecord( *iter);
+
+			if (droppedCount > 0)
+				fLogFile->AppendFormattedString( "# %u requests have not been logged\n", droppedCount);
+
+			fLogFile->Flush();
 		}
+
+		fFlushMutex.Unlock();
 	}
 }
 
 
-void VRIARequestLogger::Log( OsType inComponentID, void* inCDB4DBaseContext, const char* inMessage, sLONG inElapsedTime)
+void VRIARequestLogger::_GetRecordString( const UniChar *inBuffer, sLONG inLength, bool inEscapeQuotes, VString& outString)
 {
-	if (fLogger != NULL)
+	outString.FromBlock( inBuffer, inLength * sizeof(UniChar), VTC_UTF_16);
+
+	if (inEscapeQuotes)
 	{
-		OsType ctype[2] = { inComponentID, 0};
-	#if SMALLENDIAN
-		ByteSwapLong( &ctype[0]);
-	#endif
-		VValueBag*	bag = new VValueBag();
-		ILoggerBagKeys::source.Set( bag, VString(ctype) );
-		ILoggerBagKeys::level.Set( bag, eL4JML_Information);
-		ILoggerBagKeys::message.Set( bag, VString(inMessage) );
-		fLogger->LogBag(bag);
-		ReleaseRefCountable(&bag);
+		outString.ExchangeAll( CVSTR( "\\"), CVSTR( "\\\\"));
+		outString.ExchangeAll( CVSTR( "\""), CVSTR( "\\\""));
 	}
 }
 
 
+void VRIARequestLogger::_WriteRecord( const sRequestRecord& inRecord)
+{
+	VString method, url, address, protocol, referer, userAgent;
+	_GetRecordString( inRecord.fMethod, inRecord.fMethodLength, false, method);
+	_GetRecordString( inRecord.fURL, inRecord.fURLLength, true, url);
+	_GetRecordString( inRecord.fAddress, inRecord.fAddressLength, false, address);
+	_GetRecordString( inRecord.fProtocol, inRecord.fProtocolLength, false, protocol);
+	_GetRecordString( inRecord.fReferer, inRecord.fRefererLength, true, referer);
+	_GetRecordString( inRecord.fUserAgent, inRecord.fUserAgentLength, true, userAgent);
+
+	if (referer.IsEmpty())
+		referer.FromCString( "-");
+	if (userAgent.IsEmpty())
+		userAgent.FromCString( "-");
+
+	StStringConverter<char> methodConverter( method, VTC_UTF_8);
+	StStringConverter<char> urlConverter( url, VTC_UTF_8);
+	StStringConverter<char> addressConverter( address, VTC_UTF_8);
+	StStringConverter<char> protocolConverter( protocol, VTC_UTF_8);
+	StStringConverter<char> refererConverter( referer, VTC_UTF_8);
+	StStringConverter<char> userAgentConverter( userAgent, VTC_UTF_8);
 
+	char szTime[64];
+	::strftime( szTime, sizeof( szTime), "%d/%b/%Y:%H:%M:%S %z", ::localtime( &inRecord.fTime));
 
+	char szBodySize[32];
+	if (inRecord.fBodySize > 0)
+		::sprintf( szBodySize, "%lld", inRecord.fBodySize);
+	else
+		::strcpy( szBodySize, "-");
+
+	// combined log format followed by the stages durations
+	fLogFile->AppendFormattedString( "%s - - [%s] \"%s %s %s\" %d %s \"%s\" \"%s\" retain=%u js=%u write=%u total=%u%s\n",
+		addressConverter.GetCPointer(), szTime, methodConverter.GetCPointer(), urlConverter.GetCPointer(), protocolConverter.GetCPointer(),
+		inRecord.fStatusCode, szBodySize, refererConverter.GetCPointer(), userAgentConverter.GetCPointer(),
+		inRecord.fRetainDuration, inRecord.fExecutionDuration, inRecord.fWriteDuration, inRecord.fTotalDuration,
+		inRecord.fFromCache ? " cached" : "");
+}
+
+
+
+#if 0
 StUseLogger::StUseLogger()
 {
 	fLogger = VProcess::Get()->GetLogger();
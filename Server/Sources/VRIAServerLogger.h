@@ -17,34 +17,88 @@
 #define __RIAServerLogger__
 
 
-#if 0
-#include "ServerNet/VServerNet.h"
+// Number of rings: the requests handled by a task always go into the same ring
+const sLONG kREQUEST_LOGGER_RING_COUNT = 16;
+// Number of records of a ring, the oldest records are dropped when the flush task cannot keep up
+const sLONG kREQUEST_LOGGER_RING_SIZE = 128;
+
+const sLONG kREQUEST_LOGGER_METHOD_MAX_LENGTH = 16;
+const sLONG kREQUEST_LOGGER_URL_MAX_LENGTH = 256;
+const sLONG kREQUEST_LOGGER_ADDRESS_MAX_LENGTH = 48;
+const sLONG kREQUEST_LOGGER_PROTOCOL_MAX_LENGTH = 16;
+const sLONG kREQUEST_LOGGER_REFERER_MAX_LENGTH = 256;
+const sLONG kREQUEST_LOGGER_USER_AGENT_MAX_LENGTH = 256;
 
 
-class VRIARequestLogger : public XBOX::VObject, public IRequestLogger
+/*
+	@brief	Access log of the JavaScript request handlers with the timing of each stage of the request.
+			The records are copied into fixed size rings and a background task formats them into a splitable log file
+			using the combined log format followed by the stages durations.
+*/
+class VRIARequestLogger : public XBOX::VObject, public XBOX::IRefCountable
 {
 public:
-			VRIARequestLogger();
+	typedef struct
+	{
+		time_t					fTime;				// when the handler has been called
+		uLONG					fRetainDuration;	// durations in milliseconds
+		uLONG					fExecutionDuration;
+		uLONG					fWriteDuration;
+		uLONG					fTotalDuration;
+		sLONG					fStatusCode;
+		sLONG8					fBodySize;
+		bool					fFromCache;
+		sLONG					fMethodLength;
+		UniChar					fMethod[kREQUEST_LOGGER_METHOD_MAX_LENGTH];
+		sLONG					fURLLength;
+		UniChar					fURL[kREQUEST_LOGGER_URL_MAX_LENGTH];
+		sLONG					fAddressLength;
+		UniChar					fAddress[kREQUEST_LOGGER_ADDRESS_MAX_LENGTH];
+		sLONG					fProtocolLength;
+		UniChar					fProtocol[kREQUEST_LOGGER_PROTOCOL_MAX_LENGTH];
+		sLONG					fRefererLength;
+		UniChar					fReferer[kREQUEST_LOGGER_REFERER_MAX_LENGTH];
+		sLONG					fUserAgentLength;
+		UniChar					fUserAgent[kREQUEST_LOGGER_USER_AGENT_MAX_LENGTH];
+	} sRequestRecord;
+
+			VRIARequestLogger( const XBOX::VFolder& inFolder, const XBOX::VString& inLogFileName);
 	virtual ~VRIARequestLogger();
 
-			XBOX::ILogger*	GetLogger() const { return fLogger; }
+			/** @brief	Starts the flush task */
+			XBOX::VError				Start();
+			/** @brief	Stops the flush task and writes the remaining records */
+			void						Stop();
 
-			// Inherited from IRequestLogger interface
-	virtual void						Log( OsType inComponentID, void* inCDB4DBaseContext, sLONG inRequestNo, sLONG inRequestNbBytes, sLONG inReplyNbBytes, sLONG inElapsedTime);
-	virtual void						Log( OsType inComponentID, void* inCDB4DBaseContext, const XBOX::VString& inMessage, sLONG inElapsedTime, bool inCleanString = false);
-	virtual void						Log( OsType inComponentID, void* inCDB4DBaseContext, const char* inMessage, sLONG inElapsedTime);
-	virtual bool						IsEnable() const { return fEnable; }
+			/** @brief	Copies the record into the ring of the current task. Never blocks on the log file */
+			void						Log( const sRequestRecord& inRecord);
 
-			void						SetEnable( bool inEnable) { fEnable = inEnable; }
+	static	void						SetRecordString( UniChar *outBuffer, sLONG inMaxLength, sLONG& outLength, const XBOX::VString& inString);
 
 private:
-			XBOX::ILogger*				fLogger;
-			bool						fEnable;
+	typedef struct
+	{
+		sRequestRecord			fRecords[kREQUEST_LOGGER_RING_SIZE];
+		uLONG					fWriteCount;
+		uLONG					fReadCount;
+		uLONG					fDroppedCount;
+		XBOX::VCriticalSection	fMutex;
+	} sRing;
+
+	static	sLONG						_FlushTaskProc( XBOX::VTask* inTask);
+			void						_Flush();
+			void						_WriteRecord( const sRequestRecord& inRecord);
+	static	void						_GetRecordString( const UniChar *inBuffer, sLONG inLength, bool inEscapeQuotes, XBOX::VString& outString);
+
+			sRing						fRings[kREQUEST_LOGGER_RING_COUNT];
+			XBOX::VSplitableLogFile		*fLogFile;
+			XBOX::VTask					*fFlushTask;
+			XBOX::VCriticalSection		fFlushMutex;
 };
 
 
 
-
+#if 0
 class StUseLogger : public XBOX::VObject
 {
 public:
@@ -0,0 +1,362 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#include "headers4d.h"
+#include "VRIAServerMetrics.h"
+
+USING_TOOLBOX_NAMESPACE
+
+
+
+VRIAMetricsHistogram::VRIAMetricsHistogram( const VString& inName, const VString& inLabels)
+: fName( inName), fLabels( inLabels), fCount( 0), fSum( 0)
+{
+	::memset( fBuckets, 0, sizeof( fBuckets));
+}
+
+
+VRIAMetricsHistogram::~VRIAMetricsHistogram()
+{
+}
+
+
+void VRIAMetricsHistogram::Record( uLONG inDuration)
+{
+	sLONG bucket = 0;
+	while (bucket < kBUCKET_COUNT && inDuration > (1UL << bucket))
+		++bucket;
+
+	// there are no 64 bits interlocked operations: the mutex is only held for the increments
+	VTaskLock lock( &fMutex);
+
+	++fBuckets[bucket];
+	fSum += inDuration;
+	++fCount;
+}
+
+
+void VRIAMetricsHistogram::Print( VString& ioText) const
+{
+	sLONG8 buckets[kBUCKET_COUNT + 1];
+	sLONG8 count, sum;
+
+	{
+		VTaskLock lock( &fMutex);
+
+		for (sLONG bucket = 0 ; bucket <= kBUCKET_COUNT ; ++bucket)
+			buckets[bucket] = fBuckets[bucket];
+		count = fCount;
+		sum = fSum;
+	}
+
+	sLONG8 cumulativeCount = 0;
+	for (sLONG bucket = 0 ; bucket <= kBUCKET_COUNT ; ++bucket)
+	{
+		cumulativeCount += buckets[bucket];
+
+		ioText.AppendString( fName);
+		ioText.AppendCString( "_bucket{");
+		if (!fLabels.IsEmpty())
+		{
+			ioText.AppendString( fLabels);
+			ioText.AppendUniChar( ',');
+		}
+		ioText.AppendCString( "le=\"");
+		if (bucket < kBUCKET_COUNT)
+			ioText.AppendLong8( 1LL << bucket);
+		else
+			ioText.AppendCString( "+Inf");
+		ioText.AppendCString( "\"} ");
+		ioText.AppendLong8( cumulativeCount);
+		ioText.AppendUniChar( '\n');
+	}
+
+	VString labels;
+	if (!fLabels.IsEmpty())
+	{
+		labels.AppendUniChar( '{');
+		labels.AppendString( fLabels);
+		labels.AppendUniChar( '}');
+	}
+
+	ioText.AppendString( fName);
+	ioText.AppendCString( "_sum");
+	ioText.AppendString( labels);
+	ioText.AppendUniChar( ' ');
+	ioText.AppendLong8( sum);
+	ioText.AppendUniChar( '\n');
+
+	ioText.AppendString( fName);
+	ioText.AppendCString( "_count");
+	ioText.AppendString( labels);
+	ioText.AppendUniChar( ' ');
+	ioText.AppendLong8( count);
+	ioText.AppendUniChar( '\n');
+}
+
+
+
+// ----------------------------------------------------------------------------
+
+
+
+static VRIAServerMetrics *sServerMetrics = NULL;
+
+
+VRIAServerMetrics::VRIAServerMetrics()
+{
+}
+
+
+VRIAServerMetrics::~VRIAServerMetrics()
+{
+}
+
+
+bool VRIAServerMetrics::Init()
+{
+	if (sServerMetrics == NULL)
+		sServerMetrics = new VRIAServerMetrics();
+
+	return sServerMetrics != NULL;
+}
+
+
+void VRIAServerMetrics::DeInit()
+{
+	delete sServerMetrics;
+	sServerMetrics = NULL;
+}
+
+
+VRIAServerMetrics* VRIAServerMetrics::Get()
+{
+	return sServerMetrics;
+}
+
+
+VRIAMetricsHistogram* VRIAServerMetrics::RetainHistogram( const VString& inName, const VString& inHelp, const VString& inLabels)
+{
+	VRIAMetricsHistogram *histogram = NULL;
+
+	VString key( inName);
+	key.AppendUniChar( '{');
+	key.AppendString( inLabels);
+
+	VTaskLock lock( &fMutex);
+
+	MapOfHistograms::iterator found = fHistograms.find( key);
+	if (found != fHistograms.end())
+	{
+		histogram = RetainRefCountable( found->second.fHistogram.Get());
+		++found->second.fOwnerCount;
+	}
+	else
+	{
+		histogram = new VRIAMetricsHistogram( inName, inLabels);
+		if (histogram != NULL)
+		{
+			sHistogramEntry& entry = fHistograms[key];
+			entry.fHistogram = histogram;	// the map owns a reference
+			entry.fOwnerCount = 1;
+
+			sMetricDescription& description = fDescriptions[inName];
+			description.fHelp = inHelp;
+			description.fType = "histogram";
+		}
+	}
+	return histogram;
+}
+
+
+void VRIAServerMetrics::ReleaseHistogram( VRIAMetricsHistogram **ioHistogram)
+{
+	if (ioHistogram == NULL || *ioHistogram == NULL)
+		return;
+
+	{
+		VTaskLock lock( &fMutex);
+
+		for (MapOfHistograms::iterator iter = fHistograms.begin() ; iter != fHistograms.end() ; ++iter)
+		{
+			if (iter->second.fHistogram.Get() == *ioHistogram)
+			{
+				if (--iter->second.fOwnerCount <= 0)
+					fHistograms.erase( iter);
+				break;
+			}
+		}
+	}
+
+	ReleaseRefCountable( ioHistogram);
+}
+
+
+void VRIAServerMetrics::SetGauge( const VString& inName, const VString& inHelp, const VString& inLabels, sLONG8 inValue)
+{
+	_SetSample( inName, inHelp, inLabels, inValue, "gauge");
+}
+
+
+void VRIAServerMetrics::SetCounter( const VString& inName, const VString& inHelp, const VString& inLabels, sLONG8 inValue)
+{
+	_SetSample( inName, inHelp, inLabels, inValue, "counter");
+}
+
+
+void VRIAServerMetrics::RemoveSeries( const VString& inLabels)
+{
+	if (inLabels.IsEmpty())
+		return;
+
+	VString prefix( L"{");
+	prefix.AppendString( inLabels);
+
+	VTaskLock lock( &fMutex);
+
+	for (MapOfSamples::iterator iter = fSamples.begin() ; iter != fSamples.end() ; )
+	{
+		MapOfSamples::iterator next = iter;
+		++next;
+
+		// the labels must match up to a label boundary
+		VIndex pos = iter->first.FindUniChar( '{');
+		if (pos > 0)
+		{
+			VString labels;
+			iter->first.GetSubString( pos, iter->first.GetLength() - pos + 1, labels);
+			if (labels.BeginsWith( prefix, true))
+			{
+				UniChar boundary = (labels.GetLength() > prefix.GetLength()) ? labels[prefix.GetLength()] : 0;
+				if (boundary == '}' || boundary == ',')
+					fSamples.erase( iter);
+			}
+		}
+		iter = next;
+	}
+}
+
+
+void VRIAServerMetrics::Print( VString& ioText) const
+{
+	VTaskLock lock( &fMutex);
+
+	// the maps are sorted by name, so that the samples of a same metric are grouped as expected by the text format
+	VString lastName;
+	for (MapOfHistograms::const_iterator iter = fHistograms.begin() ; iter != fHistograms.end() ; ++iter)
+	{
+		const VString& name = iter->second.fHistogram->GetName();
+		if (name != lastName)
+		{
+			MapOfDescriptions::const_iterator description = fDescriptions.find( name);
+			AppendHelpAndType( ioText, name, (description != fDescriptions.end()) ? description->second.fHelp : VString(), "histogram");
+			lastName = name;
+		}
+		iter->second.fHistogram->Print( ioText);
+	}
+
+	lastName.Clear();
+	for (MapOfSamples::const_iterator iter = fSamples.begin() ; iter != fSamples.end() ; ++iter)
+	{
+		VString name;
+		VIndex pos = iter->first.FindUniChar( '{');
+		if (pos > 0)
+			iter->first.GetSubString( 1, pos - 1, name);
+		else
+			name = iter->first;
+
+		if (name != lastName)
+		{
+			MapOfDescriptions::const_iterator description = fDescriptions.find( name);
+			if (description != fDescriptions.end())
+				AppendHelpAndType( ioText, name, description->second.fHelp, description->second.fType);
+			else
+				AppendHelpAndType( ioText, name, VString(), "gauge");
+			lastName = name;
+		}
+
+		ioText.AppendString( iter->first);
+		ioText.AppendUniChar( ' ');
+		ioText.AppendLong8( iter->second);
+		ioText.AppendUniChar( '\n');
+	}
+}
+
+
+void VRIAServerMetrics::AppendLabel( VString& ioLabels, const VString& inName, const VString& inValue)
+{
+	if (!ioLabels.IsEmpty())
+		ioLabels.AppendUniChar( ',');
+
+	ioLabels.AppendString( inName);
+	ioLabels.AppendCString( "=\"");
+
+	const UniChar *c = inValue.GetCPointer();
+	for (VIndex i = 0 ; i < inValue.GetLength() ; ++i, ++c)
+	{
+		if (*c == '\\' || *c == '"')
+		{
+			ioLabels.AppendUniChar( '\\');
+			ioLabels.AppendUniChar( *c);
+		}
+		else if (*c == '\n')
+		{
+			ioLabels.AppendCString( "\\n");
+		}
+		else
+		{
+			ioLabels.AppendUniChar( *c);
+		}
+	}
+	ioLabels.AppendUniChar( '"');
+}
+
+
+void VRIAServerMetrics::AppendHelpAndType( VString& ioText, const VString& inName, const VString& inHelp, const char *inType)
+{
+	if (!inHelp.IsEmpty())
+	{
+		ioText.AppendCString( "# HELP ");
+		ioText.AppendString( inName);
+		ioText.AppendUniChar( ' ');
+		ioText.AppendString( inHelp);
+		ioText.AppendUniChar( '\n');
+	}
+	ioText.AppendCString( "# TYPE ");
+	ioText.AppendString( inName);
+	ioText.AppendUniChar( ' ');
+	ioText.AppendCString( inType);
+	ioText.AppendUniChar( '\n');
+}
+
+
+void VRIAServerMetrics::_SetSample( const VString& inName, const VString& inHelp, const VString& inLabels, sLONG8 inValue, const char *inType)
+{
+	VString key( inName);
+	if (!inLabels.IsEmpty())
+	{
+		key.AppendUniChar( '{');
+		key.AppendString( inLabels);
+		key.AppendUniChar( '}');
+	}
+
+	VTaskLock lock( &fMutex);
+
+	fSamples[key] = inValue;
+
+	sMetricDescription& description = fDescriptions[inName];
+	description.fHelp = inHelp;
+	description.fType = inType;
+}
@@ -0,0 +1,111 @@
+/*
+* This file is part of Wakanda software, licensed by 4D under
+*  (i) the GNU General Public License version 3 (GNU GPL v3), or
+*  (ii) the Affero General Public License version 3 (AGPL v3) or
+*  (iii) a commercial license.
+* This file remains the exclusive property of 4D and/or its licensors
+* and is protected by national and international legislations.
+* In any event, Licensee's compliance with the terms and conditions
+* of the applicable license constitutes a prerequisite to any use of this file.
+* Except as otherwise expressly stated in the applicable license,
+* such license does not include any other license or rights on this file,
+* 4D's and/or its licensors' trademarks and/or other proprietary rights.
+* Consequently, no title, copyright or other proprietary rights
+* other than those specified in the applicable license is granted.
+*/
+#ifndef __RIAServerMetrics__
+#define __RIAServerMetrics__
+
+
+
+/*
+	@brief	Histogram of durations in milliseconds. The buckets are powers of two, so that the relative error
+			is bounded whatever the magnitude of the durations. The counters are 64 bits and recording only holds
+			the histogram mutex for a few increments.
+*/
+class VRIAMetricsHistogram : public XBOX::VObject, public XBOX::IRefCountable
+{
+public:
+			VRIAMetricsHistogram( const XBOX::VString& inName, const XBOX::VString& inLabels);
+	virtual ~VRIAMetricsHistogram();
+
+			void						Record( uLONG inDuration);
+
+			/** @brief	Appends the histogram using the Prometheus text format */
+			void						Print( XBOX::VString& ioText) const;
+
+			const XBOX::VString&		GetName() const		{ return fName; }
+
+private:
+	enum { kBUCKET_COUNT = 16 };	// upper bounds from 1 ms to 32768 ms, the last bucket is +Inf
+
+			XBOX::VString				fName;
+			XBOX::VString				fLabels;
+			sLONG8						fBuckets[kBUCKET_COUNT + 1];
+			sLONG8						fCount;
+			sLONG8						fSum;
+	mutable	XBOX::VCriticalSection		fMutex;
+};
+
+
+
+/*
+	@brief	Registry of the server metrics: histograms which are recorded on the fly, gauges and counters which are set by their owner.
+			The metrics are printed using the Prometheus text format.
+*/
+class VRIAServerMetrics : public XBOX::VObject
+{
+public:
+	static	bool						Init();
+	static	void						DeInit();
+	static	VRIAServerMetrics*			Get();
+
+			/** @brief	Returns the histogram matching the name and the labels, the histogram is created if needed.
+						The histogram must be given back with ReleaseHistogram() */
+			VRIAMetricsHistogram*		RetainHistogram( const XBOX::VString& inName, const XBOX::VString& inHelp, const XBOX::VString& inLabels);
+			/** @brief	Releases the histogram and sets *ioHistogram to NULL. The series are removed when the last owner releases the histogram */
+			void						ReleaseHistogram( VRIAMetricsHistogram **ioHistogram);
+
+			void						SetGauge( const XBOX::VString& inName, const XBOX::VString& inHelp, const XBOX::VString& inLabels, sLONG8 inValue);
+			/** @brief	The counters are the "_total" series. They restart from zero when their owner is created again, which the scrapers detect as a reset */
+			void						SetCounter( const XBOX::VString& inName, const XBOX::VString& inHelp, const XBOX::VString& inLabels, sLONG8 inValue);
+
+			/** @brief	Removes the gauges and the counters whose labels begin with inLabels, e.g. the series of an application which is closed */
+			void						RemoveSeries( const XBOX::VString& inLabels);
+
+			void						Print( XBOX::VString& ioText) const;
+
+	static	void						AppendLabel( XBOX::VString& ioLabels, const XBOX::VString& inName, const XBOX::VString& inValue);
+	static	void						AppendHelpAndType( XBOX::VString& ioText, const XBOX::VString& inName, const XBOX::VString& inHelp, const char *inType);
+
+private:
+			VRIAServerMetrics();
+	virtual ~VRIAServerMetrics();
+
+	typedef struct
+	{
+		XBOX::VRefPtr<VRIAMetricsHistogram>	fHistogram;
+		sLONG								fOwnerCount;
+	} sHistogramEntry;
+
+	typedef struct
+	{
+		XBOX::VString				fHelp;
+		const char					*fType;
+	} sMetricDescription;
+
+	typedef std::map<XBOX::VString, sHistogramEntry>		MapOfHistograms;	// key is the name followed by the labels between braces
+	typedef std::map<XBOX::VString, sLONG8>					MapOfSamples;		// gauges and counters, key is the name followed by the labels between braces
+	typedef std::map<XBOX::VString, sMetricDescription>		MapOfDescriptions;	// key is the name
+
+			void						_SetSample( const XBOX::VString& inName, const XBOX::VString& inHelp, const XBOX::VString& inLabels, sLONG8 inValue, const char *inType);
+
+			MapOfHistograms				fHistograms;
+			MapOfSamples				fSamples;
+			MapOfDescriptions			fDescriptions;
+	mutable	XBOX::VCriticalSection		fMutex;
+};
+
+
+
+#endif
@@ -39,6 +39,8 @@
 #include "VRIAJSDebuggerSettings.h"
 #include "VRIAServerSupervisor.h"
 #include "VRemoteDebuggerBreakpointsManager.h"
+#include "VRIAServerLogger.h"
+#include "VRIAServerMetrics.h"
 
 #if VERSIONMAC
 #include "AuthorizationHelpers.h"
@@ -47,6 +49,12 @@
 USING_TOOLBOX_NAMESPACE
 
 
+const sLONG kRPC_CATALOG_CHECK_DELAY = 1000; // in milliseconds
+const sLONG kRELOAD_CATALOG_TIMEOUT = 5000; // in milliseconds
+const sLONG kRELOAD_GATE_TIMEOUT = 4 * kRELOAD_CATALOG_TIMEOUT; // the whole reload: two waits for the contexts, the pools cleaning and the database opening
+const VSize kJS_RESPONSE_CACHE_DEFAULT_MEMORY_SIZE = 16 * 1024 * 1024;
+
+
 namespace ProjectOpeningParametersKeys
 {
 	CREATE_BAGKEY_WITH_DEFAULT_SCALAR( openingMode, XBOX::VLong, sLONG, ePOM_FOR_RUNNING);
@@ -469,21 +477,28 @@ VRIAServerProject::VRIAServerProject()
 , fDesignProject(NULL)
 , fDesignProjectFolder(NULL)
 , fDatabase(NULL)
+, fReloadGate(NULL)
+, fReloadTask(NULL)
 , fDataService(NULL)
 , fSecurityManager(NULL)
 , fContextMgr(NULL)
 , fContextCreationEnabled(false)
 , fJSContextPool(NULL)
 , fJSRuntimeDelegate(NULL)
+, fLazyDataStore(false)
 , fRPCService(NULL)
+, fRPCCatalog(NULL)
+, fRPCCatalogStamp(0)
+, fRPCModulesCatalog(NULL)
+, fRPCFailedModules(NULL)
+, fRPCCatalogUpdaterTask(NULL)
 , fOpeningParameters(NULL)
 , fHTTPServerProject (NULL)
 , fApplicationStorage(NULL)
 , fApplicationSettings(NULL)
 , fSessionMgr(NULL)
-, fRequestNumber(0)
-, fLastGarbageCollectRequest(0)
-, fLastWorkingSetSize(0)
+, fJSResponseCache(NULL)
+, fRequestLogger(NULL)
 , fPermissions(NULL)
 , fBackupSettings(NULL)
 , fDebuggerType(UNKNOWN_DBG_TYPE)
@@ -507,21 +522,28 @@ VRIAServerProject::VRIAServerProject( VRIAServerSolution* inSolution)
 , fDesignProject(NULL)
 , fDesignProjectFolder(NULL)
 , fDatabase(NULL)
+, fReloadGate(NULL)
+, fReloadTask(NULL)
 , fDataService(NULL)
 , fSecurityManager(NULL)
 , fContextMgr(NULL)
 , fContextCreationEnabled(false)
 , fJSContextPool(NULL)
 , fJSRuntimeDelegate(NULL)
+, fLazyDataStore(false)
 , fRPCService(NULL)
+, fRPCCatalog(NULL)
+, fRPCCatalogStamp(0)
+, fRPCModulesCatalog(NULL)
+, fRPCFailedModules(NULL)
+, fRPCCatalogUpdaterTask(NULL)
 , fOpeningParameters(NULL)
 , fHTTPServerProject (NULL)
 , fApplicationStorage(NULL)
 , fApplicationSettings(NULL)
 , fSessionMgr(NULL)
-, fRequestNumber(0)
-, fLastGarbageCollectRequest(0)
-, fLastWorkingSetSize(0)
+, fJSResponseCache(NULL)
+, fRequestLogger(NULL)
 , fPermissions(NULL)
 , fBackupSettings(NULL)
 , fDebuggerType(UNKNOWN_DBG_TYPE)
@@ -610,6 +632,12 @@ VError VRIAServerProject::Close()
 	VError err = VE_OK;
 	StTaskPropertiesSetter stTaskProps( &fLoggerID);
 
+	// The spare contexts warm-up and the rpc catalog updates are stopped before the JS runtime delegate is deleted
+	if (fJSContextPool != NULL)
+		fJSContextPool->StopWarmUp();
+
+	_StopRPCCatalogUpdater();
+
 	// JS runtime delegate is deleted first, because it must first remove all web socket handlers.
 
 	delete fJSRuntimeDelegate;
@@ -648,6 +676,21 @@ VError VRIAServerProject::Close()
 
 	ReleaseRefCountable( &fRPCService);
 
+	if (fRPCCatalogMutex.Lock())
+	{
+		ReleaseRefCountable( &fRPCCatalog);
+		++fRPCCatalogStamp;
+		fRPCCatalogMutex.Unlock();
+	}
+
+	if (fRPCCatalogBuildMutex.Lock())
+	{
+		ReleaseRefCountable( &fRPCModulesCatalog);
+		ReleaseRefCountable( &fRPCFailedModules);
+		fRPCCatalogFilesTimes.clear();
+		fRPCCatalogBuildMutex.Unlock();
+	}
+
 	ReleaseRefCountable( &fDataService);
 
 	_CloseAndReleaseDatabase( fDatabase);
@@ -674,6 +717,23 @@ VError VRIAServerProject::Close()
 
 	ReleaseRefCountable( &fSessionMgr);
 
+	ReleaseRefCountable( &fJSResponseCache);
+
+	// the handlers histograms are removed with their handlers, the gauges and the counters are removed here
+	VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+	if (metrics != NULL)
+	{
+		VString labels;
+		VRIAServerMetrics::AppendLabel( labels, L"application", fName);
+		metrics->RemoveSeries( labels);
+	}
+
+	if (fRequestLogger != NULL)
+		fRequestLogger->Stop();
+	ReleaseRefCountable( &fRequestLogger);
+
+	if (fPermissions != NULL)
+		fPermissions->StopWatchingFileChanges();
 	ReleaseRefCountable( &fPermissions);
 
 	delete fJSContextPool;
@@ -747,7 +807,14 @@ VError VRIAServerProject::Start()
 
 	if (VRIAServerApplication::Get()->GetDebuggingAuthorized() && fOpeningParameters->GetHandlesDebuggerServer())
 	{
+		// the debugger settings are shared by the projects of the solution, which may be started concurrently
+		if (fSolution != NULL)
+			fSolution->GetSharedResourcesMutex().Lock();
+
 		VError lErr = _SetDebuggerServer(fOpeningParameters->GetDebuggerType(), NULL);	// sc 08/04/2013, debugger type is now an opening parameter
+
+		if (fSolution != NULL)
+			fSolution->GetSharedResourcesMutex().Unlock();
 		if (lErr != VE_OK)
 		{
 			lErr = vThrowError(VE_RIA_CANNOT_SET_DEBUGGER);
@@ -783,6 +850,25 @@ VError VRIAServerProject::Start()
 			if (err != VE_OK)
 				err = vThrowError( VE_RIA_CANNOT_ENABLE_DEBUG_SERVICE);
 
+			// Install the metrics endpoint if the HTTP settings define its pattern and the clients which may read it
+			VString metricsPattern;
+			VectorOfVString metricsAllowedAddresses;
+			fSettings.GetMetricsPattern( metricsPattern);
+			fSettings.GetMetricsAllowedAddresses( metricsAllowedAddresses);
+			if (err == VE_OK && !metricsPattern.IsEmpty() && !metricsAllowedAddresses.empty())
+			{
+				VMetricsHTTPRequestHandler *metricsHandler = new VMetricsHTTPRequestHandler( this, metricsPattern, metricsAllowedAddresses);
+				if (metricsHandler != NULL)
+				{
+					err = fHTTPServerProject->AddHTTPRequestHandler( metricsHandler);
+					metricsHandler->Release();
+				}
+				else
+				{
+					err = vThrowError( VE_MEMORY_FULL);
+				}
+			}
+
 			// Install the optimize handler for WAF
 			VFilePath optimizeScriptPath;
 			VRIAServerApplication::Get()->GetWAFrameworkFolderPath( optimizeScriptPath);
@@ -1008,7 +1094,13 @@ VRIAContext* VRIAServerProject::RetainNewContext( VError& outError)
 	outError = VE_OK;
 	VRIAContext *context = NULL;
 
-	if (fContextCreationEnabled && fContextMgr != NULL)
+	// While the catalog is being reloaded, the new contexts wait for the new database. A context created meanwhile
+	// would have no database: the creation fails so that the JavaScript context which requests it is not pooled.
+	if (!_WaitForReloadGate())
+	{
+		outError = vThrowError( VE_RIA_PROJECT_IS_BUSY);
+	}
+	else if (fContextCreationEnabled && fContextMgr != NULL)
 	{
 		context = new VRIAContext( this, fContextMgr);
 		if (context != NULL)
@@ -1158,73 +1250,72 @@ VError VRIAServerProject::ReloadCatalog( VRIAContext* inContext)
 				VJSGlobalContext::AbortAllDebug();
 			}
 
-			if (fHTTPServerProject != NULL)
-				fHTTPServerProject->MakeUnavailable();	// sc 14/02/2014, make the HTTP server unavailable
+			// The HTTP server remains available: the requests which need a new application context wait for the new database
+			_CloseReloadGate();
+
+			// Disable the application context (VRIAContext) creation to prevent the creation of base contexts and the using of the current opened database.
+			// The creation is enabled again once the new database is opened.
+			bool contextCreationEnabled = _SetContextCreationEnabled( false);
 
 			if (fDatabase != NULL)
 			{
-				if (fDataService != NULL)
-					fDataService->SetDatabase( NULL);
-				
-				// Disable the application context (VRIAContext) creation to prevent the creation of base contexts and the using of the current opened database
-				bool contextCreationEnabled = _SetContextCreationEnabled( false);
-				
-				// Disable the JavaScript context creation for this application
-				bool jsContextPoolEnabled = fJSContextPool->SetEnabled( false);
-
-				// Drop all the JavaScript contexts of the solution to release the existing application contexts
-				// sc 22/03/2013, review context pools cleaning mechanism
-				std::vector<JSWorkerInfo> workersInfos;
-				uLONG remainingContextsCount = 0;
-				VRIAServerJSContextMgr *jsContextMgr = VRIAServerApplication::Get()->GetJSContextMgr();
-				jsContextMgr->BeginPoolsCleanup();
-				err = jsContextMgr->CleanAllPools( 5000, &remainingContextsCount, &workersInfos);
-				jsContextMgr->EndPoolsCleanup();
+				// The workers keep their JavaScript contexts
+				VJSWorker::TerminateAll();
 
-				if (err == VE_OK)
-				{
-					if (remainingContextsCount == 0)
-					{
-						// Ensure the application is not used anymore
-						ReleaseRefCountable( &context);
+				// Start a new generation of JavaScript contexts: the unused contexts are dropped now and the used ones
+				// are dropped when they are released, so the running requests complete with the current database
+				fJSContextPool->Touch();
+				fJSContextPool->Clean();
 
-						if (fContextMgr != NULL)
-						{
-							VSyncEvent *syncEvent = fContextMgr->WaitForRegisteredContextsCountZero();
-							if (syncEvent != NULL)
-							{
-								syncEvent->Lock( 5000); // sc 22/03/2013, add timeout
-								syncEvent->Release();
-							}
-						}
+				// Ensure the application is not used anymore
+				ReleaseRefCountable( &context);
+
+				bool released = _WaitForContextsRelease( kRELOAD_CATALOG_TIMEOUT);
+				if (!released)
+				{
+					// Some contexts of the other pools may still use the application: drop all the JavaScript contexts of the solution
+					// sc 22/03/2013, review context pools cleaning mechanism
+					std::vector<JSWorkerInfo> workersInfos;
+					uLONG remainingContextsCount = 0;
+					VRIAServerJSContextMgr *jsContextMgr = VRIAServerApplication::Get()->GetJSContextMgr();
+					jsContextMgr->BeginPoolsCleanup();
+					err = jsContextMgr->CleanAllPools( kRELOAD_CATALOG_TIMEOUT, &remainingContextsCount, &workersInfos);
+					jsContextMgr->EndPoolsCleanup();
 
-						if (fContextMgr->GetRegisteredContextsCount() == 0)
+					if (err == VE_OK)
+					{
+						if (remainingContextsCount == 0)
 						{
-							// Here, nobody can access to the database so it's safe detach it and to close it
-							CDB4DBase *db = fDatabase;
-							fDatabase = NULL;
-							_CloseAndReleaseDatabase( db);
+							released = _WaitForContextsRelease( kRELOAD_CATALOG_TIMEOUT);
 						}
 						else
 						{
-							err = vThrowError( VE_RIA_PROJECT_IS_BUSY);
+							VString remainingContexts;
+							remainingContexts.FromLong( remainingContextsCount);
+							err = vThrowError( VE_RIA_JS_CONTEXT_STILL_IN_USE, remainingContexts);
+
+							LogWorkersInformations( fLoggerID, workersInfos); // sc 24/04/2013
 						}
 					}
-					else
+				}
+
+				if (err == VE_OK)
+				{
+					if (released)
 					{
-						VString remainingContexts;
-						remainingContexts.FromLong( remainingContextsCount);
-						vThrowError( VE_RIA_JS_CONTEXT_STILL_IN_USE, remainingContexts);
+						// Here, nobody can access to the database so it's safe detach it and to close it
+						if (fDataService != NULL)
+							fDataService->SetDatabase( NULL);
 
-						LogWorkersInformations( fLoggerID, workersInfos); // sc 24/04/2013
+						CDB4DBase *db = fDatabase;
+						fDatabase = NULL;
+						_CloseAndReleaseDatabase( db);
+					}
+					else
+					{
+						err = vThrowError( VE_RIA_PROJECT_IS_BUSY);
 					}
 				}
-
-				if ((err != VE_OK) && (fDatabase != NULL))
-					fDataService->SetDatabase( fDatabase);
-
-				_SetContextCreationEnabled( contextCreationEnabled);
-				fJSContextPool->SetEnabled( jsContextPoolEnabled);
 			}
 			else
 			{
@@ -1236,9 +1327,6 @@ VError VRIAServerProject::ReloadCatalog( VRIAContext* inContext)
 			bool haveDatastore = false;
 			if (err == VE_OK)
 			{
-				bool contextCreationEnabled = _SetContextCreationEnabled( false);
-				bool jsContextPoolEnabled = fJSContextPool->SetEnabled( false);
-
 				// Here, nobody can access to the database so it's safe to open it
 				fDatabase = _OpenDatabase( err);
 
@@ -1258,18 +1346,17 @@ VError VRIAServerProject::ReloadCatalog( VRIAContext* inContext)
 						fDatabase = NULL;
 					}
 				}
-
-				_SetContextCreationEnabled( contextCreationEnabled);
-				fJSContextPool->SetEnabled( jsContextPoolEnabled);
 			}
 
+			_SetContextCreationEnabled( contextCreationEnabled);
+
 			if (err != VE_OK)
 				err = vThrowError( VE_RIA_CANNOT_RELOAD_DATABASE);
 			else if (haveDatastore)
 				LogMessage( fLoggerID, eL4JML_Information, L"Datastore model reloaded");
 
-			if (fHTTPServerProject != NULL)
-				fHTTPServerProject->MakeAvailable();
+			// The waiting requests are served by the new generation
+			_OpenReloadGate();
 
 			// Post 'catalogDidReload' message to the services
 			_PostServicesMessage( L"catalogDidReload");
@@ -1307,6 +1394,12 @@ VRPCCatalog* VRIAServerProject::RetainRPCCatalog( VRIAContext* inContext, VError
 }
 
 
+uLONG VRIAServerProject::GetRPCCatalogStamp() const
+{
+	return fRPCCatalogStamp;
+}
+
+
 VRPCService* VRIAServerProject::RetainRPCService( VRIAContext* inContext, XBOX::VError* outError)
 {
 	VRPCService *service = NULL;
@@ -1630,34 +1723,6 @@ void VRIAServerProject::ReleaseJSContext( VJSGlobalContext* inContext, IHTTPResp
 			QuickReleaseRefCountable(session);
 
 			jsContext.GetGlobalObjectPrivateInstance()->SetSpecific('uagX', nil, VJSSpecifics::DestructorReleaseCComponent);
-
-			if ( fSolution != 0 && fSolution-> CanGarbageCollect ( ) )
-			{
-				VInterlocked::Increment ( &fRequestNumber );
-				sLONG8			nWorkingSetSize = 0;
-				if ( VSystem::AllowedToGetSystemInfo ( ) )
-					nWorkingSetSize = VSystem::GetApplicationPhysicalMemSize ( );
-
-				if ( fLastGarbageCollectRequest + 10 < fRequestNumber || fLastWorkingSetSize + 50000000 < nWorkingSetSize )
-				{
-					fLastGarbageCollectRequest = fRequestNumber;
-					fLastWorkingSetSize = nWorkingSetSize;
-					/*
-						Problem: this may be not the context hogging the memory. Need to garbage collect all contexts.
-						Need to have a usage (request) counter per context. 
-					*/
-					VString		vstrMessage ( "Garbage collecting context " );
-					sLONG8		nContext = ( sLONG8 ) inContext;
-					vstrMessage. AppendLong8 ( nContext );
-					vstrMessage. AppendCString ( "\n" );
-					::DebugMsg ( vstrMessage );
-
-					VJSGlobalObject*		globalObject = jsContext. GetGlobalObjectPrivateInstance ( );
-					globalObject-> GarbageCollect ( );
-
-					jsContext. GarbageCollect ( );
-				}
-			}
 		}
 
 		if (fJSContextPool != NULL)
@@ -1676,6 +1741,34 @@ VError VRIAServerProject::GetJSContextInformations( XBOX::VValueBag& outBag) con
 }
 
 
+void VRIAServerProject::PublishMetrics() const
+{
+	VRIAServerMetrics *metrics = VRIAServerMetrics::Get();
+	if (metrics == NULL)
+		return;
+
+	VString labels;
+	VRIAServerMetrics::AppendLabel( labels, L"application", fName);
+
+	if (fJSContextPool != NULL)
+		fJSContextPool->PublishMetrics( labels);
+
+	VRIAHTTPSessionManager *sessionMgr = RetainSessionMgr();
+	if (sessionMgr != NULL)
+	{
+		metrics->SetGauge( L"wakanda_http_sessions", L"Count of HTTP sessions.", labels, sessionMgr->GetSessionCount());
+		ReleaseRefCountable( &sessionMgr);
+	}
+
+	VJSResponseCache *responseCache = RetainJSResponseCache();
+	if (responseCache != NULL)
+	{
+		metrics->SetGauge( L"wakanda_http_handler_cache_bytes", L"Memory used by the cached responses of the request handlers.", labels, responseCache->GetMemorySize());
+		ReleaseRefCountable( &responseCache);
+	}
+}
+
+
 bool VRIAServerProject::JSContextShouldBeReleased( XBOX::VJSGlobalContext* inContext) const
 {
 	if (fJSContextPool != NULL)
@@ -1899,6 +1992,18 @@ VRIAHTTPSessionManager*  VRIAServerProject::RetainSessionMgr() const
 }
 
 
+VJSResponseCache* VRIAServerProject::RetainJSResponseCache() const
+{
+	return RetainRefCountable( fJSResponseCache);
+}
+
+
+VRIARequestLogger* VRIAServerProject::RetainRequestLogger() const
+{
+	return RetainRefCountable( fRequestLogger);
+}
+
+
 const VString& VRIAServerProject::GetMessagesLoggerID() const
 {
 	return fLoggerID;
@@ -2612,43 +2717,168 @@ VError VRIAServerProject::InitializeJSContext( VJSGlobalContext* inContext)
 					globalObject.SetProperty( kSSJS_PROPERTY_NAME_Solution, jsSolution, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete, NULL);
 				}
 
-				// Append the database object to the global object
-				VRIAContext *riaContext = rtContext->GetApplicationContext( this);
-				if (riaContext != NULL)
+				// The "ds" and "_syntaxTester" properties are static values of the global class which are resolved on first access.
+				// Unless the lazy binding is enabled, the datastore object and the entity models are bound right now
+				// because the entity models append their classes to the global object.
+				if (!fLazyDataStore)
+					_BindJSDataStore( jsContext);
+			}
+		}
+	}
+	return err;
+}
+
+
+/*
+	The objects bound on first access are kept by the private instance of the global object instead of hidden global properties,
+	so that the scripts cannot see nor shadow them. The values are protected from the garbage collector while they are kept.
+*/
+class VJSBoundObjects : public VObject
+{
+public:
+			VJSBoundObjects( const VJSContext& inContext)
+			: fDataStore( inContext), fSyntaxTester( inContext), fDataStoreBound( false), fSyntaxTesterBound( false)
+			{
+			}
+
+	virtual	~VJSBoundObjects()
+			{
+				if (fDataStoreBound)
+					fDataStore.Unprotect();
+				if (fSyntaxTesterBound)
+					fSyntaxTester.Unprotect();
+			}
+
+			bool				IsDataStoreBound() const		{ return fDataStoreBound; }
+			bool				IsSyntaxTesterBound() const		{ return fSyntaxTesterBound; }
+
+			const VJSValue&		GetDataStore() const			{ return fDataStore; }
+			const VJSValue&		GetSyntaxTester() const			{ return fSyntaxTester; }
+
+			void				SetDataStore( const VJSValue& inDataStore)
+			{
+				if (!fDataStoreBound)
+				{
+					fDataStore = inDataStore;
+					fDataStore.Protect();
+					fDataStoreBound = true;
+				}
+			}
+
+			void				SetSyntaxTester( const VJSValue& inSyntaxTester)
+			{
+				if (!fSyntaxTesterBound)
+				{
+					fSyntaxTester = inSyntaxTester;
+					fSyntaxTester.Protect();
+					fSyntaxTesterBound = true;
+				}
+			}
+
+	static	VJSBoundObjects*	Get( const VJSContext& inContext, bool inCreateIfMissing)
+			{
+				VJSBoundObjects *boundObjects = NULL;
+				VJSGlobalObject *globalObject = inContext.GetGlobalObjectPrivateInstance();
+				if (globalObject != NULL)
 				{
-					CDB4DBaseContext *baseContext = (riaContext != NULL) ? riaContext->GetBaseContext() : NULL;
-					CDB4DManager *db4d = VRIAServerApplication::Get()->GetComponentDB4D();
-					if (db4d != NULL && baseContext != NULL)
+					boundObjects = static_cast<VJSBoundObjects*>( globalObject->GetSpecific( 'bndX'));
+					if (boundObjects == NULL && inCreateIfMissing)
 					{
-						VJSObject jsDatabase = db4d->CreateJSDatabaseObject( jsContext, baseContext);
-												
-						// globalObject.SetProperty( kSSJS_PROPERTY_NAME_Database, jsDatabase, JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete, NULL);
-						globalObject.SetProperty( kSSJS_PROPERTY_NAME_DataStore, jsDatabase, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontDelete, NULL);
-						
-						std::vector<VFile*> modelFiles;
-						db4d->InitJSContextWithEntityModels(globalObject, baseContext, this, modelFiles);
-						VJSGlobalObject *xglobalObject = jsContext.GetGlobalObjectPrivateInstance();
-						for (std::vector<VFile*>::iterator cur = modelFiles.begin(), end = modelFiles.end(); cur != end; ++cur)
+						boundObjects = new VJSBoundObjects( inContext);
+						if (boundObjects != NULL && !globalObject->SetSpecific( 'bndX', boundObjects, VJSSpecifics::DestructorVObject))
 						{
-							VFile* file = *cur;
-							if (testAssert(xglobalObject != NULL))
-								xglobalObject->RegisterIncludedFile(file);
-							file->Release();
+							delete boundObjects;
+							boundObjects = NULL;
 						}
 					}
 				}
+				return boundObjects;
+			}
 
-				// Add the syntax engine tester to the global object
-				CLanguageSyntaxComponent *languageSyntax = VComponentManager::RetainComponentOfType< CLanguageSyntaxComponent >();
-				if (languageSyntax) {
-					VJSObject syntaxTester(languageSyntax->CreateJavaScriptTestObject( jsContext ));
-					globalObject.SetProperty( CVSTR( "_syntaxTester" ), syntaxTester, JS4D::PropertyAttributeReadOnly | JS4D::PropertyAttributeDontEnum | JS4D::PropertyAttributeDontDelete, NULL);
-					languageSyntax->Release();
-				}
+	/** @brief	Unprotects and forgets the objects, must be called while the context is still usable */
+	static	void				Clear( const VJSContext& inContext)
+			{
+				VJSGlobalObject *globalObject = inContext.GetGlobalObjectPrivateInstance();
+				if (globalObject != NULL && globalObject->GetSpecific( 'bndX') != NULL)
+					globalObject->SetSpecific( 'bndX', NULL, VJSSpecifics::DestructorVObject);
 			}
+
+private:
+			VJSValue			fDataStore;
+			VJSValue			fSyntaxTester;
+			bool				fDataStoreBound;
+			bool				fSyntaxTesterBound;
+};
+
+
+VJSValue VRIAServerProject::GetJSDataStore( VJSContext& inContext)
+{
+	VJSBoundObjects *boundObjects = VJSBoundObjects::Get( inContext, false);
+	if (boundObjects == NULL || !boundObjects->IsDataStoreBound())
+	{
+		_BindJSDataStore( inContext);
+		boundObjects = VJSBoundObjects::Get( inContext, false);
+	}
+
+	if (boundObjects != NULL && boundObjects->IsDataStoreBound())
+		return boundObjects->GetDataStore();
+
+	VJSValue result( inContext);
+	result.SetUndefined();
+	return result;
+}
+
+
+VJSValue VRIAServerProject::GetJSSyntaxTester( VJSContext& inContext)
+{
+	VJSBoundObjects *boundObjects = VJSBoundObjects::Get( inContext, true);
+	if (boundObjects != NULL && !boundObjects->IsSyntaxTesterBound())
+	{
+		CLanguageSyntaxComponent *languageSyntax = VComponentManager::RetainComponentOfType< CLanguageSyntaxComponent >();
+		if (languageSyntax != NULL)
+		{
+			VJSObject syntaxTester( languageSyntax->CreateJavaScriptTestObject( inContext));
+			boundObjects->SetSyntaxTester( syntaxTester);
+			languageSyntax->Release();
+		}
+	}
+
+	if (boundObjects != NULL && boundObjects->IsSyntaxTesterBound())
+		return boundObjects->GetSyntaxTester();
+
+	VJSValue result( inContext);
+	result.SetUndefined();
+	return result;
+}
+
+
+void VRIAServerProject::_BindJSDataStore( VJSContext& inContext)
+{
+	VRIAJSRuntimeContext *rtContext = VRIAJSRuntimeContext::GetFromJSContext( inContext);
+	VRIAContext *riaContext = (rtContext != NULL) ? rtContext->GetApplicationContext( this) : NULL;
+	CDB4DBaseContext *baseContext = (riaContext != NULL) ? riaContext->GetBaseContext() : NULL;
+	CDB4DManager *db4d = VRIAServerApplication::Get()->GetComponentDB4D();
+	if (db4d != NULL && baseContext != NULL)
+	{
+		VJSObject globalObject( inContext.GetGlobalObject());
+		VJSObject jsDatabase = db4d->CreateJSDatabaseObject( inContext, baseContext);
+
+		// The datastore object is memoized before the entity models are bound: the model scripts may access "ds".
+		VJSBoundObjects *boundObjects = VJSBoundObjects::Get( inContext, true);
+		if (boundObjects != NULL)
+			boundObjects->SetDataStore( jsDatabase);
+
+		std::vector<VFile*> modelFiles;
+		db4d->InitJSContextWithEntityModels( globalObject, baseContext, this, modelFiles);
+		VJSGlobalObject *xglobalObject = inContext.GetGlobalObjectPrivateInstance();
+		for (std::vector<VFile*>::iterator cur = modelFiles.begin(), end = modelFiles.end(); cur != end; ++cur)
+		{
+			VFile* file = *cur;
+			if (testAssert(xglobalObject != NULL))
+				xglobalObject->RegisterIncludedFile(file);
+			file->Release();
 		}
 	}
-	return err;
 }
 
 
@@ -2658,6 +2888,9 @@ VError VRIAServerProject::UninitializeJSContext( VJSGlobalContext* inContext)
 	
 	if (inContext != NULL)
 	{
+		VJSContext jsContext( inContext);
+		VJSBoundObjects::Clear( jsContext);
+
 		err = VRIAJSRuntimeContext::UninitializeJSContext( inContext);
 	}
 	return err;
@@ -2787,6 +3020,13 @@ VError VRIAServerProject::_Open( VProject* inDesignProject, VRIAServerProjectOpe
 				err = vThrowError( VE_MEMORY_FULL);
 		}
 
+		if (err == VE_OK && !fState.inMaintenance)
+		{
+			fJSResponseCache = new VJSResponseCache( kJS_RESPONSE_CACHE_DEFAULT_MEMORY_SIZE);
+			if (fJSResponseCache == NULL)
+				err = vThrowError( VE_MEMORY_FULL);
+		}
+
 		if (err == VE_OK || fState.inMaintenance)
 		{
 			fContextMgr = new VRIAContextManager( this);
@@ -2809,6 +3049,10 @@ VError VRIAServerProject::_Open( VProject* inDesignProject, VRIAServerProjectOpe
 				fJSContextPool->SetEnabled( false);
 				fJSContextPool->SetContextReusingEnabled ( fSettings.GetReuseJavaScriptContexts());
 				fJSContextPool->SetSize( fSettings.GetContextPoolSize());
+				fJSContextPool->SetSpareContextsMarks( fSettings.GetSpareContextsLowWaterMark(), fSettings.GetSpareContextsHighWaterMark());
+				fJSContextPool->SetScriptsCacheEnabled( fSettings.GetUseScriptsCache());
+				fJSContextPool->SetGarbageCollectBudgets( (fSolution != NULL) && fSolution->CanGarbageCollect(), fSettings.GetGarbageCollectMemoryBudget(), fSettings.GetGarbageCollectRequestsBudget(), fSettings.GetGarbageCollectPauseBudget());
+				fLazyDataStore = fSettings.GetLazyDataStore();
 
 				// Get the required script: required script will be included into each JavaScript context
 				VProjectItem *item = fDesignProject->GetProjectItem();
@@ -2871,6 +3115,10 @@ VError VRIAServerProject::_Open( VProject* inDesignProject, VRIAServerProjectOpe
 				VError lError = VE_OK;
 				CUAGDirectory *uagDirectory = RetainUAGDirectory( NULL);
 
+				// the security manager is a unique component, the projects may be opened concurrently
+				if (fSolution != NULL)
+					fSolution->GetSharedResourcesMutex().Lock();
+
 				fSecurityManager->SetUserDirectory( uagDirectory);
 
 				VFilePath path( L"c:\\keytab");
@@ -2883,6 +3131,9 @@ VError VRIAServerProject::_Open( VProject* inDesignProject, VRIAServerProjectOpe
 				//err=fSecurityManager->SetKerberosConfig("I7-64B-RD-11.private.4d.fr", "C:\\keytab");
 				//err=fSecurityManager->SetKerberosConfig("I7-64B-RD-11", "C:\\keytab");
 
+				if (fSolution != NULL)
+					fSolution->GetSharedResourcesMutex().Unlock();
+
 				ReleaseRefCountable( &uagDirectory);
 			}
 		}
@@ -3026,6 +3277,17 @@ VError VRIAServerProject::_Open( VProject* inDesignProject, VRIAServerProjectOpe
 							httpServerSettings->SetLogFileName( strValue);
 							httpServerSettings->SetLogMaxSize( fSettings.GetLogMaxSize());
 
+							if (fSettings.GetLogRequestTimings() && fRequestLogger == NULL)
+							{
+								VFolder logFolder( logFolderPath);
+								if (!logFolder.Exists())
+									logFolder.CreateRecursive( false);
+
+								fRequestLogger = new VRIARequestLogger( logFolder, fName + L"_requests");
+								if (fRequestLogger != NULL && fRequestLogger->Start() != VE_OK)
+									ReleaseRefCountable( &fRequestLogger);
+							}
+
 
 							//----------------------------------------------------------------------
 							// VRoutingPreProcessingHandler
@@ -3616,6 +3878,9 @@ VRIAPermissions* VRIAServerProject::_LoadPermissionFile( VError& outError)
 					permissions->CheckGroupsValidity( uagDirectory);
 					ReleaseRefCountable( &uagDirectory);
 				}
+
+				// The permissions file is not checked for changes on each access
+				permissions->StartWatchingFileChanges();
 			}
 		}
 	}
@@ -4833,13 +5098,113 @@ VRPCCatalog* VRIAServerProject::_RetainRPCCatalog( VError& outError, const IHTTP
 
 	outError = VE_OK;
 
+	if (fRPCCatalogMutex.Lock())
+	{
+		catalog = RetainRefCountable( fRPCCatalog);
+		fRPCCatalogMutex.Unlock();
+	}
+
+	if (catalog == NULL)
+	{
+		// The first catalog is built synchronously, then the catalog is updated in background
+		catalog = _UpdateRPCCatalog( outError, inRequest, inResponse);
+
+		if (fRPCCatalogBuildMutex.Lock())
+		{
+			if ((fRPCCatalogUpdaterTask == NULL) && fState.opened)
+			{
+				fRPCCatalogUpdaterTask = new VTask( this, 0, eTaskStylePreemptive, &VRIAServerProject::_RPCCatalogUpdaterTaskProc);
+				if (fRPCCatalogUpdaterTask != NULL)
+				{
+					fRPCCatalogUpdaterTask->SetName( CVSTR( "RPC Catalog Updater"));
+					fRPCCatalogUpdaterTask->SetKindData( (sLONG_PTR) this);
+					fRPCCatalogUpdaterTask->Run();
+				}
+			}
+			fRPCCatalogBuildMutex.Unlock();
+		}
+	}
+
+	return catalog;
+}
+
+
+VRPCCatalog* VRIAServerProject::_UpdateRPCCatalog( VError& outError, const IHTTPRequest* inRequest, IHTTPResponse* inResponse)
+{
+	VRPCCatalog *catalog = NULL;
+
+	outError = VE_OK;
+
+	if (fRPCCatalogBuildMutex.Lock())
+	{
+		if (fRPCCatalogMutex.Lock())
+		{
+			catalog = RetainRefCountable( fRPCCatalog);
+			fRPCCatalogMutex.Unlock();
+		}
+
+		// The catalog may have been updated while waiting for the build mutex
+		if ((catalog == NULL) || !_IsRPCCatalogUpToDate( catalog))
+		{
+			VRPCCatalog *newCatalog = _BuildRPCCatalog( outError, inRequest, inResponse);
+			if (newCatalog != NULL)
+			{
+				newCatalog->SetReadOnly();
+
+				if (fRPCCatalogMutex.Lock())
+				{
+					CopyRefCountable( &fRPCCatalog, newCatalog);
+					++fRPCCatalogStamp;
+					fRPCCatalogMutex.Unlock();
+				}
+
+				ReleaseRefCountable( &catalog);
+				catalog = newCatalog;
+			}
+		}
+
+		fRPCCatalogBuildMutex.Unlock();
+	}
+
+	return catalog;
+}
+
+
+VRPCCatalog* VRIAServerProject::_BuildRPCCatalog( VError& outError, const IHTTPRequest* inRequest, IHTTPResponse* inResponse)
+{
+	VRPCCatalog *catalog = NULL;
+
+	outError = VE_OK;
+
 	if (testAssert(fDesignProject != NULL))
 	{
 		catalog = new VRPCCatalog();
-		if (catalog != NULL)
+		if (fRPCModulesCatalog == NULL)
+			fRPCModulesCatalog = new VRPCCatalog();
+
+		if ((catalog != NULL) && (fRPCModulesCatalog != NULL))
 		{
+			// The catalog files override the schemas of the published methods
+			std::map< VString, VTime > catalogFilesTimes;
+			_GetRPCCatalogFilesTimes( catalogFilesTimes);
+
+			VectorOfVFile catalogFiles;
+			for (std::map< VString, VTime >::iterator iter = catalogFilesTimes.begin() ; iter != catalogFilesTimes.end() ; ++iter)
+			{
+				VFile *file = new VFile( iter->first);
+				if (file != NULL)
+				{
+					catalogFiles.push_back( file);
+					file->Release();
+				}
+			}
+			catalog->SetCatalogFilesList( catalogFiles);
+			fRPCCatalogFilesTimes.swap( catalogFilesTimes);
+
 			if (fPermissions != NULL)
 			{
+				catalog->SetPermissionsStamp( fPermissions->GetStamp());
+
 				// chech whether we have some modules permissions
 				std::vector< VRefPtr<VValueBag> > resourcePerm;
 				VString type( L"module"), action( L"executeFromClient");
@@ -4847,21 +5212,68 @@ VRPCCatalog* VRIAServerProject::_RetainRPCCatalog( VError& outError, const IHTTP
 				fPermissions->RetainResourcesPermission( resourcePerm, &type, NULL, &action);
 				if (!resourcePerm.empty())
 				{
-					VJSGlobalContext *globalContext = RetainJSContext( outError, false, inRequest);
-					if (globalContext != NULL)
+					VRPCCatalog *modulesCatalog = new VRPCCatalog();
+					VRPCCatalog *failedModules = new VRPCCatalog();
+					VJSGlobalContext *globalContext = NULL;
+
+					for (std::vector< VRefPtr<VValueBag> >::iterator permIter = resourcePerm.begin() ; (permIter != resourcePerm.end()) && (modulesCatalog != NULL) && (failedModules != NULL) ; ++permIter)
 					{
-						if (outError == VE_OK)
+						VString modulePath;
+						if (!(*permIter)->GetString( RIAPermissionsKeys::resource, modulePath))
+							continue;
+
+						// Reuse the module if its file has not been modified since it has been loaded
+						VRPCModule *module = fRPCModulesCatalog->RetainModule( modulePath);
+						if ((module != NULL) && module->IsModified())
+							ReleaseRefCountable( &module);
+
+						if (module == NULL)
 						{
-							VJSContext jsContext( globalContext);
-							for (std::vector< VRefPtr<VValueBag> >::iterator permIter = resourcePerm.begin() ; permIter != resourcePerm.end() ; ++permIter)
+							// A module which could not be loaded is not loaded again, and its errors are not logged again, until it has been modified
+							VRPCModule *failedModule = (fRPCFailedModules != NULL) ? fRPCFailedModules->RetainModule( modulePath) : NULL;
+							if ((failedModule != NULL) && !failedModule->IsModified())
+							{
+								failedModules->AppendModule( *failedModule);
+							}
+							else
 							{
-								VString modulePath;
-								if ((*permIter)->GetString( RIAPermissionsKeys::resource, modulePath))
-									catalog->LoadModule( modulePath, jsContext);
+								// The JavaScript context is created only if a module must be loaded
+								if ((globalContext == NULL) && (outError == VE_OK))
+									globalContext = RetainJSContext( outError, false, inRequest);
+
+								if ((globalContext != NULL) && (outError == VE_OK))
+								{
+									VJSContext jsContext( globalContext);
+									module = new VRPCModule( modulePath);
+									if ((module != NULL) && (module->Load( jsContext) != VE_OK))
+									{
+										failedModules->AppendModule( *module);
+										ReleaseRefCountable( &module);
+									}
+								}
 							}
+							ReleaseRefCountable( &failedModule);
+						}
+
+						if (module != NULL)
+						{
+							catalog->AppendModule( *module);
+							modulesCatalog->AppendModule( *module);
+							module->Release();
 						}
+					}
+
+					if (globalContext != NULL)
 						ReleaseJSContext( globalContext, inResponse);
+
+					// Only the modules which are still published are kept
+					if ((modulesCatalog != NULL) && (failedModules != NULL))
+					{
+						CopyRefCountable( &fRPCModulesCatalog, modulesCatalog);
+						CopyRefCountable( &fRPCFailedModules, failedModules);
 					}
+					ReleaseRefCountable( &modulesCatalog);
+					ReleaseRefCountable( &failedModules);
 				}
 
 				resourcePerm.clear();
@@ -4880,6 +5292,7 @@ VRPCCatalog* VRIAServerProject::_RetainRPCCatalog( VError& outError, const IHTTP
 		}
 		else
 		{
+			ReleaseRefCountable( &catalog);
 			outError = vThrowError( VE_MEMORY_FULL);
 		}
 	}
@@ -4888,13 +5301,106 @@ VRPCCatalog* VRIAServerProject::_RetainRPCCatalog( VError& outError, const IHTTP
 }
 
 
-VRIAContext* VRIAServerProject::_ValidateAndRetainContext( VRIAContext* inContext, bool inCreateContextIfNull)
+bool VRIAServerProject::_IsRPCCatalogUpToDate( const VRPCCatalog* inCatalog)
 {
-	VRIAContext *context = NULL;
+	if ((fPermissions != NULL) && (fPermissions->GetStamp() != inCatalog->GetPermissionsStamp()))
+		return false;
 
-	if (fContextMgr != NULL)
+	// A module is modified when its file or one of the files it requires has been modified.
+	// A module which could not be loaded is modified when a file which could be its file has been created.
+	std::vector<VString> modifiedModules;
+	if (fRPCModulesCatalog != NULL)
 	{
-		if (inContext != NULL)
+		fRPCModulesCatalog->GetModifiedModules( modifiedModules);
+		if (!modifiedModules.empty())
+			return false;
+	}
+
+	if (fRPCFailedModules != NULL)
+	{
+		fRPCFailedModules->GetModifiedModules( modifiedModules);
+		if (!modifiedModules.empty())
+			return false;
+	}
+
+	std::map< VString, VTime > catalogFilesTimes;
+	_GetRPCCatalogFilesTimes( catalogFilesTimes);
+	if (catalogFilesTimes != fRPCCatalogFilesTimes)
+		return false;
+
+	return true;
+}
+
+
+void VRIAServerProject::_GetRPCCatalogFilesTimes( std::map< VString, VTime >& outTimes) const
+{
+	outTimes.clear();
+
+	if (fDesignProject != NULL)
+	{
+		VectorOfProjectItems items;
+		fDesignProject->GetProjectItemsFromTag( kRPCCatalogTag, items);
+
+		for (VectorOfProjectItemsIterator iter = items.begin() ; iter != items.end() ; ++iter)
+		{
+			VFilePath path;
+			if ((*iter != NULL) && (*iter)->GetFilePath( path))
+			{
+				VFile file( path);
+				VTime modificationTime;
+				if (file.Exists() && (file.GetTimeAttributes( &modificationTime) == VE_OK))
+					outTimes[path.GetPath()] = modificationTime;
+			}
+		}
+	}
+}
+
+
+void VRIAServerProject::_StopRPCCatalogUpdater()
+{
+	if (fRPCCatalogUpdaterTask != NULL)
+	{
+		if (fRPCCatalogUpdaterTask->GetState() >= TS_RUNNING)
+		{
+			fRPCCatalogUpdaterTask->Kill();
+
+			// Wait for the task end: the task may be loading some modules in a JavaScript context
+			while (fRPCCatalogUpdaterTask->GetState() < TS_DEAD)
+				VTask::Sleep( 20);
+		}
+		fRPCCatalogUpdaterTask->Release();
+		fRPCCatalogUpdaterTask = NULL;
+	}
+}
+
+
+sLONG VRIAServerProject::_RPCCatalogUpdaterTaskProc( VTask* inTask)
+{
+	VRIAServerProject *project = (VRIAServerProject*) inTask->GetKindData();
+
+	while (!inTask->IsDying())
+	{
+		inTask->ExecuteMessagesWithTimeout( kRPC_CATALOG_CHECK_DELAY);
+
+		if (!inTask->IsDying() && project->fState.started)
+		{
+			StErrorContextInstaller errorContext( false, true);
+			VError err = VE_OK;
+			VRPCCatalog *catalog = project->_UpdateRPCCatalog( err, NULL, NULL);
+			ReleaseRefCountable( &catalog);
+		}
+	}
+	return 0;
+}
+
+
+VRIAContext* VRIAServerProject::_ValidateAndRetainContext( VRIAContext* inContext, bool inCreateContextIfNull)
+{
+	VRIAContext *context = NULL;
+
+	if (fContextMgr != NULL)
+	{
+		if (inContext != NULL)
 		{
 			if (fContextMgr->IsContextRegistered( inContext))
 				context = RetainRefCountable( inContext);
@@ -4923,6 +5429,81 @@ bool VRIAServerProject::_IsContextCreationEnabled() const
 }
 
 
+void VRIAServerProject::_CloseReloadGate()
+{
+	if (fReloadGateMutex.Lock())
+	{
+		if (fReloadGate == NULL)
+		{
+			fReloadGate = new VSyncEvent();
+			fReloadTask = VTask::GetCurrent();
+		}
+		fReloadGateMutex.Unlock();
+	}
+}
+
+
+void VRIAServerProject::_OpenReloadGate()
+{
+	VSyncEvent *gate = NULL;
+
+	if (fReloadGateMutex.Lock())
+	{
+		gate = fReloadGate;
+		fReloadGate = NULL;
+		fReloadTask = NULL;
+		fReloadGateMutex.Unlock();
+	}
+
+	if (gate != NULL)
+	{
+		gate->Unlock();
+		gate->Release();
+	}
+}
+
+
+bool VRIAServerProject::_WaitForReloadGate()
+{
+	bool passed = true;
+	VSyncEvent *gate = NULL;
+
+	if (fReloadGateMutex.Lock())
+	{
+		if (fReloadTask != VTask::GetCurrent())
+			gate = RetainRefCountable( fReloadGate);
+		fReloadGateMutex.Unlock();
+	}
+
+	if (gate != NULL)
+	{
+		// A task which already holds a context would keep the reload waiting for it: it fails at once
+		if (fContextMgr != NULL && fContextMgr->HasContextHeldByTask( VTask::GetCurrentID()))
+			passed = false;
+		else
+			passed = gate->Lock( kRELOAD_GATE_TIMEOUT);
+
+		gate->Release();
+	}
+	return passed;
+}
+
+
+bool VRIAServerProject::_WaitForContextsRelease( sLONG inTimeoutMs)
+{
+	if (fContextMgr == NULL)
+		return true;
+
+	VSyncEvent *syncEvent = fContextMgr->WaitForRegisteredContextsCountZero();
+	if (syncEvent != NULL)
+	{
+		syncEvent->Lock( inTimeoutMs);
+		syncEvent->Release();
+	}
+	return (fContextMgr->GetRegisteredContextsCount() == 0);
+}
+
+
 VError VRIAServerProject::_EvaluateScript( const VFilePath& inFilePath)
 {
 	VError err = VE_OK;
@@ -5317,50 +5898,11 @@ void VSetDebuggerServerMessage::DoExecute()
 //--------------------------------------------------------------------------------------------------
 
 
-struct _CountElementInVStringFunctor
+// Case folding used by the compiled routing rules: the user agents are ASCII strings
+inline UniChar _FoldRoutingChar (UniChar inChar)
 {
-	_CountElementInVStringFunctor (const XBOX::VString& inString)
-		: fString (inString)
-	{
-	}
-
-	bool operator() (const XBOX::VString& inString) const
-	{
-		return (fString.Find (inString) > 0);
-	}
-
-private:
-	const XBOX::VString&	fString;
-};
-
-
-struct _MatchVRoutingRuleFunctor
-{
-	_MatchVRoutingRuleFunctor (const XBOX::VString& inString)
-		: fString (inString)
-	{
-	}
-
-	bool operator() (const std::pair<XBOX::VString, XBOX::VString>& inPairString) const
-	{
-		XBOX::VectorOfVString includesStrings;
-		inPairString.first.GetSubStrings (CHAR_COMMA, includesStrings, false, true);
-		
-		if (std::count_if (includesStrings.begin(), includesStrings.end(), _CountElementInVStringFunctor (fString)) == includesStrings.size())
-		{
-			XBOX::VectorOfVString excludesStrings;
-			inPairString.second.GetSubStrings (CHAR_COMMA, excludesStrings, false, true);
-			
-			if (std::count_if (excludesStrings.begin(), excludesStrings.end(), _CountElementInVStringFunctor (fString)) == 0)
-				return true;
-		}
-
-		return false;
-	}
-
-private:
-	const XBOX::VString&	fString;
-};
+	return ((inChar >= CHAR_LATIN_CAPITAL_LETTER_A) && (inChar <= CHAR_LATIN_CAPITAL_LETTER_Z)) ? (UniChar) (inChar + (CHAR_LATIN_SMALL_LETTER_A - CHAR_LATIN_CAPITAL_LETTER_A)) : inChar;
+}
 
 
 //--------------------------------------------------------------------------------------------------
@@ -5369,14 +5911,14 @@ private:
 VRoutingRule::VRoutingRule()
 : fName()
 , fSuffix()
-, fRules()
+, fConditions()
 {
 }
 
 
 VRoutingRule::~VRoutingRule()
 {
-	fRules.clear();
+	fConditions.clear();
 }
 
 
@@ -5407,7 +5949,10 @@ XBOX::VError VRoutingRule::LoadFromJSONValue (const XBOX::VJSONValue& inJSONValu
 					jsValue = elemObject->GetProperty ("exclude");
 					jsValue.GetString (excludeString);
 
-					fRules.push_back (std::make_pair (includeString, excludeString));
+					VRoutingRuleCondition condition;
+					includeString.GetSubStrings (CHAR_COMMA, condition.fIncludes, false, true);
+					excludeString.GetSubStrings (CHAR_COMMA, condition.fExcludes, false, true);
+					fConditions.push_back (condition);
 				}
 			}
 		}
@@ -5417,38 +5962,9 @@ XBOX::VError VRoutingRule::LoadFromJSONValue (const XBOX::VJSONValue& inJSONValu
 }
 
 
-bool VRoutingRule::MatchString (const XBOX::VString& inString)
-{
-	if (!fRules.empty())
-	{
-		VectorOfVRoutingRulePair::iterator it = std::find_if (fRules.begin(), fRules.end(), _MatchVRoutingRuleFunctor (inString));
-		return (it != fRules.end());
-	}
-
-	return false;
-}
-
-
 //--------------------------------------------------------------------------------------------------
 
 
-struct _FindMatchingRuleFunctor
-{
-	_FindMatchingRuleFunctor (const XBOX::VString& inString)
-		: fString (inString)
-	{
-	}
-
-	bool operator() (const VRoutingRuleRefPtr& inRoutingRule) const
-	{
-		return (inRoutingRule)->MatchString (fString);
-	}
-
-private:
-	const XBOX::VString&	fString;
-};
-
-
 struct _FindRuleSuffixFunctor
 {
 	_FindRuleSuffixFunctor (const XBOX::VString& inString)
@@ -5471,6 +5987,7 @@ private:
 
 VRoutingRulesList::VRoutingRulesList()
 : fRoutingRulesList()
+, fTokenCount(0)
 , fLock()
 {
 }
@@ -5505,30 +6022,160 @@ XBOX::VError VRoutingRulesList::LoadFromJSONValue (const XBOX::VJSONValue& inJSO
 		}
 	}
 
+	_Compile();
+
 	return XBOX::VE_OK;
 }
 
 
-bool VRoutingRulesList::FindMatchingRule (const XBOX::VString& inString, XBOX::VString& outMatchingRuleSuffix)
+void VRoutingRulesList::_Compile()
+{
+	XBOX::unordered_map_VString<sLONG> tokens;
+
+	fStates.clear();
+	fConditions.clear();
+	fTokenCount = 0;
+
+	fStates.resize (1);
+	fStates[0].fFailure = 0;
+
+	// Build the trie of all the include and exclude strings, and the conditions in the rules order
+	for (sLONG ruleIndex = 0; ruleIndex < fRoutingRulesList.size(); ++ruleIndex)
+	{
+		const VRoutingRule::VectorOfVRoutingRuleCondition& conditions = fRoutingRulesList[ruleIndex]->GetConditions();
+		for (VRoutingRule::VectorOfVRoutingRuleCondition::const_iterator it = conditions.begin(); it != conditions.end(); ++it)
+		{
+			VCompiledRoutingCondition condition;
+			condition.fRule = ruleIndex;
+
+			for (XBOX::VectorOfVString::const_iterator tokenIt = it->fIncludes.begin(); tokenIt != it->fIncludes.end(); ++tokenIt)
+				condition.fIncludes.push_back (_AddToken (*tokenIt, tokens));
+
+			for (XBOX::VectorOfVString::const_iterator tokenIt = it->fExcludes.begin(); tokenIt != it->fExcludes.end(); ++tokenIt)
+				condition.fExcludes.push_back (_AddToken (*tokenIt, tokens));
+
+			fConditions.push_back (condition);
+		}
+	}
+
+	// Compute the failure links breadth first
+	std::vector<sLONG> queue;
+	for (std::map<UniChar, sLONG>::const_iterator it = fStates[0].fTransitions.begin(); it != fStates[0].fTransitions.end(); ++it)
+	{
+		fStates[it->second].fFailure = 0;
+		queue.push_back (it->second);
+	}
+
+	for (size_t pos = 0; pos < queue.size(); ++pos)
+	{
+		sLONG state = queue[pos];
+		for (std::map<UniChar, sLONG>::const_iterator it = fStates[state].fTransitions.begin(); it != fStates[state].fTransitions.end(); ++it)
+		{
+			sLONG failure = fStates[state].fFailure;
+			std::map<UniChar, sLONG>::const_iterator found = fStates[failure].fTransitions.find (it->first);
+			while ((failure != 0) && (found == fStates[failure].fTransitions.end()))
+			{
+				failure = fStates[failure].fFailure;
+				found = fStates[failure].fTransitions.find (it->first);
+			}
+
+			VRoutingTokenState& next = fStates[it->second];
+			next.fFailure = (found != fStates[failure].fTransitions.end()) ? found->second : 0;
+			next.fTokens.insert (next.fTokens.end(), fStates[next.fFailure].fTokens.begin(), fStates[next.fFailure].fTokens.end());
+
+			queue.push_back (it->second);
+		}
+	}
+}
+
+
+sLONG VRoutingRulesList::_AddToken (const XBOX::VString& inToken, XBOX::unordered_map_VString<sLONG>& ioTokens)
+{
+	XBOX::VString token;
+	for (VIndex pos = 0; pos < inToken.GetLength(); ++pos)
+		token.AppendUniChar (_FoldRoutingChar (inToken[pos]));
+
+	XBOX::unordered_map_VString<sLONG>::iterator found = ioTokens.find (token);
+	if (found != ioTokens.end())
+		return found->second;
+
+	sLONG tokenIndex = fTokenCount++;
+	ioTokens[token] = tokenIndex;
+
+	sLONG state = 0;
+	for (VIndex pos = 0; pos < token.GetLength(); ++pos)
+	{
+		std::map<UniChar, sLONG>::iterator next = fStates[state].fTransitions.find (token[pos]);
+		if (next == fStates[state].fTransitions.end())
+		{
+			sLONG newState = (sLONG) fStates.size();
+			fStates.resize (fStates.size() + 1);
+			fStates[newState].fFailure = 0;
+			fStates[state].fTransitions[token[pos]] = newState;
+			state = newState;
+		}
+		else
+		{
+			state = next->second;
+		}
+	}
+	fStates[state].fTokens.push_back (tokenIndex);
+
+	return tokenIndex;
+}
+
+
+bool VRoutingRulesList::FindMatchingRule (const XBOX::VString& inString, XBOX::VString& outMatchingRuleSuffix) const
 {
 	outMatchingRuleSuffix.Clear();
 
-	XBOX::VTaskLock		lock (&fLock);
-	bool				isOK = false;
-	VRoutingRulesVector::const_iterator it = std::find_if (fRoutingRulesList.begin(), fRoutingRulesList.end(), _FindMatchingRuleFunctor (inString));
-	if (it != fRoutingRulesList.end())
+	if (fConditions.empty())
+		return false;
+
+	// Search all the strings in a single pass
+	std::vector<bool> foundTokens (fTokenCount, false);
+	sLONG state = 0;
+	const UniChar *p = inString.GetCPointer();
+	for (const UniChar *end = p + inString.GetLength(); p != end; ++p)
 	{
-		outMatchingRuleSuffix.FromString ((*it)->GetSuffix());
-		isOK = !outMatchingRuleSuffix.IsEmpty();
+		UniChar c = _FoldRoutingChar (*p);
+		std::map<UniChar, sLONG>::const_iterator next = fStates[state].fTransitions.find (c);
+		while ((state != 0) && (next == fStates[state].fTransitions.end()))
+		{
+			state = fStates[state].fFailure;
+			next = fStates[state].fTransitions.find (c);
+		}
+		state = (next != fStates[state].fTransitions.end()) ? next->second : 0;
+
+		for (std::vector<sLONG>::const_iterator it = fStates[state].fTokens.begin(); it != fStates[state].fTokens.end(); ++it)
+			foundTokens[*it] = true;
+	}
+
+	// The first rule having a matching condition wins
+	bool isOK = false;
+	for (std::vector<VCompiledRoutingCondition>::const_iterator it = fConditions.begin(); it != fConditions.end(); ++it)
+	{
+		bool match = true;
+		for (std::vector<sLONG>::const_iterator tokenIt = it->fIncludes.begin(); match && tokenIt != it->fIncludes.end(); ++tokenIt)
+			match = foundTokens[*tokenIt];
+
+		for (std::vector<sLONG>::const_iterator tokenIt = it->fExcludes.begin(); match && tokenIt != it->fExcludes.end(); ++tokenIt)
+			match = !foundTokens[*tokenIt];
+
+		if (match)
+		{
+			outMatchingRuleSuffix.FromString (fRoutingRulesList[it->fRule]->GetSuffix());
+			isOK = !outMatchingRuleSuffix.IsEmpty();
+			break;
+		}
 	}
 
 	return isOK;
 }
 
 
-bool VRoutingRulesList::AcceptRuleSuffix (const XBOX::VString& inString)
+bool VRoutingRulesList::AcceptRuleSuffix (const XBOX::VString& inString) const
 {
-	XBOX::VTaskLock		lock (&fLock);
 	VRoutingRulesVector::const_iterator it = std::find_if (fRoutingRulesList.begin(), fRoutingRulesList.end(), _FindRuleSuffixFunctor (inString));
 	if (it != fRoutingRulesList.end())
 		return true;
@@ -5548,44 +6195,315 @@ const XBOX::VString		CONST_DEFAULT_WAPAGE_NAME (CVSTR ("index.waPage"));
 const XBOX::VString		CONST_WAPAGE_SUFFIX (CVSTR (".waPage"));
 
 
+const sLONG				kURL_RESOLUTION_WATCHING_LATENCY = 100; // in milliseconds
+
+
+VURLResolutionCache::VURLResolutionCache()
+: fWatching(true)
+{
+}
+
+
+VURLResolutionCache::~VURLResolutionCache()
+{
+	xbox_assert(fFolders.empty());
+}
+
+
+bool VURLResolutionCache::GetFolderGeneration (const XBOX::VFilePath& inBaseFolderPath, uLONG& outGeneration)
+{
+	bool watched = false;
+	bool unknown = false;
+
+	outGeneration = 0;
+
+	if (fFoldersMutex.Lock())
+	{
+		MapOfFolderGeneration::const_iterator found = fFolders.find (inBaseFolderPath.GetPath());
+		if (found != fFolders.end())
+		{
+			outGeneration = found->second;
+			watched = true;
+		}
+		else
+		{
+			unknown = fWatching && (std::find (fUnwatchedFolders.begin(), fUnwatchedFolders.end(), inBaseFolderPath.GetPath()) == fUnwatchedFolders.end());
+		}
+		fFoldersMutex.Unlock();
+	}
+
+	if (unknown)
+	{
+		// Start watching the web folder: the notifier is not called while fFoldersMutex is locked because the handler locks it
+		XBOX::VTaskLock lock (&fWatchingMutex);
+
+		if (fFoldersMutex.Lock())
+		{
+			unknown = fWatching && (fFolders.find (inBaseFolderPath.GetPath()) == fFolders.end());
+			fFoldersMutex.Unlock();
+		}
+
+		if (unknown)
+		{
+			XBOX::VError error = XBOX::VE_OK;
+			{
+				XBOX::StErrorContextInstaller errorContext (false, true);
+				XBOX::VFolder folder (inBaseFolderPath);
+				if (folder.Exists())
+					error = XBOX::VFileSystemNotifier::Instance()->StartWatchingForChanges (folder, XBOX::VFileSystemNotifier::kAll, this, kURL_RESOLUTION_WATCHING_LATENCY);
+				else
+					error = XBOX::VE_FOLDER_NOT_FOUND;
+			}
+
+			if (fFoldersMutex.Lock())
+			{
+				if (XBOX::VE_OK == error)
+				{
+					fFolders[inBaseFolderPath.GetPath()] = 0;
+					watched = true;
+				}
+				else
+				{
+					fUnwatchedFolders.push_back (inBaseFolderPath.GetPath());
+				}
+				fFoldersMutex.Unlock();
+			}
+		}
+	}
+
+	return watched;
+}
+
+
+bool VURLResolutionCache::GetResolution (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, uLONG inGeneration, XBOX::VString& ioURL, XBOX::VError& outError)
+{
+	bool found = false;
+	XBOX::VString key;
+
+	_BuildKey (inBaseFolderPath, inVirtualFolderName, ioURL, key);
+
+	VURLResolutionShard& shard = _GetShard (key);
+	if (shard.fMutex.Lock())
+	{
+		MapOfURLResolution::iterator foundIter = shard.fIndex.find (key);
+		if (foundIter != shard.fIndex.end())
+		{
+			ListOfURLResolution::iterator resolution = foundIter->second;
+			if (resolution->fGeneration == inGeneration)
+			{
+				ioURL.FromString (resolution->fResolvedURL);
+				outError = resolution->fError;
+				shard.fResolutions.splice (shard.fResolutions.begin(), shard.fResolutions, resolution);
+				found = true;
+			}
+			else
+			{
+				// The web folder has changed since the resolution
+				shard.fResolutions.erase (resolution);
+				shard.fIndex.erase (foundIter);
+			}
+		}
+		shard.fMutex.Unlock();
+	}
+
+	return found;
+}
+
+
+void VURLResolutionCache::SetResolution (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, uLONG inGeneration, const XBOX::VString& inURL, const XBOX::VString& inResolvedURL, XBOX::VError inError)
+{
+	// Only the resolutions, the redirections and the negative resolutions are cached
+	if ((XBOX::VE_OK != inError) && (VE_HTTP_PROTOCOL_FOUND != inError) && (VE_HTTP_PROTOCOL_NOT_FOUND != inError))
+		return;
+
+	XBOX::VString key;
+
+	_BuildKey (inBaseFolderPath, inVirtualFolderName, inURL, key);
+
+	VURLResolutionShard& shard = _GetShard (key);
+	if (shard.fMutex.Lock())
+	{
+		MapOfURLResolution::iterator foundIter = shard.fIndex.find (key);
+		if (foundIter != shard.fIndex.end())
+		{
+			shard.fResolutions.erase (foundIter->second);
+			shard.fIndex.erase (foundIter);
+		}
+
+		VURLResolution resolution;
+		resolution.fKey = key;
+		resolution.fResolvedURL = inResolvedURL;
+		resolution.fError = inError;
+		resolution.fGeneration = inGeneration;
+
+		shard.fResolutions.push_front (resolution);
+		shard.fIndex[key] = shard.fResolutions.begin();
+
+		// Evict the least recently used resolutions
+		while (shard.fResolutions.size() > kSHARD_CAPACITY)
+		{
+			shard.fIndex.erase (shard.fResolutions.back().fKey);
+			shard.fResolutions.pop_back();
+		}
+		shard.fMutex.Unlock();
+	}
+}
+
+
+void VURLResolutionCache::StopWatching()
+{
+	XBOX::VTaskLock lock (&fWatchingMutex);
+	XBOX::VectorOfVString folders;
+
+	if (fFoldersMutex.Lock())
+	{
+		for (MapOfFolderGeneration::const_iterator iter = fFolders.begin(); iter != fFolders.end(); ++iter)
+			folders.push_back (iter->first);
+
+		fFolders.clear();
+		fWatching = false;
+		fFoldersMutex.Unlock();
+	}
+
+	for (XBOX::VectorOfVString::const_iterator iter = folders.begin(); iter != folders.end(); ++iter)
+	{
+		XBOX::VFolder folder (*iter);
+		XBOX::VFileSystemNotifier::Instance()->StopWatchingForChanges (folder, this);
+	}
+
+	for (sLONG shardIndex = 0; shardIndex < kSHARD_COUNT; ++shardIndex)
+	{
+		VURLResolutionShard& shard = fShards[shardIndex];
+		if (shard.fMutex.Lock())
+		{
+			shard.fResolutions.clear();
+			shard.fIndex.clear();
+			shard.fMutex.Unlock();
+		}
+	}
+}
+
+
+void VURLResolutionCache::FileSystemEventHandler (const std::vector< XBOX::VFilePath > &inFilePaths, XBOX::VFileSystemNotifier::EventKind inKind)
+{
+	if (fFoldersMutex.Lock())
+	{
+		// The resolutions made before the change become stale
+		for (MapOfFolderGeneration::iterator iter = fFolders.begin(); iter != fFolders.end(); ++iter)
+		{
+			for (std::vector< XBOX::VFilePath >::const_iterator pathIter = inFilePaths.begin(); pathIter != inFilePaths.end(); ++pathIter)
+			{
+				if (pathIter->GetPath().BeginsWith (iter->first))
+				{
+					++iter->second;
+					break;
+				}
+			}
+		}
+		fFoldersMutex.Unlock();
+	}
+}
+
+
+/* static */
+void VURLResolutionCache::_BuildKey (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, const XBOX::VString& inURL, XBOX::VString& outKey)
+{
+	outKey.FromString (inBaseFolderPath.GetPath());
+	outKey.AppendUniChar (CHAR_LINE_FEED);
+	outKey.AppendString (inVirtualFolderName);
+	outKey.AppendUniChar (CHAR_LINE_FEED);
+	outKey.AppendString (inURL);
+}
+
+
+VURLResolutionCache::VURLResolutionShard& VURLResolutionCache::_GetShard (const XBOX::VString& inKey)
+{
+	return fShards[ComputeStringHash (inKey) % kSHARD_COUNT];
+}
+
+
+//--------------------------------------------------------------------------------------------------
+
+
 VRoutingRulesList *VRoutingPreProcessingHandler::fRoutingRulesList = NULL;
+VURLResolutionCache *VRoutingPreProcessingHandler::fURLResolutionCache = NULL;
+sLONG VRoutingPreProcessingHandler::fHandlersCount = 0;
+XBOX::VCriticalSection VRoutingPreProcessingHandler::fInitMutex;
 
 
 VRoutingPreProcessingHandler::VRoutingPreProcessingHandler (const XBOX::VFilePath& inFilePath)
 {
+	XBOX::VTaskLock lock (&fInitMutex);
+
+	++fHandlersCount;
+
 	// Init Routing List once
 	if (NULL == fRoutingRulesList)
-		_InitRulesFromFile (inFilePath);
+	{
+		// The rules are loaded before being published
+		VRoutingRulesList *rulesList = new VRoutingRulesList();
+		if (NULL != rulesList)
+		{
+			_InitRulesFromFile (rulesList, inFilePath);
+			fRoutingRulesList = rulesList;
+		}
+	}
+
+	if (NULL == fURLResolutionCache)
+		fURLResolutionCache = new VURLResolutionCache();
 }
 
 
 VRoutingPreProcessingHandler::~VRoutingPreProcessingHandler()
 {
 #if !WITH_SANDBOXED_PROJECT
-	XBOX::ReleaseRefCountable (&fRoutingRulesList);
+	XBOX::VTaskLock lock (&fInitMutex);
+
+	// The other projects keep using the shared objects
+	if (--fHandlersCount == 0)
+	{
+		XBOX::ReleaseRefCountable (&fRoutingRulesList);
+
+		if (NULL != fURLResolutionCache)
+			fURLResolutionCache->StopWatching();
+		XBOX::ReleaseRefCountable (&fURLResolutionCache);
+	}
 #endif
 }
 
 
 /* static */
-void VRoutingPreProcessingHandler::_InitRulesFromFile (const XBOX::VFilePath& inFilePath)
+VURLResolutionCache * VRoutingPreProcessingHandler::_RetainURLResolutionCache()
 {
-	fRoutingRulesList = new VRoutingRulesList ();
+	XBOX::VTaskLock lock (&fInitMutex);
 
-	if (NULL != fRoutingRulesList)
-	{
-		XBOX::VError	error = XBOX::VE_OK;
-		XBOX::VFile		file (inFilePath);
+	return XBOX::RetainRefCountable (fURLResolutionCache);
+}
 
-		if (file.Exists())
-		{
-			VJSONValue		jsonValue;
 
-			error = VJSONImporter::ParseFile (&file, jsonValue, VJSONImporter::EJSI_Strict);
+/* static */
+VRoutingRulesList * VRoutingPreProcessingHandler::_RetainRoutingRulesList()
+{
+	XBOX::VTaskLock lock (&fInitMutex);
 
-			if (XBOX::VE_OK == error)
-				fRoutingRulesList->LoadFromJSONValue (jsonValue);
-		}
+	return XBOX::RetainRefCountable (fRoutingRulesList);
+}
+
+
+/* static */
+void VRoutingPreProcessingHandler::_InitRulesFromFile (VRoutingRulesList *ioRulesList, const XBOX::VFilePath& inFilePath)
+{
+	XBOX::VError	error = XBOX::VE_OK;
+	XBOX::VFile		file (inFilePath);
+
+	if (file.Exists())
+	{
+		VJSONValue		jsonValue;
+
+		error = VJSONImporter::ParseFile (&file, jsonValue, VJSONImporter::EJSI_Strict);
+
+		if (XBOX::VE_OK == error)
+			ioRulesList->LoadFromJSONValue (jsonValue);
 	}
 }
 
@@ -5788,14 +6706,36 @@ XBOX::VError CheckAndResolveURL (const XBOX::VFilePath& inBaseFolderPath, const
 
 
 static
-XBOX::VError CheckAndResolveURL (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, XBOX::VString& ioURL, IHTTPResponse *ioResponse)
+XBOX::VError CheckAndResolveURLUsingCache (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, XBOX::VString& ioURL, VURLResolutionCache *inCache)
+{
+	uLONG generation = 0;
+
+	if ((NULL == inCache) || !inCache->GetFolderGeneration (inBaseFolderPath, generation))
+		return CheckAndResolveURL (inBaseFolderPath, inVirtualFolderName, ioURL);
+
+	XBOX::VError error = XBOX::VE_OK;
+
+	if (!inCache->GetResolution (inBaseFolderPath, inVirtualFolderName, generation, ioURL, error))
+	{
+		XBOX::VString URL (ioURL);
+
+		error = CheckAndResolveURL (inBaseFolderPath, inVirtualFolderName, ioURL);
+		inCache->SetResolution (inBaseFolderPath, inVirtualFolderName, generation, URL, ioURL, error);
+	}
+
+	return error;
+}
+
+
+static
+XBOX::VError CheckAndResolveURL (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, XBOX::VString& ioURL, IHTTPResponse *ioResponse, VURLResolutionCache *inCache)
 {
 	if (NULL == ioResponse)
 		return VE_HTTP_INVALID_ARGUMENT;
 
 	XBOX::VString		URL (ioURL);
 	XBOX::VString		URLQuery (ioResponse->GetRequest().GetURLQuery());
-	XBOX::VError		error = CheckAndResolveURL (inBaseFolderPath, inVirtualFolderName, ioURL);
+	XBOX::VError		error = CheckAndResolveURLUsingCache (inBaseFolderPath, inVirtualFolderName, ioURL, inCache);
 
 	if (VE_HTTP_PROTOCOL_FOUND == error)
 	{
@@ -5827,7 +6767,9 @@ XBOX::VError CheckAndResolveURL (const XBOX::VFilePath& inBaseFolderPath, const
 
 XBOX::VError VRoutingPreProcessingHandler::HandleRequest (IHTTPResponse *ioResponse)
 {
-	if (NULL == fRoutingRulesList)
+	XBOX::VRefPtr<VRoutingRulesList>	rulesList (_RetainRoutingRulesList(), false);
+
+	if (NULL == rulesList.Get())
 		return XBOX::VE_OK;
 
 	if (NULL == ioResponse)
@@ -5889,9 +6831,11 @@ XBOX::VError VRoutingPreProcessingHandler::HandleRequest (IHTTPResponse *ioRespo
 /* static */
 XBOX::VError VRoutingPreProcessingHandler::_ResolveURL (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, XBOX::VString& ioURL, IHTTPResponse *ioResponse)
 {
-	XBOX::VError error = CheckAndResolveURL (inBaseFolderPath, inVirtualFolderName, ioURL, ioResponse);
+	XBOX::VRefPtr<VURLResolutionCache>	cache (_RetainURLResolutionCache(), false);
+	XBOX::VError						error = CheckAndResolveURL (inBaseFolderPath, inVirtualFolderName, ioURL, ioResponse, cache.Get());
+	XBOX::VRefPtr<VRoutingRulesList>	rulesList (_RetainRoutingRulesList(), false);
 
-	if (XBOX::VE_OK == error)
+	if ((XBOX::VE_OK == error) && (NULL != rulesList.Get()))
 	{
 		IVirtualHost *			virtualHost = ioResponse->GetVirtualHost();
 
@@ -5905,11 +6849,11 @@ XBOX::VError VRoutingPreProcessingHandler::_ResolveURL (const XBOX::VFilePath& i
 		bool			waPlatformCookieExists = false;
 
 		waPlatformCookieExists = ioResponse->GetRequest().GetCookie (CONST_WAPLATFORM_COOKIE, platformValue);
-		if (!waPlatformCookieExists || platformValue.IsEmpty() || (!platformValue.IsEmpty() && !fRoutingRulesList->AcceptRuleSuffix (platformValue)))
+		if (!waPlatformCookieExists || platformValue.IsEmpty() || (!platformValue.IsEmpty() && !rulesList->AcceptRuleSuffix (platformValue)))
 		{
 			XBOX::VString	userAgent;
 			ioResponse->GetRequestHeader().GetHeaderValue (CONST_USER_AGENT, userAgent);
-			fRoutingRulesList->FindMatchingRule (userAgent, platformValue);
+			rulesList->FindMatchingRule (userAgent, platformValue);
 		}
 
 		if (!platformValue.IsEmpty())
@@ -5957,9 +6901,11 @@ XBOX::VError VRoutingPreProcessingHandler::ResolveURL (IHTTPRequest *inRequest,
 
 	if (virtualHost->GetMatchingVirtualFolderInfos (URL, outWebFolderPath, defaultIndexName, webFolderName))
 	{
-		error = CheckAndResolveURL (outWebFolderPath, webFolderName, URL);
+		XBOX::VRefPtr<VURLResolutionCache>	cache (_RetainURLResolutionCache(), false);
+		XBOX::VRefPtr<VRoutingRulesList>	rulesList (_RetainRoutingRulesList(), false);
+		error = CheckAndResolveURLUsingCache (outWebFolderPath, webFolderName, URL, cache.Get());
 
-		if (XBOX::VE_OK == error)
+		if ((XBOX::VE_OK == error) && (NULL != rulesList.Get()))
 		{
 			/*
 			*	Check waPlatform cookie other else try to guess platform using User-Agent header
@@ -5968,11 +6914,11 @@ XBOX::VError VRoutingPreProcessingHandler::ResolveURL (IHTTPRequest *inRequest,
 			bool			waPlatformCookieExists = false;
 
 			waPlatformCookieExists = inRequest->GetCookie (CONST_WAPLATFORM_COOKIE, platformValue);
-			if (!waPlatformCookieExists || platformValue.IsEmpty() || (!platformValue.IsEmpty() && !fRoutingRulesList->AcceptRuleSuffix (platformValue)))
+			if (!waPlatformCookieExists || platformValue.IsEmpty() || (!platformValue.IsEmpty() && !rulesList->AcceptRuleSuffix (platformValue)))
 			{
 				XBOX::VString	userAgent;
 				inRequest->GetHTTPHeaders().GetHeaderValue (CONST_USER_AGENT, userAgent);
-				fRoutingRulesList->FindMatchingRule (userAgent, platformValue);
+				rulesList->FindMatchingRule (userAgent, platformValue);
 			}
 
 			if (!platformValue.IsEmpty())
@@ -6003,7 +6949,15 @@ XBOX::VError VRoutingPreProcessingHandler::ResolveURL (IHTTPRequest *inRequest,
 
 void VRoutingPreProcessingHandler::DeInit()
 {
+	XBOX::VTaskLock lock (&fInitMutex);
+
+	fHandlersCount = 0;
+
 	ReleaseRefCountable (&fRoutingRulesList);
+
+	if (NULL != fURLResolutionCache)
+		fURLResolutionCache->StopWatching();
+	ReleaseRefCountable (&fURLResolutionCache);
 }
 
 #endif // WITH_SANDBOXED_PROJECT
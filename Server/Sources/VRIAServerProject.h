@@ -36,6 +36,8 @@ class VRIAServerProjectJSRuntimeDelegate;
 class CUAGDirectory;
 class ISymbolTable;
 class VRIAHTTPSessionManager;
+class VJSResponseCache;
+class VRIARequestLogger;
 class VJSRequestHandler;
 class IRIAJSCallback;
 class VRPCService;
@@ -167,6 +169,8 @@ public:
 			/**	@brief	RPC service handling high-level methods */
 			VRPCCatalog*				RetainRPCCatalog( VRIAContext* inContext, XBOX::VError* outError, const IHTTPRequest* inRequest, IHTTPResponse* inResponse);
 			VRPCService*				RetainRPCService( VRIAContext* inContext, XBOX::VError* outError);
+			/**	@brief	Returns a stamp which is incremented each time a new rpc catalog snapshot is published. Does not access the catalog. */
+			uLONG						GetRPCCatalogStamp() const;
 
 			CUAGDirectory*				RetainUAGDirectory( XBOX::VError *outError);
 
@@ -188,14 +192,26 @@ public:
 			/**	@brief	Returns some informations about the JavaScript contexts pool */
 			XBOX::VError				GetJSContextInformations( XBOX::VValueBag& outBag) const;
 
+			/**	@brief	Updates the gauges of the server metrics which belong to the application */
+			void						PublishMetrics() const;
+
 			// Basic retain/release JS context for WebSocket handlers.
 
 			XBOX::VJSGlobalContext		*RetainJSContext (XBOX::VError &outError, bool inReusable)	{	return fJSContextPool->RetainContext(outError, inReusable);	}
 			XBOX::VError				ReleaseJSContext (XBOX::VJSGlobalContext *inGlobalContext)	{	return fJSContextPool->ReleaseContext(inGlobalContext);		}
 
+			/**	@brief	Returns true if the included and required scripts are evaluated through the shared scripts cache */
+			bool						IsScriptsCacheEnabled() const								{	return (fJSContextPool != NULL) && fJSContextPool->IsScriptsCacheEnabled();	}
+
 			/**	@brief	The context should be released when the pool is being cleaned */
 			bool						JSContextShouldBeReleased( XBOX::VJSGlobalContext* inContext) const;
 
+			/**	@brief	Returns the datastore object of the JavaScript context. The datastore object and the entity models
+						are bound on first call if it has not been done when the context has been initialized. */
+			XBOX::VJSValue				GetJSDataStore( XBOX::VJSContext& inContext);
+			/**	@brief	Returns the syntax engine tester of the JavaScript context, created on first call. */
+			XBOX::VJSValue				GetJSSyntaxTester( XBOX::VJSContext& inContext);
+
 			/** @brief	Required scripts are evaluated for each JavaScript context. */
 			void						AppendJSContextRequiredScript( const XBOX::VFilePath& inPath);
 
@@ -224,6 +240,12 @@ public:
 
 			VRIAHTTPSessionManager*		RetainSessionMgr() const;
 
+			/** @brief	Returns the cache of the responses built by the JavaScript request handlers */
+			VJSResponseCache*			RetainJSResponseCache() const;
+
+			/** @brief	Returns the request timings logger or NULL if the timings are not logged. The logger is not retained */
+			VRIARequestLogger*			RetainRequestLogger() const;
+
 			// Logging
 			const XBOX::VString&		GetMessagesLoggerID() const;
 
@@ -334,8 +356,19 @@ private:
 			/** @brief	Disable the context registration, wait for all contexts being unregistered, stop the services which depend on the http server, and finally stop the http server. */
 			XBOX::VError				_StopHTTPServer();
 
-			/**	@brief	Returns the rpc catalog which has been built from the methods files (*.js) and catalog files (*.waRpc) */
+			/**	@brief	Returns the rpc catalog which has been built from the methods files (*.js) and catalog files (*.waRpc).
+						The returned catalog is a read-only snapshot which is built on first call and then updated in background. */
 			VRPCCatalog*				_RetainRPCCatalog( XBOX::VError& outError, const IHTTPRequest* inRequest, IHTTPResponse* inResponse);
+			/**	@brief	Builds and publishes a new rpc catalog snapshot if the permissions or some modules have changed. Returns the current snapshot. */
+			VRPCCatalog*				_UpdateRPCCatalog( XBOX::VError& outError, const IHTTPRequest* inRequest, IHTTPResponse* inResponse);
+			/**	@brief	Only the modules which have changed since they have been loaded are required again. The build mutex must be locked. */
+			VRPCCatalog*				_BuildRPCCatalog( XBOX::VError& outError, const IHTTPRequest* inRequest, IHTTPResponse* inResponse);
+			/**	@brief	The build mutex must be locked. */
+			bool						_IsRPCCatalogUpToDate( const VRPCCatalog* inCatalog);
+			/**	@brief	Returns the modification time of the catalog files (*.waRpc) of the project, the key is the full path of the file. */
+			void						_GetRPCCatalogFilesTimes( std::map< XBOX::VString, XBOX::VTime >& outTimes) const;
+			void						_StopRPCCatalogUpdater();
+	static	sLONG						_RPCCatalogUpdaterTaskProc( XBOX::VTask* inTask);
 
 			/** @brief	Returns NULL if inContext is not valid, else returns a valid retained context.
 						Typically, _ValidateAndRetainContext() should be used to validate a context passed as parameter. */
@@ -345,16 +378,25 @@ private:
 			bool						_SetContextCreationEnabled( bool inEnabled);
 			bool						_IsContextCreationEnabled() const;
 
+			/**	@brief	While the catalog is being reloaded, the creation of an application context waits for the new database.
+						The task which reloads the catalog does not wait. Returns false if the gate has not been opened in time
+						or if the current task holds an application context, in which case the creation must fail. */
+			void						_CloseReloadGate();
+			void						_OpenReloadGate();
+			bool						_WaitForReloadGate();
+
+			/**	@brief	Appends the datastore object and the entity models classes to the global object of the JavaScript context. */
+			void						_BindJSDataStore( XBOX::VJSContext& inContext);
+
+			/**	@brief	Waits for the release of all the application contexts. Returns false on timeout. */
+			bool						_WaitForContextsRelease( sLONG inTimeoutMs);
+
 			XBOX::VError				_EvaluateScript( const XBOX::VFilePath& inFilePath);
 
 			// JavaScript services utilities
 			/** @brief	Post a message to the registered services. */
 			XBOX::VError				_PostServicesMessage( const XBOX::VString& inMessageName);
 
-			sLONG						fRequestNumber;
-			sLONG						fLastGarbageCollectRequest;
-			sLONG8						fLastWorkingSetSize;
-
 			VRIAServerSolution			*fSolution;
 			VProject					*fDesignProject;
 			VFolder						*fDesignProjectFolder;
@@ -389,6 +431,9 @@ private:
 			// Database
 			CDB4DBase					*fDatabase;
 	mutable	XBOX::VCriticalSection		fReloadDatabaseMutex;
+			XBOX::VSyncEvent			*fReloadGate;				// not NULL while the catalog is being reloaded
+			XBOX::VTask					*fReloadTask;
+	mutable	XBOX::VCriticalSection		fReloadGateMutex;
 
 			// Data service
 			VDataService				*fDataService;
@@ -401,6 +446,14 @@ private:
 
 			// RPC service
 			VRPCService					*fRPCService;
+			VRPCCatalog					*fRPCCatalog;				// current read-only snapshot
+			uLONG						fRPCCatalogStamp;
+	mutable	XBOX::VCriticalSection		fRPCCatalogMutex;			// protects the snapshot pointer only
+			VRPCCatalog					*fRPCModulesCatalog;		// modules which have been loaded, reused from a build to the next one
+			VRPCCatalog					*fRPCFailedModules;			// modules which could not be loaded, loaded again once they have been modified
+			std::map< XBOX::VString, XBOX::VTime >	fRPCCatalogFilesTimes;	// catalog files from which the current snapshot has been built
+	mutable	XBOX::VCriticalSection		fRPCCatalogBuildMutex;
+			XBOX::VTask					*fRPCCatalogUpdaterTask;
 
 			// Application context
 			VRIAContextManager			*fContextMgr;
@@ -409,10 +462,15 @@ private:
 			// JavaScript contexts
 			VJSContextPool						*fJSContextPool;
 			VRIAServerProjectJSRuntimeDelegate	*fJSRuntimeDelegate;
+			bool								fLazyDataStore;			// the datastore is bound on first access to "ds"
 
 			// HTTP sessions
 			VRIAHTTPSessionManager		*fSessionMgr;
 
+			// Responses of the JavaScript request handlers
+			VJSResponseCache			*fJSResponseCache;
+			VRIARequestLogger			*fRequestLogger;
+
 			XBOX::VJSSessionStorageObject		*fApplicationStorage;
 			XBOX::VJSSessionStorageObject		*fApplicationSettings;
 
@@ -533,17 +591,21 @@ public:
 	const XBOX::VString&		GetName() const { return fName; }
 	const XBOX::VString&		GetSuffix() const { return fSuffix; }
 
-	bool						MatchString (const XBOX::VString& inString);
+	// The include and exclude strings are split once when the rule is loaded
+	typedef struct
+	{
+		XBOX::VectorOfVString	fIncludes;
+		XBOX::VectorOfVString	fExcludes;
+	} VRoutingRuleCondition;
+	typedef std::vector<VRoutingRuleCondition>	VectorOfVRoutingRuleCondition;
 
-private:
-	//				  Includes		 Excludes
-	typedef std::pair<XBOX::VString, XBOX::VString>	VRoutingRulePair;
-	typedef std::vector<VRoutingRulePair>	VectorOfVRoutingRulePair;
+	const VectorOfVRoutingRuleCondition&	GetConditions() const { return fConditions; }
 
-	XBOX::VString				fName;
-	XBOX::VString				fSuffix;
+private:
+	XBOX::VString					fName;
+	XBOX::VString					fSuffix;
 
-	VectorOfVRoutingRulePair	fRules;
+	VectorOfVRoutingRuleCondition	fConditions;
 };
 typedef XBOX::VRefPtr<VRoutingRule>	VRoutingRuleRefPtr;
 
@@ -554,16 +616,94 @@ public:
 	VRoutingRulesList();
 	virtual						~VRoutingRulesList();
 
+	/** @brief	The rules are compiled once loaded. The list is immutable once published: the readers retain it and match without any lock. */
 	XBOX::VError				LoadFromJSONValue (const XBOX::VJSONValue& inJSONValue);
 
-	bool						FindMatchingRule (const XBOX::VString& inString, XBOX::VString& outMatchingRuleSuffix);
-	bool						AcceptRuleSuffix (const XBOX::VString& inString);
+	bool						FindMatchingRule (const XBOX::VString& inString, XBOX::VString& outMatchingRuleSuffix) const;
+	bool						AcceptRuleSuffix (const XBOX::VString& inString) const;
 
 private:
 	typedef std::vector<VRoutingRuleRefPtr>	VRoutingRulesVector;
 
-	VRoutingRulesVector			fRoutingRulesList;
-	XBOX::VCriticalSection		fLock;
+	// Aho-Corasick automaton state: all the include and exclude strings of all the rules are searched in a single pass
+	typedef struct
+	{
+		std::map<UniChar, sLONG>	fTransitions;
+		sLONG						fFailure;
+		std::vector<sLONG>			fTokens;	// the strings which are found when the state is reached
+	} VRoutingTokenState;
+
+	typedef struct
+	{
+		sLONG						fRule;
+		std::vector<sLONG>			fIncludes;
+		std::vector<sLONG>			fExcludes;
+	} VCompiledRoutingCondition;
+
+	void						_Compile();
+	sLONG						_AddToken (const XBOX::VString& inToken, XBOX::unordered_map_VString<sLONG>& ioTokens);
+
+	VRoutingRulesVector						fRoutingRulesList;
+	std::vector<VRoutingTokenState>			fStates;
+	std::vector<VCompiledRoutingCondition>	fConditions;
+	sLONG									fTokenCount;
+	XBOX::VCriticalSection					fLock;
+};
+
+
+// Cache of the URL resolutions done by VRoutingPreProcessingHandler. The entries of a web folder are invalidated when the web folder changes.
+class VURLResolutionCache : public XBOX::VObject, public XBOX::IRefCountable, public XBOX::VFileSystemNotifier::IEventHandler
+{
+public:
+								VURLResolutionCache();
+	virtual						~VURLResolutionCache();
+
+	/** @brief	Returns false if the web folder cannot be watched: its resolutions must not be cached. outGeneration is the web folder generation to pass to SetResolution() */
+	bool						GetFolderGeneration (const XBOX::VFilePath& inBaseFolderPath, uLONG& outGeneration);
+
+	/** @brief	Returns true if the resolution is cached. ioURL receives the resolved URL */
+	bool						GetResolution (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, uLONG inGeneration, XBOX::VString& ioURL, XBOX::VError& outError);
+	void						SetResolution (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, uLONG inGeneration, const XBOX::VString& inURL, const XBOX::VString& inResolvedURL, XBOX::VError inError);
+
+	/** @brief	Must be called before the cache is released */
+	void						StopWatching();
+
+	virtual void				FileSystemEventHandler (const std::vector< XBOX::VFilePath > &inFilePaths, XBOX::VFileSystemNotifier::EventKind inKind);
+
+private:
+	enum { kSHARD_COUNT = 8 };
+	enum { kSHARD_CAPACITY = 1024 };
+
+	typedef struct
+	{
+		XBOX::VString			fKey;
+		XBOX::VString			fResolvedURL;
+		XBOX::VError			fError;
+		uLONG					fGeneration;
+	} VURLResolution;
+
+	typedef std::list<VURLResolution>											ListOfURLResolution;
+	typedef XBOX::unordered_map_VString<ListOfURLResolution::iterator>			MapOfURLResolution;
+
+	class VURLResolutionShard
+	{
+	public:
+		ListOfURLResolution		fResolutions;	// the most recently used first
+		MapOfURLResolution		fIndex;
+		XBOX::VCriticalSection	fMutex;
+	};
+
+	typedef XBOX::unordered_map_VString<uLONG>									MapOfFolderGeneration;
+
+	static void					_BuildKey (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, const XBOX::VString& inURL, XBOX::VString& outKey);
+	VURLResolutionShard&		_GetShard (const XBOX::VString& inKey);
+
+	VURLResolutionShard			fShards[kSHARD_COUNT];
+	MapOfFolderGeneration		fFolders;			// the watched web folders
+	XBOX::VectorOfVString		fUnwatchedFolders;
+	bool						fWatching;
+	XBOX::VCriticalSection		fFoldersMutex;
+	XBOX::VCriticalSection		fWatchingMutex;		// serializes the calls to the file system notifier
 };
 
 
@@ -584,8 +724,15 @@ public:
 
 private:
 	static	VRoutingRulesList *		fRoutingRulesList;
+	static	VURLResolutionCache *	fURLResolutionCache;
+	static	sLONG					fHandlersCount;		// the shared objects are released with the last handler
+	static	XBOX::VCriticalSection	fInitMutex;			// the handlers of the projects may be created by concurrent startup workers
+
+	/** @brief	The readers retain the shared objects: the handler of another project may be released meanwhile */
+	static VURLResolutionCache *	_RetainURLResolutionCache();
+	static VRoutingRulesList *		_RetainRoutingRulesList();
 
-	static void						_InitRulesFromFile (const XBOX::VFilePath& inFilePath);
+	static void						_InitRulesFromFile (VRoutingRulesList *ioRulesList, const XBOX::VFilePath& inFilePath);
 	static XBOX::VError				_ResolveURL (const XBOX::VFilePath& inBaseFolderPath, const XBOX::VString& inVirtualFolderName, XBOX::VString& ioURL, IHTTPResponse *ioResponse);
 
 };
@@ -140,6 +140,21 @@ VSyncEvent* VRIAContextManager::WaitForRegisteredContextsCountZero()
 }
 
 
+bool VRIAContextManager::HasContextHeldByTask( VTaskID inTaskID) const
+{
+	bool result = false;
+
+	if (fSetOfContextMutex.Lock())
+	{
+		for (SetOfContext_citer iter = fSetOfContext.begin() ; iter != fSetOfContext.end() && !result ; ++iter)
+			result = ((*iter)->GetHolderTaskID() == inTaskID);
+
+		fSetOfContextMutex.Unlock();
+	}
+	return result;
+}
+
+
 uLONG VRIAContextManager::GetRegisteredContextsCount() const
 {
 	uLONG result = 0;
@@ -158,7 +173,7 @@ uLONG VRIAContextManager::GetRegisteredContextsCount() const
 
 
 VRIAContext::VRIAContext()
-: fApplication(NULL), fContextMgr(NULL), fBaseContext(NULL)
+: fApplication(NULL), fHolderTaskID(NULL_TASK_ID), fContextMgr(NULL), fBaseContext(NULL)
 {
 }
 
@@ -166,6 +181,7 @@ VRIAContext::VRIAContext()
 VRIAContext::VRIAContext( VRIAServerProject* inApplication, VRIAContextManager* inContextMgr)
 : fBaseContext(NULL)
 {
+	fHolderTaskID = VTask::GetCurrentID();
 	fApplication = RetainRefCountable( inApplication);
 	fContextMgr = RetainRefCountable( inContextMgr);
 }
@@ -199,3 +215,15 @@ VRIAServerProject* VRIAContext::GetApplication() const
 	return fApplication;
 }
 
+
+void VRIAContext::SetHolderTaskID( VTaskID inTaskID)
+{
+	VInterlocked::Exchange( &fHolderTaskID, inTaskID);
+}
+
+
+VTaskID VRIAContext::GetHolderTaskID() const
+{
+	return VInterlocked::CompareExchange( const_cast<VTaskID*>( &fHolderTaskID), NULL_TASK_ID, NULL_TASK_ID);
+}
+
@@ -41,6 +41,9 @@ public:
 
 			uLONG						GetRegisteredContextsCount() const;
 
+			/** @brief	Returns true if a registered context is currently held by the task */
+			bool						HasContextHeldByTask( XBOX::VTaskID inTaskID) const;
+
 private:
 
 			VRIAContextManager();
@@ -70,11 +73,16 @@ public:
 
 			// Accessors
 			VRIAServerProject*		GetApplication() const;
+			/**	@brief	The holder is the task which currently uses the context: the creator, then the task which retains
+						the pooled JavaScript context. NULL_TASK_ID while the JavaScript context is pooled. */
+			void					SetHolderTaskID( XBOX::VTaskID inTaskID);
+			XBOX::VTaskID			GetHolderTaskID() const;
 
 private:
 			VRIAContext();
 
 			VRIAServerProject		*fApplication;
+			XBOX::VTaskID			fHolderTaskID;		// task which currently uses the context
 			VRIAContextManager		*fContextMgr;
 			CDB4DBaseContext		*fBaseContext;
 };
@@ -28,6 +28,7 @@
 #include "VRIAJSDebuggerSettings.h"
 #include "VRIAPermissions.h"
 #include "VRIAServerSolution.h"
+#include "VRIAServerMetrics.h"
 
 //jmo - Pour les certificats intermediaires ; Necessite sans doute un petit refactoring !
 #include "ServerNet/VServerNet.h"
@@ -195,6 +196,194 @@ bool VRIAServerSolutionOpeningParameters::GetCreateAdminUser() const
 
 
 
+// The project which handles the debugger server and the supervisor is opened and started before the others
+static const sLONG	kADMINISTRATION_STARTUP_WAVE = 0;
+static const sLONG	kPROJECTS_STARTUP_WAVE = 1;
+
+
+VRIAServerStartupScheduler::VRIAServerStartupScheduler( VRIAServerSolution *inSolution, sLONG inWorkersCount, const VString& inLoggerID)
+: fSolution( inSolution)
+, fWorkersCount( (inWorkersCount > 1) ? inWorkersCount : 1)
+, fLoggerID( inLoggerID)
+, fStartTime( VSystem::GetCurrentTime())
+, fJobs( NULL)
+, fMethod( NULL)
+, fStopOnError( false)
+, fNextJob( 0)
+, fFailed( 0)
+, fRunningWorkers( 0)
+, fWorkersDoneEvent( NULL)
+{
+}
+
+
+VRIAServerStartupScheduler::~VRIAServerStartupScheduler()
+{
+}
+
+
+void VRIAServerStartupScheduler::RunPhase( const VString& inPhaseName, VectorOfStartupJobs& ioJobs, JobMethod inMethod, bool inStopOnError)
+{
+	fPhaseName = inPhaseName;
+	fJobs = &ioJobs;
+	fMethod = inMethod;
+	fStopOnError = inStopOnError;
+	fFailed = 0;
+
+	for (VectorOfStartupJobs::iterator iter = ioJobs.begin() ; iter != ioJobs.end() ; ++iter)
+	{
+		iter->fError = VE_OK;
+		iter->fDone = false;
+		iter->fMessage.Clear();
+	}
+
+	uLONG phaseStartTime = VSystem::GetCurrentTime();
+
+	sLONG lastWave = 0;
+	for (VectorOfStartupJobs::const_iterator iter = ioJobs.begin() ; iter != ioJobs.end() ; ++iter)
+	{
+		if (iter->fWave > lastWave)
+			lastWave = iter->fWave;
+	}
+
+	for (sLONG wave = 0 ; (wave <= lastWave) && (!fStopOnError || !_HasFailed()) ; ++wave)
+	{
+		fWaveJobs.clear();
+		for (size_t pos = 0 ; pos < ioJobs.size() ; ++pos)
+		{
+			if (ioJobs[pos].fWave == wave)
+				fWaveJobs.push_back( pos);
+		}
+		fNextJob = 0;
+
+		// The calling task is the first worker
+		fRunningWorkers = 1;
+		fWorkersDoneEvent = new VSyncEvent();
+
+		std::vector<VTask*> workers;
+		for (sLONG count = 1 ; (count < fWorkersCount) && (count < (sLONG) fWaveJobs.size()) ; ++count)
+		{
+			VTask *task = new VTask( this, 0, eTaskStylePreemptive, &VRIAServerStartupScheduler::_WorkerTaskProc);
+			if (task != NULL)
+			{
+				task->SetName( CVSTR( "Projects Startup Worker"));
+				task->SetKindData( (sLONG_PTR) this);
+				VInterlocked::Increment( &fRunningWorkers);
+				task->Run();
+				workers.push_back( task);
+			}
+		}
+
+		_RunJobs();
+
+		// wait for the last worker, which unlocks the event
+		if (VInterlocked::Decrement( &fRunningWorkers) > 0)
+			fWorkersDoneEvent->Lock();
+
+		ReleaseRefCountable( &fWorkersDoneEvent);
+
+		for (std::vector<VTask*>::iterator iter = workers.begin() ; iter != workers.end() ; ++iter)
+			(*iter)->Release();
+	}
+
+	// Trace the startup timeline of the phase
+	VString trace;
+	trace.Printf( "Startup timeline: \"%S\" phase done in %i ms", &fPhaseName, (sLONG) (VSystem::GetCurrentTime() - phaseStartTime));
+	LogMessage( fLoggerID, eL4JML_Debug, trace);
+
+	for (VectorOfStartupJobs::const_iterator iter = ioJobs.begin() ; iter != ioJobs.end() ; ++iter)
+	{
+		if (iter->fDone)
+		{
+			VString name;
+			if (!iter->fApplication.IsNull())
+				iter->fApplication->GetName( name);
+			else if (iter->fDesignProject != NULL)
+				iter->fDesignProject->GetName( name);
+
+			trace.Printf( "Startup timeline: \"%S\" %S from %i ms to %i ms%s", &name, &fPhaseName, (sLONG) iter->fStartTime, (sLONG) (iter->fStartTime + iter->fDuration), (iter->fError != VE_OK) ? " (failed)" : "");
+			LogMessage( fLoggerID, eL4JML_Debug, trace);
+		}
+	}
+
+	fJobs = NULL;
+	fMethod = NULL;
+}
+
+
+sLONG VRIAServerStartupScheduler::_WorkerTaskProc( VTask *inTask)
+{
+	VRIAServerStartupScheduler *scheduler = (VRIAServerStartupScheduler*) inTask->GetKindData();
+	scheduler->_RunJobs();
+
+	// the scheduler may be gone as soon as the counter is decremented, the event is retained before
+	VSyncEvent *doneEvent = RetainRefCountable( scheduler->fWorkersDoneEvent);
+	if (VInterlocked::Decrement( &scheduler->fRunningWorkers) == 0)
+		doneEvent->Unlock();
+	ReleaseRefCountable( &doneEvent);
+
+	return 0;
+}
+
+
+void VRIAServerStartupScheduler::_RunJobs()
+{
+	sLONG pos = VInterlocked::Increment( &fNextJob) - 1;
+	while ((pos < (sLONG) fWaveJobs.size()) && (!fStopOnError || !_HasFailed()))
+	{
+		_RunJob( (*fJobs)[fWaveJobs[pos]]);
+		pos = VInterlocked::Increment( &fNextJob) - 1;
+	}
+}
+
+
+void VRIAServerStartupScheduler::_RunJob( VRIAServerStartupJob& ioJob)
+{
+	ioJob.fStartTime = VSystem::GetCurrentTime() - fStartTime;
+
+	if (IsConcurrent())
+	{
+		// The error context of a worker is not the one of the calling task: the errors are logged by the worker
+		StTaskPropertiesSetter stTaskProps( &fLoggerID);
+		StErrorContextInstaller errorContext( false);
+		
+		ioJob.fError = (fSolution->*fMethod)( ioJob);
+
+		VErrorContext *context = errorContext.GetContext();
+		if ((ioJob.fError != VE_OK) && (context != NULL))
+		{
+			VString errorMessage;
+			for (std::vector<VRefPtr<VErrorBase> >::const_iterator iter = context->GetErrorStack().begin() ; iter != context->GetErrorStack().end() ; ++iter)
+			{
+				(*iter)->GetErrorDescription( errorMessage);
+				LogMessage( fLoggerID, eL4JML_Error, errorMessage);
+			}
+		}
+	}
+	else
+	{
+		ioJob.fError = (fSolution->*fMethod)( ioJob);
+	}
+
+	ioJob.fDuration = VSystem::GetCurrentTime() - fStartTime - ioJob.fStartTime;
+	ioJob.fDone = true;
+
+	if (ioJob.fError != VE_OK)
+		VInterlocked::Increment( &fFailed);
+}
+
+
+bool VRIAServerStartupScheduler::_HasFailed() const
+{
+	return VInterlocked::CompareExchange( (sLONG*) &fFailed, 0, 0) != 0;
+}
+
+
+
+// ----------------------------------------------------------------------------
+
+
+
 VRIAServerSolution::VRIAServerSolution()
 : fDesignSolution(NULL),
 fDesignSolutionFolder( NULL),
@@ -280,6 +469,8 @@ VError VRIAServerSolution::Close()
 		fApplicationsMutex.Unlock();
 	}
 
+	if (fPermissions != NULL)
+		fPermissions->StopWatchingFileChanges();
 	ReleaseRefCountable( &fPermissions);
 	if (fUAGDirectory != NULL)
 	{
@@ -379,112 +570,55 @@ VError VRIAServerSolution::Start()
 
 	if (err == VE_OK)
 	{
-		VString lHostName, lIp, lPattern, lPublishName;
-		sLONG lPort = 0, lSSLPort = 0;
-		bool lAllowSSL = false, lSSLMandatory = false, lAllowHTTPOnLocal = false;
-
 		bool ignoreProjectStartingErrors = !fSettings.GetStopIfProjectFails();
 		fGarbageCollect = fSettings.GetGarbageCollect();
 
-		for (VectorOfApplication_iter iter = fApplicationsCollection.begin() ; iter != fApplicationsCollection.end() && err == VE_OK ; ++iter)
-		{
-			StErrorContextInstaller lErrorContext;
-			
-			err = (*iter)->Start();
+		// The project which handles the debugger server is started before the others
+		VectorOfStartupJobs jobs;
+		for (VectorOfApplication_iter iter = fApplicationsCollection.begin() ; iter != fApplicationsCollection.end() ; ++iter)
+			jobs.push_back( VRIAServerStartupJob( NULL, *iter, (*iter)->CanHandlesDebuggerServer() ? kADMINISTRATION_STARTUP_WAVE : kPROJECTS_STARTUP_WAVE));
 
-			if ((*iter)->GetPublicationSettings( lHostName, lIp, lPort, lSSLPort, lPattern, lPublishName, lAllowSSL, lSSLMandatory, lAllowHTTPOnLocal) == VE_OK)
-			{
-				VString lMsg, lProjectDesc, lPublicationPorts, lPublicationAddress;
-
-				(*iter)->GetName( lPublishName);
-				if ((*iter)->IsAdministrator())
-					lProjectDesc.AppendString( L"The Administration Web Server");
-				else
-					lProjectDesc.Printf( "\"%S\" project", &lPublishName);
+		VRIAServerStartupScheduler scheduler( this, fSettings.GetStartupWorkers(), fLoggerID);
+		scheduler.RunPhase( L"start", jobs, &VRIAServerSolution::_StartProjectJob, !ignoreProjectStartingErrors);
 
-				if (lAllowSSL)
-				{
-					if (lSSLMandatory && !lAllowHTTPOnLocal)
-					{
-						lPublicationPorts.Printf( "secure port %i", lSSLPort);
-					}
-					else
-					{
-						VString lStrAnd( L"and"), lStrOr( L"or");
-						lPublicationPorts.Printf( "port %i %S secure port %i", lPort, (err == VE_OK) ? &lStrAnd : &lStrOr, lSSLPort);
-					}
-				}
-				else
-				{
-					lPublicationPorts.Printf( "port %i", lPort);
-				}
-
-				VNetAddress netAddress( lIp);
-				if (netAddress.IsAny())
-					lPublicationAddress.AppendString( L"all IP addresses");
-				else if (netAddress.IsLoopBack())
-					lPublicationAddress.AppendString( L"localhost");
-				else
-					lPublicationAddress.Printf( "%S IP address", &lIp);
+		for (VectorOfStartupJobs::iterator iter = jobs.begin() ; iter != jobs.end() && err == VE_OK ; ++iter)
+		{
+			if (!iter->fDone)
+				continue;
 
+			if (!iter->fMessage.IsEmpty())
+				fputs_VString( iter->fMessage, stdout);
 
-				if (err == VE_OK)
-				{
-					lMsg.Printf( "- %S listens for connections on %S on %S\n", &lProjectDesc, &lPublicationPorts, &lPublicationAddress);
-					if (lAllowHTTPOnLocal)
-						lMsg.AppendString( "  Note that unsecured remote connections will be refused\n");
-					lMsg.AppendString( L"\n");
-				}
-				else
-				{
-					if (lErrorContext.GetContext()->FindAny( VE_SRVR_FAILED_TO_CREATE_LISTENING_SOCKET, VE_SRVR_FAILED_TO_START_LISTENER, VE_OK))
-					{
-						lMsg.Printf( "- %S cannot listen for connections on %S on %S\n", &lProjectDesc, &lPublicationPorts, &lPublicationAddress);
-						
-						if ((*iter)->IsAdministrator())
-							lMsg.AppendString( L"  You can customize the Administration Web Server's ports with the \"--admin-port\" and \"--admin-ssl-port\" options\n\n");
-						else
-							lMsg.AppendString( L"  Please check the project's publishing settings\n\n");
-					}
-					else
-					{
-						lMsg.Printf( "- %S cannot be published\n\n", &lProjectDesc);
-					}
-				}
-				
-				fputs_VString( lMsg, stdout);
-			}
-
-			if (err != VE_OK)
+			if (iter->fError != VE_OK)
 			{
 				VString name;
-				(*iter)->GetName( name);
+				iter->fApplication->GetName( name);
 				err = vThrowError( VE_RIA_CANNOT_START_PROJECT, name);
 
 				VJSWorker::TerminateAll();
 				
-				(*iter)->Stop();	// sc 19/01/2011 if the project started with errors, the project must be stopped
+				iter->fApplication->Stop();	// sc 19/01/2011 if the project started with errors, the project must be stopped
 
 				if (ignoreProjectStartingErrors)
 					err = VE_OK;
 			}
 		}
 
-		for (VectorOfApplication_iter iter = fApplicationsCollection.begin() ; iter != fApplicationsCollection.end() && err == VE_OK ; ++iter)
+		if (err == VE_OK)
 		{
-			if ((*iter)->IsStarted())
-			{
-				err = (*iter)->OnStartup();
+			scheduler.RunPhase( L"bootstrap", jobs, &VRIAServerSolution::_OnStartupProjectJob, !ignoreProjectStartingErrors);
 
-				if (err != VE_OK)
+			for (VectorOfStartupJobs::iterator iter = jobs.begin() ; iter != jobs.end() && err == VE_OK ; ++iter)
+			{
+				if (iter->fDone && (iter->fError != VE_OK))
 				{
 					VString name;
-					(*iter)->GetName( name);
+					iter->fApplication->GetName( name);
 					err = vThrowError( VE_RIA_CANNOT_START_PROJECT, name);
 
 					VJSWorker::TerminateAll();
 					
-					(*iter)->Stop();	// sc 19/01/2011 if the bootstrap cannot be executed, the project must be stopped
+					iter->fApplication->Stop();	// sc 19/01/2011 if the bootstrap cannot be executed, the project must be stopped
 
 					if (ignoreProjectStartingErrors)
 						err = VE_OK;
@@ -506,6 +640,140 @@ VError VRIAServerSolution::Start()
 }
 
 
+VError VRIAServerSolution::_OpenProjectJob( VRIAServerStartupJob& ioJob)
+{
+	VError err = VE_OK;
+
+	// Create opening parameters
+	VRIAServerProjectOpeningParameters *projectOpeningParams = new VRIAServerProjectOpeningParameters();
+	if (projectOpeningParams != NULL)
+	{
+		projectOpeningParams->SetOpeningMode( fState.inMaintenance ? ePOM_FOR_MAINTENANCE : ePOM_FOR_RUNNING);
+
+		if (ioJob.fWave == kADMINISTRATION_STARTUP_WAVE)
+		{
+			sLONG defaultAdminPort = -1, dftAdminSSLPort = -1;
+			VString authType;
+
+			if (fOpeningParameters->GetCustomAdministratorHttpPort( defaultAdminPort))
+				projectOpeningParams->SetCustomHttpPort( defaultAdminPort);
+
+			if (fOpeningParameters->GetCustomAdministratorSSLPort( dftAdminSSLPort))
+				projectOpeningParams->SetCustomSSLPort( dftAdminSSLPort);
+
+			if (fOpeningParameters->GetCustomAdministratorAuthType( authType))
+				projectOpeningParams->SetCustomAuthenticationType( authType);
+
+			projectOpeningParams->SetHandlesDebuggerServer( fOpeningParameters->GetAdministratorHandlesDebugger());
+			projectOpeningParams->SetHandlesServerSupervisor( true);
+
+			WAKDebuggerType_t dbgType = NO_DEBUGGER_TYPE;
+			if (fOpeningParameters->GetDebuggerType( dbgType))
+				projectOpeningParams->SetDebuggerType( dbgType);
+		}
+									
+		// for Default solution, pass the WebAdmin opening parameters
+		ioJob.fApplication.Adopt( VRIAServerProject::OpenProject( err, this, ioJob.fDesignProject, projectOpeningParams));
+
+		ReleaseRefCountable( &projectOpeningParams);
+	}
+	else
+	{
+		err = vThrowError( VE_MEMORY_FULL);
+	}
+	return err;
+}
+
+
+VError VRIAServerSolution::_StartProjectJob( VRIAServerStartupJob& ioJob)
+{
+	VRIAServerProject *application = ioJob.fApplication.Get();
+	StErrorContextInstaller lErrorContext;
+	
+	VError err = application->Start();
+
+	VString lHostName, lIp, lPattern, lPublishName;
+	sLONG lPort = 0, lSSLPort = 0;
+	bool lAllowSSL = false, lSSLMandatory = false, lAllowHTTPOnLocal = false;
+
+	if (application->GetPublicationSettings( lHostName, lIp, lPort, lSSLPort, lPattern, lPublishName, lAllowSSL, lSSLMandatory, lAllowHTTPOnLocal) == VE_OK)
+	{
+		VString lMsg, lProjectDesc, lPublicationPorts, lPublicationAddress;
+
+		application->GetName( lPublishName);
+		if (application->IsAdministrator())
+			lProjectDesc.AppendString( L"The Administration Web Server");
+		else
+			lProjectDesc.Printf( "\"%S\" project", &lPublishName);
+
+		if (lAllowSSL)
+		{
+			if (lSSLMandatory && !lAllowHTTPOnLocal)
+			{
+				lPublicationPorts.Printf( "secure port %i", lSSLPort);
+			}
+			else
+			{
+				VString lStrAnd( L"and"), lStrOr( L"or");
+				lPublicationPorts.Printf( "port %i %S secure port %i", lPort, (err == VE_OK) ? &lStrAnd : &lStrOr, lSSLPort);
+			}
+		}
+		else
+		{
+			lPublicationPorts.Printf( "port %i", lPort);
+		}
+
+		VNetAddress netAddress( lIp);
+		if (netAddress.IsAny())
+			lPublicationAddress.AppendString( L"all IP addresses");
+		else if (netAddress.IsLoopBack())
+			lPublicationAddress.AppendString( L"localhost");
+		else
+			lPublicationAddress.Printf( "%S IP address", &lIp);
+
+
+		if (err == VE_OK)
+		{
+			lMsg.Printf( "- %S listens for connections on %S on %S\n", &lProjectDesc, &lPublicationPorts, &lPublicationAddress);
+			if (lAllowHTTPOnLocal)
+				lMsg.AppendString( "  Note that unsecured remote connections will be refused\n");
+			lMsg.AppendString( L"\n");
+		}
+		else
+		{
+			if (lErrorContext.GetContext()->FindAny( VE_SRVR_FAILED_TO_CREATE_LISTENING_SOCKET, VE_SRVR_FAILED_TO_START_LISTENER, VE_OK))
+			{
+				lMsg.Printf( "- %S cannot listen for connections on %S on %S\n", &lProjectDesc, &lPublicationPorts, &lPublicationAddress);
+				
+				if (application->IsAdministrator())
+					lMsg.AppendString( L"  You can customize the Administration Web Server's ports with the \"--admin-port\" and \"--admin-ssl-port\" options\n\n");
+				else
+					lMsg.AppendString( L"  Please check the project's publishing settings\n\n");
+			}
+			else
+			{
+				lMsg.Printf( "- %S cannot be published\n\n", &lProjectDesc);
+			}
+		}
+		
+		// printed by the calling task in the projects order
+		ioJob.fMessage = lMsg;
+	}
+	return err;
+}
+
+
+VError VRIAServerSolution::_OnStartupProjectJob( VRIAServerStartupJob& ioJob)
+{
+	VError err = VE_OK;
+
+	if (ioJob.fApplication->IsStarted())
+		err = ioJob.fApplication->OnStartup();
+
+	return err;
+}
+
+
 VError VRIAServerSolution::Stop()
 {
 	if (!fState.started)
@@ -995,83 +1263,67 @@ VError VRIAServerSolution::_Open( VSolution* inDesignSolution, VRIAServerSolutio
 
 					VectorOfProjects designProjects;
 					fDesignSolution->GetVectorOfProjects( designProjects);
-					for (VectorOfProjects::iterator iter = designProjects.begin() ; iter != designProjects.end() && (err == VE_OK || fState.inMaintenance) ; ++iter)
+
+					VectorOfStartupJobs jobs;
+					for (VectorOfProjects::iterator iter = designProjects.begin() ; iter != designProjects.end() ; ++iter)
 					{
 						if (*iter != NULL)
-						{
-							VRIAServerProject *application = NULL;
-
-							// Create opening parameters
-							VRIAServerProjectOpeningParameters *projectOpeningParams = new VRIAServerProjectOpeningParameters();
-							if (projectOpeningParams != NULL)
-							{
-								projectOpeningParams->SetOpeningMode( fState.inMaintenance ? ePOM_FOR_MAINTENANCE : ePOM_FOR_RUNNING);
+							jobs.push_back( VRIAServerStartupJob( *iter, NULL, (*iter == serverAdminProject) ? kADMINISTRATION_STARTUP_WAVE : kPROJECTS_STARTUP_WAVE));
+					}
 
-								bool isServerAdminProject = (*iter == serverAdminProject);
-								if (isServerAdminProject)
-								{
-									sLONG defaultAdminPort = -1, dftAdminSSLPort = -1;
-									VString authType;
+					// The projects are opened concurrently only for running
+					VRIAServerStartupScheduler scheduler( this, fState.inMaintenance ? 1 : fSettings.GetStartupWorkers(), fLoggerID);
+					scheduler.RunPhase( L"open", jobs, &VRIAServerSolution::_OpenProjectJob, !ignoreProjectOpeningErrors && !fState.inMaintenance);
 
-									if (fOpeningParameters->GetCustomAdministratorHttpPort( defaultAdminPort))
-										projectOpeningParams->SetCustomHttpPort( defaultAdminPort);
+					for (VectorOfStartupJobs::iterator iter = jobs.begin() ; iter != jobs.end() ; ++iter)
+					{
+						if (!iter->fDone)
+							continue;
 
-									if (fOpeningParameters->GetCustomAdministratorSSLPort( dftAdminSSLPort))
-										projectOpeningParams->SetCustomSSLPort( dftAdminSSLPort);
+						VRIAServerProject *application = iter->fApplication.Get();
 
-									if (fOpeningParameters->GetCustomAdministratorAuthType( authType))
-										projectOpeningParams->SetCustomAuthenticationType( authType);
+						if ((err != VE_OK) && !fState.inMaintenance)
+						{
+							// a previous project failed to open
+							if (application != NULL)
+								application->Close();
+							continue;
+						}
 
-									projectOpeningParams->SetHandlesDebuggerServer( fOpeningParameters->GetAdministratorHandlesDebugger());
-									projectOpeningParams->SetHandlesServerSupervisor( true);
+						err = iter->fError;
+						if ((application != NULL) && (err == VE_OK || fState.inMaintenance))
+						{
+							VUUID uuid;
+							application->GetUUID( uuid);
+							xbox_assert(!uuid.IsNull());
+							
+							// sc 17/04/2013, because it handles the debugger, the "ServerAdmin" project must be the first started project
+							if (iter->fWave == kADMINISTRATION_STARTUP_WAVE)
+								fApplicationsCollection.insert( fApplicationsCollection.begin(), VRefPtr<VRIAServerProject>(application));
+							else
+								fApplicationsCollection.push_back( VRefPtr<VRIAServerProject>(application));
 
-									WAKDebuggerType_t dbgType = NO_DEBUGGER_TYPE;
-									if (fOpeningParameters->GetDebuggerType( dbgType))
-										projectOpeningParams->SetDebuggerType( dbgType);
-								}
-															
-								// for Default solution, pass the WebAdmin opening parameters
-								application = VRIAServerProject::OpenProject( err, this, *iter, projectOpeningParams);
-								if ((application != NULL) && (err == VE_OK || fState.inMaintenance))
-								{
-									VUUID uuid;
-									application->GetUUID( uuid);
-									xbox_assert(!uuid.IsNull());
-									
-									// sc 17/04/2013, because it handles the debugger, the "ServerAdmin" project must be the first started project
-									if (isServerAdminProject)
-										fApplicationsCollection.insert( fApplicationsCollection.begin(), VRefPtr<VRIAServerProject>(application));
-									else
-										fApplicationsCollection.push_back( VRefPtr<VRIAServerProject>(application));
+							fApplicationsMap[uuid] = VRefPtr<VRIAServerProject>(application);
+							hasAdmin |= application->IsAdministrator();
+						}
 
-									fApplicationsMap[uuid] = VRefPtr<VRIAServerProject>(application);
-									hasAdmin |= application->IsAdministrator();
-								}
-								ReleaseRefCountable( &projectOpeningParams);
-							}
-							else
-							{
-								err = vThrowError( VE_MEMORY_FULL);
-							}
+						if (err != VE_OK)
+						{
+							VString name;
+							iter->fDesignProject->GetName( name);
+							err = vThrowError( VE_RIA_CANNOT_OPEN_PROJECT, name);
 
-							if (err != VE_OK)
+							if (!fState.inMaintenance)
 							{
-								VString name;
-								(*iter)->GetName( name);
-								err = vThrowError( VE_RIA_CANNOT_OPEN_PROJECT, name);
-
-								if (!fState.inMaintenance)
-								{
-									if (application != NULL)
-										application->Close();
+								if (application != NULL)
+									application->Close();
 
-									if (ignoreProjectOpeningErrors)
-										err = VE_OK;
-								}
+								if (ignoreProjectOpeningErrors)
+									err = VE_OK;
 							}
-							ReleaseRefCountable( &application);
 						}
 					}
+					jobs.clear();
 
 					if (!hasAdmin && !fState.inMaintenance && (err == VE_OK))
 					{
@@ -1320,6 +1572,9 @@ VError VRIAServerSolution::_LoadDatabaseSettings()
 		
 			err = db4dMgr->SetCacheSize( wantedSizeBlockMem, fSettings.GetKeepCacheInMemory(), &allocatedSize);
 
+			if (err == VE_OK && VRIAServerMetrics::Get() != NULL)
+				VRIAServerMetrics::Get()->SetGauge( L"wakanda_db_cache_allocated_bytes", L"Size of the database cache.", VString(), (sLONG8) allocatedSize);
+
 			// Calculate the minimum size to flush
 			if ( allocatedSize <= 2*1024L*1024L)
 			{
@@ -1497,6 +1752,9 @@ VRIAPermissions* VRIAServerSolution::_LoadPermissionFile( VError& outError)
 					// sc 17/12/2013 WAK0077108
 					permissions->CheckGroupsValidity( fUAGDirectory);
 				}
+
+				// The permissions file is not checked for changes on each access
+				permissions->StartWatchingFileChanges();
 			}
 		}
 	}
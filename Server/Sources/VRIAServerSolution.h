@@ -25,6 +25,7 @@
 #include "VRemoteDebuggerBreakpointsManager.h"
 
 class VSolution;
+class VProject;
 class VRIAServerProject;
 class VRIAServerJSContext;
 class VRIAServerSolutionJSRuntimeDelegate;
@@ -94,6 +95,71 @@ private:
 
 
 
+/**	@brief	A startup phase of a project: opening, starting or running the bootstrap files.
+			The jobs of a wave are run only when all the jobs of the previous waves are done. */
+class VRIAServerStartupJob
+{
+public:
+			VRIAServerStartupJob( VProject *inDesignProject, VRIAServerProject *inApplication, sLONG inWave)
+			: fDesignProject( inDesignProject), fApplication( inApplication), fWave( inWave), fError( XBOX::VE_OK), fDone( false), fStartTime( 0), fDuration( 0) {;}
+
+			VProject*								fDesignProject;
+			XBOX::VRefPtr<VRIAServerProject>		fApplication;
+			sLONG									fWave;
+			XBOX::VError							fError;
+			bool									fDone;
+			XBOX::VString							fMessage;		// console message, printed in the projects order
+			uLONG									fStartTime;		// in milliseconds since the startup of the solution
+			uLONG									fDuration;
+};
+
+typedef std::vector<VRIAServerStartupJob>		VectorOfStartupJobs;
+
+
+
+class VRIAServerSolution;
+
+/**	@brief	Runs a startup phase of the projects on a pool of worker tasks and traces the startup timeline.
+			With a single worker, the jobs are run by the calling task and their errors are left in its error context. */
+class VRIAServerStartupScheduler : public XBOX::VObject
+{
+public:
+	typedef XBOX::VError (VRIAServerSolution::*JobMethod)( VRIAServerStartupJob& ioJob);
+
+			VRIAServerStartupScheduler( VRIAServerSolution *inSolution, sLONG inWorkersCount, const XBOX::VString& inLoggerID);
+	virtual	~VRIAServerStartupScheduler();
+
+			bool							IsConcurrent() const		{ return fWorkersCount > 1; }
+
+			/**	@brief	Runs the method on each job and returns when all the jobs are done.
+						If inStopOnError is true, the jobs which are not yet started are skipped once a job has failed. */
+			void							RunPhase( const XBOX::VString& inPhaseName, VectorOfStartupJobs& ioJobs, JobMethod inMethod, bool inStopOnError);
+
+private:
+	static	sLONG							_WorkerTaskProc( XBOX::VTask *inTask);
+			void							_RunJobs();
+			void							_RunJob( VRIAServerStartupJob& ioJob);
+			bool							_HasFailed() const;
+
+			VRIAServerSolution				*fSolution;
+			sLONG							fWorkersCount;
+			XBOX::VString					fLoggerID;
+			uLONG							fStartTime;
+
+			// current phase
+			XBOX::VString					fPhaseName;
+			VectorOfStartupJobs				*fJobs;
+			std::vector<size_t>				fWaveJobs;
+			JobMethod						fMethod;
+			bool							fStopOnError;
+			sLONG volatile					fNextJob;
+			sLONG volatile					fFailed;
+			sLONG volatile					fRunningWorkers;	// the calling task counts as a worker
+			XBOX::VSyncEvent				*fWorkersDoneEvent;	// unlocked when the last worker of the wave is done
+};
+
+
+
 class VRIAServerSolution : public XBOX::VObject, public XBOX::IRefCountable, public IJSContextPoolDelegate
 {
 public:
@@ -157,6 +223,10 @@ public:
 			void							RemoveAllBreakpoints(const XBOX::VString& inUrl);
 			void							GetBreakpointsTimeStamp(sLONG& outbreakpointsTimeStamp);
 
+			/**	@brief	Serializes the accesses to the resources shared by the projects while they are opened and started concurrently:
+						the security manager user directory and the debugger settings. */
+			XBOX::VCriticalSection&			GetSharedResourcesMutex()			{ return fSharedResourcesMutex; }
+
 private:
 
 			// Inherited from IJSContextPoolDelegate
@@ -180,6 +250,11 @@ private:
 
 			VRIAPermissions*				_LoadPermissionFile( XBOX::VError& outError);
 
+			// Startup jobs, run by the startup scheduler
+			XBOX::VError					_OpenProjectJob( VRIAServerStartupJob& ioJob);
+			XBOX::VError					_StartProjectJob( VRIAServerStartupJob& ioJob);
+			XBOX::VError					_OnStartupProjectJob( VRIAServerStartupJob& ioJob);
+
 			XBOX::VString					fName;
 			VSolution						*fDesignSolution;
 			XBOX::VFolder					*fDesignSolutionFolder;
@@ -200,6 +275,7 @@ private:
 			VectorOfApplication				fApplicationsCollection;
 			MapOfApplication				fApplicationsMap;
 	mutable	XBOX::VCriticalSection			fApplicationsMutex;
+			XBOX::VCriticalSection			fSharedResourcesMutex;
 
 			VSolutionSettings				fSettings;
 			VJSDebuggerSettings*			fDebuggerSettings;
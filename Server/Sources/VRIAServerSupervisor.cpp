@@ -182,15 +182,24 @@ VError VRIAServerSupervisor::TerminateJob( const VString& inJobId, const VValueB
 }
 
 
-#define K_PAUSE_DELAY_MS	(500)
+#define K_PAUSE_DELAY_MS			(500)
+#define K_FLUSH_DELAY_MS			(20)		// delay before the next pass when some frames are still queued
+#define K_MAX_PENDING_BAGS			(4096)		// the bags logged while the queue is full are dropped
+#define K_MAX_QUEUED_FRAMES			(1024)		// a client which has more frames waiting is disconnected
+#define K_FLUSH_BUDGET_MS			(50)		// time given to each client during a pass
+#define K_MAX_WRITE_DURATION_MS		(2000)		// a client which blocks a single write for longer is disconnected
 
 
-VRIAServerSupervisor::VRIAServerSupervisor() : fAcceptClients(false), fNumberOfConnectedStudios(0)
+VRIAServerSupervisor::VRIAServerSupervisor() : fWakeUpPosted(false), fAcceptClients(false), fTask(NULL), fNumberOfConnectedStudios(0)
 {
 }
 
 VRIAServerSupervisor::~VRIAServerSupervisor()
 {
+	xbox_assert(fTask == NULL);
+
+	for (VectorOfBags::iterator iter = fPendingBags.begin() ; iter != fPendingBags.end() ; ++iter)
+		(*iter)->Release();
 }
 
 bool VRIAServerSupervisor::Init()
@@ -208,31 +217,10 @@ void VRIAServerSupervisor::DeInit()
 	if (sRIAServerSupervisor != NULL)
 	{
 		VProcess::Get()->GetLogger()->RemoveLogListener( sRIAServerSupervisor);
-		sRIAServerSupervisor->fClientSetLock.Lock();
-		for(	std::set< VRIAServerSupervisorClient* >::iterator itClient = sRIAServerSupervisor->fClientSet.begin();
-				(itClient != sRIAServerSupervisor->fClientSet.end());
-				itClient++ )
-		{
-			(*itClient)->Stop();
-		}
-		sRIAServerSupervisor->fClientSetLock.Unlock();
-		bool allThreadsDead = false;
-		while(!allThreadsDead)
-		{
-			VTask::Sleep(500);
-			allThreadsDead = true;
-			sRIAServerSupervisor->fClientSetLock.Lock();
-			for(std::set< VRIAServerSupervisorClient* >::iterator itClient = sRIAServerSupervisor->fClientSet.begin();
-				(itClient != sRIAServerSupervisor->fClientSet.end());
-				itClient++ )
-			{
-				if ((*itClient)->GetTaskState() != XBOX::TS_DEAD)
-				{
-					allThreadsDead = false;
-				}
-			}
-			sRIAServerSupervisor->fClientSetLock.Unlock();
-		}
+
+		// the supervisor task closes the clients before it ends
+		sRIAServerSupervisor->_StopTask();
+
 		delete sRIAServerSupervisor;
 		sRIAServerSupervisor = NULL;
 	}
@@ -287,38 +275,27 @@ void VRIAServerSupervisor::Put( std::vector< const XBOX::VValueBag* >& inValuesV
 	fClientSetLock.Lock();
 
 	// jobs are only treated if somebody's connected
-	if (fClientSet.size() > 0)
+	// the bags are queued once, the supervisor task serializes them once for all the clients
+	if (!fClients.empty())
 	{
+		bool queued = false;
 		for( std::vector< const XBOX::VValueBag* >::size_type idx = 0; idx < inValuesVector.size(); idx++ )
 		{
 			VString		jobId;
-			if ( ILoggerBagKeys::jobId.Get( inValuesVector[idx], jobId ) )
-			{
-				for( std::set< VRIAServerSupervisorClient* >::iterator itClient = fClientSet.begin(); (itClient != fClientSet.end()); itClient++ )
-				{
-					if ((*itClient)->IsStarted())
-					{
-						inValuesVector[idx]->Retain();
-						(*itClient)->fBagsVector.push_back(inValuesVector[idx]);
-					}
-				}
-			}
-			else
+			sLONG8		debugContext;
+			if (fPendingBags.size() >= K_MAX_PENDING_BAGS)
+				break;	// the supervisor task does not keep up, the clients will miss these bags
+
+			if (ILoggerBagKeys::jobId.Get( inValuesVector[idx], jobId ) || ILoggerBagKeys::debug_context.Get( inValuesVector[idx], debugContext))
 			{
-				sLONG8	debugContext;
-				if (ILoggerBagKeys::debug_context.Get(inValuesVector[idx], debugContext))
-				{
-					for (std::set< VRIAServerSupervisorClient* >::iterator itClient = fClientSet.begin(); (itClient != fClientSet.end()); itClient++)
-					{
-						if ((*itClient)->IsStarted())
-						{
-							inValuesVector[idx]->Retain();
-							(*itClient)->fBagsVector.push_back(inValuesVector[idx]);
-						}
-					}
-				}
+				inValuesVector[idx]->Retain();
+				fPendingBags.push_back( inValuesVector[idx]);
+				queued = true;
 			}
 		}
+
+		if (queued)
+			_WakeUp();
 	}
 	/*else
 	{
@@ -378,407 +355,438 @@ XBOX::VError VRIAServerSupervisor::GetPatterns (XBOX::VectorOfVString *outPatter
 
 	return XBOX::VE_OK;
 }
-XBOX::TaskState VRIAServerSupervisor::VRIAServerSupervisorClient::GetTaskState()
+
+void VRIAServerSupervisor::_StartTask()
 {
-	if (fTask)
+	// called with fClientSetLock held
+	if (fTask == NULL)
 	{
-		return fTask->GetState();
+		fTask = new XBOX::VTask( this, 64000, XBOX::eTaskStylePreemptive, &VRIAServerSupervisor::_TaskProc);
+		if (fTask != NULL)
+		{
+			fTask->SetName( "RIAServerSupervisor");
+			fTask->SetKindData( (sLONG_PTR) this);
+			fTask->Run();
+		}
 	}
-	return XBOX::TS_DEAD;
 }
 
-void VRIAServerSupervisor::VRIAServerSupervisorClient::TreatBags(VError& ioError)
+void VRIAServerSupervisor::_StopTask()
 {
-	VectorOfBags					tmpBags;
-	sRIAServerSupervisor->fClientSetLock.Lock();
-	for (VectorOfBags::size_type idx = 0; idx < fBagsVector.size(); idx++)
-	{
-		tmpBags.push_back(fBagsVector[idx]);
-	}
-	fBagsVector.clear();
-	sRIAServerSupervisor->fClientSetLock.Unlock();
+	fClientSetLock.Lock();
+	VTask *task = fTask;
+	fTask = NULL;
+	fClientSetLock.Unlock();
 
-	for (VectorOfBags::size_type idx = 0; idx < tmpBags.size(); idx++)
+	if (task != NULL)
 	{
-		if (!ioError)
+		task->Kill();
+		while (task->GetState() < TS_DEAD)
 		{
-			VString		jobId;
-			bool isJobMsg = ILoggerBagKeys::jobId.Get(tmpBags[idx], jobId);
-			sLONG8	debugContext;
-			bool isDbgMsg = ILoggerBagKeys::debug_context.Get(tmpBags[idx], debugContext);
-			VString		msg;
-			bool isJsonOK = tmpBags[idx]->GetJSONString(msg) == VE_OK;
-			if (isJobMsg || isDbgMsg)
-			{
-				if (debugContext)
-				{
-					VString	logID;
-					if (ILoggerBagKeys::source.Get(tmpBags[idx], logID))
-					{
-						if (logID.Find(L".console") > 0)
-						{
-							continue;
-						}
-					}
-				}
-				XBOX::VStringConvertBuffer	buffer(msg, XBOX::VTC_UTF_8);
-				ioError = fWS->WriteMessage(buffer.GetCPointer(), buffer.GetLength(), true);
-				//DebugMsg("...will send  <%s>\n",buffer.GetCPointer());
-				if (!ioError)
-				{
-					ioError = SendCurrentState(false, "");
-				}
-			}
+			VTask::Sleep( 20);
 		}
-		tmpBags[idx]->Release();
+		task->Release();
 	}
-	tmpBags.clear();
 }
 
-sLONG VRIAServerSupervisor::VRIAServerSupervisorClient::InnerTaskProc(XBOX::VTask* inTask)
+void VRIAServerSupervisor::_WakeUp()
 {
-	VRIAServerSupervisorClient*		l_this = (VRIAServerSupervisorClient*)inTask->GetKindData();
-	VTask*							curtTask = VTask::GetCurrent();
-	sBYTE*							tmpData = new sBYTE[K_BUFFER_MAX_SIZE];
-	VError							err = VE_OK;
+	// called with fClientSetLock held, one message is enough whatever the count of bags logged until the task runs
+	if (!fWakeUpPosted && fTask != NULL)
+	{
+		VWakeUpMessage *msg = new VWakeUpMessage();
+		msg->PostTo( fTask);
+		ReleaseRefCountable( &msg);
+		fWakeUpPosted = true;
+	}
+}
 
-#if 1
-	while (!l_this->fExitTask)
+sLONG VRIAServerSupervisor::_TaskProc( XBOX::VTask* inTask)
+{
+	VRIAServerSupervisor	*supervisor = (VRIAServerSupervisor*) inTask->GetKindData();
+	sBYTE					*buffer = new sBYTE[K_BUFFER_MAX_SIZE];
+
+	while (!inTask->IsDying())
 	{
-		err = VE_OK;
+		bool queuedFrames = supervisor->_ServeClients( buffer, K_BUFFER_MAX_SIZE);
 
-		while (!l_this->fStarted)
-		{
-			if (l_this->fExitTask)
-			{
-				break; // sc, GH,  05/02/2014 WAK0086433
-			}
+		// the task is woken up when bags are logged or when a client connects.
+		// The websockets have no readiness notification, so the timeout also polls the clients messages and the debugger state.
+		inTask->ExecuteMessagesWithTimeout( queuedFrames ? K_FLUSH_DELAY_MS : K_PAUSE_DELAY_MS);
+	}
 
-			if (curtTask->IsDying())
-			{
-				l_this->fExitTask = true;
-				break;
-			}
-			curtTask->ExecuteMessagesWithTimeout(K_PAUSE_DELAY_MS);
-		}
+	VectorOfClients clients;
+	supervisor->fClientSetLock.Lock();
+	clients.swap( supervisor->fClients);
+	clients.insert( clients.end(), supervisor->fNewClients.begin(), supervisor->fNewClients.end());
+	supervisor->fNewClients.clear();
+	supervisor->fClientSetLock.Unlock();
 
-		while (!err && !l_this->fExitTask)
-		{
-			if (curtTask->IsDying())
-			{
-				l_this->fExitTask = true;
-				break;
-			}
+	for (VectorOfClients::iterator iter = clients.begin() ; iter != clients.end() ; ++iter)
+		delete *iter;
 
-			VSize	msgLen = K_BUFFER_MAX_SIZE - 1;
-			bool	isTerminated = false;
-			while (!isTerminated)
-			{
-				err = l_this->fWS->ReadMessage(tmpData, msgLen, isTerminated);
-				if (err)
-				{
-					break;
-				}
-				xbox_assert(isTerminated); // TBC for framed msgs
-				if (msgLen)
-				{
-					// treat received msg
-					tmpData[msgLen] = 0;
-					const char*		K_CONN_TYPE_MSG = "{\"connectionType\":\"";
-					char*			startChar = strstr(tmpData, K_CONN_TYPE_MSG);
-					if (startChar)
-					{
-						if (strstr(startChar + strlen(K_CONN_TYPE_MSG), "STUDIO"))
-						{
-							l_this->fStudioIsConnected = true;
+	delete [] buffer;
+	return 0;
+}
 
-							sRIAServerSupervisor->fStudioConnectionLock.Lock();
-							sRIAServerSupervisor->fNumberOfConnectedStudios++;
-							sRIAServerSupervisor->fStudioConnectionLock.Unlock();
-						}
-					}
-				}
-				msgLen = K_BUFFER_MAX_SIZE - 1;
-			}
+bool VRIAServerSupervisor::_ServeClients( sBYTE *ioBuffer, VSize inBufferSize)
+{
+	VectorOfClients		newClients;
+	VectorOfBags		bags;
 
-			if (!err)
-			{
-				err = l_this->SendCurrentState(false, "");
-			}
+	fClientSetLock.Lock();
+	newClients.swap( fNewClients);
+	bags.swap( fPendingBags);
+	fWakeUpPosted = false;
+	fClientSetLock.Unlock();
 
-			l_this->TreatBags(err);
+	// the debugger state is read once for all the clients
+	VRIAServerState state;
+	state.Update();
 
-			//if (!err)
-			{
-				curtTask->ExecuteMessagesWithTimeout(K_PAUSE_DELAY_MS);
-			}
-		}
+	if (!newClients.empty())
+	{
+		// the first message is flushed with the other frames
+		for (VectorOfClients::iterator iter = newClients.begin() ; iter != newClients.end() ; ++iter)
+			(*iter)->QueueState( state, true);
+
+		fClientSetLock.Lock();
+		fClients.insert( fClients.end(), newClients.begin(), newClients.end());
+		fClientSetLock.Unlock();
+	}
 
+	// fClients is only modified by this task, it can be read without the lock
+	std::vector<bool> failedClients( fClients.size(), false);
+	bool someClientWantsBatches = false;
 
-		if (l_this->fWS)
+	for (VectorOfClients::size_type idx = 0 ; idx < fClients.size() ; ++idx)
+	{
+		bool wasStudio = fClients[idx]->IsStudio();
+		failedClients[idx] = (fClients[idx]->ReadMessages( ioBuffer, inBufferSize) != VE_OK);
+		if (!wasStudio && fClients[idx]->IsStudio())
+			++fNumberOfConnectedStudios;
+
+		someClientWantsBatches = someClientWantsBatches || fClients[idx]->WantsBatches();
+	}
+
+	// serialize the bags once, the same frames are queued for all the clients
+	VectorOfFrames messages;
+	std::vector<char> batch;
+
+	for (VectorOfBags::iterator iter = bags.begin() ; iter != bags.end() ; ++iter)
+	{
+		const VValueBag *bag = *iter;
+		bool skip = false;
+
+		// the console messages of the debugged contexts are sent by the debugger
+		sLONG8 debugContext = 0;
+		if (ILoggerBagKeys::debug_context.Get( bag, debugContext) && debugContext != 0)
 		{
-			l_this->fWS->Close();
-			delete l_this->fWS;
-			l_this->fWS = NULL;
+			VString	logID;
+			if (ILoggerBagKeys::source.Get( bag, logID))
+				skip = (logID.Find( L".console") > 0);
 		}
-		l_this->fStarted = false;
 
-		if (!l_this->fExitTask)
+		VString msg;
+		if (!skip && bag->GetJSONString( msg) == VE_OK)
 		{
-			if (l_this->fStudioIsConnected)
+			XBOX::VStringConvertBuffer	buffer( msg, XBOX::VTC_UTF_8);
+			messages.push_back( VRefPtr<VFrame>( new VFrame( buffer.GetCPointer(), buffer.GetLength()), false));
+
+			if (someClientWantsBatches)
 			{
-				l_this->fStudioIsConnected = false;
-				sRIAServerSupervisor->fStudioConnectionLock.Lock();
-				sRIAServerSupervisor->fNumberOfConnectedStudios--;
-				sRIAServerSupervisor->fStudioConnectionLock.Unlock();
+				batch.push_back( batch.empty() ? '[' : ',');
+				batch.insert( batch.end(), buffer.GetCPointer(), buffer.GetCPointer() + buffer.GetLength());
 			}
 		}
+		bag->Release();
+	}
 
+	VRefPtr<VFrame> batchFrame;
+	if (!batch.empty())
+	{
+		batch.push_back( ']');
+		batchFrame.Adopt( new VFrame( &batch[0], batch.size()));
 	}
 
-#endif
-	delete tmpData;
-	return 0;
-}
+	bool queuedFrames = false;
+	for (VectorOfClients::size_type idx = 0 ; idx < fClients.size() ; ++idx)
+	{
+		if (!failedClients[idx])
+			failedClients[idx] = !fClients[idx]->QueueBags( messages, batchFrame.Get());
 
-VRIAServerSupervisor::VRIAServerSupervisorClient::VRIAServerSupervisorClient() : fWS(NULL)
-{
-	fStarted = false;
-	fExitTask = false;
-	fStudioIsConnected = false;
-	fTask = new XBOX::VTask(this, 64000, XBOX::eTaskStylePreemptive, &VRIAServerSupervisorClient::InnerTaskProc);
+		// the state is sent once after the batch instead of after each bag
+		if (!failedClients[idx])
+		{
+			fClients[idx]->QueueState( state, false);
+			failedClients[idx] = (fClients[idx]->Flush() != VE_OK);
+		}
 
-	fTask->SetName("RIAServerSupervisor");
-	fTask->SetKindData((sLONG_PTR)this);
-	fTask->Run();
-}
+		if (!failedClients[idx])
+			queuedFrames = queuedFrames || fClients[idx]->HasQueuedFrames();
+	}
 
-VRIAServerSupervisor::VRIAServerSupervisorClient::~VRIAServerSupervisorClient()
-{
+	// remove the disconnected clients
+	VectorOfClients failed;
+	fClientSetLock.Lock();
+	for (sLONG idx = (sLONG) fClients.size() - 1 ; idx >= 0 ; --idx)
+	{
+		if (failedClients[idx])
+		{
+			failed.push_back( fClients[idx]);
+			fClients.erase( fClients.begin() + idx);
+		}
+	}
+	fClientSetLock.Unlock();
+
+	for (VectorOfClients::iterator iter = failed.begin() ; iter != failed.end() ; ++iter)
+	{
+		if ((*iter)->IsStudio())
+			--fNumberOfConnectedStudios;
+		delete *iter;
+	}
+
+	return queuedFrames;
 }
 
 
-void VRIAServerSupervisor::VRIAServerSupervisorClient::Start(IHTTPWebsocketServer* inWS, const XBOX::VString& inSolutionName)
+static void _AppendJSONMember( VString& ioObject, const char *inName, const VString& inJSONValue)
 {
-	VStartMessage*	startMsg = new VStartMessage(this,inWS,inSolutionName);
-	// post in order to not block the caller during the sending of first msg
-	startMsg->PostTo( fTask );
-	ReleaseRefCountable(&startMsg);
+	ioObject.AppendUniChar( ioObject.IsEmpty() ? '{' : ',');
+	ioObject.AppendUniChar( '"');
+	ioObject.AppendCString( inName);
+	ioObject.AppendCString( "\":");
+	ioObject.AppendString( inJSONValue);
 }
 
-VError VRIAServerSupervisor::VRIAServerSupervisorClient::SendCurrentState(bool inFirstMessage,const XBOX::VString& inSolutionName)
+void VRIAServerSupervisor::VRIAServerState::Update()
 {
-	VError				err = VE_OK;
-
-	bool				sendToClient;
-	WAKDebuggerType_t	wakDebuggerType;
-	bool				started;
-	sLONG				breakpointsTimeStamp;
-	bool				connected;
-	sLONG				debuggingEventsTimeStamp;
-	bool				pendingContexts;
-	IRemoteDebuggerServer*		dbgrSrv;
-
-
-	VRemoteDebuggerBreakpointsManager::GetGlobalTimeStamp(breakpointsTimeStamp);
+	VRemoteDebuggerBreakpointsManager::GetGlobalTimeStamp( fBreakpointsTimeStamp);
 
-	dbgrSrv = VJSGlobalContext::GetDebuggerServer();
-	sendToClient = false;
-	wakDebuggerType = NO_DEBUGGER_TYPE;
-	started = false;
-	connected = false;
-	pendingContexts = false;
-	debuggingEventsTimeStamp = -1;
+	fDebuggerType = NO_DEBUGGER_TYPE;
+	fStarted = false;
+	fConnected = false;
+	fPendingContexts = false;
+	fDebuggingEventsTimeStamp = -1;
 
+	IRemoteDebuggerServer *dbgrSrv = VJSGlobalContext::GetDebuggerServer();
 	if (dbgrSrv)
 	{
 		long long evtsTS;
-		wakDebuggerType = dbgrSrv->GetType();
-		if (wakDebuggerType != NO_DEBUGGER_TYPE)
+		fDebuggerType = dbgrSrv->GetType();
+		if (fDebuggerType != NO_DEBUGGER_TYPE)
 		{
 			dbgrSrv->GetStatus(
-					started,
-					connected,
+					fStarted,
+					fConnected,
 					evtsTS,
-					pendingContexts);
+					fPendingContexts);
 
-			debuggingEventsTimeStamp = (sLONG)evtsTS;
+			fDebuggingEventsTimeStamp = (sLONG)evtsTS;
 		}
 	}
+}
 
-	if (!inFirstMessage)
+bool VRIAServerSupervisor::VRIAServerState::IsChangedFrom( const VRIAServerState& inState) const
+{
+	return	(fDebuggerType != inState.fDebuggerType)
+		||	(fStarted != inState.fStarted)
+		||	(fConnected != inState.fConnected)
+		||	(inState.fConnected && (fPendingContexts != inState.fPendingContexts))
+		||	(fDebuggingEventsTimeStamp != inState.fDebuggingEventsTimeStamp)
+		||	(fBreakpointsTimeStamp != inState.fBreakpointsTimeStamp);
+}
+
+VRIAServerSupervisor::VRIAServerSupervisorClient::VRIAServerSupervisorClient( IHTTPWebsocketServer* inWS, const XBOX::VString& inSolutionName)
+: fWS(inWS), fSolutionName(inSolutionName), fStudioIsConnected(false), fStateDiffs(false), fBatches(false)
+{
+}
+
+VRIAServerSupervisor::VRIAServerSupervisorClient::~VRIAServerSupervisorClient()
+{
+	if (fWS)
 	{
-		sendToClient = (fServerState.fDebuggerType != wakDebuggerType);
-		if (!sendToClient)
-		{
-			sendToClient = (fServerState.fStarted != started);
-		}
-		if (!sendToClient)
-		{
-			sendToClient = (fServerState.fConnected != connected);
-		}
-		if (!sendToClient && fServerState.fConnected)
+		fWS->Close();
+		delete fWS;
+		fWS = NULL;
+	}
+}
+
+VError VRIAServerSupervisor::VRIAServerSupervisorClient::ReadMessages( sBYTE *ioBuffer, VSize inBufferSize)
+{
+	VError	err = VE_OK;
+	VSize	msgLen = inBufferSize - 1;
+	bool	isTerminated = false;
+
+	while (!isTerminated)
+	{
+		err = fWS->ReadMessage( ioBuffer, msgLen, isTerminated);
+		if (err)
 		{
-			sendToClient = (fServerState.fPendingContexts != pendingContexts);
+			break;
 		}
-		if (!sendToClient)
+		xbox_assert(isTerminated); // TBC for framed msgs
+		if (msgLen)
 		{
-			sendToClient = (fServerState.fDebuggingEventsTimeStamp != debuggingEventsTimeStamp);
+			// treat received msg
+			ioBuffer[msgLen] = 0;
+			const char*		K_CONN_TYPE_MSG = "{\"connectionType\":\"";
+			char*			startChar = strstr( ioBuffer, K_CONN_TYPE_MSG);
+			if (startChar)
+			{
+				if (strstr(startChar + strlen(K_CONN_TYPE_MSG), "STUDIO"))
+				{
+					fStudioIsConnected = true;
+				}
+
+				// the protocol options are opt-in: the clients which do not send them receive full states and one bag per message
+				fStateDiffs = (strstr( startChar, "\"stateDiffs\":true") != NULL);
+				fBatches = (strstr( startChar, "\"batches\":true") != NULL);
+			}
 		}
-		if (!sendToClient)
+		msgLen = inBufferSize - 1;
+	}
+	return err;
+}
+
+bool VRIAServerSupervisor::VRIAServerSupervisorClient::QueueBags( const VectorOfFrames& inMessages, VFrame *inBatch)
+{
+	if (fBatches)
+	{
+		if (inBatch != NULL)
 		{
-			sendToClient = (fServerState.fBreakpointsTimeStamp != breakpointsTimeStamp);
+			if (fQueue.size() >= K_MAX_QUEUED_FRAMES)
+				return false;
+
+			fQueue.push_back( VRefPtr<VFrame>( inBatch));
 		}
-		/*if (!sendToClient)
-		{
-			sendToClient = (fServerState.fSolutionName != inSolutionName);
-		}*/
 	}
-	else
+	else if (!inMessages.empty())
 	{
-		sendToClient = true;
+		if (fQueue.size() + inMessages.size() > K_MAX_QUEUED_FRAMES)
+			return false;
+
+		fQueue.insert( fQueue.end(), inMessages.begin(), inMessages.end());
 	}
+	return true;
+}
+
+VError VRIAServerSupervisor::VRIAServerSupervisorClient::Flush()
+{
+	VError err = VE_OK;
+	uLONG startTime = VSystem::GetCurrentTime();
+	VectorOfFrames::size_type written = 0;
 
-	if (!err && sendToClient)
+	while (written < fQueue.size() && err == VE_OK)
 	{
-		fServerState.fDebuggerType = wakDebuggerType;
-		fServerState.fStarted = started;
-		fServerState.fConnected = connected;
-		fServerState.fPendingContexts = pendingContexts;
-		fServerState.fBreakpointsTimeStamp = breakpointsTimeStamp;
-		fServerState.fDebuggingEventsTimeStamp = debuggingEventsTimeStamp;
-		sendToClient = true;
+		const std::vector<char>& data = fQueue[written]->fData;
+		uLONG writeTime = VSystem::GetCurrentTime();
+
+		if (!data.empty())
+			err = fWS->WriteMessage( &data[0], data.size(), true);
+		++written;
+
+		uLONG currentTime = VSystem::GetCurrentTime();
+		if (err == VE_OK && (currentTime - writeTime) > K_MAX_WRITE_DURATION_MS)
+			err = VE_UNKNOWN_ERROR;	// the client does not read its messages anymore
+
+		if ((currentTime - startTime) > K_FLUSH_BUDGET_MS)
+			break;	// the remaining frames are written during the next passes
 	}
 
-	if (!err && sendToClient)
+	fQueue.erase( fQueue.begin(), fQueue.begin() + written);
+	return err;
+}
+
+void VRIAServerSupervisor::VRIAServerSupervisorClient::QueueState( const VRIAServerState& inState, bool inFirstMessage)
+{
+	if (!inFirstMessage && !inState.IsChangedFrom( fServerState))
+		return;
+
+	// with state diffs, only the members which changed since the previous state are sent
+	bool	diff = fStateDiffs && !inFirstMessage;
+	VString	result, value;
+
+	if (!diff || (inState.fStarted != fServerState.fStarted))
+		_AppendJSONMember( result, "debuggerStarted", inState.fStarted ? "true" : "false");
+
+	if (!diff || (inState.fDebuggerType != fServerState.fDebuggerType))
 	{
-		VString		result("{\"debuggerStarted\":");
-		if (started)
-		{
-			result += "true";
-		}
-		else
-		{
-			result += "false";
-		}
-		result += ",\"debuggerType\":";
-		switch(fServerState.fDebuggerType)
+		switch(inState.fDebuggerType)
 		{
 		case WEB_INSPECTOR_TYPE:
-			result += "\"REMOTE_DEBUGGER\"";
+			value = "\"REMOTE_DEBUGGER\"";
 			break;
 		case REGULAR_DBG_TYPE:
-			result += "\"WAKANDA_DEBUGGER\"";
+			value = "\"WAKANDA_DEBUGGER\"";
 			break;
 		case NO_DEBUGGER_TYPE:
-			result += "\"NO_DEBUGGER\"";
+			value = "\"NO_DEBUGGER\"";
 			break;
 		default:
-			result += "\"UNKNOWN_DEBUGGER\"";
+			value = "\"UNKNOWN_DEBUGGER\"";
 			break;
 		}
-		result += ",\"breakpointsTimeStamp\":";
-		result.AppendLong8(fServerState.fBreakpointsTimeStamp);
-		result += ",\"debuggerConnected\":";
-		if (connected)
-		{
-			result += "true";
-		}
-		else
-		{
-			result += "false";
-		}
-		result += ",\"debuggingPendingContexts\":";
-		if (fServerState.fPendingContexts)
-		{
-			result += "true";
-		}
-		else
-		{
-			result += "false";
-		}
-		result += ",\"debuggingEventsTimeStamp\":";
-		result.AppendLong8(fServerState.fDebuggingEventsTimeStamp);
-		
-		if (inFirstMessage)
-		{
-			bool	isStudioConnected = false;
-			sRIAServerSupervisor->fStudioConnectionLock.Lock();
-			isStudioConnected = (sRIAServerSupervisor->fNumberOfConnectedStudios > 0);
-			sRIAServerSupervisor->fStudioConnectionLock.Unlock();
-			result += ",\"studioIsConnected\":\"";
-			result += ( isStudioConnected ? "true" : "false" );
-			result += "\"";
-
-			fServerState.fSolutionName = inSolutionName;
-			result += ",\"solutionName\":\"";
-			result += fServerState.fSolutionName;
-			result += "\"";
-
-			result += ",\"protocolVersion\":\"";
-			result += K_CURRENT_PROTOCOL_VERSION;
-			if ( VRIAServerApplication::Get()->IsEnterpriseVersion() )
-			{
-				result += "_ENTERPRISE";
-			}
-			result += "\"";
-			result += ",\"serverPath\":\"";
-			XBOX::VFilePath	vFilePath = VProcess::Get()->GetExecutableFilePath();
-			VString		jsonPath;
-			vFilePath.GetPath().GetJSONString(jsonPath);
-			result += jsonPath;
-			result += "\"";
-		}
-		result += "}";
+		_AppendJSONMember( result, "debuggerType", value);
+	}
 
-		VStringConvertBuffer	buffer(result,VTC_UTF_8);
-		err = fWS->WriteMessage(buffer.GetCPointer(),buffer.GetSize(),true);
+	if (!diff || (inState.fBreakpointsTimeStamp != fServerState.fBreakpointsTimeStamp))
+	{
+		value.Clear();
+		value.AppendLong8( inState.fBreakpointsTimeStamp);
+		_AppendJSONMember( result, "breakpointsTimeStamp", value);
 	}
 
-	return err;
-}
+	if (!diff || (inState.fConnected != fServerState.fConnected))
+		_AppendJSONMember( result, "debuggerConnected", inState.fConnected ? "true" : "false");
 
-void VRIAServerSupervisor::VRIAServerSupervisorClient::VStartMessage::DoExecute()
-{
-	VError	err = VE_UNKNOWN_ERROR;
+	if (!diff || (inState.fPendingContexts != fServerState.fPendingContexts))
+		_AppendJSONMember( result, "debuggingPendingContexts", inState.fPendingContexts ? "true" : "false");
 
-	if (!fClient->IsStarted())
+	if (!diff || (inState.fDebuggingEventsTimeStamp != fServerState.fDebuggingEventsTimeStamp))
 	{
-		fClient->fWS = fWS;
-		err = fClient->SendCurrentState(true,fSolutionName);
-		if (!err)
-		{
-			//fClient->fBagsVector.clear();
-			fClient->fStarted = true;
-		}
+		value.Clear();
+		value.AppendLong8( inState.fDebuggingEventsTimeStamp);
+		_AppendJSONMember( result, "debuggingEventsTimeStamp", value);
 	}
-	if (err)
+
+	if (inFirstMessage)
 	{
-		if (fWS)
+		bool	isStudioConnected = (sRIAServerSupervisor->fNumberOfConnectedStudios > 0);
+		_AppendJSONMember( result, "studioIsConnected", isStudioConnected ? "\"true\"" : "\"false\"");
+
+		value = "\"";
+		value += fSolutionName;
+		value += "\"";
+		_AppendJSONMember( result, "solutionName", value);
+
+		value = "\"";
+		value += K_CURRENT_PROTOCOL_VERSION;
+		if ( VRIAServerApplication::Get()->IsEnterpriseVersion() )
 		{
-			fWS->Close();
-			delete fWS;
-			fClient->fWS = NULL;
+			value += "_ENTERPRISE";
 		}
-	}
-}
+		value += "\"";
+		_AppendJSONMember( result, "protocolVersion", value);
 
+		// the options a client may ask for in its connectionType message
+		_AppendJSONMember( result, "protocolOptions", "[\"stateDiffs\",\"batches\"]");
 
-bool VRIAServerSupervisor::VRIAServerSupervisorClient::IsStarted()
-{
-	return fStarted;
-}
+		XBOX::VFilePath	vFilePath = VProcess::Get()->GetExecutableFilePath();
+		VString		jsonPath;
+		vFilePath.GetPath().GetJSONString(jsonPath);
+		value = "\"";
+		value += jsonPath;
+		value += "\"";
+		_AppendJSONMember( result, "serverPath", value);
+	}
+	result += "}";
 
-void VRIAServerSupervisor::VRIAServerSupervisorClient::Stop()
-{
-	VStopMessage*	stopMsg = new VStopMessage(this);
-	stopMsg->PostTo( fTask );
-	ReleaseRefCountable(&stopMsg);
-}
+	fServerState = inState;
+	fServerState.fSolutionName = fSolutionName;
 
-void VRIAServerSupervisor::VRIAServerSupervisorClient::VStopMessage::DoExecute()
-{
-	fClient->fExitTask = true;
+	VStringConvertBuffer	buffer(result,VTC_UTF_8);
+	fQueue.push_back( VRefPtr<VFrame>( new VFrame( buffer.GetCPointer(), buffer.GetSize()), false));
 }
 
 
@@ -809,26 +817,21 @@ XBOX::VError VRIAServerSupervisor::HandleRequest(IHTTPResponse* ioResponse)
 				}
 				else
 				{
-					fClientSetLock.Lock();
-					for( std::set< VRIAServerSupervisorClient* >::iterator itClient = fClientSet.begin(); (itClient != fClientSet.end()); itClient++ )
+					// the first message is sent by the supervisor task in order to not block the caller
+					VRIAServerSupervisorClient*		newClt = new VRIAServerSupervisorClient(webSocket,solution->GetName());
+					if (newClt)
 					{
-						if (!(*itClient)->IsStarted())
-						{
-							(*itClient)->Start(webSocket,solution->GetName());
-							webSocket = NULL;
-							break;
-						}
+						fClientSetLock.Lock();
+						_StartTask();
+						fNewClients.push_back( newClt );
+						_WakeUp();
+						fClientSetLock.Unlock();
 					}
-					if (webSocket)
+					else
 					{
-						VRIAServerSupervisorClient*		newClt = new VRIAServerSupervisorClient();
-						if (newClt)
-						{
-							fClientSet.insert( newClt );
-							newClt->Start(webSocket,solution->GetName());
-						}
+						webSocket->Close();
+						delete webSocket;
 					}
-					fClientSetLock.Unlock();
 					solution->Release();
 				}
 			}
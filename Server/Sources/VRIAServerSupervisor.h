@@ -90,82 +90,103 @@ private:
 
 	typedef std::vector< const XBOX::VValueBag* > VectorOfBags;
 
-	class VRIAServerSupervisorClient : public XBOX::VObject
+	class VRIAServerState
+	{
+	public:
+													VRIAServerState() :
+															fDebuggerType(NO_DEBUGGER_TYPE),
+															fStarted(false),
+															fConnected(false),
+															fBreakpointsTimeStamp(-1),
+															fDebuggingEventsTimeStamp(-1),
+															fPendingContexts(false),
+															fSolutionName("") {;}
+
+			/** @brief	Reads the current state of the debugger */
+			void							Update();
+
+			/** @brief	Returns true if the state must be sent to a client which has received inState */
+			bool							IsChangedFrom( const VRIAServerState& inState) const;
+
+			WAKDebuggerType_t			fDebuggerType;
+			bool						fStarted;
+			sLONG						fBreakpointsTimeStamp;
+			bool						fConnected;
+			sLONG						fDebuggingEventsTimeStamp;
+			bool						fPendingContexts;
+			XBOX::VString				fSolutionName;
+	};
+
+	/** @brief	A serialized message. The frames of the bags are shared by the queues of all the clients. */
+	class VFrame : public XBOX::VObject, public XBOX::IRefCountable
 	{
+	public:
+														VFrame( const char *inData, XBOX::VSize inSize) : fData( inData, inData + inSize) {;}
 
+				std::vector<char>						fData;
+	};
+
+	typedef std::vector< XBOX::VRefPtr<VFrame> > VectorOfFrames;
+
+	/** @brief	A supervisor websocket client. The clients have no task of their own: they are all served by the supervisor task.
+				The frames are queued, then flushed with a time budget so that a slow client cannot hold the other ones. */
+	class VRIAServerSupervisorClient : public XBOX::VObject
+	{
 	public:
-														VRIAServerSupervisorClient();
-				void									Start(IHTTPWebsocketServer* inWS, const XBOX::VString& inSolutionName);
-				void									Stop();
-				bool									IsStarted();
-				VectorOfBags							fBagsVector;
-				XBOX::TaskState							GetTaskState();
-				void									TreatBags(XBOX::VError& ioError);
+														VRIAServerSupervisorClient( IHTTPWebsocketServer* inWS, const XBOX::VString& inSolutionName);
+		virtual											~VRIAServerSupervisorClient();
+
+				/** @brief	Reads the messages sent by the client, which declare its connection type and its protocol options */
+				XBOX::VError							ReadMessages( sBYTE *ioBuffer, XBOX::VSize inBufferSize);
+
+				/** @brief	Queues the serialized bags, one frame per bag or one frame for the batch if the client asked for batches.
+							Returns false if the queue is full: the client does not read fast enough and must be disconnected. */
+				bool									QueueBags( const VectorOfFrames& inMessages, VFrame *inBatch);
+
+				/** @brief	Queues the state if it changed since the previous one queued for the client */
+				void									QueueState( const VRIAServerState& inState, bool inFirstMessage);
+
+				/** @brief	Writes the queued frames until the queue is empty or the time budget is spent.
+							Returns an error if a write fails or if a single write blocks for too long. */
+				XBOX::VError							Flush();
+
+				bool									IsStudio() const			{ return fStudioIsConnected; }
+				bool									WantsBatches() const		{ return fBatches; }
+				bool									HasQueuedFrames() const		{ return !fQueue.empty(); }
 
 	private:
-		class VRIAServerState
-		{
-		public:
-														VRIAServerState() :
-																fDebuggerType(NO_DEBUGGER_TYPE),
-																fStarted(false),
-																fConnected(false),
-																fBreakpointsTimeStamp(-1),
-																fDebuggingEventsTimeStamp(-1),
-																fPendingContexts(false),
-																fSolutionName("") {;}
-
-				WAKDebuggerType_t			fDebuggerType;
-				bool						fStarted;
-				sLONG						fBreakpointsTimeStamp;
-				bool						fConnected;
-				sLONG						fDebuggingEventsTimeStamp;
-				bool						fPendingContexts;
-				XBOX::VString				fSolutionName;
-		};
-
-		XBOX::VError									SendCurrentState(bool inFirstMessage,const XBOX::VString& inSolutionName);
-
-		class VStartMessage : public XBOX::VMessage
-		{
-		public:
-			VStartMessage(VRIAServerSupervisorClient* inClient, IHTTPWebsocketServer* inWS, const XBOX::VString& inSolutionName) :
-				fClient(inClient),
-				fWS(inWS),
-				fSolutionName(inSolutionName) {;}
-		private:
-					void								DoExecute();
-
-			VRIAServerSupervisorClient*					fClient;
-			IHTTPWebsocketServer*						fWS;
-			XBOX::VString								fSolutionName;
-		};
-
-		class VStopMessage : public XBOX::VMessage
-		{
-		public:
-			VStopMessage(VRIAServerSupervisorClient* inClient) : fClient(inClient) {;}
-		private:
-					void								DoExecute();
-			VRIAServerSupervisorClient*					fClient;
-		};
-
-		virtual												~VRIAServerSupervisorClient();
-
-				bool										fStarted;
-				bool										fExitTask;
-				IHTTPWebsocketServer*						fWS;
-				XBOX::VTask*								fTask;
-				VRIAServerState								fServerState;
-				bool										fStudioIsConnected;
-		static	sLONG										InnerTaskProc(XBOX::VTask* inTask);
+				IHTTPWebsocketServer*					fWS;
+				VectorOfFrames							fQueue;				// frames waiting to be written, the oldest first
+				VRIAServerState							fServerState;		// last state sent to the client
+				XBOX::VString							fSolutionName;
+				bool									fStudioIsConnected;
+				bool									fStateDiffs;		// the client accepts state messages which only hold the changed members
+				bool									fBatches;			// the client accepts JSON arrays of bags
+	};
+
+	typedef std::vector< VRIAServerSupervisorClient* > VectorOfClients;
+
+	class VWakeUpMessage : public XBOX::VMessage
+	{
+	private:
+					void								DoExecute() {;}
 	};
 
-			std::set< VRIAServerSupervisorClient* >					fClientSet;
+			void											_StartTask();
+			void											_StopTask();
+			void											_WakeUp();
+			/** @brief	Returns true if some frames are still queued for the clients */
+			bool											_ServeClients( sBYTE *ioBuffer, XBOX::VSize inBufferSize);
+	static	sLONG											_TaskProc( XBOX::VTask* inTask);
+
+			VectorOfClients											fClients;			// clients served by the supervisor task
+			VectorOfClients											fNewClients;		// clients waiting for their first message
+			VectorOfBags											fPendingBags;		// bags logged since the supervisor task last ran, at most K_MAX_PENDING_BAGS
+			bool													fWakeUpPosted;
 			bool													fAcceptClients;
 			XBOX::VCriticalSection									fClientSetLock;
-			XBOX::VCriticalSection									fStudioConnectionLock;
-			sLONG													fNumberOfConnectedStudios;
+			XBOX::VTask												*fTask;
+			sLONG													fNumberOfConnectedStudios;	// only used by the supervisor task
 
 	static	VRIAServerSupervisor*									sRIAServerSupervisor;
 
@@ -27,14 +27,8 @@ VError SetHTTPResponseString( IHTTPResponse* inResponse, const VString& inString
 	if (inResponse == NULL)
 		return VE_INVALID_PARAMETER;
 	
-	StStringConverter<char> buffer( inString, VTC_UTF_8);
-
-	inResponse->GetResponseBody().OpenWriting();
-	inResponse->GetResponseBody().SetSize(0); // YT 06-May-2014 - Clear Body if not empty
-	inResponse->GetResponseBody().PutData( buffer.GetCPointer(), buffer.GetLength());
-	inResponse->GetResponseBody().CloseWriting();
-
-	VError err = inResponse->GetResponseBody().GetLastError();
+	VSize bodySize = 0;
+	VError err = SetHTTPResponseBodyText( inResponse, inString, VTC_UTF_8, bodySize);
 	if (err == VE_OK)
 	{
 		inResponse->SetExpiresHeader( GMT_NOW);
@@ -54,13 +48,40 @@ VError SetHTTPResponseString( IHTTPResponse* inResponse, const VString& inString
 #if HTTP_SERVER_VERBOSE_MODE
 		inResponse->AddResponseHeader( HEADER_X_POWERED_BY, "RIA Server");
 #endif
-		inResponse->SetContentLengthHeader( buffer.GetLength());
+		inResponse->SetContentLengthHeader( bodySize);
 		inResponse->AllowCompression (false);
 	}
 	return err;
 }
 
 
+VError SetHTTPResponseBodyText( IHTTPResponse* inResponse, const VString& inText, CharSet inCharSet, VSize& outSize)
+{
+	outSize = 0;
+
+	if (inResponse == NULL)
+		return VE_INVALID_PARAMETER;
+
+	VPtrStream& body = inResponse->GetResponseBody();
+
+	VError err = body.OpenWriting();
+	if (err == VE_OK)
+	{
+		body.SetSize(0); // YT 06-May-2014 - Clear Body if not empty
+		body.SetCharSet( inCharSet);
+		err = body.PutText( inText);	// the stream converter transcodes by chunks
+		body.CloseWriting();
+
+		if (err == VE_OK)
+			err = body.GetLastError();
+
+		outSize = body.GetDataSize();
+	}
+
+	return err;
+}
+
+
 VError ThrowError( VError inError)
 {
 	VErrorBase *errBase = new VErrorBase( inError, 0);
@@ -230,6 +251,19 @@ bool FolderContentWasChangedSinceDate( const VFolder *inFolder, const VTime& inD
 }
 
 
+uLONG8 ComputeStringHash( const XBOX::VString& inString)
+{
+	uLONG8 hash = 0xcbf29ce484222325ULL;
+	const UniChar *p = inString.GetCPointer();
+	for (const UniChar *end = p + inString.GetLength() ; p != end ; ++p)
+	{
+		hash ^= (uLONG8) *p;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+
 
 void LogBag( const XBOX::VValueBag *inMessage)
 {
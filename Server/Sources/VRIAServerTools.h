@@ -22,6 +22,10 @@ class IHTTPResponse;
 
 XBOX::VError SetHTTPResponseString( IHTTPResponse* inResponse, const XBOX::VString& inString, const XBOX::VString* inContentType = NULL);
 
+/**	@brief	Replaces the response body by the text transcoded into inCharSet. The text is transcoded directly into the body, without intermediate buffer.
+			outSize receives the body size in bytes. The headers are not modified. */
+XBOX::VError SetHTTPResponseBodyText( IHTTPResponse* inResponse, const XBOX::VString& inText, XBOX::CharSet inCharSet, XBOX::VSize& outSize);
+
 XBOX::VError ThrowError( XBOX::VError inError);
 
 /**	@brief	Error formatting function */
@@ -44,6 +48,9 @@ sLONG8 ComputeFolderSize( const XBOX::VFolder *inFolder);
 
 bool FolderContentWasChangedSinceDate( const XBOX::VFolder *inFolder, const XBOX::VTime& inDate);
 
+/**	@brief	Returns a 64 bits FNV-1a hash of the string content. */
+uLONG8 ComputeStringHash( const XBOX::VString& inString);
+
 
 // Logging utilities
 void LogBag( const XBOX::VValueBag *inMessage);
@@ -30,6 +30,37 @@
 USING_TOOLBOX_NAMESPACE
 
 
+const uLONG kPROXY_TEMPLATES_CHECK_DELAY = 1000; // in milliseconds
+const size_t kPROXY_CACHE_MAX_SIZE = 256; // count of cached proxies, the least recently used proxy is dropped first
+
+
+
+/** @brief	Returns true if the If-None-Match header value matches the entity tag, using the weak comparison (RFC 7232). */
+static bool IfNoneMatchHeaderMatches( const VString& inHeaderValue, const VString& inETag)
+{
+	VString eTag( inETag);
+	if (eTag.BeginsWith( CVSTR( "W/"), true))
+		eTag.Remove( 1, 2);
+
+	VectorOfVString eTags;
+	inHeaderValue.GetSubStrings( CHAR_COMMA, eTags, false, true);
+
+	for (VectorOfVString::iterator iter = eTags.begin() ; iter != eTags.end() ; ++iter)
+	{
+		if (iter->EqualToString( CVSTR( "*"), true))
+			return true;
+
+		if (iter->BeginsWith( CVSTR( "W/"), true))
+			iter->Remove( 1, 2);
+
+		if (iter->EqualToString( eTag, true))
+			return true;
+	}
+
+	return false;
+}
+
+
 
 class VProxyRequestHandler : public VHTTPRequestHandler
 {
@@ -39,13 +70,22 @@ public:
 			{
 				fService = inService;
 				fPattern = inPattern;
+
+				// The pattern is compiled once, then an other matcher is compiled only if all matchers are in use
+				fPatternIsValid = true;
+				VRegexMatcher *matcher = _RetainMatcher();
+				fPatternIsValid = (matcher != NULL);
+				_ReleaseMatcher( matcher);
 			}
 
 	virtual ~VProxyRequestHandler()
 			{
+				for (std::vector<VRegexMatcher*>::iterator iter = fMatchers.begin() ; iter != fMatchers.end() ; ++iter)
+					(*iter)->Release();
 			}
 
-	virtual	VError HandleRequest( IHTTPResponse* inResponse)
+protected:
+	virtual	VError _HandleRequest( IHTTPResponse* inResponse)
 			{
 				if (inResponse == NULL)
 					return VE_INVALID_PARAMETER;
@@ -55,14 +95,21 @@ public:
 
 				// First, extract the relative path from the url
 				VString path = inResponse->GetRequest().GetURLPath();
-				VRegexMatcher *matcher = VRegexMatcher::Create( fPattern, &err);
-				if ((matcher != NULL) && (err == VE_OK))
+
+				// The matcher keeps the groups of the last match, so each request uses its own matcher
+				VRegexMatcher *matcher = _RetainMatcher();
+				if (matcher != NULL)
 				{
 					bool match = matcher->Find( path, 1, false, &err);
 					if (match && (err == VE_OK))
 					{
 						// Remove the pattern from the path
 						path.Remove( matcher->GetGroupStart(0), matcher->GetGroupLength(0));
+					}
+					_ReleaseMatcher( matcher);
+
+					if (match && (err == VE_OK))
+					{
 
 						// Check whether a namespace is specified
 						VString lNamespaceKey( L"namespace=");
@@ -73,17 +120,28 @@ public:
 							lNamespace.Clear();
 
 						// Now, we have a relative  module path
-						VString proxy;
-						err = fService->GetProxy( proxy, path, lNamespace, &inResponse->GetRequest(), inResponse);
+						VString proxy, eTag;
+						err = fService->GetProxy( proxy, eTag, path, lNamespace, &inResponse->GetRequest(), inResponse);
 						if (err == VE_OK)
 						{
-							VString contentType( L"application/javascript");
-							err = SetHTTPResponseString( inResponse, proxy, &contentType);
+							// The client already owns the proxy
+							VString ifNoneMatch;
+							if (!eTag.IsEmpty() && inResponse->GetRequest().GetHTTPHeaders().GetHeaderValue( HEADER_IF_NONE_MATCH, ifNoneMatch) && IfNoneMatchHeaderMatches( ifNoneMatch, eTag))
+							{
+								inResponse->SetResponseStatusCode( HTTP_NOT_MODIFIED);
+								inResponse->AddResponseHeader( HEADER_ETAG, eTag);
+							}
+							else
+							{
+								VString contentType( L"application/javascript");
+								err = SetHTTPResponseString( inResponse, proxy, &contentType);
+								if ((err == VE_OK) && !eTag.IsEmpty())
+									inResponse->AddResponseHeader( HEADER_ETAG, eTag);
+							}
 							done = true;
 						}
 					}
 				}
-				ReleaseRefCountable( &matcher);
 
 				if (!done)
 					err = inResponse->ReplyWithStatusCode( HTTP_NOT_FOUND);
@@ -92,15 +150,51 @@ public:
 			}
 
 private:
-			VRPCService			*fService;
-			VString				fPattern;
+			VRegexMatcher* _RetainMatcher()
+			{
+				VRegexMatcher *matcher = NULL;
+				if (fMatchersMutex.Lock())
+				{
+					if (!fMatchers.empty())
+					{
+						matcher = fMatchers.back();
+						fMatchers.pop_back();
+					}
+					fMatchersMutex.Unlock();
+				}
+
+				if ((matcher == NULL) && fPatternIsValid)
+				{
+					VError err = VE_OK;
+					matcher = VRegexMatcher::Create( fPattern, &err);
+					if (err != VE_OK)
+						ReleaseRefCountable( &matcher);
+				}
+				return matcher;
+			}
+
+			void _ReleaseMatcher( VRegexMatcher* inMatcher)
+			{
+				if ((inMatcher != NULL) && fMatchersMutex.Lock())
+				{
+					fMatchers.push_back( inMatcher);
+					fMatchersMutex.Unlock();
+				}
+			}
+
+			VRPCService						*fService;
+			VString							fPattern;
+			bool							fPatternIsValid;
+			std::vector<VRegexMatcher*>		fMatchers;		// idle matchers, there are at most as many matchers as concurrent requests
+			VCriticalSection				fMatchersMutex;
 };
 
 
 
 VRPCService::VRPCService( VRIAServerProject* inApplication, IHTTPServerProject *inHTTPServerProject)
 : fApplication(inApplication), fDesignProject(NULL), fProxyRequestHandler(NULL), fMethodsRequestHandler(NULL),
-fPublishInClientGlobalNamespace(false), fHTTPServerProject(inHTTPServerProject), fPatternForMethods( L"/rpc/"), fPatternForProxy( L"^/rpc-proxy/")
+fPublishInClientGlobalNamespace(false), fHTTPServerProject(inHTTPServerProject), fPatternForMethods( L"/rpc/"), fPatternForProxy( L"^/rpc-proxy/"),
+fProxyTemplatesStamp(0), fProxyTemplatesCheckTime(0)
 {
 	if (fApplication != NULL)
 	{
@@ -150,7 +244,17 @@ void VRPCService::GetPatterns( XBOX::VString& outPatternForMethods, XBOX::VStrin
 
 void VRPCService::SetPublishInClientGlobalNamespace( bool inPublishInClientGlobalNamespace)
 {
-	fPublishInClientGlobalNamespace = inPublishInClientGlobalNamespace;
+	if (fProxyCacheMutex.Lock())
+	{
+		if (fPublishInClientGlobalNamespace != inPublishInClientGlobalNamespace)
+		{
+			fProxyCache.clear();
+			fProxyCacheLRU.clear();
+		}
+
+		fPublishInClientGlobalNamespace = inPublishInClientGlobalNamespace;
+		fProxyCacheMutex.Unlock();
+	}
 }
 
 
@@ -268,14 +372,59 @@ VProxyRequestHandler* VRPCService::_CreateRequestHandlerForProxy()
 }
 
 
-XBOX::VError VRPCService::GetProxy( XBOX::VString& outProxy, const XBOX::VString& inModulePath, const XBOX::VString& inNamespace, const IHTTPRequest* inRequest, IHTTPResponse* inResponse)
+XBOX::VError VRPCService::GetProxy( XBOX::VString& outProxy, XBOX::VString& outETag, const XBOX::VString& inModulePath, const XBOX::VString& inNamespace, const IHTTPRequest* inRequest, IHTTPResponse* inResponse)
 {
 	VError err = VE_OK;
 
 	outProxy.Clear();
+	outETag.Clear();
 
 	if (fApplication != NULL)
 	{
+		VString key( inModulePath);
+		key.AppendUniChar( CHAR_LINE_FEED);
+		key.AppendString( inNamespace);
+
+		// The catalog stamp is read before the catalog is retained: if the catalog changes meanwhile, the proxy will be generated again
+		uLONG catalogStamp = fApplication->GetRPCCatalogStamp();
+		uLONG templatesStamp = 0;
+		VString bodyTemplate, methodTemplate;
+		bool found = false;
+
+		if (fProxyTemplatesMutex.Lock())
+		{
+			err = _UpdateProxyTemplates();
+			templatesStamp = fProxyTemplatesStamp;
+			fProxyTemplatesMutex.Unlock();
+		}
+
+		if (err != VE_OK)
+			return err;
+
+		if (fProxyCacheMutex.Lock())
+		{
+			MapOfProxyCacheEntry::iterator iter = fProxyCache.find( key);
+			if ((iter != fProxyCache.end()) && (iter->second.fCatalogStamp == catalogStamp) && (iter->second.fTemplatesStamp == templatesStamp))
+			{
+				outProxy = iter->second.fProxy;
+				outETag = iter->second.fETag;
+				fProxyCacheLRU.splice( fProxyCacheLRU.begin(), fProxyCacheLRU, iter->second.fLRUPosition);
+				found = true;
+			}
+			fProxyCacheMutex.Unlock();
+		}
+
+		if (found)
+			return err;
+
+		if (fProxyTemplatesMutex.Lock())
+		{
+			bodyTemplate = fProxyBodyTemplate;
+			methodTemplate = fProxyMethodTemplate;
+			templatesStamp = fProxyTemplatesStamp;
+			fProxyTemplatesMutex.Unlock();
+		}
+
 		VRIAContext *riaContext = fApplication->RetainNewContext( err);
 		if (err == VE_OK)
 		{
@@ -290,69 +439,55 @@ XBOX::VError VRPCService::GetProxy( XBOX::VString& outProxy, const XBOX::VString
 					if (err == VE_OK)
 					{
 						// Build the proxy
-						VFile *bodyFile = NULL, *templateFile = NULL;
-						VFilePath path;
-
-						VRIAServerApplication::Get()->GetWAFrameworkFolderPath( path);
-						path.ToSubFolder( L"Core").ToSubFolder( L"Runtime").ToSubFolder( L"rpcService");
-						path.SetFileName( L"proxy-body.js", true);
-
-						bodyFile = new VFile( path);
-						if (bodyFile == NULL)
-							err = vThrowError( VE_MEMORY_FULL);
-						
-						if (err == VE_OK)
+						VValueBag bodyBag;
+						bodyBag.SetString( L"rpc-pattern", fPatternForMethods);
+						bodyBag.SetString( L"publishInGlobalNamespace", (fPublishInClientGlobalNamespace) ? L"true" : L"false");
+						outProxy = bodyTemplate;
+						outProxy.Format( &bodyBag);
+
+						VValueBag methodBag;
+						methodBag.SetString( L"namespace", inNamespace);
+						methodBag.SetString( L"modulePath", inModulePath);
+						for (MapOfRPCSchema::const_iterator iter = schemas.begin() ; iter != schemas.end() ; ++iter)
 						{
-							path.SetFileName( L"proxy-template.js", true);
-							templateFile = new VFile( path);
-							if (templateFile == NULL)
-								err = vThrowError( VE_MEMORY_FULL);
+							methodBag.SetString( L"function-name", iter->first.GetMethodName());
+							VString proxy( methodTemplate);
+							proxy.Format( &methodBag);
+							outProxy.AppendString( proxy);
 						}
-						
-						if (err == VE_OK && bodyFile->Exists() && templateFile->Exists())
+
+						// Strong entity tag computed from the proxy content
+						outETag.AppendUniChar( CHAR_QUOTATION_MARK);
+						outETag.AppendULong8( ComputeStringHash( outProxy));
+						outETag.AppendUniChar( CHAR_QUOTATION_MARK);
+
+						// Only the proxies of the published modules are cached, and the cache is bounded because the namespace is given by the client
+						if (!schemas.empty() && fProxyCacheMutex.Lock())
 						{
-							VString templateString;
-							VFileStream bodyStream( bodyFile);
-							VFileStream templateStream( templateFile);
-							
-							err = bodyStream.OpenReading();
-							if (err == VE_OK)
-								templateStream.OpenReading();
-							if (err == VE_OK)
-								err = bodyStream.GetText( outProxy);
-							if (err == VE_OK)
-							{
-								VValueBag bag;
-								bag.SetString( L"rpc-pattern", fPatternForMethods);
-								bag.SetString( L"publishInGlobalNamespace", (fPublishInClientGlobalNamespace) ? L"true" : L"false");
-								outProxy.Format( &bag);
-							}
-							if (err == VE_OK)
-								err = templateStream.GetText( templateString);
-							if (err == VE_OK)
+							MapOfProxyCacheEntry::iterator iter = fProxyCache.find( key);
+							if (iter == fProxyCache.end())
 							{
-								for (MapOfRPCSchema::const_iterator iter = schemas.begin() ; iter != schemas.end() ; ++iter)
+								if (fProxyCache.size() >= kPROXY_CACHE_MAX_SIZE)
 								{
-									VValueBag bag;
-									bag.SetString( L"function-name", iter->first.GetMethodName());
-									bag.SetString( L"namespace", inNamespace);
-									bag.SetString( L"modulePath", inModulePath);
-									VString proxy( templateString);
-									proxy.Format( &bag);
-									outProxy.AppendString( proxy);
+									fProxyCache.erase( fProxyCacheLRU.back());
+									fProxyCacheLRU.pop_back();
 								}
+								fProxyCacheLRU.push_front( key);
+								iter = fProxyCache.insert( MapOfProxyCacheEntry::value_type( key, ProxyCacheEntry())).first;
+							}
+							else
+							{
+								fProxyCacheLRU.splice( fProxyCacheLRU.begin(), fProxyCacheLRU, iter->second.fLRUPosition);
 							}
 
-							bodyStream.CloseReading();
-							templateStream.CloseReading();
+							ProxyCacheEntry& entry = iter->second;
+							entry.fProxy = outProxy;
+							entry.fETag = outETag;
+							entry.fCatalogStamp = catalogStamp;
+							entry.fTemplatesStamp = templatesStamp;
+							entry.fLRUPosition = fProxyCacheLRU.begin();
+							fProxyCacheMutex.Unlock();
 						}
-						else
-						{
-							err = vThrowError( VE_FILE_NOT_FOUND);
-						}
-
-						QuickReleaseRefCountable( bodyFile);
-						QuickReleaseRefCountable( templateFile);
 					}
 				}
 				else
@@ -360,9 +495,69 @@ XBOX::VError VRPCService::GetProxy( XBOX::VString& outProxy, const XBOX::VString
 					err = vThrowError( VE_RIA_RPC_CATALOG_NOT_FOUND);
 				}
 			}
+			ReleaseRefCountable( &catalog);
 		}
 		ReleaseRefCountable( &riaContext);
 	}
 
 	return err;	
 }
+
+
+XBOX::VError VRPCService::_UpdateProxyTemplates()
+{
+	VError err = VE_OK;
+
+	// Check for templates changes at most one time per second
+	uLONG currentTime = VSystem::GetCurrentTime();
+	if ((fProxyTemplatesStamp != 0) && ((fProxyTemplatesCheckTime + kPROXY_TEMPLATES_CHECK_DELAY) >= currentTime))
+		return VE_OK;
+
+	fProxyTemplatesCheckTime = currentTime;
+
+	VFilePath path;
+	VRIAServerApplication::Get()->GetWAFrameworkFolderPath( path);
+	path.ToSubFolder( L"Core").ToSubFolder( L"Runtime").ToSubFolder( L"rpcService");
+	path.SetFileName( L"proxy-body.js", true);
+	VFile bodyFile( path);
+
+	path.SetFileName( L"proxy-template.js", true);
+	VFile templateFile( path);
+
+	VTime bodyTime, templateTime;
+	if (bodyFile.Exists() && templateFile.Exists() && (bodyFile.GetTimeAttributes( &bodyTime) == VE_OK) && (templateFile.GetTimeAttributes( &templateTime) == VE_OK))
+	{
+		if ((fProxyTemplatesStamp == 0) || (bodyTime != fProxyBodyTemplateTime) || (templateTime != fProxyMethodTemplateTime))
+		{
+			VString bodyString, templateString;
+			VFileStream bodyStream( &bodyFile);
+			VFileStream templateStream( &templateFile);
+
+			err = bodyStream.OpenReading();
+			if (err == VE_OK)
+				err = templateStream.OpenReading();
+			if (err == VE_OK)
+				err = bodyStream.GetText( bodyString);
+			if (err == VE_OK)
+				err = templateStream.GetText( templateString);
+
+			bodyStream.CloseReading();
+			templateStream.CloseReading();
+
+			if (err == VE_OK)
+			{
+				fProxyBodyTemplate = bodyString;
+				fProxyMethodTemplate = templateString;
+				fProxyBodyTemplateTime = bodyTime;
+				fProxyMethodTemplateTime = templateTime;
+				++fProxyTemplatesStamp;
+			}
+		}
+	}
+	else
+	{
+		err = vThrowError( VE_FILE_NOT_FOUND);
+	}
+
+	return err;
+}
@@ -50,10 +50,25 @@ public:
 
 			bool							IsEnabled() const;
 		
-			/** @brief	Returns the rpc proxy file according to the rpc module path. */
-			XBOX::VError					GetProxy( XBOX::VString& outProxy, const XBOX::VString& inModulePath, const XBOX::VString& inNamespace, const IHTTPRequest* inRequest, IHTTPResponse* inResponse);
+			/** @brief	Returns the rpc proxy file according to the rpc module path.
+						The generated proxy is cached until the rpc catalog or the proxy templates change. outETag is a strong entity tag of the proxy. */
+			XBOX::VError					GetProxy( XBOX::VString& outProxy, XBOX::VString& outETag, const XBOX::VString& inModulePath, const XBOX::VString& inNamespace, const IHTTPRequest* inRequest, IHTTPResponse* inResponse);
 
 private:
+	typedef struct
+	{
+		XBOX::VString	fProxy;
+		XBOX::VString	fETag;
+		uLONG			fCatalogStamp;
+		uLONG			fTemplatesStamp;
+		std::list<XBOX::VString>::iterator	fLRUPosition;
+	} ProxyCacheEntry;
+
+	typedef XBOX::unordered_map_VString< ProxyCacheEntry >		MapOfProxyCacheEntry;
+
+			/** @brief	Reload the proxy templates if they have been modified. The proxy templates mutex must be locked. */
+			XBOX::VError					_UpdateProxyTemplates();
+
 			VJSRequestHandler*				_CreateRequestHandlerForMethods();
 			VProxyRequestHandler*			_CreateRequestHandlerForProxy();
 
@@ -68,6 +83,20 @@ private:
 			VProxyRequestHandler			*fProxyRequestHandler;
 			VJSRequestHandler				*fMethodsRequestHandler;
 
+			// Proxy cache: the key is the module path and the namespace
+			MapOfProxyCacheEntry			fProxyCache;
+			std::list<XBOX::VString>		fProxyCacheLRU;			// keys of the cached proxies, the most recently used first
+	mutable	XBOX::VCriticalSection			fProxyCacheMutex;
+
+			// Proxy templates
+			XBOX::VString					fProxyBodyTemplate;
+			XBOX::VString					fProxyMethodTemplate;
+			XBOX::VTime						fProxyBodyTemplateTime;
+			XBOX::VTime						fProxyMethodTemplateTime;
+			uLONG							fProxyTemplatesStamp;
+			uLONG							fProxyTemplatesCheckTime;
+	mutable	XBOX::VCriticalSection			fProxyTemplatesMutex;
+
 	mutable	XBOX::VCriticalSection			fMutex;
 };
 
@@ -20,6 +20,7 @@
 #include "VRIAJSDebuggerSettings.h"
 #include "VProject.h"
 #include "VRIAServerApplication.h"
+#include "VRIAServerTools.h"
 
 const XBOX::VString			K_LF_STR("\n");
 const XBOX::VString			K_CR_STR("\r");
@@ -41,13 +42,24 @@ sLONG											VRemoteDebuggerBreakpointsManager::sTimeStamp = 1;
 XBOX::VCriticalSection							VRemoteDebuggerBreakpointsManager::sTimeStampLock;
 
 
-VRemoteDebuggerBreakpointsManager::VRemoteDebuggerBreakpointsManager(const XBOX::VString& inSourcesRoot) : fSourcesRoot(inSourcesRoot), fSolution(NULL)
+VRemoteDebuggerBreakpointsManager::VRemoteDebuggerBreakpointsManager(const XBOX::VString& inSourcesRoot) : fSourcesRoot(inSourcesRoot), fSolution(NULL), fSnapshot(NULL), fRetiredCount(0), fEpoch(0)
 {
+	for (sLONG idx = 0; idx < kREADER_SHARD_COUNT; idx++)
+	{
+		fReaders[0][idx].fCount = 0;
+		fReaders[1][idx].fCount = 0;
+	}
 }
 
 VRemoteDebuggerBreakpointsManager::~VRemoteDebuggerBreakpointsManager()
 {
 	fAllBreakPoints.clear();
+
+	delete fSnapshot;
+	for (std::vector< sRetiredSnapshot >::iterator itSnapshot = fRetiredSnapshots.begin(); itSnapshot != fRetiredSnapshots.end(); itSnapshot++)
+	{
+		delete (*itSnapshot).fSnapshot;
+	}
 }
 
 void VRemoteDebuggerBreakpointsManager::GetGlobalTimeStamp(sLONG& outTimeStamp)
@@ -143,61 +155,161 @@ static	OpaqueDebuggerContext	GH_DEBUG_CTX = (OpaqueDebuggerContext)-1;
 
 bool VRemoteDebuggerBreakpointsManager::HasBreakpoint(OpaqueDebuggerContext inContext,intptr_t inSourceId, unsigned inLineNumber)
 {
-	bool	l_res = false;
+	// called on every executed line while debugging: the snapshot is read without lock.
+	// The reader registers with the current epoch: the snapshots replaced during this epoch are not deleted until its readers are gone.
+	bool		l_res = false;
+	sLONG		shard = ((uLONG) VTask::GetCurrentID()) % kREADER_SHARD_COUNT;
+	sLONG*		readerCount = NULL;
 
-	fLock.Lock();
-#if defined(__GH_DEBUG__)
-	if (inSourceId == GH_DEBUG_SRCID)
+	do
 	{
-		if (inContext != GH_DEBUG_CTX)
+		sLONG	epoch = VInterlocked::CompareExchange( &fEpoch, 0, 0);
+
+		readerCount = &fReaders[epoch & 1][shard].fCount;
+		VInterlocked::Increment( readerCount);
+
+		// the epoch may have been advanced before the registration was visible
+		if (VInterlocked::CompareExchange( &fEpoch, 0, 0) == epoch)
 		{
-			int a=1;
+			break;
 		}
-		else
+		VInterlocked::Decrement( readerCount);
+	} while (true);
+
+	const VBreakpointsSnapshot*		snapshot = (const VBreakpointsSnapshot*) VInterlocked::CompareExchangePtr( (void**) &fSnapshot, NULL, NULL);
+	if (snapshot != NULL)
+	{
+		std::unordered_map< VBreakpointsSnapshot::SourceKey, size_t, VBreakpointsSnapshot::SourceKeyHash >::const_iterator	itSource =
+									snapshot->fSources.find( VBreakpointsSnapshot::SourceKey( inContext, inSourceId));
+
+		if (itSource != snapshot->fSources.end())
 		{
-			int b=1;
+			const std::vector< uLONG >&		bitmap = snapshot->fBitmaps[(*itSource).second];
+			size_t							word = inLineNumber / 32;
+
+			l_res = (word < bitmap.size()) && ((bitmap[word] & (1UL << (inLineNumber % 32))) != 0);
 		}
 	}
-#endif
 
-	std::map< OpaqueDebuggerContext, std::map< uintptr_t, SourceDesc > >::const_iterator	itCtx = fCtxs.find(inContext);
-
-	if (itCtx != fCtxs.end())
+	// the last reader retries the reclamation so that the retired snapshots do not pile up while the contexts are busy
+	if ( (VInterlocked::Decrement( readerCount) == 0) && (VInterlocked::CompareExchange( &fRetiredCount, 0, 0) != 0) )
 	{
-		std::map< uintptr_t, SourceDesc >::const_iterator	itSource = (*itCtx).second.find(inSourceId);
+		if (fLock.TryToLock())
+		{
+			_ReclaimSnapshots();
+			fLock.Unlock();
+		}
+	}
 
-		if (itSource != (*itCtx).second.end())
+	return l_res;
+}
+
+#define K_BREAKPOINTS_MAX_LINE	(1024*1024)
+
+void VRemoteDebuggerBreakpointsManager::_PublishSnapshot()
+{
+	VBreakpointsSnapshot*				snapshot = NULL;
+	std::map< XBOX::VString, size_t >	bitmapsIndexes;
+
+	std::map< OpaqueDebuggerContext, std::map< uintptr_t, SourceDesc > >::const_iterator	itCtx = fCtxs.begin();
+	while (itCtx != fCtxs.end())
+	{
+		std::map< uintptr_t, SourceDesc >::const_iterator	itSource = (*itCtx).second.begin();
+		while (itSource != (*itCtx).second.end())
 		{
+			std::map< XBOX::VString, std::set< unsigned > >::const_iterator	itFile = fAllBreakPoints.find((*itSource).second.fUrl);
 
-			std::map< XBOX::VString, std::set< unsigned > >::iterator	itFile =
-												fAllBreakPoints.find((*itSource).second.fUrl);
-		
-			if (testAssert(itFile != fAllBreakPoints.end()))
+			if ( (itFile != fAllBreakPoints.end()) && !(*itFile).second.empty() )
 			{
-				/*std::set< unsigned >::iterator		itLine = (*itFile).second.find(inLineNumber+1);
-				if ((*itFile).second.fUrl.Find("test.js"))
+				if (snapshot == NULL)
+				{
+					snapshot = new VBreakpointsSnapshot();
+				}
+
+				// the sources which share an url share its bitmap
+				std::map< XBOX::VString, size_t >::iterator		itIndex = bitmapsIndexes.find((*itFile).first);
+				if (itIndex == bitmapsIndexes.end())
 				{
-					DebugMsg("\nWAKDebuggerBreakpoints::HasBreakpoint url='%S' line=%d\n",&(*itFile).second.fUrl,inLineNumber+1);
-					std::set< unsigned >::iterator	l_tmp_it = (*itFile).second.fBreakpoints.begin();
-					while( l_tmp_it != (*itFile).second.fBreakpoints.end() )
+					// the lines beyond K_BREAKPOINTS_MAX_LINE (bogus line numbers) are ignored to bound the bitmap size
+					unsigned				lastLine = *(*itFile).second.rbegin();
+					std::vector< uLONG >	bitmap( ((lastLine < K_BREAKPOINTS_MAX_LINE) ? lastLine : K_BREAKPOINTS_MAX_LINE) / 32 + 1, 0);
+					for (std::set< unsigned >::const_iterator itLine = (*itFile).second.begin(); itLine != (*itFile).second.end() && *itLine <= K_BREAKPOINTS_MAX_LINE; itLine++)
 					{
-						DebugMsg("\n   ... WAKDebuggerBreakpoints::HasBreakpoint    LINE->%d\n", (*l_tmp_it));
-						l_tmp_it++;
+						bitmap[*itLine / 32] |= (1UL << (*itLine % 32));
 					}
+					snapshot->fBitmaps.push_back( bitmap);
+					itIndex = bitmapsIndexes.insert( std::pair< XBOX::VString, size_t >( (*itFile).first, snapshot->fBitmaps.size() - 1)).first;
 				}
-				l_res = (itLine != (*itFile).second.fBreakpoints.end());*/
-				l_res = ((*itFile).second.count(inLineNumber) > 0);
+				snapshot->fSources[VBreakpointsSnapshot::SourceKey( (*itCtx).first, (*itSource).first)] = (*itIndex).second;
 			}
+			itSource++;
 		}
+		itCtx++;
 	}
-	if (l_res)
+
+	VBreakpointsSnapshot*	previous = (VBreakpointsSnapshot*) VInterlocked::ExchangePtr( (void**) &fSnapshot, snapshot);
+	if (previous != NULL)
 	{
-			//l_tmp = UString("has brkpt");
-		//TRACE(&l_tmp);
-		//int a=1;
+		sRetiredSnapshot	retired = { previous, fEpoch };
+		fRetiredSnapshots.push_back(retired);
+		VInterlocked::Exchange( &fRetiredCount, (sLONG) fRetiredSnapshots.size());
 	}
-	fLock.Unlock();
-	return l_res;
+	_ReclaimSnapshots();
+}
+
+bool VRemoteDebuggerBreakpointsManager::_HasNoReader( sLONG inParity) const
+{
+	for (sLONG idx = 0; idx < kREADER_SHARD_COUNT; idx++)
+	{
+		if (VInterlocked::CompareExchange( const_cast<sLONG*>( &fReaders[inParity][idx].fCount), 0, 0) != 0)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void VRemoteDebuggerBreakpointsManager::_ReclaimSnapshots()
+{
+	// A snapshot retired during epoch E may be used by the readers of epoch E and before. The epoch is advanced from E to E+1
+	// only once the readers of E-1 are gone (they share the parity of E+1), so at epoch E+1 only the readers of E may still
+	// use it: it is deleted as soon as no reader is registered with the parity of E.
+	// The readers of the current epoch do not block the deletion of the snapshots retired before it.
+	if (fRetiredSnapshots.empty())
+	{
+		return;
+	}
+
+	sLONG	epoch = fEpoch;
+	if ( (fRetiredSnapshots.back().fEpoch == epoch) && _HasNoReader( (epoch + 1) & 1) )
+	{
+		// the new snapshot has been published before the epoch is advanced: the readers of the new epoch cannot get a retired snapshot
+		epoch++;
+		VInterlocked::Exchange( &fEpoch, epoch);
+	}
+
+	bool	previousEpochDone = _HasNoReader( (epoch - 1) & 1);
+
+	std::vector< sRetiredSnapshot >::iterator	itSnapshot = fRetiredSnapshots.begin();
+	while (itSnapshot != fRetiredSnapshots.end())
+	{
+		if ( ((*itSnapshot).fEpoch < epoch - 1) || (((*itSnapshot).fEpoch == epoch - 1) && previousEpochDone) )
+		{
+			delete (*itSnapshot).fSnapshot;
+			itSnapshot = fRetiredSnapshots.erase(itSnapshot);
+		}
+		else
+		{
+			itSnapshot++;
+		}
+	}
+	VInterlocked::Exchange( &fRetiredCount, (sLONG) fRetiredSnapshots.size());
+}
+
+bool VRemoteDebuggerBreakpointsManager::_HasBreakpoints( const XBOX::VString& inUrl) const
+{
+	std::map< XBOX::VString, std::set< unsigned > >::const_iterator	itFile = fAllBreakPoints.find(inUrl);
+	return (itFile != fAllBreakPoints.end()) && !(*itFile).second.empty();
 }
 
 #define K_BREAKPOINTS_FILENAME	CVSTR("breakpoints.json")
@@ -413,6 +525,7 @@ bool VRemoteDebuggerBreakpointsManager::AddBreakPoint( OpaqueDebuggerContext inC
 				{
 					(*itFile).second.insert(inLineNumber);
 					IncrementGlobalTimeStamp();
+					_PublishSnapshot();
 					result = true;
 				}
 			}
@@ -441,6 +554,7 @@ bool VRemoteDebuggerBreakpointsManager::AddBreakPoint( const XBOX::VString& inUr
 				fAllBreakPoints.insert( std::pair< XBOX::VString, std::set< unsigned > >(inUrl, tmpLines) );
 		xbox_assert(l_new.second);
 		IncrementGlobalTimeStamp();
+		_PublishSnapshot();
 	}
 	else
 	{
@@ -448,6 +562,7 @@ bool VRemoteDebuggerBreakpointsManager::AddBreakPoint( const XBOX::VString& inUr
 		{
 			(*itFile).second.insert(inLineNumber);
 			IncrementGlobalTimeStamp();
+			_PublishSnapshot();
 		}
 	}
 
@@ -457,8 +572,9 @@ bool VRemoteDebuggerBreakpointsManager::AddBreakPoint( const XBOX::VString& inUr
 
 void VRemoteDebuggerBreakpointsManager::GetSourceFromUrl(OpaqueDebuggerContext inContext, const XBOX::VString& inSourceUrl,XBOX::VectorOfVString& outSourceData)
 {
-	const VString	K_EMPTY_DATA("No source found");
-	bool			isFound = false;
+	const VString			K_EMPTY_DATA("No source found");
+	bool					isFound = false;
+	VRefPtr< VSourceText >	sourceText;
 
 	outSourceData.clear();
 	
@@ -473,7 +589,7 @@ void VRemoteDebuggerBreakpointsManager::GetSourceFromUrl(OpaqueDebuggerContext i
 		while (itSource != (*itCtxs).second.end())
 		{
 			VStringConvertBuffer bufferUrl((*itSource).second.fUrl, VTC_UTF_8);
-			VStringConvertBuffer bufferSrc((*itSource).second.fData[0], VTC_UTF_8);
+			VStringConvertBuffer bufferSrc((*itSource).second.fText->GetLines()[0], VTC_UTF_8);
 			DebugMsg(" .srcId=%lld URL='%s' %s\n", (unsigned long long)((*itSource).first), bufferUrl.GetCPointer(), bufferSrc.GetCPointer());
 			itSource++;
 		}
@@ -490,15 +606,20 @@ void VRemoteDebuggerBreakpointsManager::GetSourceFromUrl(OpaqueDebuggerContext i
 		{
 			if ( (*itSource).second.fUrl == inSourceUrl )
 			{
-				outSourceData = (*itSource).second.fData;
+				sourceText = (*itSource).second.fText;
 				isFound = true;
 				break;
 			}
 			itSource++;
 		}
 	}
-	
-	if (!isFound)
+	fLock.Unlock();
+
+	if (isFound)
+	{
+		outSourceData = sourceText->GetLines();
+	}
+	else
 	{
 		XBOX::VFilePath		filePath;
 
@@ -539,9 +660,6 @@ void VRemoteDebuggerBreakpointsManager::GetSourceFromUrl(OpaqueDebuggerContext i
 			}
 		}
 	}
-
-	fLock.Unlock();
-
 }
 #if USE_V8_ENGINE
 bool VRemoteDebuggerBreakpointsManager::GetRelativePosixPath(const XBOX::VString& inUrl, XBOX::VString& outRelativePosixPath)
@@ -568,11 +686,22 @@ bool VRemoteDebuggerBreakpointsManager::GetRelativePosixPath(const XBOX::VString
 #endif
 bool VRemoteDebuggerBreakpointsManager::GetData(OpaqueDebuggerContext inContext,intptr_t inSourceId, XBOX::VString& outSourceUrl, XBOX::VectorOfVString& outSourceData)
 {
-	const VString	K_EMPTY_DATA("No source found");
-	bool			res = false;
-
 	outSourceData.clear();
-	
+
+	const VSourceText*	sourceText = RetainSourceText( inContext, inSourceId, outSourceUrl);
+	if (sourceText != NULL)
+	{
+		// the debugger interface fills a vector: the shared lines are copied outside of the lock
+		outSourceData = sourceText->GetLines();
+		sourceText->Release();
+	}
+	return (sourceText != NULL);
+}
+
+const VRemoteDebuggerBreakpointsManager::VSourceText* VRemoteDebuggerBreakpointsManager::RetainSourceText(OpaqueDebuggerContext inContext,intptr_t inSourceId, XBOX::VString& outSourceUrl)
+{
+	const VSourceText*	sourceText = NULL;
+
 	fLock.Lock();
 
 	std::map< OpaqueDebuggerContext, std::map< uintptr_t, SourceDesc > >::const_iterator	itCtx = fCtxs.find(inContext);
@@ -588,14 +717,37 @@ bool VRemoteDebuggerBreakpointsManager::GetData(OpaqueDebuggerContext inContext,
 			if ( itFile != fAllBreakPoints.end() )
 			{
 				outSourceUrl = (*itSource).second.fUrl;
-				outSourceData = (*itSource).second.fData;
-				res = true;
+				sourceText = RetainRefCountable( (*itSource).second.fText.Get());
 			}
 		}
 	}
 		
 	fLock.Unlock();
-	return res;
+	return sourceText;
+}
+
+VRemoteDebuggerBreakpointsManager::VSourceText* VRemoteDebuggerBreakpointsManager::_RetainSourceText( const SourceTextKey& inKey, const XBOX::VString& inSource) const
+{
+	std::pair< MapOfSourceTexts::const_iterator, MapOfSourceTexts::const_iterator >	range = fSourceTexts.equal_range( inKey);
+	for (MapOfSourceTexts::const_iterator itText = range.first ; itText != range.second ; ++itText)
+	{
+		if ((*itText).second->GetSource().EqualToStringRaw( inSource))
+			return RetainRefCountable( (*itText).second.Get());
+	}
+	return NULL;
+}
+
+void VRemoteDebuggerBreakpointsManager::_PurgeSourceTexts()
+{
+	MapOfSourceTexts::iterator	itText = fSourceTexts.begin();
+	while (itText != fSourceTexts.end())
+	{
+		// only referenced by the store
+		if ((*itText).second->GetRefCount() == 1)
+			fSourceTexts.erase( itText++);
+		else
+			++itText;
+	}
 }
 
 
@@ -757,26 +909,49 @@ void VRemoteDebuggerBreakpointsManager::Set(OpaqueDebuggerContext inContext,cons
 #endif
 
 	sourceCodeStr.ConvertCarriageReturns(eCRM_NATIVE);
-	if (!sourceCodeStr.GetSubStrings(K_DEFAULT_LINE_SEPARATOR,sourceCode,true))
+
+	// the same source is loaded by every context of the pool: split and escape it only once
+	SourceTextKey	textKey( ComputeStringHash(sourceCodeStr), sourceCodeStr.GetLength());
+
+	VRefPtr< VSourceText >	sourceText;
+	fLock.Lock();
+	sourceText.Adopt( _RetainSourceText( textKey, sourceCodeStr));
+	fLock.Unlock();
+
+	if (sourceText.IsNull())
 	{
-		if (!sourceCodeStr.GetSubStrings(K_ALTERNATIVE_LINE_SEPARATOR,sourceCode,true))
+		if (!sourceCodeStr.GetSubStrings(K_DEFAULT_LINE_SEPARATOR,sourceCode,true))
 		{
-			sourceCode = VectorOfVString(1,sourceCodeStr);
-			//sourceCode = VectorOfVString(1,VString("No line separator detected in source CODE"));
+			if (!sourceCodeStr.GetSubStrings(K_ALTERNATIVE_LINE_SEPARATOR,sourceCode,true))
+			{
+				sourceCode = VectorOfVString(1,sourceCodeStr);
+				//sourceCode = VectorOfVString(1,VString("No line separator detected in source CODE"));
+			}
 		}
-	}
-	for(VectorOfVString::iterator iter = sourceCode.begin(); (iter != sourceCode.end()); )
-	{
-		tmpStr = *iter;
-		if (tmpStr.GetJSONString(*iter) != VE_OK)
+		for(VectorOfVString::iterator iter = sourceCode.begin(); (iter != sourceCode.end()); )
 		{
-			xbox_assert(false);
+			tmpStr = *iter;
+			if (tmpStr.GetJSONString(*iter) != VE_OK)
+			{
+				xbox_assert(false);
+			}
+			++iter;
 		}
-		++iter;
 	}
 
 	fLock.Lock();
 
+	if (sourceText.IsNull())
+	{
+		// another context may have stored the same text in the meantime
+		sourceText.Adopt( _RetainSourceText( textKey, sourceCodeStr));
+		if (sourceText.IsNull())
+		{
+			sourceText.Adopt( new VSourceText( sourceCodeStr, sourceCode));
+			fSourceTexts.insert( MapOfSourceTexts::value_type( textKey, sourceText));
+		}
+	}
+
 	std::map< OpaqueDebuggerContext, std::map< uintptr_t, SourceDesc > >::iterator	itCtx = fCtxs.find(inContext);
 
 	if ( !testAssert(itCtx != fCtxs.end()) )
@@ -817,7 +992,7 @@ void VRemoteDebuggerBreakpointsManager::Set(OpaqueDebuggerContext inContext,cons
 				else
 				{
 					//same sourceID & same URL: replace the source code
-					(*itSource).second.fData = sourceCode;
+					(*itSource).second.fText = sourceText;
 				}
 			}
 		}
@@ -840,7 +1015,7 @@ here:
 
 			if ( itFile != fAllBreakPoints.end() )
 			{
-				SourceDesc		l_new(sourceCode);
+				SourceDesc		l_new(sourceText);
 				l_new.fUrl = outRelativePosixPath;
 				std::pair< std::map< uintptr_t, SourceDesc >::iterator, bool >	l_new_file =
 					(*itCtx).second.insert( std::pair< uintptr_t, SourceDesc >(inSourceId, l_new) );
@@ -854,7 +1029,7 @@ here:
 					fAllBreakPoints.insert( std::pair< XBOX::VString, std::set< unsigned > >(outRelativePosixPath, emptyLines) );
 			
 				xbox_assert(l_new_brkpts.second);
-				SourceDesc		l_new(sourceCode);
+				SourceDesc		l_new(sourceText);
 				l_new.fUrl = outRelativePosixPath;
 				std::pair< std::map< uintptr_t, SourceDesc >::iterator, bool >	l_new_file =
 					(*itCtx).second.insert( std::pair< uintptr_t,SourceDesc >(inSourceId, l_new) );
@@ -862,6 +1037,13 @@ here:
 			}
 
 		}
+
+		// a source with breakpoints has been added or a source which had breakpoints has been replaced
+		if ( _HasBreakpoints(outRelativePosixPath)
+			|| ( (fSnapshot != NULL) && (fSnapshot->fSources.count(VBreakpointsSnapshot::SourceKey(inContext, inSourceId)) > 0) ) )
+		{
+			_PublishSnapshot();
+		}
 	}
 	fLock.Unlock();
 }
@@ -888,6 +1070,13 @@ void VRemoteDebuggerBreakpointsManager::Remove(OpaqueDebuggerContext inContext)
 
 	if ( itCtx != fCtxs.end() )
 	{
+		// the context address may be reused by a next context, its sources must leave the snapshot
+		bool	hadBreakpoints = false;
+		for (std::map< uintptr_t, SourceDesc >::iterator itSrc = (*itCtx).second.begin(); itSrc != (*itCtx).second.end() && !hadBreakpoints; itSrc++)
+		{
+			hadBreakpoints = _HasBreakpoints((*itSrc).second.fUrl);
+		}
+
 		std::map< uintptr_t, SourceDesc >::iterator	itSource = (*itCtx).second.begin();
 
 		if (itSource != (*itCtx).second.end())
@@ -913,6 +1102,12 @@ void VRemoteDebuggerBreakpointsManager::Remove(OpaqueDebuggerContext inContext)
 			itSource++;
 		}*/
 		fCtxs.erase(itCtx);
+		_PurgeSourceTexts();
+
+		if (hadBreakpoints)
+		{
+			_PublishSnapshot();
+		}
 	}
 	fLock.Unlock();
 }
@@ -975,6 +1170,7 @@ bool VRemoteDebuggerBreakpointsManager::RemoveBreakPoint(OpaqueDebuggerContext i
 				{
 					(*itFile).second.erase(itLine);
 					IncrementGlobalTimeStamp();
+					_PublishSnapshot();
 					l_res = true;
 				}
 			}
@@ -995,6 +1191,7 @@ bool VRemoteDebuggerBreakpointsManager::RemoveAllBreakPoints( const XBOX::VStrin
 	{
 		(*itFile).second.clear();
 		IncrementGlobalTimeStamp();
+		_PublishSnapshot();
 	}
 
 	fLock.Unlock();
@@ -1018,6 +1215,7 @@ bool VRemoteDebuggerBreakpointsManager::RemoveBreakPoint( const XBOX::VString& i
 			{
 				(*itFile).second.erase(itLine);
 				IncrementGlobalTimeStamp();
+				_PublishSnapshot();
 			}
 			//break;
 		}
@@ -31,6 +31,18 @@ class VRemoteDebuggerBreakpointsManager : public XBOX::VObject
 {
 
 public:
+	/** @brief	Immutable source text split in JSON escaped lines. The texts are shared by all the contexts which load the same source. */
+	class VSourceText : public XBOX::VObject, public XBOX::IRefCountable {
+	public:
+		VSourceText(const XBOX::VString& inSource, const XBOX::VectorOfVString& inLines) : fSource(inSource), fLines(inLines) {;}
+		const XBOX::VString&			GetSource() const { return fSource; }
+		const XBOX::VectorOfVString&	GetLines() const { return fLines; }
+	private:
+		~VSourceText() {;}
+		const XBOX::VString				fSource;	// the source code is kept to tell apart the texts whose keys collide
+		const XBOX::VectorOfVString		fLines;
+	};
+
 	class VFileBreakpoints : public XBOX::VObject {
 	public:
 		VFileBreakpoints(const XBOX::VString& inUrl = XBOX::VString("") ) : fUrl(inUrl) {;}
@@ -64,6 +76,8 @@ public:
 	virtual void		GetJSONBreakpoints(XBOX::VString& outJSONBreakPoints);
 	virtual void		GetAllJSFileNames(XBOX::VectorOfVString& outFileNameVector);
 	virtual	void		GetSourceFromUrl(OpaqueDebuggerContext inContext, const XBOX::VString& inSourceUrl,XBOX::VectorOfVString& outSourceData);
+			/** @brief	Same as GetData() without copying the source lines, the returned text must be released */
+			const VSourceText*	RetainSourceText(OpaqueDebuggerContext inContext,intptr_t inSourceId, XBOX::VString& outSourceUrl);
 #if WITH_SANDBOXED_PROJECT
 			void		SetBreakpointsFolderPath( const XBOX::VFilePath& inPath);
 #endif
@@ -73,23 +87,73 @@ public:
 private:
 	class SourceDesc {
 	public:
-		SourceDesc(const XBOX::VectorOfVString& inData) { fData = inData; fNbRef = 1; }
+		SourceDesc(VSourceText* inText) : fText(inText) { fNbRef = 1; }
 		~SourceDesc() {;}
-		XBOX::VectorOfVString	fData;
-		XBOX::VString			fUrl;
-		unsigned int			fNbRef;
+		XBOX::VRefPtr< VSourceText >	fText;
+		XBOX::VString					fUrl;
+		unsigned int					fNbRef;
 	private:
 		SourceDesc();
 	};
 
+	/** @brief	Texts are keyed by the hash and the length of the source code, the texts whose keys collide are compared on lookup */
+	typedef std::pair< uLONG8, XBOX::VIndex >									SourceTextKey;
+	typedef std::multimap< SourceTextKey, XBOX::VRefPtr< VSourceText > >		MapOfSourceTexts;
+
+			/** @brief	Returns the shared text matching the source code, fLock must be held */
+			VSourceText*	_RetainSourceText( const SourceTextKey& inKey, const XBOX::VString& inSource) const;
+			/** @brief	Releases the texts which are no longer used by any context, fLock must be held */
+			void			_PurgeSourceTexts();
+
 			void	GetJSFileNamesFromDirectory(XBOX::VectorOfVString&	ioFileNameVector,
 												VProjectItem*			inProjectItem);
 
+	/** @brief	Immutable lookup table of the breakpoints: each source which has breakpoints refers to the bitmap of its url (bit n is set if line n has a breakpoint).
+				It is rebuilt under fLock when the breakpoints or the sources change and read by HasBreakpoint() without any lock. */
+	class VBreakpointsSnapshot {
+	public:
+		typedef std::pair< OpaqueDebuggerContext, uintptr_t >	SourceKey;
+		struct SourceKeyHash {
+			size_t operator()( const SourceKey& inKey) const { return std::hash< void* >()(inKey.first) ^ (std::hash< uintptr_t >()(inKey.second) * 31); }
+		};
+		std::unordered_map< SourceKey, size_t, SourceKeyHash >	fSources;	// index of the bitmap in fBitmaps
+		std::vector< std::vector< uLONG > >						fBitmaps;
+	};
+
+	enum { kREADER_SHARD_COUNT = 16 };
+
+	/** @brief	Count of HasBreakpoint() calls in progress, spread over several cache lines to limit the contention between the JavaScript tasks */
+	typedef struct {
+		sLONG		fCount;
+		char		fPadding[64 - sizeof(sLONG)];
+	} sReaderCount;
+
+	/** @brief	A replaced snapshot, tagged with the reader epoch during which it was replaced */
+	typedef struct {
+		VBreakpointsSnapshot*	fSnapshot;
+		sLONG					fEpoch;
+	} sRetiredSnapshot;
+
+			/** @brief	Rebuilds and publishes the snapshot, fLock must be held */
+			void	_PublishSnapshot();
+			/** @brief	Advances the reader epoch if possible and deletes the retired snapshots which no reader may still use, fLock must be held */
+			void	_ReclaimSnapshots();
+			/** @brief	Returns true if no reader is registered with the epoch parity */
+			bool	_HasNoReader( sLONG inParity) const;
+			/** @brief	Returns true if the source url has breakpoints, fLock must be held */
+			bool	_HasBreakpoints( const XBOX::VString& inUrl) const;
+
 			std::map< OpaqueDebuggerContext, std::map< uintptr_t, SourceDesc > >	fCtxs;
 			VSolution*																fSolution;	
 			XBOX::VString															fSourcesRoot;
 			std::map< XBOX::VString, std::set< unsigned > >							fAllBreakPoints;
 			XBOX::VCriticalSection													fLock;
+			VBreakpointsSnapshot * volatile											fSnapshot;			// NULL if there is no breakpoint
+			std::vector< sRetiredSnapshot >											fRetiredSnapshots;	// replaced snapshots which readers may still use
+			sLONG																	fRetiredCount;		// size of fRetiredSnapshots, read by the readers without lock
+			MapOfSourceTexts														fSourceTexts;		// content-addressed store of the source texts
+			sLONG																	fEpoch;				// the readers register with the parity of the epoch
+			sReaderCount															fReaders[2][kREADER_SHARD_COUNT];
 		#if WITH_SANDBOXED_PROJECT
 			XBOX::VFilePath															fBreakpointsFolderPath;
 		#endif
@@ -426,6 +426,21 @@
 		
 	}
 	
+	// Return the full paths of the loaded ".js" and ".json" files.
+	// Used by the server to detect the changes of the files required by a module.
+	
+	requireFunction.getLoadedFiles = function () {
+	
+		var	files	= [];
+		
+		for (var uniqueId in loadedModules)
+		
+			files.push(uniqueId);
+		
+		return files;
+	
+	}
+	
 	return requireFunction;
 
 }).call();	
\ No newline at end of file
@@ -350,6 +350,137 @@ function getCatalog(params) {
     return JSON.stringify(oSignature);
 }
 
+/**
+ * Check whether a JSON-RPC call is a notification: a JSON-RPC 2.0 request without id,
+ * which is executed but which must not be replied to
+ * @method isNotification
+ * @param {Object} jsonObj the JSON-RPC call
+ * @return {Boolean} true if the call is a notification
+ */
+function isNotification(jsonObj) {
+    return (jsonObj !== null) && (typeof jsonObj === 'object') && (jsonObj.jsonrpc === '2.0') && !jsonObj.hasOwnProperty('id');
+}
+
+/**
+ * Execute a JSON-RPC call
+ * @method doCall
+ * @param {Object} jsonObj the JSON-RPC call
+ * @param {String} type type of the message
+ * @param {String} body the raw body of the request
+ * @return {Object} the JSON-RPC message and the HTTP status code of the call
+ */
+function doCall(jsonObj, type, body) {
+    var result = null,
+    errorCode = null,
+    version = '2.0',
+    errorMessage = null,
+    errorInfo = null,
+    tempErrorInfo = null,
+    statusCode = 200,
+    message = null;
+
+    jsonObj = jsonObj || {};
+
+    try {
+        if (((typeof jsonObj.id === "object") && (jsonObj.id !== null)) || (typeof jsonObj.id === "function")) {
+            errorCode = -32600;
+            errorMessage = 'invalid request id type (' + typeof jsonObj.id + ' instead of number, string, boolean or undefined)';
+            statusCode = 400;
+        } else if (jsonObj.method.keys) {
+            result = WAF.rpc.execute(jsonObj.method.keys, jsonObj.params, jsonObj.method.source);
+            version = jsonObj.jsonrpc;
+        } else {
+            result = WAF.rpc.call(jsonObj.module, jsonObj.method, jsonObj.params || []);
+            version = jsonObj.jsonrpc;
+        }
+
+    } catch (error) {
+        errorInfo = JSON.stringify(error);
+        tempErrorInfo = error;
+
+        if (error instanceof RangeError) {
+            errorCode = -32602;
+            errorMessage = 'Invalid params';
+            statusCode = 500;
+        } else {
+            errorCode = -32603;
+            errorMessage = 'Internal error while handling ' + body;
+            if (errorInfo.indexOf('failed permission') !== -1) {
+                statusCode = 401;
+            } else {
+                statusCode = 500;
+            }
+        }
+    }
+
+    message = WAF.rpc.MessageFactory.createMessage({
+        'messageType': type,
+        'version': version,
+        'id': jsonObj.id,
+        'result': result,
+        'errorCode': errorCode,
+        'errorMessage': errorMessage,
+        'errorInfo': tempErrorInfo
+    });
+
+    return {
+        'message': message,
+        'statusCode': statusCode
+    };
+}
+
+/**
+ * Execute a JSON-RPC 2.0 batch: all the calls are executed in the same context
+ * and the results array is streamed back as the calls complete.
+ * The notifications are not replied to: if the batch only contains notifications, nothing is returned
+ * @method doBatchRequest
+ * @param {Array} calls the JSON-RPC calls
+ * @param request the request send to the server
+ * @param response the response
+ * @param {String} type type of the message
+ */
+function doBatchRequest(calls, request, response, type) {
+    var i = 0,
+    start = 0,
+    call = null,
+    chunk = '',
+    replied = false;
+
+    if (calls.length === 0) {
+        response.statusCode = 400;
+        return JSON.stringify(WAF.rpc.MessageFactory.createMessage({
+            'messageType': type,
+            'id': null,
+            'errorCode': -32600,
+            'errorMessage': 'Invalid Request'
+        }));
+    }
+
+    for (i = 0; i < calls.length; i += 1) {
+        start = new Date().getTime();
+        call = doCall(calls[i], type, JSON.stringify(calls[i]));
+
+        if (isNotification(calls[i])) {
+            continue;
+        }
+
+        // per call execution time in milliseconds
+        call.message.duration = new Date().getTime() - start;
+
+        // each result is sent as soon as it is available
+        chunk = (replied ? ',' : '[') + JSON.stringify(call.message);
+        response.sendChunkedData(chunk);
+        replied = true;
+    }
+
+    if (replied) {
+        response.sendChunkedData(']');
+    } else {
+        response.statusCode = 204;
+        return '';
+    }
+}
+
 /**
  * Get the request
  * @method doRequest
@@ -359,11 +490,7 @@ function getCatalog(params) {
 function doRequest(request, response) {
     var message = '',
     jsonObj = {},
-    result = null,
-    errorCode = null,
-    version = '2.0',
-    errorMessage = null,
-    errorInfo = null,
+    call = null,
     type = null;
 
     /**
@@ -396,76 +523,30 @@ function doRequest(request, response) {
         return type;
     }
 
-    /**
-     * Check the return type
-     * @method checkReturnType
-     * @param functionName the function name
-     * @param returnValue the result of the function name
-     */
-    function checkReturnType(functionName, returnValue) {
-        var description = null;
-
-        getCatalog();
-        description = WAF.rpc.serviceDescription[functionName];
-        if (description) {
-            if ((typeof returnValue !== description.returns) && (typeof description.returns !== 'undefined')) {
-                errorCode = -32602;
-                errorMessage = 'invalid return type (' + typeof returnValue + ' instead of ' + description.returns + ')';
-                response.statusCode = 500;
-            }
-        }
-    }
+    type = getType(request.headers['Content-Type']);
+    response.headers['Content-Type'] = getFullType(request.headers['Content-Type']);
 
     try {
         jsonObj = JSON.parse(request.body);
-
-        if (((typeof jsonObj.id === "object") && (jsonObj.id !== null)) || (typeof jsonObj.id === "function")) {
-            errorCode = -32600;
-            errorMessage = 'invalid request id type (' + typeof jsonObj.id + ' instead of number, string, boolean or undefined)';
-            response.statusCode = 400;
-        } else if (jsonObj.method.keys) {
-            result = WAF.rpc.execute(jsonObj.method.keys, jsonObj.params, jsonObj.method.source);
-            version = jsonObj.jsonrpc;
-        } else {
-            result = WAF.rpc.call(jsonObj.module, jsonObj.method, jsonObj.params || []);
-            version = jsonObj.jsonrpc;
-        }
-
     } catch (error) {
-        errorInfo = JSON.stringify(error);
-        var tempErrorInfo = error;
-
-        if (error instanceof RangeError) {
-            errorCode = -32602;
-            errorMessage = 'Invalid params';
-            response.statusCode = 500;
-        } else {
-            errorCode = -32603;
-            errorMessage = 'Internal error while handling ' + request.body;
-            if (errorInfo.indexOf('failed permission') !== -1) {
-                response.statusCode = 401;
-            } else {
-                response.statusCode = 500;
-            }
-        }
+        jsonObj = null;
     }
 
-    //checkReturnType(jsonObj.method, result);
+    if (jsonObj instanceof Array) {
+        return doBatchRequest(jsonObj, request, response, type);
+    }
 
-    type = getType(request.headers['Content-Type']);
+    call = doCall(jsonObj, type, request.body);
 
-    message = WAF.rpc.MessageFactory.createMessage({
-        'messageType': type,
-        'version': version,
-        'id': jsonObj.id,
-        'result': result,
-        'errorCode': errorCode,
-        'errorMessage': errorMessage,
-        'errorInfo': tempErrorInfo
-    });
+    if (isNotification(jsonObj)) {
+        response.statusCode = 204;
+        return '';
+    }
 
-    response.headers['Content-Type'] = getFullType(request.headers['Content-Type']);
+    if (call.statusCode !== 200) {
+        response.statusCode = call.statusCode;
+    }
 
-    message = JSON.stringify(message);
+    message = JSON.stringify(call.message);
     return message;
-}
\ No newline at end of file
+}